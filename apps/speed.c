@@ -251,6 +251,12 @@ static double Time_F(int s)
 
 static void multiblock_speed(const EVP_CIPHER *evp_cipher, int lengths_single,
                              const openssl_speed_sec_t *seconds);
+#ifndef OPENSSL_NO_EC
+static void ecdsa_batch_speed(const char *curve, int nid, unsigned int bits,
+                              const openssl_speed_sec_t *seconds);
+static void ec_msm_speed(const char *curve, int nid, unsigned int bits,
+                         const openssl_speed_sec_t *seconds);
+#endif
 
 static int opt_found(const char *name, unsigned int *result,
                      const OPT_PAIR pairs[], unsigned int nbelem)
@@ -271,7 +277,8 @@ typedef enum OPTION_choice {
     OPT_ERR = -1, OPT_EOF = 0, OPT_HELP,
     OPT_ELAPSED, OPT_EVP, OPT_HMAC, OPT_DECRYPT, OPT_ENGINE, OPT_MULTI,
     OPT_MR, OPT_MB, OPT_MISALIGN, OPT_ASYNCJOBS, OPT_R_ENUM, OPT_PROV_ENUM,
-    OPT_PRIMES, OPT_SECONDS, OPT_BYTES, OPT_AEAD, OPT_CMAC
+    OPT_PRIMES, OPT_SECONDS, OPT_BYTES, OPT_AEAD, OPT_CMAC, OPT_BATCH,
+    OPT_MSM
 } OPTION_CHOICE;
 
 const OPTIONS speed_options[] = {
@@ -306,6 +313,12 @@ const OPTIONS speed_options[] = {
      "Time decryption instead of encryption (only EVP)"},
     {"aead", OPT_AEAD, '-',
      "Benchmark EVP-named AEAD cipher in TLS-like sequence"},
+#ifndef OPENSSL_NO_EC
+    {"batch", OPT_BATCH, '-',
+     "Benchmark ECDSA signing in batches of 1 to 64 signatures"},
+    {"msm", OPT_MSM, '-',
+     "Benchmark EC multi-scalar multiplication of 2 to 4096 points"},
+#endif
 
     OPT_SECTION("Timing"),
     {"elapsed", OPT_ELAPSED, '-',
@@ -1695,6 +1708,7 @@ int speed_main(int argc, char **argv)
     uint8_t sm2_doit[SM2_NUM] = { 0 };
 # endif
     uint8_t ecdsa_doit[ECDSA_NUM] = { 0 };
+    int ecdsa_batch = 0, ec_msm = 0;
     uint8_t ecdh_doit[EC_NUM] = { 0 };
     uint8_t eddsa_doit[EdDSA_NUM] = { 0 };
 
@@ -1847,6 +1861,16 @@ int speed_main(int argc, char **argv)
         case OPT_AEAD:
             aead = 1;
             break;
+        case OPT_BATCH:
+#ifndef OPENSSL_NO_EC
+            ecdsa_batch = 1;
+#endif
+            break;
+        case OPT_MSM:
+#ifndef OPENSSL_NO_EC
+            ec_msm = 1;
+#endif
+            break;
         }
     }
 
@@ -1992,6 +2016,26 @@ int speed_main(int argc, char **argv)
             goto end;
         }
     }
+#ifndef OPENSSL_NO_EC
+    if (ecdsa_batch && async_jobs > 0) {
+        BIO_printf(bio_err, "Async mode is not supported with -batch\n");
+        goto end;
+    }
+    if (ec_msm && async_jobs > 0) {
+        BIO_printf(bio_err, "Async mode is not supported with -msm\n");
+        goto end;
+    }
+# ifndef NO_FORK
+    if (ecdsa_batch && multi) {
+        BIO_printf(bio_err, "-multi is not supported with -batch\n");
+        goto end;
+    }
+    if (ec_msm && multi) {
+        BIO_printf(bio_err, "-multi is not supported with -msm\n");
+        goto end;
+    }
+# endif
+#endif
 
     /* Initialize the job pool if async mode is enabled */
     if (async_jobs > 0) {
@@ -2427,6 +2471,48 @@ int speed_main(int argc, char **argv)
     signal(SIGALRM, alarmed);
 #endif                          /* SIGALRM */
 
+#ifndef OPENSSL_NO_EC
+    /*
+     * Batch signing is measured on its own.  Unless curves were named, it is
+     * done for the two curves that have a dedicated implementation.
+     */
+    if (ecdsa_batch) {
+        for (testnum = 0; testnum < ECDSA_NUM; testnum++) {
+            if (ecdsa_doit[testnum] == 2
+                || (ecdsa_doit[testnum] == 1
+                    && (testnum == R_EC_P256 || testnum == R_EC_P384)))
+                ecdsa_batch_speed(ec_curves[testnum].name,
+                                  ec_curves[testnum].nid,
+                                  ec_curves[testnum].bits, &seconds);
+        }
+        ret = 0;
+        goto end;
+    }
+
+    /*
+     * Multi-scalar multiplication is measured on its own as well.  Unless
+     * curves were named, it is done for P-256 and secp256k1.
+     */
+    if (ec_msm) {
+        int named = 0;
+
+        for (testnum = 0; testnum < ECDSA_NUM; testnum++) {
+            if (ecdsa_doit[testnum] == 2) {
+                named = 1;
+                ec_msm_speed(ec_curves[testnum].name, ec_curves[testnum].nid,
+                             ec_curves[testnum].bits, &seconds);
+            }
+        }
+        if (!named) {
+            ec_msm_speed(ec_curves[R_EC_P256].name, ec_curves[R_EC_P256].nid,
+                         ec_curves[R_EC_P256].bits, &seconds);
+            ec_msm_speed("secp256k1", NID_secp256k1, 256, &seconds);
+        }
+        ret = 0;
+        goto end;
+    }
+#endif
+
 #if !defined(OPENSSL_NO_MD2) && !defined(OPENSSL_NO_DEPRECATED_3_0)
     if (doit[D_MD2]) {
         for (testnum = 0; testnum < size_num; testnum++) {
@@ -3300,28 +3386,16 @@ int speed_main(int argc, char **argv)
              * If this fails we try creating a EVP_PKEY_EC generic param ctx,
              * then we set the curve by NID before deriving the actual keygen
              * ctx for that specific curve. */
+            ERR_set_mark();
             kctx = EVP_PKEY_CTX_new_id(ec_curves[testnum].nid, NULL); /* keygen ctx from NID */
             if (!kctx) {
                 EVP_PKEY_CTX *pctx = NULL;
                 EVP_PKEY *params = NULL;
 
-                /* If we reach this code EVP_PKEY_CTX_new_id() failed and a
-                 * "int_ctx_new:unsupported algorithm" error was added to the
-                 * error queue.
-                 * We remove it from the error queue as we are handling it. */
-                unsigned long error = ERR_peek_error(); /* peek the latest error in the queue */
-                if (error == ERR_peek_last_error() && /* oldest and latest errors match */
-                    /* check that the error origin matches */
-                    ERR_GET_LIB(error) == ERR_LIB_EVP &&
-                    ERR_GET_REASON(error) == EVP_R_UNSUPPORTED_ALGORITHM)
-                    ERR_get_error(); /* pop error from queue */
-                if (ERR_peek_error()) {
-                    BIO_printf(bio_err,
-                               "Unhandled error in the error queue during ECDH init.\n");
-                    ERR_print_errors(bio_err);
-                    op_count = 1;
-                    break;
-                }
+                /* If we reach this code EVP_PKEY_CTX_new_id() failed and
+                 * left "unsupported" errors on the error queue.
+                 * We remove them from the error queue as we are handling it. */
+                ERR_pop_to_mark();
 
                 /* Create the context for parameter generation */
                 if (!(pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL)) ||
@@ -3346,6 +3420,8 @@ int speed_main(int argc, char **argv)
                 params = NULL;
                 EVP_PKEY_CTX_free(pctx);
                 pctx = NULL;
+            } else {
+                ERR_clear_last_mark();
             }
             if (kctx == NULL ||      /* keygen ctx is not null */
                 EVP_PKEY_keygen_init(kctx) <= 0/* init keygen ctx */ ) {
@@ -4511,3 +4587,179 @@ static void multiblock_speed(const EVP_CIPHER *evp_cipher, int lengths_single,
     OPENSSL_free(out);
     EVP_CIPHER_CTX_free(ctx);
 }
+
+#ifndef OPENSSL_NO_EC
+static void ecdsa_batch_speed(const char *curve, int nid, unsigned int bits,
+                              const openssl_speed_sec_t *seconds)
+{
+    static const int batch_sizes[] = { 1, 2, 4, 8, 16, 32, 64 };
+    unsigned char dgst[32], *sigs[64];
+    const unsigned char *tbs[64];
+    size_t siglens[64], tbslens[64], sigsize;
+    double batch_results[OSSL_NELEM(batch_sizes)], d;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY *pkey = NULL;
+    char name[64];
+    int j, k, n, count;
+
+    memset(sigs, 0, sizeof(sigs));
+    memset(dgst, 0, sizeof(dgst));
+    for (k = 0; k < (int)OSSL_NELEM(sigs); k++) {
+        tbs[k] = dgst;
+        tbslens[k] = sizeof(dgst);
+    }
+
+    if ((ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL)) == NULL
+        || EVP_PKEY_keygen_init(ctx) <= 0
+        || EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, nid) <= 0
+        || EVP_PKEY_keygen(ctx, &pkey) <= 0)
+        goto err;
+    EVP_PKEY_CTX_free(ctx);
+    if ((ctx = EVP_PKEY_CTX_new(pkey, NULL)) == NULL
+        || EVP_PKEY_sign_init(ctx) <= 0
+        || EVP_PKEY_sign_batch(ctx, OSSL_NELEM(sigs), NULL, siglens,
+                               tbs, tbslens) <= 0)
+        goto err;
+    sigsize = siglens[0];
+    for (k = 0; k < (int)OSSL_NELEM(sigs); k++)
+        sigs[k] = app_malloc(sigsize, "ECDSA signature");
+
+    for (j = 0; j < (int)OSSL_NELEM(batch_sizes); j++) {
+        n = batch_sizes[j];
+        BIO_snprintf(name, sizeof(name), "ecdsa batch(%d)", n);
+        pkey_print_message("sign", name, 0, bits, seconds->ecdsa);
+        Time_F(START);
+        for (count = 0; run && count < 0x7fffffff; count += n) {
+            for (k = 0; k < n; k++)
+                siglens[k] = sigsize;
+            if (EVP_PKEY_sign_batch(ctx, n, sigs, siglens, tbs, tbslens) <= 0)
+                goto err;
+        }
+        d = Time_F(STOP);
+        BIO_printf(bio_err, mr ? "+R14:%d:%u:%d:%.2f\n"
+                   : "%d %u bits ECDSA signs in batches of %d in %.2fs\n",
+                   count, bits, n, d);
+        batch_results[j] = ((double)count) / d;
+    }
+
+    if (mr) {
+        fprintf(stdout, "+H");
+        for (j = 0; j < (int)OSSL_NELEM(batch_sizes); j++)
+            fprintf(stdout, ":%d", batch_sizes[j]);
+        fprintf(stdout, "\n");
+        fprintf(stdout, "+F9:%u:%s", bits, curve);
+        for (j = 0; j < (int)OSSL_NELEM(batch_sizes); j++)
+            fprintf(stdout, ":%.1f", batch_results[j]);
+        fprintf(stdout, "\n");
+    } else {
+        fprintf(stdout, "%-30s", "sign/s, by batch size");
+        for (j = 0; j < (int)OSSL_NELEM(batch_sizes); j++)
+            fprintf(stdout, " %8d", batch_sizes[j]);
+        fprintf(stdout, "\n");
+        BIO_snprintf(name, sizeof(name), "%u bits ecdsa (%s)", bits, curve);
+        fprintf(stdout, "%-30s", name);
+        for (j = 0; j < (int)OSSL_NELEM(batch_sizes); j++)
+            fprintf(stdout, " %8.1f", batch_results[j]);
+        fprintf(stdout, "\n");
+    }
+    goto end;
+
+ err:
+    BIO_printf(bio_err, "ECDSA batch sign failure\n");
+    ERR_print_errors(bio_err);
+ end:
+    for (k = 0; k < (int)OSSL_NELEM(sigs); k++)
+        OPENSSL_free(sigs[k]);
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(pkey);
+}
+
+static void ec_msm_speed(const char *curve, int nid, unsigned int bits,
+                         const openssl_speed_sec_t *seconds)
+{
+    enum { MSM_MIN_LOG = 1, MSM_MAX_LOG = 12 };
+    const int maxnum = 1 << MSM_MAX_LOG;
+    double msm_results[MSM_MAX_LOG - MSM_MIN_LOG + 1], d;
+    EC_GROUP *group = NULL;
+    EC_POINT **points = NULL, *r = NULL;
+    BIGNUM **scalars = NULL, *x = NULL;
+    BN_CTX *ctx = NULL;
+    char name[64];
+    int j, k, n, count;
+
+    points = app_malloc(maxnum * sizeof(*points), "EC points");
+    scalars = app_malloc(maxnum * sizeof(*scalars), "EC scalars");
+    memset(points, 0, maxnum * sizeof(*points));
+    memset(scalars, 0, maxnum * sizeof(*scalars));
+
+    if ((ctx = BN_CTX_new()) == NULL
+        || (x = BN_new()) == NULL
+        || (group = EC_GROUP_new_by_curve_name(nid)) == NULL
+        || (r = EC_POINT_new(group)) == NULL)
+        goto err;
+    for (k = 0; k < maxnum; k++) {
+        if ((points[k] = EC_POINT_new(group)) == NULL
+            || (scalars[k] = BN_new()) == NULL
+            || !BN_rand_range(x, EC_GROUP_get0_order(group))
+            || !BN_rand_range(scalars[k], EC_GROUP_get0_order(group))
+            || !EC_POINT_mul(group, points[k], x, NULL, NULL, ctx))
+            goto err;
+    }
+
+    for (j = MSM_MIN_LOG; j <= MSM_MAX_LOG; j++) {
+        n = 1 << j;
+        BIO_snprintf(name, sizeof(name), "ec msm(%d)", n);
+        pkey_print_message("mul", name, 0, bits, seconds->ecdsa);
+        Time_F(START);
+        for (count = 0; run && count < 0x7fffffff; count++) {
+            if (!EC_POINT_msm(group, r, NULL, n,
+                              (const EC_POINT **)points,
+                              (const BIGNUM **)scalars, ctx))
+                goto err;
+        }
+        d = Time_F(STOP);
+        BIO_printf(bio_err, mr ? "+R13:%d:%u:%d:%.2f\n"
+                   : "%d %u bits EC multi-scalar muls of %d points in %.2fs\n",
+                   count, bits, n, d);
+        msm_results[j - MSM_MIN_LOG] = ((double)count) / d;
+    }
+
+    if (mr) {
+        fprintf(stdout, "+H");
+        for (j = MSM_MIN_LOG; j <= MSM_MAX_LOG; j++)
+            fprintf(stdout, ":%d", 1 << j);
+        fprintf(stdout, "\n");
+        fprintf(stdout, "+F10:%u:%s", bits, curve);
+        for (j = MSM_MIN_LOG; j <= MSM_MAX_LOG; j++)
+            fprintf(stdout, ":%.1f", msm_results[j - MSM_MIN_LOG]);
+        fprintf(stdout, "\n");
+    } else {
+        fprintf(stdout, "%-30s", "us/point, by number of points");
+        for (j = MSM_MIN_LOG; j <= MSM_MAX_LOG; j++)
+            fprintf(stdout, " %7d", 1 << j);
+        fprintf(stdout, "\n");
+        BIO_snprintf(name, sizeof(name), "%u bits ec msm (%s)", bits, curve);
+        fprintf(stdout, "%-30s", name);
+        for (j = MSM_MIN_LOG; j <= MSM_MAX_LOG; j++)
+            fprintf(stdout, " %7.2f",
+                    1e6 / (msm_results[j - MSM_MIN_LOG] * (1 << j)));
+        fprintf(stdout, "\n");
+    }
+    goto end;
+
+ err:
+    BIO_printf(bio_err, "EC multi-scalar multiplication failure\n");
+    ERR_print_errors(bio_err);
+ end:
+    for (k = 0; k < maxnum; k++) {
+        EC_POINT_free(points[k]);
+        BN_free(scalars[k]);
+    }
+    OPENSSL_free(points);
+    OPENSSL_free(scalars);
+    EC_POINT_free(r);
+    EC_GROUP_free(group);
+    BN_free(x);
+    BN_CTX_free(ctx);
+}
+#endif
@@ -0,0 +1,653 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "apps.h"
+#include "progs.h"
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#ifndef OPENSSL_NO_OCSP
+# include <openssl/ocsp.h>
+#endif
+
+#if defined(OPENSSL_THREADS)
+# if defined(OPENSSL_SYS_WINDOWS)
+#  include <windows.h>
+# else
+#  include <pthread.h>
+# endif
+#endif
+
+#define MAX_THREADS     256
+
+typedef enum OPTION_choice {
+    OPT_ERR = -1, OPT_EOF = 0, OPT_HELP,
+    OPT_SECONDS, OPT_THREADS, OPT_MR, OPT_IN, OPT_KEYALG,
+    OPT_STORE_SIZE, OPT_CRL_SIZE, OPT_CACHE,
+    OPT_PROV_ENUM
+} OPTION_CHOICE;
+
+const OPTIONS x509bench_options[] = {
+    {OPT_HELP_STR, 1, '-', "Usage: %s [options] [test...]\n"},
+
+    OPT_SECTION("General"),
+    {"help", OPT_HELP, '-', "Display this summary"},
+    {"seconds", OPT_SECONDS, 'p', "Run each test for num seconds"},
+    {"threads", OPT_THREADS, 'p', "Run each test in num threads"},
+    {"mr", OPT_MR, '-', "Produce machine readable output"},
+
+    OPT_SECTION("Corpus"),
+    {"in", OPT_IN, '<', "Certificates to parse instead of the generated ones"},
+    {"keyalg", OPT_KEYALG, 's',
+     "Key algorithm of the generated certificates (default EC)"},
+    {"store_size", OPT_STORE_SIZE, 'n',
+     "Number of additional trust anchors in the store (default 100)"},
+    {"crl_size", OPT_CRL_SIZE, 'p',
+     "Number of revoked certificates in the CRL (default 1000)"},
+    {"cache", OPT_CACHE, 'n',
+     "Enable the store verification cache with the given capacity"},
+
+    OPT_PROV_OPTIONS,
+
+    OPT_PARAMETERS(),
+    {"test", 0, 0, "Tests to run: parse, verify, crl, ocsp (default all)"},
+    {NULL}
+};
+
+/* The data shared by all threads */
+typedef struct bench_st {
+    unsigned char **der;
+    long *derlen;
+    int nder;
+    X509_STORE *store;
+    X509 *leaf;
+    STACK_OF(X509) *untrusted;
+    X509_CRL *crl;
+    ASN1_INTEGER **serials;
+    int nserials;
+#ifndef OPENSSL_NO_OCSP
+    OCSP_BASICRESP *bs;
+#endif
+} BENCH;
+
+typedef int (*bench_op_fn)(BENCH *bench, X509_STORE_CTX *ctx, long i);
+
+typedef struct bench_thread_st {
+    BENCH *bench;
+    bench_op_fn op;
+    long start;
+    time_t end;
+    volatile int *stop;     /* Shared by all threads, set to end early */
+    long count;
+    int failed;
+} BENCH_THREAD;
+
+static int op_parse(BENCH *bench, X509_STORE_CTX *ctx, long i)
+{
+    const unsigned char *p = bench->der[i % bench->nder];
+    X509 *x = d2i_X509(NULL, &p, bench->derlen[i % bench->nder]);
+
+    X509_free(x);
+    return x != NULL;
+}
+
+static int op_verify(BENCH *bench, X509_STORE_CTX *ctx, long i)
+{
+    int ret = X509_STORE_CTX_init(ctx, bench->store, bench->leaf,
+                                  bench->untrusted)
+              && X509_verify_cert(ctx) > 0;
+
+    X509_STORE_CTX_cleanup(ctx);
+    return ret;
+}
+
+static int op_crl(BENCH *bench, X509_STORE_CTX *ctx, long i)
+{
+    X509_REVOKED *rev = NULL;
+    int revoked = X509_CRL_get0_by_serial(bench->crl, &rev,
+                                          bench->serials[i % bench->nserials]);
+
+    /* Every other serial number is revoked */
+    return (revoked != 0) == ((i % bench->nserials) % 2 == 0);
+}
+
+#ifndef OPENSSL_NO_OCSP
+static int op_ocsp(BENCH *bench, X509_STORE_CTX *ctx, long i)
+{
+    return OCSP_basic_verify(bench->bs, NULL, bench->store, 0) > 0;
+}
+#endif
+
+static const struct {
+    const char *name;
+    bench_op_fn op;
+    const char *unit;
+} tests[] = {
+    {"parse", op_parse, "certificates"},
+    {"verify", op_verify, "chains"},
+    {"crl", op_crl, "lookups"},
+#ifndef OPENSSL_NO_OCSP
+    {"ocsp", op_ocsp, "responses"},
+#endif
+};
+
+static void bench_worker(BENCH_THREAD *t)
+{
+    X509_STORE_CTX *ctx = X509_STORE_CTX_new_ex(app_get0_libctx(),
+                                                app_get0_propq());
+    long i;
+
+    if (ctx == NULL) {
+        t->failed = 1;
+        *t->stop = 1;
+        return;
+    }
+    for (i = 0; !*t->stop && time(NULL) < t->end; i++) {
+        if (!t->op(t->bench, ctx, t->start + i)) {
+            t->failed = 1;
+            *t->stop = 1;
+            break;
+        }
+    }
+    t->count = i;
+    X509_STORE_CTX_free(ctx);
+}
+
+#if defined(OPENSSL_THREADS)
+# if defined(OPENSSL_SYS_WINDOWS)
+
+typedef HANDLE bench_thread_t;
+
+static DWORD WINAPI bench_thread_run(LPVOID arg)
+{
+    bench_worker(arg);
+    return 0;
+}
+
+static int bench_thread_start(bench_thread_t *t, BENCH_THREAD *arg)
+{
+    *t = CreateThread(NULL, 0, bench_thread_run, arg, 0, NULL);
+    return *t != NULL;
+}
+
+static int bench_thread_join(bench_thread_t t)
+{
+    int ret = WaitForSingleObject(t, INFINITE) == WAIT_OBJECT_0;
+
+    CloseHandle(t);
+    return ret;
+}
+
+# else
+
+typedef pthread_t bench_thread_t;
+
+static void *bench_thread_run(void *arg)
+{
+    bench_worker(arg);
+    return NULL;
+}
+
+static int bench_thread_start(bench_thread_t *t, BENCH_THREAD *arg)
+{
+    return pthread_create(t, NULL, bench_thread_run, arg) == 0;
+}
+
+static int bench_thread_join(bench_thread_t t)
+{
+    return pthread_join(t, NULL) == 0;
+}
+
+# endif
+#endif
+
+/*
+ * Run |op| in |nthreads| threads for |seconds| seconds, the calling thread
+ * being one of them.  Returns the total number of operations, or -1 if one
+ * of them failed or a thread could not be started, in which case all the
+ * threads stop early.
+ */
+static long run_test(BENCH *bench, bench_op_fn op, int nthreads, int seconds,
+                     double *elapsed)
+{
+    BENCH_THREAD t[MAX_THREADS];
+#if defined(OPENSSL_THREADS)
+    bench_thread_t tid[MAX_THREADS];
+#endif
+    int i, started = 1, failed = 0;
+    volatile int stop = 0;
+    long count = 0;
+    time_t end;
+
+    memset(t, 0, sizeof(t));
+    /* Start on a second boundary so that the test runs for |seconds| */
+    for (end = time(NULL); time(NULL) == end; )
+        continue;
+    app_tminterval(TM_START, 0);
+    end = time(NULL) + seconds;
+    for (i = 0; i < nthreads; i++) {
+        t[i].bench = bench;
+        t[i].op = op;
+        t[i].start = (long)i * 7919;
+        t[i].end = end;
+        t[i].stop = &stop;
+    }
+#if defined(OPENSSL_THREADS)
+    for (; started < nthreads; started++)
+        if (!bench_thread_start(&tid[started], &t[started])) {
+            BIO_printf(bio_err, "Unable to start thread %d\n", started);
+            stop = 1;
+            failed = 1;
+            break;
+        }
+#endif
+    bench_worker(&t[0]);
+#if defined(OPENSSL_THREADS)
+    for (i = 1; i < started; i++)
+        if (!bench_thread_join(tid[i]))
+            failed = 1;
+#endif
+    *elapsed = app_tminterval(TM_STOP, 0);
+
+    for (i = 0; i < started; i++) {
+        failed |= t[i].failed;
+        count += t[i].count;
+    }
+    return failed ? -1 : count;
+}
+
+static EVP_PKEY *gen_key(const char *keyalg)
+{
+    EVP_PKEY_CTX *pctx;
+    EVP_PKEY *pkey = NULL;
+
+    pctx = EVP_PKEY_CTX_new_from_name(app_get0_libctx(), keyalg,
+                                      app_get0_propq());
+    if (pctx == NULL
+            || EVP_PKEY_keygen_init(pctx) <= 0
+            || (strcasecmp(keyalg, "EC") == 0
+                && EVP_PKEY_CTX_set_group_name(pctx, "P-256") <= 0)
+            || EVP_PKEY_keygen(pctx, &pkey) <= 0)
+        BIO_printf(bio_err, "Unable to generate a %s key\n", keyalg);
+    EVP_PKEY_CTX_free(pctx);
+    return pkey;
+}
+
+static int add_ext(X509 *x, X509V3_CTX *ext_ctx, int nid, const char *value)
+{
+    X509_EXTENSION *ext = X509V3_EXT_nconf_nid(NULL, ext_ctx, nid, value);
+    int ret = ext != NULL && X509_add_ext(x, ext, -1);
+
+    X509_EXTENSION_free(ext);
+    return ret;
+}
+
+/*
+ * Make a certificate for |pkey| named |cn|, issued by |issuer| (or
+ * self-signed if NULL) and signed with |signkey|.  The result is encoded and
+ * decoded again, so that it is in the same state as a certificate read from
+ * a file or the network.
+ */
+static X509 *make_cert(const char *cn, long serial, EVP_PKEY *pkey,
+                       X509 *issuer, EVP_PKEY *signkey, int ca)
+{
+    X509 *x = X509_new_ex(app_get0_libctx(), app_get0_propq());
+    X509 *ret = NULL;
+    X509_NAME *name = NULL;
+    X509V3_CTX ext_ctx;
+
+    if (x == NULL
+            || !ASN1_INTEGER_set(X509_get_serialNumber(x), serial)
+            || (name = X509_NAME_new()) == NULL
+            || !X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                           (const unsigned char *)cn, -1, -1,
+                                           0)
+            || !X509_set_subject_name(x, name)
+            || !X509_set_issuer_name(x, issuer == NULL ? name
+                                     : X509_get_subject_name(issuer))
+            || X509_gmtime_adj(X509_getm_notBefore(x), -86400) == NULL
+            || X509_gmtime_adj(X509_getm_notAfter(x), 365 * 86400L) == NULL
+            || !X509_set_pubkey(x, pkey))
+        goto end;
+
+    X509V3_set_ctx(&ext_ctx, issuer == NULL ? x : issuer, x, NULL, NULL, 0);
+    if (!add_ext(x, &ext_ctx, NID_basic_constraints,
+                 ca ? "critical,CA:TRUE" : "critical,CA:FALSE")
+            || (ca && !add_ext(x, &ext_ctx, NID_key_usage,
+                               "critical,keyCertSign,cRLSign"))
+            || !do_X509_sign(x, signkey, NULL, NULL, &ext_ctx))
+        goto end;
+    ret = X509_dup(x);
+
+ end:
+    X509_NAME_free(name);
+    X509_free(x);
+    return ret;
+}
+
+/* Serial numbers of the CRL test: even indexes are revoked, odd ones not */
+static int make_serial(ASN1_INTEGER **pserial, int i)
+{
+    uint64_t v = (uint64_t)(i / 2 + 1) * 0x9E3779B97F4A7C15ULL;
+
+    v = i % 2 == 0 ? v & ~(uint64_t)1 : v | 1;
+    return (*pserial = ASN1_INTEGER_new()) != NULL
+        && ASN1_INTEGER_set_uint64(*pserial, v);
+}
+
+static X509_CRL *make_crl(BENCH *bench, X509 *ca, EVP_PKEY *cakey,
+                          int crl_size)
+{
+    X509_CRL *crl = X509_CRL_new(), *ret = NULL;
+    ASN1_TIME *tm = X509_gmtime_adj(NULL, 0);
+    int i;
+
+    if (crl == NULL || tm == NULL
+            || !X509_CRL_set_version(crl, 1)
+            || !X509_CRL_set_issuer_name(crl, X509_get_subject_name(ca))
+            || !X509_CRL_set1_lastUpdate(crl, tm))
+        goto end;
+    for (i = 0; i < bench->nserials; i += 2) {
+        X509_REVOKED *rev = X509_REVOKED_new();
+
+        if (rev == NULL
+                || !X509_REVOKED_set_serialNumber(rev, bench->serials[i])
+                || !X509_REVOKED_set_revocationDate(rev, tm)
+                || !X509_CRL_add0_revoked(crl, rev)) {
+            X509_REVOKED_free(rev);
+            goto end;
+        }
+    }
+    if (X509_gmtime_adj(tm, 7 * 86400L) == NULL
+            || !X509_CRL_set1_nextUpdate(crl, tm)
+            || !X509_CRL_sort(crl)
+            || !do_X509_CRL_sign(crl, cakey, NULL, NULL))
+        goto end;
+    ret = X509_CRL_dup(crl);
+
+ end:
+    ASN1_TIME_free(tm);
+    X509_CRL_free(crl);
+    return ret;
+}
+
+#ifndef OPENSSL_NO_OCSP
+static OCSP_BASICRESP *make_ocsp(X509 *leaf, X509 *ca, EVP_PKEY *cakey)
+{
+    OCSP_BASICRESP *bs = OCSP_BASICRESP_new();
+    OCSP_CERTID *id = OCSP_cert_to_id(NULL, leaf, ca);
+    ASN1_TIME *thisupd = X509_gmtime_adj(NULL, 0);
+    ASN1_TIME *nextupd = X509_gmtime_adj(NULL, 7 * 86400L);
+
+    if (bs == NULL || id == NULL || thisupd == NULL || nextupd == NULL
+            || OCSP_basic_add1_status(bs, id, V_OCSP_CERTSTATUS_GOOD, 0, NULL,
+                                      thisupd, nextupd) == NULL
+            || !OCSP_basic_sign(bs, ca, cakey, NULL, NULL, 0)) {
+        OCSP_BASICRESP_free(bs);
+        bs = NULL;
+    }
+    OCSP_CERTID_free(id);
+    ASN1_TIME_free(thisupd);
+    ASN1_TIME_free(nextupd);
+    return bs;
+}
+#endif
+
+static int add_der(BENCH *bench, X509 *x)
+{
+    unsigned char *der = NULL;
+    int len = i2d_X509(x, &der);
+
+    if (len <= 0)
+        return 0;
+    bench->der[bench->nder] = der;
+    bench->derlen[bench->nder++] = len;
+    return 1;
+}
+
+int x509bench_main(int argc, char **argv)
+{
+    BENCH bench;
+    STACK_OF(X509) *incerts = NULL, *fillers = NULL;
+    EVP_PKEY *rootkey = NULL, *cakey = NULL, *leafkey = NULL;
+    X509 *root = NULL, *ca = NULL, *x;
+    const char *infile = NULL, *keyalg = "EC";
+    char *prog, name[64];
+    int seconds = 3, nthreads = 1, mr = 0, store_size = 100;
+    int crl_size = 1000, cache = 0, ret = 1, i, j;
+    int ntests = OSSL_NELEM(tests), run[OSSL_NELEM(tests)];
+    long counts[OSSL_NELEM(tests)];
+    double times[OSSL_NELEM(tests)];
+    OPTION_CHOICE o;
+
+    memset(&bench, 0, sizeof(bench));
+    prog = opt_init(argc, argv, x509bench_options);
+    while ((o = opt_next()) != OPT_EOF) {
+        switch (o) {
+        case OPT_EOF:
+        case OPT_ERR:
+ opthelp:
+            BIO_printf(bio_err, "%s: Use -help for summary.\n", prog);
+            goto end;
+        case OPT_HELP:
+            opt_help(x509bench_options);
+            ret = 0;
+            goto end;
+        case OPT_SECONDS:
+            seconds = atoi(opt_arg());
+            break;
+        case OPT_THREADS:
+            nthreads = atoi(opt_arg());
+            break;
+        case OPT_MR:
+            mr = 1;
+            break;
+        case OPT_IN:
+            infile = opt_arg();
+            break;
+        case OPT_KEYALG:
+            keyalg = opt_arg();
+            break;
+        case OPT_STORE_SIZE:
+            store_size = atoi(opt_arg());
+            break;
+        case OPT_CRL_SIZE:
+            crl_size = atoi(opt_arg());
+            break;
+        case OPT_CACHE:
+            cache = atoi(opt_arg());
+            break;
+        case OPT_PROV_CASES:
+            if (!opt_provider(o))
+                goto end;
+            break;
+        }
+    }
+    argc = opt_num_rest();
+    argv = opt_rest();
+
+    if (store_size < 0 || cache < 0) {
+        BIO_printf(bio_err, "%s: -store_size and -cache must not be negative\n",
+                   prog);
+        goto end;
+    }
+#if defined(OPENSSL_THREADS)
+    if (nthreads <= 0 || nthreads > MAX_THREADS) {
+        BIO_printf(bio_err, "%s: -threads must be between 1 and %d\n",
+                   prog, MAX_THREADS);
+        goto end;
+    }
+#else
+    if (nthreads != 1) {
+        BIO_printf(bio_err, "%s: threads are not supported\n", prog);
+        goto end;
+    }
+#endif
+
+    for (i = 0; i < ntests; i++)
+        run[i] = argc == 0;
+    for (; *argv != NULL; argv++) {
+        for (i = 0; i < ntests; i++)
+            if (strcmp(*argv, tests[i].name) == 0)
+                break;
+        if (i == ntests) {
+            BIO_printf(bio_err, "%s: Unknown test %s\n", prog, *argv);
+            goto opthelp;
+        }
+        run[i] = 1;
+    }
+
+    if (infile != NULL
+            && !load_certs(infile, &incerts, NULL, "certificates to parse"))
+        goto end;
+
+    /* Generate a root, an intermediate CA and a leaf certificate */
+    if ((rootkey = gen_key(keyalg)) == NULL
+            || (cakey = gen_key(keyalg)) == NULL
+            || (leafkey = gen_key(keyalg)) == NULL)
+        goto end;
+    root = make_cert("x509bench root", 1, rootkey, NULL, rootkey, 1);
+    ca = make_cert("x509bench CA", 2, cakey, root, rootkey, 1);
+    bench.leaf = make_cert("x509bench leaf", 3, leafkey, ca, cakey, 0);
+    if (root == NULL || ca == NULL || bench.leaf == NULL
+            || (bench.untrusted = sk_X509_new_null()) == NULL
+            || !sk_X509_push(bench.untrusted, ca)
+            || !X509_up_ref(ca))
+        goto err;
+
+    /* The trust store with |store_size| unrelated roots besides ours */
+    if ((bench.store = X509_STORE_new()) == NULL
+            || !X509_STORE_add_cert(bench.store, root)
+            || (fillers = sk_X509_new_null()) == NULL)
+        goto err;
+    for (i = 0; i < store_size; i++) {
+        BIO_snprintf(name, sizeof(name), "x509bench other root %d", i);
+        if ((x = make_cert(name, 4 + i, rootkey, NULL, rootkey, 1)) == NULL
+                || !sk_X509_push(fillers, x)) {
+            X509_free(x);
+            goto err;
+        }
+        if (!X509_STORE_add_cert(bench.store, x))
+            goto err;
+    }
+    if (cache > 0 && !X509_STORE_set_verify_cache(bench.store, cache))
+        goto err;
+
+    /* The parse corpus, either the input or all the generated certificates */
+    if (incerts != NULL) {
+        j = sk_X509_num(incerts);
+    } else {
+        j = 3 + sk_X509_num(fillers);
+    }
+    if (j == 0) {
+        BIO_printf(bio_err, "%s: No certificates in %s\n", prog, infile);
+        goto end;
+    }
+    bench.der = app_malloc(j * sizeof(*bench.der), "DER buffers");
+    bench.derlen = app_malloc(j * sizeof(*bench.derlen), "DER lengths");
+    if (incerts != NULL) {
+        for (i = 0; i < j; i++)
+            if (!add_der(&bench, sk_X509_value(incerts, i)))
+                goto err;
+    } else {
+        if (!add_der(&bench, root) || !add_der(&bench, ca)
+                || !add_der(&bench, bench.leaf))
+            goto err;
+        for (i = 0; i < sk_X509_num(fillers); i++)
+            if (!add_der(&bench, sk_X509_value(fillers, i)))
+                goto err;
+    }
+
+    bench.nserials = 2 * crl_size;
+    bench.serials = app_malloc(bench.nserials * sizeof(*bench.serials),
+                               "serial numbers");
+    memset(bench.serials, 0, bench.nserials * sizeof(*bench.serials));
+    for (i = 0; i < bench.nserials; i++)
+        if (!make_serial(&bench.serials[i], i))
+            goto err;
+    if ((bench.crl = make_crl(&bench, ca, cakey, crl_size)) == NULL)
+        goto err;
+#ifndef OPENSSL_NO_OCSP
+    if ((bench.bs = make_ocsp(bench.leaf, ca, cakey)) == NULL)
+        goto err;
+#endif
+
+    if (mr)
+        BIO_printf(bio_out, "+C:%s:%d:%d:%d\n",
+                   keyalg, bench.nder, store_size, crl_size);
+    for (i = 0; i < ntests; i++) {
+        if (!run[i])
+            continue;
+        if (!mr) {
+            BIO_printf(bio_err, "Doing %s for %ds in %d thread%s: ",
+                       tests[i].name, seconds, nthreads,
+                       nthreads == 1 ? "" : "s");
+            (void)BIO_flush(bio_err);
+        }
+        counts[i] = run_test(&bench, tests[i].op, nthreads, seconds,
+                             &times[i]);
+        if (counts[i] < 0) {
+            BIO_printf(bio_err, "%s: %s test failed\n", prog, tests[i].name);
+            goto err;
+        }
+        if (mr)
+            BIO_printf(bio_out, "+R:%s:%d:%ld:%.2f\n",
+                       tests[i].name, nthreads, counts[i], times[i]);
+        else
+            BIO_printf(bio_err, "%ld %s in %.2fs\n",
+                       counts[i], tests[i].unit, times[i]);
+    }
+
+    if (!mr) {
+        BIO_printf(bio_out, "%-8s %8s %14s %14s\n",
+                   "test", "threads", "ops/s", "ops/s/thread");
+        for (i = 0; i < ntests; i++) {
+            double rate;
+
+            if (!run[i])
+                continue;
+            rate = times[i] > 0 ? counts[i] / times[i] : 0;
+            BIO_printf(bio_out, "%-8s %8d %14.1f %14.1f\n", tests[i].name,
+                       nthreads, rate, rate / nthreads);
+        }
+    }
+    ret = 0;
+    goto end;
+
+ err:
+    ERR_print_errors(bio_err);
+ end:
+    for (i = 0; i < bench.nder; i++)
+        OPENSSL_free(bench.der[i]);
+    OPENSSL_free(bench.der);
+    OPENSSL_free(bench.derlen);
+    for (i = 0; bench.serials != NULL && i < bench.nserials; i++)
+        ASN1_INTEGER_free(bench.serials[i]);
+    OPENSSL_free(bench.serials);
+#ifndef OPENSSL_NO_OCSP
+    OCSP_BASICRESP_free(bench.bs);
+#endif
+    X509_CRL_free(bench.crl);
+    X509_STORE_free(bench.store);
+    sk_X509_pop_free(bench.untrusted, X509_free);
+    X509_free(bench.leaf);
+    sk_X509_pop_free(fillers, X509_free);
+    sk_X509_pop_free(incerts, X509_free);
+    X509_free(ca);
+    X509_free(root);
+    EVP_PKEY_free(rootkey);
+    EVP_PKEY_free(cakey);
+    EVP_PKEY_free(leafkey);
+    return ret;
+}
@@ -0,0 +1,344 @@
+#! /usr/bin/env perl
+# Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+#
+# Almost Montgomery Multiplication in radix 2^52 with AVX512_IFMA.
+#
+# Numbers are represented as arrays of 52-bit digits stored in 64-bit
+# words, which is what vpmadd52[lh]uq consume. Multiplication is
+# word-by-word Montgomery, "almost" meaning that the result is only
+# known to be less than 2*m for inputs less than 2*m [as long as
+# 4*m < 2^(52*digits)], which is sufficient for exponentiation and
+# avoids data-dependent final subtraction. Each subroutine processes
+# two independent operand sets, e.g. CRT halves of RSA private key,
+# so that long-latency dependency chain of one set is overlapped with
+# computations for the other one. Subroutines are generated for
+# 20, 30 and 40 digits, i.e. for 1024-, 1536- and 2048-bit moduli.
+# Operands are padded to a multiple of four digits, and the two sets
+# of operands follow each other, e.g. |a| is a[2][20], a[2][32] and
+# a[2][40] respectively.
+#
+# void ossl_rsaz_amm52xN_x2_ifma256(BN_ULONG *res, const BN_ULONG *a,
+#                                   const BN_ULONG *b, const BN_ULONG *m,
+#                                   const BN_ULONG k0[2]);
+# void ossl_extract_multiplier_2xN_win5(BN_ULONG *red_Y,
+#                                       const BN_ULONG *red_table,
+#                                       BN_ULONG idx1, BN_ULONG idx2);
+# int ossl_rsaz_avx512ifma_eligible(void);
+#
+# Result of the former is normalized, i.e. all digits are less than
+# 2^52, and so it can be passed as input to next multiplication. The
+# latter gathers idx1-th and idx2-th multipliers from 32-entry table of
+# pairs in constant-time manner.
+#
+# Non-volatile %xmm registers are not preserved as required by Windows
+# ABI, so only stubs are generated there.
+
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+		=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+	$avx512ifma = ($1>=2.26);
+}
+
+if (!$avx512ifma && `$ENV{CC} -v 2>&1` =~ /((?:clang|LLVM) version|based on LLVM) ([0-9]+)\.([0-9]+)/) {
+	my $ver = $2 + $3/100.0;	# 3.1->3.01, 3.10->3.10
+	$avx512ifma = ($ver>=7.0);
+}
+
+$avx512ifma = 0 if ($win64);
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
+my @digits = (20, 30, 40);
+
+if ($avx512ifma) {{{
+my ($res,$a,$b,$m,$k0) = ("%rdi","%rsi","%rdx","%rcx","%r8");
+my ($k0_0,$k0_1,$iter,$t0) = ("%r9","%r10","%r11","%r8");
+
+$code.=<<___;
+.text
+
+.extern	OPENSSL_ia32cap_P
+.globl	ossl_rsaz_avx512ifma_eligible
+.type	ossl_rsaz_avx512ifma_eligible,\@abi-omnipotent
+.align	32
+ossl_rsaz_avx512ifma_eligible:
+	mov	OPENSSL_ia32cap_P+8(%rip),%ecx
+	xor	%eax,%eax
+	and	\$`1<<31|1<<21|1<<16`,%ecx	# AVX512VL, AVX512IFMA, AVX512F
+	cmp	\$`1<<31|1<<21|1<<16`,%ecx
+	cmove	%ecx,%eax
+	ret
+.size	ossl_rsaz_avx512ifma_eligible,.-ossl_rsaz_avx512ifma_eligible
+___
+
+# Bring all digits of |@R| back to 52 bits. First the excess bits of
+# every digit are added to the next one, after which digits can still
+# be larger than 2^52-1 by at most one, and resulting carry chain is
+# resolved with k-masks as if digits were bits of a general-purpose
+# register: "generate" are digits that overflowed, "propagate" are
+# digits equal to 2^52-1, incoming carries are ((g<<1)+p)^p. It's all
+# constant-time.
+
+sub normalize {
+my ($mask,$zero,$t0,$t1,$t2,@R) = @_;
+my $k;
+
+    $code.="	vpsrlq		\$52,$R[-1],$t0\n";
+    for ($k=$#R; $k>=0; $k--) {
+	if ($k) {
+	    $code.="	vpsrlq		\$52,$R[$k-1],$t1\n";
+	    $code.="	valignq		\$3,$t1,$t0,$t2\n";
+	} else {
+	    $code.="	valignq		\$3,$zero,$t0,$t2\n";
+	}
+	$code.=<<___;
+	vpandq		$mask,$R[$k],$R[$k]
+	vpaddq		$t2,$R[$k],$R[$k]
+___
+	($t0,$t1) = ($t1,$t0);
+    }
+
+    $code.=<<___;
+	xor		%eax,%eax
+	xor		%r8d,%r8d
+___
+    for ($k=$#R; $k>=0; $k--) {
+	$code.=<<___;
+	vpcmpuq		\$6,$mask,$R[$k],%k1	# digit > 2^52-1
+	vpcmpuq		\$0,$mask,$R[$k],%k2	# digit == 2^52-1
+	kmovw		%k1,%ecx
+	kmovw		%k2,%edx
+	shl		\$4,%rax
+	or		%rcx,%rax
+	shl		\$4,%r8
+	or		%rdx,%r8
+___
+    }
+    $code.=<<___;
+	lea		(%r8,%rax,2),%rax	# (g<<1)+p
+	xor		%r8,%rax		# digits receiving carry
+___
+    for ($k=0; $k<=$#R; $k++) {
+	$code.=<<___;
+	kmovw		%eax,%k1
+	shr		\$4,%rax
+	vpsubq		$mask,$R[$k],$R[$k]\{%k1\}	# +1-2^52
+	vpandq		$mask,$R[$k],$R[$k]
+___
+    }
+}
+
+foreach my $n (@digits) {
+my $W = ($n+3)>>2;		# number of %ymm per operand
+my $S = 32*$W;			# stride between two operand sets
+my @R0 = map("%ymm$_",(0..$W-1));
+my @R1 = map("%ymm$_",($W..2*$W-1));
+my ($B0,$B1,$Y0,$Y1,$zero,$T) = map("%ymm$_",(2*$W..2*$W+5));
+my $k;
+
+$code.=<<___;
+
+.globl	ossl_rsaz_amm52x${n}_x2_ifma256
+.type	ossl_rsaz_amm52x${n}_x2_ifma256,\@function,5
+.align	32
+ossl_rsaz_amm52x${n}_x2_ifma256:
+.cfi_startproc
+	mov		0($k0),$k0_0
+	mov		8($k0),$k0_1
+	vpxorq		$zero,$zero,$zero
+___
+foreach (@R0,@R1) {
+$code.="	vmovdqa64	$zero,$_\n";
+}
+$code.=<<___;
+	mov		\$$n,$iter
+	jmp		.Lloop_amm52x${n}_x2
+
+.align	32
+.Lloop_amm52x${n}_x2:
+___
+foreach my $h (0..1) {
+my ($B,$Y,$o) = $h ? ($B1,$Y1,$S) : ($B0,$Y0,0);
+my @R = $h ? @R1 : @R0;
+my $k0_h = $h ? $k0_1 : $k0_0;
+my $xR = $R[0];	$xR =~ s/ymm/xmm/;
+my $xT = $T;	$xT =~ s/ymm/xmm/;
+
+$code.=<<___;
+	################################# operand set $h
+	vpbroadcastq	$o($b),$B
+___
+for ($k=0; $k<$W; $k++) {
+$code.="	vpmadd52luq	`$o+32*$k`($a),$B,$R[$k]\n";
+}
+$code.=<<___;
+	vmovq		$xR,%rax
+	mov		%rax,$t0
+	imul		$k0_h,%rax
+	shl		\$12,%rax
+	shr		\$12,%rax		# y = R[0]*k0 mod 2^52
+	vpbroadcastq	%rax,$Y
+	imul		$o($m),%rax
+	shl		\$12,%rax
+	shr		\$12,%rax
+	add		$t0,%rax
+	shr		\$52,%rax		# carry out of R[0]
+___
+for ($k=0; $k<$W; $k++) {
+$code.="	vpmadd52luq	`$o+32*$k`($m),$Y,$R[$k]\n";
+}
+# R[0] is divisible by 2^52 now, shift it out...
+for ($k=0; $k<$W-1; $k++) {
+$code.="	valignq		\$1,$R[$k],$R[$k+1],$R[$k]\n";
+}
+$code.=<<___;
+	valignq		\$1,$R[$W-1],$zero,$R[$W-1]
+	vmovq		%rax,$xT
+	vpaddq		$T,$R[0],$R[0]
+___
+# ... and accumulate high halves of products, which end up aligned
+for ($k=0; $k<$W; $k++) {
+$code.="	vpmadd52huq	`$o+32*$k`($a),$B,$R[$k]\n";
+}
+for ($k=0; $k<$W; $k++) {
+$code.="	vpmadd52huq	`$o+32*$k`($m),$Y,$R[$k]\n";
+}
+}
+$code.=<<___;
+
+	lea		8($b),$b
+	dec		$iter
+	jnz		.Lloop_amm52x${n}_x2
+
+	vmovdqa64	.Lmask52x4(%rip),$B0
+___
+	&normalize($B0,$zero,$Y0,$Y1,$T,@R0);
+	&normalize($B0,$zero,$Y0,$Y1,$T,@R1);
+for ($k=0; $k<$W; $k++) {
+$code.="	vmovdqu64	$R0[$k],`32*$k`($res)\n";
+}
+for ($k=0; $k<$W; $k++) {
+$code.="	vmovdqu64	$R1[$k],`$S+32*$k`($res)\n";
+}
+$code.=<<___;
+
+	vzeroupper
+	ret
+.cfi_endproc
+.size	ossl_rsaz_amm52x${n}_x2_ifma256,.-ossl_rsaz_amm52x${n}_x2_ifma256
+___
+
+{
+my @A0 = @R0;
+my @A1 = @R1;
+my ($I1,$I2,$cur,$ones) = ($B0,$B1,$Y0,$Y1);
+
+$code.=<<___;
+
+.globl	ossl_extract_multiplier_2x${n}_win5
+.type	ossl_extract_multiplier_2x${n}_win5,\@function,4
+.align	32
+ossl_extract_multiplier_2x${n}_win5:
+.cfi_startproc
+	vpbroadcastq	%rdx,$I1
+	vpbroadcastq	%rcx,$I2
+	vmovdqa64	.Lones(%rip),$ones
+	vpxorq		$cur,$cur,$cur
+___
+foreach (@A0,@A1) {
+$code.="	vmovdqa64	$cur,$_\n";
+}
+$code.=<<___;
+	mov		\$32,%eax
+	jmp		.Lloop_extract_2x${n}
+
+.align	32
+.Lloop_extract_2x${n}:
+	vpcmpq		\$0,$cur,$I1,%k1
+	vpcmpq		\$0,$cur,$I2,%k2
+___
+for ($k=0; $k<$W; $k++) {
+$code.="	vpblendmq	`32*$k`(%rsi),$A0[$k],$A0[$k]\{%k1\}\n";
+}
+for ($k=0; $k<$W; $k++) {
+$code.="	vpblendmq	`$S+32*$k`(%rsi),$A1[$k],$A1[$k]\{%k2\}\n";
+}
+$code.=<<___;
+	vpaddq		$ones,$cur,$cur
+	lea		`2*$S`(%rsi),%rsi
+	dec		%eax
+	jnz		.Lloop_extract_2x${n}
+
+___
+for ($k=0; $k<$W; $k++) {
+$code.="	vmovdqu64	$A0[$k],`32*$k`(%rdi)\n";
+}
+for ($k=0; $k<$W; $k++) {
+$code.="	vmovdqu64	$A1[$k],`$S+32*$k`(%rdi)\n";
+}
+$code.=<<___;
+
+	vzeroupper
+	ret
+.cfi_endproc
+.size	ossl_extract_multiplier_2x${n}_win5,.-ossl_extract_multiplier_2x${n}_win5
+___
+}
+}
+
+$code.=<<___;
+
+.align	32
+.Lmask52x4:
+	.quad	0xfffffffffffff,0xfffffffffffff,0xfffffffffffff,0xfffffffffffff
+.Lones:
+	.quad	1,1,1,1
+___
+
+}}} else {{{	# assembler is too old or target is Windows
+$code.=<<___;
+.text
+
+.globl	ossl_rsaz_avx512ifma_eligible
+.type	ossl_rsaz_avx512ifma_eligible,\@abi-omnipotent
+ossl_rsaz_avx512ifma_eligible:
+	xor	%eax,%eax
+	ret
+.size	ossl_rsaz_avx512ifma_eligible,.-ossl_rsaz_avx512ifma_eligible
+___
+foreach my $n (@digits) {
+$code.=<<___;
+
+.globl	ossl_rsaz_amm52x${n}_x2_ifma256
+.globl	ossl_extract_multiplier_2x${n}_win5
+.type	ossl_rsaz_amm52x${n}_x2_ifma256,\@abi-omnipotent
+ossl_rsaz_amm52x${n}_x2_ifma256:
+ossl_extract_multiplier_2x${n}_win5:
+	.byte	0x0f,0x0b	# ud2
+	ret
+.size	ossl_rsaz_amm52x${n}_x2_ifma256,.-ossl_rsaz_amm52x${n}_x2_ifma256
+___
+}
+}}}
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+print $code;
+close STDOUT or die "error closing STDOUT: $!";
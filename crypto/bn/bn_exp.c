@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -1124,6 +1124,278 @@ int BN_mod_exp_mont_consttime(BIGNUM *rr, const BIGNUM *a, const BIGNUM *p,
     return ret;
 }
 
+/*
+ * Fixed-base exponentiation for a base that is used many times, e.g. the
+ * generator of a named group, using the comb method of Lim and Lee.
+ *
+ * The exponent, of at most |bits| bits, is viewed as BN_COMB_WINDOW rows of
+ * |block| bits each, and every row is split into BN_COMB_TABLES blocks of
+ * |cols| bits.  Table k holds, for every BN_COMB_WINDOW bit index i, the
+ * product of g^(2^(j * block + k * cols)) over the bits j set in i.  An
+ * exponentiation then costs |cols| squarings and |block| multiplications
+ * instead of |bits| squarings and |bits| / window multiplications.
+ *
+ * The tables use the same layout as BN_mod_exp_mont_consttime() so that
+ * every lookup touches the same cache lines, and the number of operations
+ * only depends on |bits|.
+ */
+#define BN_COMB_WINDOW  5
+#define BN_COMB_TABLES  4
+
+struct bn_mont_comb_st {
+    BN_MONT_CTX *mont;
+    int bits;
+    int block;
+    int cols;
+    size_t tablelen;
+    unsigned char *tableFree;
+    unsigned char *table;
+};
+
+BN_MONT_COMB *bn_mont_comb_new(const BIGNUM *g, const BIGNUM *m, int bits,
+                               BN_CTX *ctx)
+{
+    BN_MONT_COMB *comb = NULL;
+    BIGNUM *base, *tmp;
+    unsigned char *table;
+    int top = m->top, width = 1 << BN_COMB_WINDOW;
+    int i, j, k, t, ok = 0;
+
+    if (!BN_is_odd(m)) {
+        ERR_raise(ERR_LIB_BN, BN_R_CALLED_WITH_EVEN_MODULUS);
+        return NULL;
+    }
+    if (bits <= 0) {
+        ERR_raise(ERR_LIB_BN, ERR_R_PASSED_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    BN_CTX_start(ctx);
+    base = BN_CTX_get(ctx);
+    tmp = BN_CTX_get(ctx);
+    if (tmp == NULL)
+        goto err;
+
+    if ((comb = OPENSSL_zalloc(sizeof(*comb))) == NULL) {
+        ERR_raise(ERR_LIB_BN, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    comb->cols = (bits + BN_COMB_WINDOW * BN_COMB_TABLES - 1)
+                 / (BN_COMB_WINDOW * BN_COMB_TABLES);
+    comb->block = comb->cols * BN_COMB_TABLES;
+    comb->bits = comb->block * BN_COMB_WINDOW;
+    comb->tablelen = sizeof(m->d[0]) * top * width;
+    comb->tableFree = OPENSSL_zalloc(comb->tablelen * BN_COMB_TABLES
+                                     + MOD_EXP_CTIME_MIN_CACHE_LINE_WIDTH);
+    if (comb->tableFree == NULL) {
+        ERR_raise(ERR_LIB_BN, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    comb->table = MOD_EXP_CTIME_ALIGN(comb->tableFree);
+
+    if ((comb->mont = BN_MONT_CTX_new()) == NULL
+        || !BN_MONT_CTX_set(comb->mont, m, ctx))
+        goto err;
+
+    /* Entry 0 of every table is 1 in the Montgomery domain */
+    if (!bn_to_mont_fixed_top(tmp, BN_value_one(), comb->mont, ctx))
+        goto err;
+    for (k = 0; k < BN_COMB_TABLES; k++)
+        MOD_EXP_CTIME_COPY_TO_PREBUF(tmp, top, comb->table
+                                               + k * comb->tablelen,
+                                     0, BN_COMB_WINDOW);
+
+    if (!BN_nnmod(base, g, m, ctx)
+        || !bn_to_mont_fixed_top(base, base, comb->mont, ctx))
+        goto err;
+
+    /*
+     * base = g^(2^(t * cols)) = g^(2^(j * block + k * cols)) completes the
+     * entries of table k whose highest set bit is j.
+     */
+    for (t = 0; t < BN_COMB_WINDOW * BN_COMB_TABLES; t++) {
+        j = t / BN_COMB_TABLES;
+        k = t % BN_COMB_TABLES;
+        table = comb->table + k * comb->tablelen;
+
+        if (t > 0)
+            for (i = 0; i < comb->cols; i++)
+                if (!bn_mul_mont_fixed_top(base, base, base, comb->mont, ctx))
+                    goto err;
+
+        for (i = 1 << j; i < 2 << j; i++) {
+            if (!MOD_EXP_CTIME_COPY_FROM_PREBUF(tmp, top, table, i - (1 << j),
+                                                BN_COMB_WINDOW)
+                || !bn_mul_mont_fixed_top(tmp, tmp, base, comb->mont, ctx))
+                goto err;
+            MOD_EXP_CTIME_COPY_TO_PREBUF(tmp, top, table, i, BN_COMB_WINDOW);
+        }
+    }
+    ok = 1;
+ err:
+    BN_CTX_end(ctx);
+    if (!ok) {
+        bn_mont_comb_free(comb);
+        comb = NULL;
+    }
+    return comb;
+}
+
+void bn_mont_comb_free(BN_MONT_COMB *comb)
+{
+    if (comb == NULL)
+        return;
+    BN_MONT_CTX_free(comb->mont);
+    OPENSSL_free(comb->tableFree);
+    OPENSSL_free(comb);
+}
+
+/* Returns the largest exponent size in bits |comb| can be used for */
+int bn_mont_comb_bits(const BN_MONT_COMB *comb)
+{
+    return comb->bits;
+}
+
+/*
+ * Computes rr = g^p mod m in constant time, for the g and m |comb| was
+ * created with.  p must be non-negative and at most bn_mont_comb_bits() bits.
+ */
+int bn_mod_exp_mont_comb(BIGNUM *rr, const BIGNUM *p,
+                         const BN_MONT_COMB *comb, BN_CTX *ctx)
+{
+    BN_MONT_CTX *mont = comb->mont;
+    BIGNUM *r, *am, *e;
+    BN_ULONG *d = NULL;
+    int top = mont->N.top, words = (comb->bits + BN_BITS2 - 1) / BN_BITS2;
+    int c, j, k, pos, idx, ret = 0;
+
+    bn_check_top(p);
+
+    if (p->neg || BN_num_bits(p) > comb->bits) {
+        ERR_raise(ERR_LIB_BN, BN_R_BIGNUM_TOO_LONG);
+        return 0;
+    }
+
+    BN_CTX_start(ctx);
+    r = BN_CTX_get(ctx);
+    am = BN_CTX_get(ctx);
+    e = BN_CTX_get(ctx);
+    if (e == NULL || bn_wexpand(e, words) == NULL)
+        goto err;
+
+    /*
+     * Copy the exponent into a zero padded buffer of fixed size, so that
+     * reading its bits does not depend on p->top.
+     */
+    if (!bn_copy_words(e->d, p, words))
+        goto err;
+    d = e->d;
+
+    for (c = comb->cols - 1; c >= 0; c--) {
+        if (c != comb->cols - 1
+            && !bn_mul_mont_fixed_top(r, r, r, mont, ctx))
+            goto err;
+
+        for (k = 0; k < BN_COMB_TABLES; k++) {
+            idx = 0;
+            for (j = 0; j < BN_COMB_WINDOW; j++) {
+                pos = j * comb->block + k * comb->cols + c;
+                idx |= (int)((d[pos / BN_BITS2] >> (pos % BN_BITS2)) & 1) << j;
+            }
+            if (c == comb->cols - 1 && k == 0) {
+                if (!MOD_EXP_CTIME_COPY_FROM_PREBUF(r, top, comb->table, idx,
+                                                    BN_COMB_WINDOW))
+                    goto err;
+                continue;
+            }
+            if (!MOD_EXP_CTIME_COPY_FROM_PREBUF(am, top, comb->table
+                                                         + k * comb->tablelen,
+                                                idx, BN_COMB_WINDOW)
+                || !bn_mul_mont_fixed_top(r, r, am, mont, ctx))
+                goto err;
+        }
+    }
+
+    ret = BN_from_montgomery(rr, r, mont, ctx);
+ err:
+    if (d != NULL)
+        OPENSSL_cleanse(d, sizeof(d[0]) * words);
+    BN_CTX_end(ctx);
+    return ret;
+}
+
+/*
+ * Compute two independent constant-time exponentiations, rr1 = a1^p1 mod m1
+ * and rr2 = a2^p2 mod m2, e.g. for two halves of RSA CRT. If processor
+ * supports AVX512_IFMA and moduli are of same supported size, they are
+ * computed together, otherwise one after another.
+ */
+int bn_mod_exp_mont_consttime_x2(BIGNUM *rr1, const BIGNUM *a1,
+                                 const BIGNUM *p1, const BIGNUM *m1,
+                                 BN_MONT_CTX *in_mont1,
+                                 BIGNUM *rr2, const BIGNUM *a2,
+                                 const BIGNUM *p2, const BIGNUM *m2,
+                                 BN_MONT_CTX *in_mont2, BN_CTX *ctx)
+{
+    int ret = 0;
+#ifdef RSAZ_ENABLED
+    BN_MONT_CTX *mont1 = NULL, *mont2 = NULL;
+    int bits = BN_num_bits(m1), top = bits / BN_BITS2;
+
+    if ((bits == 1024 || bits == 1536 || bits == 2048)
+        && BN_num_bits(m2) == bits
+        && !a1->neg && !a2->neg && !p1->neg && !p2->neg
+        && ossl_rsaz_avx512ifma_eligible()) {
+        BN_ULONG words[4][2048 / BN_BITS2];
+
+        /*
+         * Bases only have to be less than 2^bits, and all values are
+         * copied to fixed size buffers. This takes care of fixed-top
+         * values and in-place operation.
+         */
+        if (!bn_copy_words(words[0], a1, top)
+            || !bn_copy_words(words[1], p1, top)
+            || !bn_copy_words(words[2], a2, top)
+            || !bn_copy_words(words[3], p2, top))
+            goto seq;
+
+        if ((mont1 = in_mont1) == NULL
+            && ((mont1 = BN_MONT_CTX_new()) == NULL
+                || !BN_MONT_CTX_set(mont1, m1, ctx)))
+            goto err;
+        if ((mont2 = in_mont2) == NULL
+            && ((mont2 = BN_MONT_CTX_new()) == NULL
+                || !BN_MONT_CTX_set(mont2, m2, ctx)))
+            goto err;
+        if (bn_wexpand(rr1, top) == NULL || bn_wexpand(rr2, top) == NULL)
+            goto err;
+
+        ret = ossl_rsaz_mod_exp_avx512_x2(rr1->d, words[0], words[1], m1->d,
+                                          mont1->RR.d, mont1->n0[0],
+                                          rr2->d, words[2], words[3], m2->d,
+                                          mont2->RR.d, mont2->n0[0], bits);
+        OPENSSL_cleanse(words, sizeof(words));
+        if (ret) {
+            rr1->top = rr2->top = top;
+            rr1->neg = rr2->neg = 0;
+            bn_correct_top(rr1);
+            bn_correct_top(rr2);
+        }
+ err:
+        if (in_mont1 == NULL)
+            BN_MONT_CTX_free(mont1);
+        if (in_mont2 == NULL)
+            BN_MONT_CTX_free(mont2);
+        return ret;
+    }
+ seq:
+#endif
+    ret = BN_mod_exp_mont_consttime(rr1, a1, p1, m1, ctx, in_mont1)
+          && BN_mod_exp_mont_consttime(rr2, a2, p2, m2, ctx, in_mont2);
+
+    return ret;
+}
+
 int BN_mod_exp_mont_word(BIGNUM *rr, BN_ULONG a, const BIGNUM *p,
                          const BIGNUM *m, BN_CTX *ctx, BN_MONT_CTX *in_mont)
 {
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -669,4 +669,12 @@ static ossl_inline BIGNUM *bn_expand(BIGNUM *a, int bits)
 int bn_check_prime_int(const BIGNUM *w, int checks, BN_CTX *ctx,
                       int do_trial_division, BN_GENCB *cb);
 
+typedef struct bn_sieve_st BN_SIEVE;
+
+BN_SIEVE *bn_sieve_new(const BIGNUM *step, int bits);
+void bn_sieve_free(BN_SIEVE *sieve);
+int bn_sieve_start(BN_SIEVE *sieve, const BIGNUM *w);
+void bn_sieve_next(BN_SIEVE *sieve);
+int bn_sieve_has_factor(const BN_SIEVE *sieve);
+
 #endif
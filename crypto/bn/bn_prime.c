@@ -257,6 +257,104 @@ int BN_check_prime(const BIGNUM *p, BN_CTX *ctx, BN_GENCB *cb)
     return bn_check_prime_int(p, 0, ctx, 1, cb);
 }
 
+/*
+ * Incremental trial division of the candidates w, w + step, w + 2 * step, ...
+ *
+ * The residues of the current candidate modulo the small primes are updated
+ * with a single addition per prime when moving to the next candidate, instead
+ * of being recomputed with a multi-precision division for every candidate.
+ */
+struct bn_sieve_st {
+    int n;
+    prime_t *mods;
+    prime_t *steps;
+};
+
+/*
+ * Creates a sieve for candidates of |bits| bits that are |step| apart.
+ * The candidates must be larger than the biggest sieving prime.
+ */
+BN_SIEVE *bn_sieve_new(const BIGNUM *step, int bits)
+{
+    BN_SIEVE *sieve;
+    BN_ULONG mod;
+    int i;
+
+    if (bits <= 16)
+        return NULL;
+    if ((sieve = OPENSSL_zalloc(sizeof(*sieve))) == NULL) {
+        ERR_raise(ERR_LIB_BN, ERR_R_MALLOC_FAILURE);
+        return NULL;
+    }
+    sieve->n = calc_trial_divisions(bits);
+    sieve->mods = OPENSSL_zalloc(sizeof(*sieve->mods) * sieve->n);
+    sieve->steps = OPENSSL_zalloc(sizeof(*sieve->steps) * sieve->n);
+    if (sieve->mods == NULL || sieve->steps == NULL) {
+        ERR_raise(ERR_LIB_BN, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    for (i = 1; i < sieve->n; i++) {
+        if ((mod = BN_mod_word(step, primes[i])) == (BN_ULONG)-1)
+            goto err;
+        sieve->steps[i] = (prime_t)mod;
+    }
+    return sieve;
+ err:
+    bn_sieve_free(sieve);
+    return NULL;
+}
+
+void bn_sieve_free(BN_SIEVE *sieve)
+{
+    if (sieve == NULL)
+        return;
+    OPENSSL_clear_free(sieve->mods, sizeof(*sieve->mods) * sieve->n);
+    OPENSSL_free(sieve->steps);
+    OPENSSL_free(sieve);
+}
+
+/* Makes |w| the current candidate. Returns 1 on success and 0 on error. */
+int bn_sieve_start(BN_SIEVE *sieve, const BIGNUM *w)
+{
+    BN_ULONG mod;
+    int i;
+
+    for (i = 1; i < sieve->n; i++) {
+        if ((mod = BN_mod_word(w, primes[i])) == (BN_ULONG)-1)
+            return 0;
+        sieve->mods[i] = (prime_t)mod;
+    }
+    return 1;
+}
+
+/* Moves on to the next candidate, i.e. adds step to the current one */
+void bn_sieve_next(BN_SIEVE *sieve)
+{
+    unsigned int mod;
+    int i;
+
+    for (i = 1; i < sieve->n; i++) {
+        mod = (unsigned int)sieve->mods[i] + sieve->steps[i];
+        if (mod >= primes[i])
+            mod -= primes[i];
+        sieve->mods[i] = (prime_t)mod;
+    }
+}
+
+/*
+ * Returns 1 if the current candidate is divisible by one of the sieving
+ * primes (and is therefore composite) or 0 otherwise.
+ */
+int bn_sieve_has_factor(const BN_SIEVE *sieve)
+{
+    int i;
+
+    for (i = 1; i < sieve->n; i++)
+        if (sieve->mods[i] == 0)
+            return 1;
+    return 0;
+}
+
 /*
  * Tests that |w| is probably prime
  * See FIPS 186-4 C.3.1 Miller Rabin Probabilistic Primality Test.
@@ -308,8 +406,7 @@ static int bn_is_prime_int(const BIGNUM *w, int checks, BN_CTX *ctx,
         goto err;
 #endif
 
-    ret = bn_miller_rabin_is_prime(w, checks, ctx, cb, 0, &status);
-    if (!ret)
+    if (!bn_miller_rabin_is_prime(w, checks, ctx, cb, 0, &status))
         goto err;
     ret = (status == BN_PRIMETEST_PROBABLY_PRIME);
 err:
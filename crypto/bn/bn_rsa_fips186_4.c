@@ -1,5 +1,5 @@
 /*
- * Copyright 2018-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2018-2021 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2018-2019, Oracle and/or its affiliates.  All rights reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -105,26 +105,45 @@ static int bn_rsa_fips186_4_find_aux_prob_prime(const BIGNUM *Xp1,
                                                 BN_GENCB *cb)
 {
     int ret = 0;
-    int i = 0;
+    int i = 0, j;
+    BIGNUM *two;
+    BN_SIEVE *sieve = NULL;
 
+    BN_CTX_start(ctx);
+    two = BN_CTX_get(ctx);
+    if (two == NULL || !BN_set_word(two, 2))
+        goto err;
     if (BN_copy(p1, Xp1) == NULL)
-        return 0;
+        goto err;
     BN_set_flags(p1, BN_FLG_CONSTTIME);
 
+    /* Trial division by small primes is done incrementally by the sieve */
+    if ((sieve = bn_sieve_new(two, BN_num_bits(Xp1))) == NULL
+            || !bn_sieve_start(sieve, p1))
+        goto err;
+
     /* Find the first odd number >= Xp1 that is probably prime */
     for(;;) {
         i++;
         BN_GENCB_call(cb, 0, i);
-        /* MR test with trial division */
-        if (BN_check_prime(p1, ctx, cb))
-            break;
+        if (!bn_sieve_has_factor(sieve)) {
+            /* MR test, trial division has already been done */
+            j = bn_check_prime_int(p1, 0, ctx, 0, cb);
+            if (j < 0)
+                goto err;
+            if (j > 0)
+                break;
+        }
         /* Get next odd number */
         if (!BN_add_word(p1, 2))
             goto err;
+        bn_sieve_next(sieve);
     }
     BN_GENCB_call(cb, 2, i);
     ret = 1;
 err:
+    bn_sieve_free(sieve);
+    BN_CTX_end(ctx);
     return ret;
 }
 
@@ -240,10 +259,11 @@ int bn_rsa_fips186_4_derive_prime(BIGNUM *Y, BIGNUM *X, const BIGNUM *Xin,
                                   const BIGNUM *e, BN_CTX *ctx, BN_GENCB *cb)
 {
     int ret = 0;
-    int i, imax;
+    int i, imax, j;
     int bits = nlen >> 1;
     BIGNUM *tmp, *R, *r1r2x2, *y1, *r1x2;
     BIGNUM *base, *range;
+    BN_SIEVE *sieve = NULL;
 
     BN_CTX_start(ctx);
 
@@ -295,6 +315,13 @@ int bn_rsa_fips186_4_derive_prime(BIGNUM *Y, BIGNUM *X, const BIGNUM *Xin,
     if (BN_is_negative(R) && !BN_add(R, R, r1r2x2))
         goto err;
 
+    /*
+     * The candidates Y are 2r1r2 apart, so trial division by small primes can
+     * be done incrementally.
+     */
+    if ((sieve = bn_sieve_new(r1r2x2, bits)) == NULL)
+        goto err;
+
     imax = 5 * bits; /* max = 5/2 * nbits */
     for (;;) {
         if (Xin == NULL) {
@@ -306,7 +333,8 @@ int bn_rsa_fips186_4_derive_prime(BIGNUM *Y, BIGNUM *X, const BIGNUM *Xin,
                 goto end;
         }
         /* (Step 4) Y = X + ((R - X) mod 2r1r2) */
-        if (!BN_mod_sub(Y, R, X, r1r2x2, ctx) || !BN_add(Y, Y, X))
+        if (!BN_mod_sub(Y, R, X, r1r2x2, ctx) || !BN_add(Y, Y, X)
+                || !bn_sieve_start(sieve, Y))
             goto err;
         /* (Step 5) */
         i = 0;
@@ -321,21 +349,31 @@ int bn_rsa_fips186_4_derive_prime(BIGNUM *Y, BIGNUM *X, const BIGNUM *Xin,
             BN_GENCB_call(cb, 0, 2);
 
             /* (Step 7) If GCD(Y-1) == 1 & Y is probably prime then return Y */
-            if (BN_copy(y1, Y) == NULL
-                    || !BN_sub_word(y1, 1)
-                    || !BN_gcd(tmp, y1, e, ctx))
-                goto err;
-            if (BN_is_one(tmp) && BN_check_prime(Y, ctx, cb))
-                goto end;
+            if (!bn_sieve_has_factor(sieve)) {
+                if (BN_copy(y1, Y) == NULL
+                        || !BN_sub_word(y1, 1)
+                        || !BN_gcd(tmp, y1, e, ctx))
+                    goto err;
+                if (BN_is_one(tmp)) {
+                    /* MR test, trial division has already been done */
+                    j = bn_check_prime_int(Y, 0, ctx, 0, cb);
+                    if (j < 0)
+                        goto err;
+                    if (j > 0)
+                        goto end;
+                }
+            }
             /* (Step 8-10) */
             if (++i >= imax || !BN_add(Y, Y, r1r2x2))
                 goto err;
+            bn_sieve_next(sieve);
         }
     }
 end:
     ret = 1;
     BN_GENCB_call(cb, 3, 0);
 err:
+    bn_sieve_free(sieve);
     BN_clear(y1);
     BN_CTX_end(ctx);
     return ret;
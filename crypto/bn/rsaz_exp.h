@@ -1,5 +1,5 @@
 /*
- * Copyright 2013-2018 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2013-2021 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2012, Intel Corporation. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -35,6 +35,16 @@ void RSAZ_512_mod_exp(BN_ULONG result[8],
                       const BN_ULONG m_norm[8], BN_ULONG k0,
                       const BN_ULONG RR[8]);
 
+int ossl_rsaz_avx512ifma_eligible(void);
+
+int ossl_rsaz_mod_exp_avx512_x2(BN_ULONG *res1, const BN_ULONG *base1,
+                                const BN_ULONG *exp1, const BN_ULONG *m1,
+                                const BN_ULONG *rr1, BN_ULONG k0_1,
+                                BN_ULONG *res2, const BN_ULONG *base2,
+                                const BN_ULONG *exp2, const BN_ULONG *m2,
+                                const BN_ULONG *rr2, BN_ULONG k0_2,
+                                int factor_size);
+
 # endif
 
 #endif
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <openssl/opensslconf.h>
+#include <openssl/crypto.h>
+#include "rsaz_exp.h"
+
+#ifndef RSAZ_ENABLED
+NON_EMPTY_TRANSLATION_UNIT
+#else
+# include <string.h>
+# include "bn_local.h"
+
+/*
+ * See crypto/bn/asm/rsaz-avx512.pl for further details.
+ */
+typedef void (*AMM52_X2)(BN_ULONG *res, const BN_ULONG *a,
+                         const BN_ULONG *b, const BN_ULONG *m,
+                         const BN_ULONG k0[2]);
+typedef void (*EXTRACT_X2)(BN_ULONG *red_Y, const BN_ULONG *red_table,
+                           BN_ULONG idx1, BN_ULONG idx2);
+
+void ossl_rsaz_amm52x20_x2_ifma256(BN_ULONG *res, const BN_ULONG *a,
+                                   const BN_ULONG *b, const BN_ULONG *m,
+                                   const BN_ULONG k0[2]);
+void ossl_rsaz_amm52x30_x2_ifma256(BN_ULONG *res, const BN_ULONG *a,
+                                   const BN_ULONG *b, const BN_ULONG *m,
+                                   const BN_ULONG k0[2]);
+void ossl_rsaz_amm52x40_x2_ifma256(BN_ULONG *res, const BN_ULONG *a,
+                                   const BN_ULONG *b, const BN_ULONG *m,
+                                   const BN_ULONG k0[2]);
+void ossl_extract_multiplier_2x20_win5(BN_ULONG *red_Y,
+                                       const BN_ULONG *red_table,
+                                       BN_ULONG idx1, BN_ULONG idx2);
+void ossl_extract_multiplier_2x30_win5(BN_ULONG *red_Y,
+                                       const BN_ULONG *red_table,
+                                       BN_ULONG idx1, BN_ULONG idx2);
+void ossl_extract_multiplier_2x40_win5(BN_ULONG *red_Y,
+                                       const BN_ULONG *red_table,
+                                       BN_ULONG idx1, BN_ULONG idx2);
+
+# define DIGIT_SIZE     52
+# define DIGIT_MASK     ((BN_ULONG)0xFFFFFFFFFFFFF)
+# define EXP_WIN_SIZE   5
+# define EXP_WIN_MASK   ((1 << EXP_WIN_SIZE) - 1)
+
+/* Convert |in_bits|-bit little-endian number to 52-bit digits */
+static void to_words52(BN_ULONG *out, int out_len, const BN_ULONG *in,
+                       int in_bits)
+{
+    int in_len = in_bits / BN_BITS2, i, w, s;
+
+    for (i = 0; i < out_len; i++) {
+        w = i * DIGIT_SIZE / BN_BITS2;
+        s = i * DIGIT_SIZE % BN_BITS2;
+        out[i] = 0;
+        if (w >= in_len)
+            continue;
+        out[i] = in[w] >> s;
+        if (s > BN_BITS2 - DIGIT_SIZE && w + 1 < in_len)
+            out[i] |= in[w + 1] << (BN_BITS2 - s);
+        out[i] &= DIGIT_MASK;
+    }
+}
+
+/* Convert normalized 52-bit digits back to |out_bits|-bit number */
+static void from_words52(BN_ULONG *out, int out_bits, const BN_ULONG *in,
+                         int in_len)
+{
+    int out_len = out_bits / BN_BITS2, i, w, s;
+
+    memset(out, 0, sizeof(*out) * out_len);
+    for (i = 0; i < in_len; i++) {
+        w = i * DIGIT_SIZE / BN_BITS2;
+        s = i * DIGIT_SIZE % BN_BITS2;
+        if (w >= out_len)
+            break;
+        out[w] |= in[i] << s;
+        if (s > BN_BITS2 - DIGIT_SIZE && w + 1 < out_len)
+            out[w + 1] |= in[i] >> (BN_BITS2 - s);
+    }
+}
+
+/*
+ * Window positions are public, it's only their values that are secret,
+ * and they are used solely as indices for constant-time gathering.
+ */
+static BN_ULONG get_window(const BN_ULONG *exp, int exp_len, int bit)
+{
+    int w = bit / BN_BITS2, s = bit % BN_BITS2;
+    BN_ULONG v = exp[w] >> s;
+
+    if (s > BN_BITS2 - EXP_WIN_SIZE && w + 1 < exp_len)
+        v |= exp[w + 1] << (BN_BITS2 - s);
+    return v & EXP_WIN_MASK;
+}
+
+/* |r| is known to be not larger than |m|, subtract |m| if equal */
+static void reduce_once(BN_ULONG *r, const BN_ULONG *m, BN_ULONG *tmp,
+                        int num)
+{
+    BN_ULONG mask = 0 - bn_sub_words(tmp, r, m, num);
+    int i;
+
+    for (i = 0; i < num; i++)
+        r[i] = (r[i] & mask) | (tmp[i] & ~mask);
+}
+
+/*
+ * Compute res1 = base1^exp1 mod m1 and res2 = base2^exp2 mod m2 for two
+ * |factor_size|-bit moduli in constant time. All inputs and outputs are
+ * |factor_size|/64 words long, |rr1| and |rr2| are Montgomery converters
+ * for 2^factor_size radix and |k0_1| and |k0_2| are corresponding
+ * Montgomery constants, i.e. BN_MONT_CTX's RR and n0[0]. Bases are
+ * expected to be less than 2^factor_size and moduli should be exactly
+ * |factor_size| bits long. Returns 0 if |factor_size| is not supported.
+ */
+int ossl_rsaz_mod_exp_avx512_x2(BN_ULONG *res1, const BN_ULONG *base1,
+                                const BN_ULONG *exp1, const BN_ULONG *m1,
+                                const BN_ULONG *rr1, BN_ULONG k0_1,
+                                BN_ULONG *res2, const BN_ULONG *base2,
+                                const BN_ULONG *exp2, const BN_ULONG *m2,
+                                const BN_ULONG *rr2, BN_ULONG k0_2,
+                                int factor_size)
+{
+    AMM52_X2 amm;
+    EXTRACT_X2 extract;
+    BN_ULONG *storage, *m, *rr, *base, *coeff, *one, *Y, *X, *table;
+    BN_ULONG k0[2];
+    size_t storage_len;
+    int digits, stride, exp_len = factor_size / BN_BITS2, i, bit;
+
+    switch (factor_size) {
+    case 1024:
+        amm = ossl_rsaz_amm52x20_x2_ifma256;
+        extract = ossl_extract_multiplier_2x20_win5;
+        break;
+    case 1536:
+        amm = ossl_rsaz_amm52x30_x2_ifma256;
+        extract = ossl_extract_multiplier_2x30_win5;
+        break;
+    case 2048:
+        amm = ossl_rsaz_amm52x40_x2_ifma256;
+        extract = ossl_extract_multiplier_2x40_win5;
+        break;
+    default:
+        return 0;
+    }
+    digits = (factor_size + DIGIT_SIZE - 1) / DIGIT_SIZE;
+    stride = (digits + 3) & ~3;
+
+    /* m, rr, base, coeff, one, Y, X and 2^EXP_WIN_SIZE table entries */
+    storage_len = sizeof(BN_ULONG) * 2 * stride * (7 + (1 << EXP_WIN_SIZE));
+    if ((storage = OPENSSL_zalloc(storage_len + 64)) == NULL)
+        return 0;
+    m = (BN_ULONG *)(((size_t)storage + 63) & ~(size_t)63);
+    rr = m + 2 * stride;
+    base = rr + 2 * stride;
+    coeff = base + 2 * stride;
+    one = coeff + 2 * stride;
+    Y = one + 2 * stride;
+    X = Y + 2 * stride;
+    table = X + 2 * stride;
+
+    to_words52(m, digits, m1, factor_size);
+    to_words52(m + stride, digits, m2, factor_size);
+    to_words52(rr, digits, rr1, factor_size);
+    to_words52(rr + stride, digits, rr2, factor_size);
+    to_words52(base, digits, base1, factor_size);
+    to_words52(base + stride, digits, base2, factor_size);
+    k0[0] = k0_1 & DIGIT_MASK;
+    k0[1] = k0_2 & DIGIT_MASK;
+
+    /*
+     * Montgomery converter for 2^(52*digits) radix, R', is derived from
+     * original one for R = 2^factor_size as AMM(AMM(RR, RR), 2^k) =
+     * R^4 * 2^k / R'^2, which is R'^2 for k = 4 * (52*digits - factor_size).
+     */
+    bit = 4 * (DIGIT_SIZE * digits - factor_size);
+    coeff[bit / DIGIT_SIZE] = coeff[stride + bit / DIGIT_SIZE]
+        = (BN_ULONG)1 << (bit % DIGIT_SIZE);
+    one[0] = one[stride] = 1;
+    amm(Y, rr, rr, m, k0);
+    amm(rr, Y, coeff, m, k0);
+
+    /* table[i] = base^i in Montgomery representation */
+    amm(table, rr, one, m, k0);
+    amm(table + 2 * stride, base, rr, m, k0);
+    for (i = 2; i < (1 << EXP_WIN_SIZE); i++)
+        amm(table + 2 * stride * i, table + 2 * stride * (i - 1),
+            table + 2 * stride, m, k0);
+
+    /* Fixed-window left-to-right exponentiation */
+    bit = (factor_size - 1) / EXP_WIN_SIZE * EXP_WIN_SIZE;
+    extract(Y, table, get_window(exp1, exp_len, bit),
+            get_window(exp2, exp_len, bit));
+    while (bit > 0) {
+        bit -= EXP_WIN_SIZE;
+        for (i = 0; i < EXP_WIN_SIZE; i++)
+            amm(Y, Y, Y, m, k0);
+        extract(X, table, get_window(exp1, exp_len, bit),
+                get_window(exp2, exp_len, bit));
+        amm(Y, Y, X, m, k0);
+    }
+
+    /* Convert from Montgomery representation, result is in [0, m] */
+    amm(Y, Y, one, m, k0);
+    from_words52(res1, factor_size, Y, digits);
+    from_words52(res2, factor_size, Y + stride, digits);
+    reduce_once(res1, m1, X, exp_len);
+    reduce_once(res2, m2, X, exp_len);
+
+    OPENSSL_clear_free(storage, storage_len + 64);
+    return 1;
+}
+#endif
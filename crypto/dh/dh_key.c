@@ -216,10 +216,26 @@ int dh_generate_public_key(BN_CTX *ctx, const DH *dh, const BIGNUM *priv_key,
     int ret = 0;
     BIGNUM *prk = BN_new();
     BN_MONT_CTX *mont = NULL;
+    const DH_NAMED_GROUP *group = NULL;
 
     if (prk == NULL)
         return 0;
 
+    /*
+     * Use the precomputed table for the generator of a named group, unless
+     * the method overrides the exponentiation.
+     */
+    if (dh->params.nid != NID_undef && dh->meth->bn_mod_exp == dh_bn_mod_exp)
+        group = ossl_ffc_numbers_to_dh_named_group(dh->params.p, NULL,
+                                                   dh->params.g);
+    if (group != NULL) {
+        BN_with_flags(prk, priv_key, BN_FLG_CONSTTIME);
+        ret = ossl_ffc_named_group_exp_g(dh->libctx, group, pub_key, prk, ctx);
+        if (ret >= 0)
+            goto err;
+        ret = 0;
+    }
+
     if (dh->flags & DH_FLAG_CACHE_MONT_P) {
         /*
          * We take the input DH as const, but we lie, because in some cases we
@@ -0,0 +1,483 @@
+#!/usr/bin/env perl
+# Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+#
+# X25519 Montgomery ladder for x86_64, four independent scalars at a
+# time.
+#
+# int x25519_ladder_x4(uint64_t xz[2][10][4], const uint64_t x1[10][4],
+#                      const uint64_t k[4][4]);
+#
+# Field elements are in radix 2^25.5, i.e. the same ten limbs of 26 and
+# 25 bits as the ref10 code in ec/curve25519.c, and the four of them
+# are interleaved limb by limb, so that each %ymm register holds the
+# same limb of all four elements and arithmetic is plain vertical SIMD
+# on 64-bit lanes with vpmuludq. Additions don't carry, subtractions
+# add 2*p first, and multiplication, squaring and multiplication by
+# 121666 carry their results, which are then below 2^26 and 2^25 but
+# for small excess in limbs 1 and 5. Bounds are such that operands of
+# vpmuludq, including the ones multiplied by 19, always fit in 32 bits
+# and sums of products in 64.
+#
+# |x1| is the u-coordinate of the input point of each lane, carried,
+# and |k| holds the 64-bit words of the clamped scalars, k[i][lane].
+# The ladder runs from bit 254 down to 0 and returns the projective
+# result X/Z of each lane in |xz|, in ref10 limb bounds. The swaps are
+# constant time, lanes being selected with masks.
+#
+# Returns 0 without touching |xz| if processor doesn't support AVX2,
+# so that caller can fall back to one scalar at a time.
+
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+		=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.19) + ($1>=2.22);
+}
+
+if (!$avx && `$ENV{CC} -v 2>&1` =~ /((?:clang|LLVM) version|.*based on LLVM) ([0-9]+\.[0-9]+)/) {
+	$avx = ($2>=3.0) + ($2>3.0);
+}
+
+# Non-volatile %xmm registers are not preserved as required by Windows
+# ABI, so only the stub is generated there.
+$avx=0 if ($win64);
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
+my @H = map("%ymm$_",(0..9));		# accumulators
+my ($F,$F2,$T,$M26,$M25) = map("%ymm$_",(10..14));
+my $C = "%ymm15";
+
+# Arguments of the field subroutines: destination, first and second
+# operand. %r11 points at the stack frame.
+my ($dst,$a,$b,$frame) = ("%r8","%r9","%r10","%r11");
+
+# Stack frame, field elements being 10*32 bytes
+my ($X2,$Z2,$X3,$Z3,$T0,$T1) = map(320*$_,(0..5));
+my $SCR = 320*6;			# 30 precomputed limbs
+my $SWAP = $SCR+32*30;			# previous scalar bit of each lane
+my $FRAME = $SWAP+32;
+
+# Carries |@H| so that even limbs are below 2^26 and odd ones below
+# 2^25, but for the small carries that end up in limbs 1 and 5, as
+# in ref10 fe_mul. Limbs are unsigned, so carries are plain shifts.
+sub carry {
+    my $code = "";
+
+    $code.=<<___;
+	vmovdqa		.Lmask26(%rip),$M26
+	vmovdqa		.Lmask25(%rip),$M25
+___
+    foreach my $i (0,4,1,5,2,6,3,7,4,8,9,0) {
+	my ($bits,$mask) = $i & 1 ? (25,$M25) : (26,$M26);
+	my $next = ($i+1) % 10;
+
+	$code.=<<___;
+	vpsrlq		\$$bits,$H[$i],$T
+	vpand		$mask,$H[$i],$H[$i]
+___
+	if ($i == 9) {
+	    # 2^255 = 19 mod p
+	    $code.=<<___;
+	vpaddq		$T,$H[0],$H[0]
+	vpaddq		$T,$T,$T
+	vpaddq		$T,$H[0],$H[0]
+	vpsllq		\$3,$T,$T
+	vpaddq		$T,$H[0],$H[0]
+___
+	} else {
+	    $code.="	vpaddq		$T,$H[$next],$H[$next]\n";
+	}
+    }
+    return $code;
+}
+
+sub store {
+    my $code = "";
+
+    foreach my $i (0..9) {
+	$code.="	vmovdqa		$H[$i],`32*$i`($dst)\n";
+    }
+    return $code;
+}
+
+$code.=<<___;
+.text
+
+.extern	OPENSSL_ia32cap_P
+
+.globl	x25519_ladder_x4
+.type	x25519_ladder_x4,\@function,3
+.align	32
+x25519_ladder_x4:
+.cfi_startproc
+___
+$code.=<<___	if ($avx>1);
+	mov	OPENSSL_ia32cap_P+8(%rip),%eax
+	test	\$`1<<5`,%eax		# check for AVX2
+	jnz	.Lladder_x4_avx2
+___
+$code.=<<___;
+	xor	%eax,%eax		# not supported
+	ret
+___
+
+if ($avx>1) {
+my ($out,$x1,$k) = ("%rdi","%rsi","%rdx");
+
+sub call {
+    my ($f,$h,$x,$y) = @_;
+    my $code = "	lea		$h($frame),$dst\n";
+
+    $code.=($x =~ /^%/ ? "	mov		$x,$a\n"
+		       : "	lea		$x($frame),$a\n")	if (defined($x));
+    $code.="	lea		$y($frame),$b\n"		if (defined($y));
+    $code.="	call		__fe4_${f}_avx2\n";
+    return $code;
+}
+
+sub cswap {
+    my ($p,$q) = @_;	# mask in $C
+    my $code = "";
+
+    foreach my $i (0..9) {
+	$code.=<<___;
+	vmovdqa		`$p+32*$i`($frame),$H[0]
+	vmovdqa		`$q+32*$i`($frame),$H[1]
+	vpxor		$H[0],$H[1],$T
+	vpand		$C,$T,$T
+	vpxor		$T,$H[0],$H[0]
+	vpxor		$T,$H[1],$H[1]
+	vmovdqa		$H[0],`$p+32*$i`($frame)
+	vmovdqa		$H[1],`$q+32*$i`($frame)
+___
+    }
+    return $code;
+}
+
+$code.=<<___;
+
+.align	32
+.Lladder_x4_avx2:
+	mov	%rsp,%rax
+.cfi_def_cfa_register	%rax
+	sub	\$$FRAME+8,%rsp
+	and	\$-32,%rsp
+	mov	%rsp,$frame
+	mov	%rax,$FRAME(%rsp)	# save original stack pointer
+.cfi_cfa_expression	%rsp+$FRAME,deref,+8
+
+	# x2 = 1, z2 = 0, x3 = x1, z3 = 1, no swap pending
+	vpxor		$T,$T,$T
+	vmovdqa		.Lone(%rip),$F
+___
+foreach my $i (0..9) {
+$code.=<<___;
+	vmovdqu		`32*$i`($x1),$H[0]
+	vmovdqa		$T,`$X2+32*$i`($frame)
+	vmovdqa		$T,`$Z2+32*$i`($frame)
+	vmovdqa		$H[0],`$X3+32*$i`($frame)
+	vmovdqa		$T,`$Z3+32*$i`($frame)
+___
+}
+$code.=<<___;
+	vmovdqa		$F,$X2($frame)
+	vmovdqa		$F,$Z3($frame)
+	vmovdqa		$T,$SWAP($frame)
+
+	mov		\$254,%ecx
+	jmp		.Loop_ladder_x4
+
+.align	32
+.Loop_ladder_x4:
+	# bit of each lane, then the swap mask from the previous one
+	mov		%ecx,%eax
+	shr		\$6,%eax
+	shl		\$5,%eax
+	vmovdqu		($k,%rax),$F
+	mov		%ecx,%eax
+	and		\$63,%eax
+	vmovd		%eax,%xmm11
+	vpsrlq		%xmm11,$F,$F
+	vpand		.Lone(%rip),$F,$F
+	vpxor		$SWAP($frame),$F,$C
+	vmovdqa		$F,$SWAP($frame)
+	vpxor		$T,$T,$T
+	vpsubq		$C,$T,$C
+___
+$code.=&cswap($X2,$X3);
+$code.=&cswap($Z2,$Z3);
+$code.=&call("sub",$T0,$X3,$Z3);
+$code.=&call("sub",$T1,$X2,$Z2);
+$code.=&call("add",$X2,$X2,$Z2);
+$code.=&call("add",$Z2,$X3,$Z3);
+$code.=&call("mul",$Z3,$T0,$X2);
+$code.=&call("mul",$Z2,$Z2,$T1);
+$code.=&call("sqr",$T0,$T1);
+$code.=&call("sqr",$T1,$X2);
+$code.=&call("add",$X3,$Z3,$Z2);
+$code.=&call("sub",$Z2,$Z3,$Z2);
+$code.=&call("mul",$X2,$T1,$T0);
+$code.=&call("sub",$T1,$T1,$T0);
+$code.=&call("sqr",$Z2,$Z2);
+$code.=&call("mul121666",$Z3,$T1);
+$code.=&call("sqr",$X3,$X3);
+$code.=&call("add",$T0,$T0,$Z3);
+$code.=&call("mul",$Z3,$x1,$Z2);
+$code.=&call("mul",$Z2,$T1,$T0);
+$code.=<<___;
+	dec		%ecx
+	jns		.Loop_ladder_x4
+
+	vpxor		$T,$T,$T
+	vpsubq		$SWAP($frame),$T,$C
+___
+$code.=&cswap($X2,$X3);
+$code.=&cswap($Z2,$Z3);
+foreach my $i (0..9) {
+$code.=<<___;
+	vmovdqa		`$X2+32*$i`($frame),$H[0]
+	vmovdqa		`$Z2+32*$i`($frame),$H[1]
+	vmovdqu		$H[0],`32*$i`($out)
+	vmovdqu		$H[1],`320+32*$i`($out)
+___
+}
+$code.=<<___;
+
+	# wipe the secrets off the stack
+	vpxor		$T,$T,$T
+	xor		%eax,%eax
+.Lwipe_x4:
+	vmovdqa		$T,($frame,%rax)
+	add		\$32,%rax
+	cmp		\$$FRAME,%rax
+	jb		.Lwipe_x4
+
+	vzeroall
+	mov		$FRAME(%rsp),%rsp
+.cfi_def_cfa_register	%rsp
+	mov		\$1,%eax
+	ret
+.cfi_endproc
+.size	x25519_ladder_x4,.-x25519_ladder_x4
+___
+
+######################################################################
+# The field subroutines. They preserve general purpose registers but
+# for %r8-%r10, and use 30 limbs of scratch space at $SCR($frame).
+
+# h = f + g
+$code.=<<___;
+
+.type	__fe4_add_avx2,\@abi-omnipotent
+.align	32
+__fe4_add_avx2:
+.cfi_startproc
+___
+foreach my $i (0..9) {
+$code.=<<___;
+	vmovdqu		`32*$i`($a),$H[$i]
+	vpaddq		`32*$i`($b),$H[$i],$H[$i]
+___
+}
+$code.=&store();
+$code.=<<___;
+	ret
+.cfi_endproc
+.size	__fe4_add_avx2,.-__fe4_add_avx2
+
+.type	__fe4_sub_avx2,\@abi-omnipotent
+.align	32
+__fe4_sub_avx2:
+.cfi_startproc
+	vmovdqa		.L2p0(%rip),$H[0]
+	vmovdqa		.L2p_even(%rip),$M26
+	vmovdqa		.L2p_odd(%rip),$M25
+___
+# h = f + 2*p - g, with carried g
+foreach my $i (0..9) {
+$code.="	vpaddq		`32*$i`($a),".($i ? ($i & 1 ? $M25 : $M26) : $H[0]).",$H[$i]\n";
+$code.="	vpsubq		`32*$i`($b),$H[$i],$H[$i]\n";
+}
+$code.=&store();
+$code.=<<___;
+	ret
+.cfi_endproc
+.size	__fe4_sub_avx2,.-__fe4_sub_avx2
+
+.type	__fe4_mul121666_avx2,\@abi-omnipotent
+.align	32
+__fe4_mul121666_avx2:
+.cfi_startproc
+	vmovdqa		.L121666(%rip),$C
+___
+foreach my $i (0..9) {
+$code.="	vpmuludq	`32*$i`($a),$C,$H[$i]\n";
+}
+$code.=&carry();
+$code.=&store();
+$code.=<<___;
+	ret
+.cfi_endproc
+.size	__fe4_mul121666_avx2,.-__fe4_mul121666_avx2
+___
+
+# h = f * g. The product f[i]*g[j] goes to h[(i+j)%10], times 19 if
+# i+j >= 10 and times 2 if both i and j are odd. 19*g[j] is
+# precomputed.
+{
+my $G19 = $SCR;
+
+$code.=<<___;
+
+.type	__fe4_mul_avx2,\@abi-omnipotent
+.align	32
+__fe4_mul_avx2:
+.cfi_startproc
+	vmovdqa		.L19(%rip),$C
+___
+foreach my $j (1..9) {
+$code.=<<___;
+	vpmuludq	`32*$j`($b),$C,$T
+	vmovdqa		$T,`$G19+32*$j`($frame)
+___
+}
+foreach my $i (0..9) {
+    $code.="	vmovdqu		`32*$i`($a),$F\n";
+    $code.="	vpaddq		$F,$F,$F2\n"		if ($i & 1);
+    foreach my $j (0..9) {
+	my $k = ($i+$j) % 10;
+	my $f = ($i & $j & 1) ? $F2 : $F;
+	my $g = $i+$j >= 10 ? "`$G19+32*$j`($frame)" : "`32*$j`($b)";
+
+	if ($i == 0) {
+	    $code.="	vpmuludq	$g,$f,$H[$k]\n";
+	} else {
+	    $code.=<<___;
+	vpmuludq	$g,$f,$T
+	vpaddq		$T,$H[$k],$H[$k]
+___
+	}
+    }
+}
+$code.=&carry();
+$code.=&store();
+$code.=<<___;
+	ret
+.cfi_endproc
+.size	__fe4_mul_avx2,.-__fe4_mul_avx2
+___
+}
+
+# h = f^2. Each f[i]*f[j] with i <= j is taken once, times 2 if i != j,
+# on top of the factors of multiplication. The powers of 2 are applied
+# to f[i] and 19 to f[j], 2*f[i], 4*f[i] and 19*f[j] being precomputed.
+{
+my ($F2s,$F4s,$F19s) = ($SCR,$SCR+320,$SCR+640);
+
+$code.=<<___;
+
+.type	__fe4_sqr_avx2,\@abi-omnipotent
+.align	32
+__fe4_sqr_avx2:
+.cfi_startproc
+	vmovdqa		.L19(%rip),$C
+___
+foreach my $i (0..9) {
+$code.=<<___;
+	vmovdqu		`32*$i`($a),$F
+	vpaddq		$F,$F,$F2
+	vmovdqa		$F2,`$F2s+32*$i`($frame)
+___
+$code.=<<___	if ($i & 1);
+	vpaddq		$F2,$F2,$F2
+	vmovdqa		$F2,`$F4s+32*$i`($frame)
+___
+$code.=<<___	if ($i);
+	vpmuludq	$C,$F,$T
+	vmovdqa		$T,`$F19s+32*$i`($frame)
+___
+}
+my %init;
+foreach my $i (0..9) {
+    my %terms;
+
+    foreach my $j ($i..9) {
+	my $p = ($i != $j ? 2 : 1) * (($i & $j & 1) ? 2 : 1);
+
+	push @{$terms{$p}},$j;
+    }
+    foreach my $p (sort keys %terms) {
+	my $f = $p == 1 ? "`32*$i`($a)"
+			: "`".($p == 2 ? $F2s : $F4s)."+32*$i`($frame)";
+
+	$code.="	vmovdqu		$f,$F\n";
+	foreach my $j (@{$terms{$p}}) {
+	    my $k = ($i+$j) % 10;
+	    my $g = $i+$j >= 10 ? "`$F19s+32*$j`($frame)" : "`32*$j`($a)";
+
+	    if (!$init{$k}++) {
+		$code.="	vpmuludq	$g,$F,$H[$k]\n";
+	    } else {
+		$code.=<<___;
+	vpmuludq	$g,$F,$T
+	vpaddq		$T,$H[$k],$H[$k]
+___
+	    }
+	}
+    }
+}
+$code.=&carry();
+$code.=&store();
+$code.=<<___;
+	ret
+.cfi_endproc
+.size	__fe4_sqr_avx2,.-__fe4_sqr_avx2
+___
+}
+
+$code.=<<___;
+
+.align	64
+.Lmask26:
+	.quad	0x3ffffff,0x3ffffff,0x3ffffff,0x3ffffff
+.Lmask25:
+	.quad	0x1ffffff,0x1ffffff,0x1ffffff,0x1ffffff
+.L2p0:
+	.quad	0x7ffffda,0x7ffffda,0x7ffffda,0x7ffffda
+.L2p_even:
+	.quad	0x7fffffe,0x7fffffe,0x7fffffe,0x7fffffe
+.L2p_odd:
+	.quad	0x3fffffe,0x3fffffe,0x3fffffe,0x3fffffe
+.L19:
+	.quad	19,19,19,19
+.L121666:
+	.quad	121666,121666,121666,121666
+.Lone:
+	.quad	1,1,1,1
+___
+}
+$code.=<<___;
+.asciz	"X25519 x4 ladder for x86_64, CRYPTOGAMS by <appro\@openssl.org>"
+___
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+print $code;
+close STDOUT or die "error closing STDOUT: $!";
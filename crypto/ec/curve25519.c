@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -17,6 +17,7 @@
 #include "crypto/ecx.h"
 #include "ec_local.h"
 #include <openssl/evp.h>
+#include <openssl/rand.h>
 #include <openssl/sha.h>
 
 #if defined(X25519_ASM) && (defined(__x86_64) || defined(__x86_64__) || \
@@ -50,6 +51,14 @@ void x25519_fe64_tobytes(uint8_t *s, const fe64 f);
 # define fe64_sub x25519_fe64_sub
 # define fe64_tobytes x25519_fe64_tobytes
 
+/*
+ * Montgomery ladder on four scalars at a time, in radix 2^25.5 limbs
+ * interleaved by lane. Returns 0 if the processor lacks AVX2.
+ */
+# define X25519_LADDER_X4
+int x25519_ladder_x4(uint64_t xz[2][10][4], const uint64_t x1[10][4],
+                     const uint64_t k[4][4]);
+
 static uint64_t load_8(const uint8_t *in)
 {
     uint64_t result;
@@ -1852,6 +1861,29 @@ static void ge_p3_tobytes(uint8_t *s, const ge_p3 *h)
     s[31] ^= fe_isnegative(x) << 7;
 }
 
+/*
+ * Sets out[i] to 1/in[i] for all |n| elements with a single inversion
+ * (Montgomery's trick), none of the |in| elements may be zero.
+ */
+static void fe_batch_invert(fe *out, fe *in, size_t n)
+{
+    fe acc;
+    fe t;
+    size_t i;
+
+    fe_copy(out[0], in[0]);
+    for (i = 1; i < n; i++)
+        fe_mul(out[i], out[i - 1], in[i]);
+
+    fe_invert(acc, out[n - 1]);
+    for (i = n - 1; i > 0; i--) {
+        fe_mul(t, acc, out[i - 1]);
+        fe_mul(acc, acc, in[i]);
+        fe_copy(out[i], t);
+    }
+    fe_copy(out[0], acc);
+}
+
 static const fe d = {
     -10913610, 13857413, -15372611, 6949391,   114729,
     -8787816,  -6275908, -3247719,  -18696448, -12055116
@@ -4538,19 +4570,12 @@ static const ge_precomp Bi[8] = {
  * and b = b[0]+256*b[1]+...+256^31 b[31].
  * B is the Ed25519 base point (x,4/5) with x positive.
  */
-static void ge_double_scalarmult_vartime(ge_p2 *r, const uint8_t *a,
-                                         const ge_p3 *A, const uint8_t *b)
+/* Ai = A,3A,5A,7A,9A,11A,13A,15A */
+static void ge_precompute_cached(ge_cached Ai[8], const ge_p3 *A)
 {
-    signed char aslide[256];
-    signed char bslide[256];
-    ge_cached Ai[8]; /* A,3A,5A,7A,9A,11A,13A,15A */
     ge_p1p1 t;
     ge_p3 u;
     ge_p3 A2;
-    int i;
-
-    slide(aslide, a);
-    slide(bslide, b);
 
     ge_p3_to_cached(&Ai[0], A);
     ge_p3_dbl(&t, A);
@@ -4576,6 +4601,22 @@ static void ge_double_scalarmult_vartime(ge_p2 *r, const uint8_t *a,
     ge_add(&t, &A2, &Ai[6]);
     ge_p1p1_to_p3(&u, &t);
     ge_p3_to_cached(&Ai[7], &u);
+}
+
+static void ge_double_scalarmult_vartime(ge_p2 *r, const uint8_t *a,
+                                         const ge_p3 *A, const uint8_t *b)
+{
+    signed char aslide[256];
+    signed char bslide[256];
+    ge_cached Ai[8]; /* A,3A,5A,7A,9A,11A,13A,15A */
+    ge_p1p1 t;
+    ge_p3 u;
+    int i;
+
+    slide(aslide, a);
+    slide(bslide, b);
+
+    ge_precompute_cached(Ai, A);
 
     ge_p2_0(r);
 
@@ -5493,37 +5534,22 @@ err:
 
 static const char allzeroes[15];
 
-int ED25519_verify(const uint8_t *message, size_t message_len,
-                   const uint8_t signature[64], const uint8_t public_key[32],
-                   OSSL_LIB_CTX *libctx, const char *propq)
+/*
+ * Check 0 <= s < L where L = 2^252 + 27742317777372353535851937790883648493
+ *
+ * If not the signature is publicly invalid. Since it's public we can do the
+ * check in variable time.
+ */
+static int sc_is_canonical(const uint8_t *s)
 {
     int i;
-    ge_p3 A;
-    const uint8_t *r, *s;
-    EVP_MD *sha512;
-    EVP_MD_CTX *hash_ctx = NULL;
-    unsigned int sz;
-    int res = 0;
-    ge_p2 R;
-    uint8_t rcheck[32];
-    uint8_t h[SHA512_DIGEST_LENGTH];
     /* 27742317777372353535851937790883648493 in little endian format */
     const uint8_t l_low[16] = {
         0xED, 0xD3, 0xF5, 0x5C, 0x1A, 0x63, 0x12, 0x58, 0xD6, 0x9C, 0xF7, 0xA2,
         0xDE, 0xF9, 0xDE, 0x14
     };
 
-    r = signature;
-    s = signature + 32;
-
-    /*
-     * Check 0 <= s < L where L = 2^252 + 27742317777372353535851937790883648493
-     *
-     * If not the signature is publicly invalid. Since it's public we can do the
-     * check in variable time.
-     *
-     * First check the most significant byte
-     */
+    /* First check the most significant byte */
     if (s[31] > 0x10)
         return 0;
     if (s[31] == 0x10) {
@@ -5542,6 +5568,28 @@ int ED25519_verify(const uint8_t *message, size_t message_len,
         if (i < 0)
             return 0;
     }
+    return 1;
+}
+
+int ED25519_verify(const uint8_t *message, size_t message_len,
+                   const uint8_t signature[64], const uint8_t public_key[32],
+                   OSSL_LIB_CTX *libctx, const char *propq)
+{
+    ge_p3 A;
+    const uint8_t *r, *s;
+    EVP_MD *sha512;
+    EVP_MD_CTX *hash_ctx = NULL;
+    unsigned int sz;
+    int res = 0;
+    ge_p2 R;
+    uint8_t rcheck[32];
+    uint8_t h[SHA512_DIGEST_LENGTH];
+
+    r = signature;
+    s = signature + 32;
+
+    if (!sc_is_canonical(s))
+        return 0;
 
     if (ge_frombytes_vartime(&A, public_key) != 0) {
         return 0;
@@ -5577,6 +5625,185 @@ err:
     return res;
 }
 
+#ifndef FIPS_MODULE
+/*
+ * Number of signatures checked with a single multi-scalar multiplication,
+ * larger batches are split.
+ */
+# define ED25519_BATCH_MAX      64
+
+/*
+ * Check that
+ *
+ *   [8]([sum z_i s_i]B - sum [z_i]R_i - sum [z_i h_i]A_i) == 0
+ *
+ * for random 128 bit z_i, with Straus' interleaved multi-scalar
+ * multiplication.  The doublings are shared by all the signatures, which
+ * is what makes it faster than checking them one by one.
+ */
+static int ed25519_verify_batch_chunk(size_t n,
+                                      const uint8_t *const *messages,
+                                      const size_t *message_lens,
+                                      const uint8_t *const *signatures,
+                                      const uint8_t *const *public_keys,
+                                      EVP_MD *sha512, EVP_MD_CTX *hash_ctx,
+                                      OSSL_LIB_CTX *libctx)
+{
+    ge_cached (*tables)[8];
+    signed char (*slides)[256];
+    uint8_t z[32], zh[32], sum[32], rcheck[32];
+    uint8_t h[SHA512_DIGEST_LENGTH];
+    const uint8_t zero[32] = { 0 };
+    const uint8_t *r, *s;
+    ge_p3 P, u;
+    ge_p2 R;
+    ge_p1p1 t;
+    fe diff;
+    size_t i, j;
+    unsigned int sz;
+    int k, res = 0;
+
+    tables = OPENSSL_malloc(2 * n * sizeof(*tables));
+    slides = OPENSSL_malloc((2 * n + 1) * sizeof(*slides));
+    if (tables == NULL || slides == NULL)
+        goto err;
+
+    memset(sum, 0, sizeof(sum));
+    for (i = 0; i < n; i++) {
+        r = signatures[i];
+        s = signatures[i] + 32;
+
+        if (!sc_is_canonical(s))
+            goto err;
+
+        /*
+         * ED25519_verify() compares encodings, so R must be encoded
+         * canonically for the signature to be valid.
+         */
+        if (ge_frombytes_vartime(&P, r) != 0)
+            goto err;
+        ge_p3_tobytes(rcheck, &P);
+        if (CRYPTO_memcmp(rcheck, r, sizeof(rcheck)) != 0)
+            goto err;
+        fe_neg(P.X, P.X);
+        fe_neg(P.T, P.T);
+        ge_precompute_cached(tables[2 * i], &P);
+
+        if (ge_frombytes_vartime(&P, public_keys[i]) != 0)
+            goto err;
+        fe_neg(P.X, P.X);
+        fe_neg(P.T, P.T);
+        ge_precompute_cached(tables[2 * i + 1], &P);
+
+        if (!EVP_DigestInit_ex(hash_ctx, sha512, NULL)
+            || !EVP_DigestUpdate(hash_ctx, r, 32)
+            || !EVP_DigestUpdate(hash_ctx, public_keys[i], 32)
+            || !EVP_DigestUpdate(hash_ctx, messages[i], message_lens[i])
+            || !EVP_DigestFinal_ex(hash_ctx, h, &sz))
+            goto err;
+        x25519_sc_reduce(h);
+
+        /* z_i is odd so that no signature is ever left out */
+        memset(z, 0, sizeof(z));
+        if (RAND_bytes_ex(libctx, z, 16) <= 0)
+            goto err;
+        z[0] |= 1;
+
+        slide(slides[2 * i], z);
+        sc_muladd(zh, z, h, zero);
+        slide(slides[2 * i + 1], zh);
+        sc_muladd(sum, z, s, sum);
+    }
+    slide(slides[2 * n], sum);
+
+    ge_p2_0(&R);
+    for (k = 255; k >= 0; k--) {
+        ge_p2_dbl(&t, &R);
+
+        for (j = 0; j < 2 * n; j++) {
+            if (slides[j][k] > 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_add(&t, &u, &tables[j][slides[j][k] / 2]);
+            } else if (slides[j][k] < 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_sub(&t, &u, &tables[j][(-slides[j][k]) / 2]);
+            }
+        }
+
+        if (slides[2 * n][k] > 0) {
+            ge_p1p1_to_p3(&u, &t);
+            ge_madd(&t, &u, &Bi[slides[2 * n][k] / 2]);
+        } else if (slides[2 * n][k] < 0) {
+            ge_p1p1_to_p3(&u, &t);
+            ge_msub(&t, &u, &Bi[(-slides[2 * n][k]) / 2]);
+        }
+
+        ge_p1p1_to_p2(&R, &t);
+    }
+
+    /* Multiply by the cofactor and compare with the neutral point (0:1:1) */
+    for (k = 0; k < 3; k++) {
+        ge_p2_dbl(&t, &R);
+        ge_p1p1_to_p2(&R, &t);
+    }
+    fe_sub(diff, R.Y, R.Z);
+    res = !fe_isnonzero(R.X) && !fe_isnonzero(diff);
+
+ err:
+    OPENSSL_free(tables);
+    OPENSSL_free(slides);
+    return res;
+}
+
+int ED25519_verify_batch(size_t n, const uint8_t *const *messages,
+                         const size_t *message_lens,
+                         const uint8_t *const *signatures,
+                         const uint8_t *const *public_keys,
+                         OSSL_LIB_CTX *libctx, const char *propq)
+{
+    EVP_MD *sha512 = EVP_MD_fetch(libctx, SN_sha512, propq);
+    EVP_MD_CTX *hash_ctx = EVP_MD_CTX_new();
+    size_t i, chunk;
+    int res = 0;
+
+    if (sha512 == NULL || hash_ctx == NULL)
+        goto err;
+
+    for (i = 0; i < n; i += chunk) {
+        chunk = n - i > ED25519_BATCH_MAX ? ED25519_BATCH_MAX : n - i;
+        if (!ed25519_verify_batch_chunk(chunk, messages + i, message_lens + i,
+                                        signatures + i, public_keys + i,
+                                        sha512, hash_ctx, libctx))
+            goto err;
+    }
+    res = 1;
+
+ err:
+    EVP_MD_free(sha512);
+    EVP_MD_CTX_free(hash_ctx);
+    return res;
+}
+#else
+/*
+ * The cofactored batch equation is not approved, so the FIPS provider checks
+ * the signatures one by one.
+ */
+int ED25519_verify_batch(size_t n, const uint8_t *const *messages,
+                         const size_t *message_lens,
+                         const uint8_t *const *signatures,
+                         const uint8_t *const *public_keys,
+                         OSSL_LIB_CTX *libctx, const char *propq)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        if (!ED25519_verify(messages[i], message_lens[i], signatures[i],
+                            public_keys[i], libctx, propq))
+            return 0;
+    return 1;
+}
+#endif
+
 int ED25519_public_from_private(OSSL_LIB_CTX *ctx, uint8_t out_public_key[32],
                                 const uint8_t private_key[32], const char *propq)
 {
@@ -5606,6 +5833,61 @@ int ED25519_public_from_private(OSSL_LIB_CTX *ctx, uint8_t out_public_key[32],
     return 1;
 }
 
+int ED25519_public_from_private_batch(OSSL_LIB_CTX *ctx, size_t n,
+                                      uint8_t *const *out_public_keys,
+                                      const uint8_t *const *private_keys,
+                                      const char *propq)
+{
+    uint8_t az[SHA512_DIGEST_LENGTH];
+    ge_p3 *A = NULL;
+    fe *z = NULL;
+    fe x;
+    fe y;
+    size_t i;
+    int r = 0;
+    EVP_MD *sha512 = NULL;
+
+    if (n == 0)
+        return 1;
+
+    if (n > SIZE_MAX / (2 * sizeof(*z)))
+        return 0;
+    sha512 = EVP_MD_fetch(ctx, SN_sha512, propq);
+    A = OPENSSL_malloc(n * sizeof(*A));
+    z = OPENSSL_malloc(2 * n * sizeof(*z));
+    if (sha512 == NULL || A == NULL || z == NULL)
+        goto err;
+
+    for (i = 0; i < n; i++) {
+        if (!EVP_Digest(private_keys[i], 32, az, NULL, sha512, NULL))
+            goto err;
+
+        az[0] &= 248;
+        az[31] &= 63;
+        az[31] |= 64;
+
+        ge_scalarmult_base(&A[i], az);
+        fe_copy(z[i], A[i].Z);
+    }
+
+    /* As ge_p3_tobytes(), with one inversion for all the keys */
+    fe_batch_invert(z + n, z, n);
+    for (i = 0; i < n; i++) {
+        fe_mul(x, A[i].X, z[n + i]);
+        fe_mul(y, A[i].Y, z[n + i]);
+        fe_tobytes(out_public_keys[i], y);
+        out_public_keys[i][31] ^= fe_isnegative(x) << 7;
+    }
+    r = 1;
+
+ err:
+    OPENSSL_cleanse(az, sizeof(az));
+    OPENSSL_clear_free(A, n * sizeof(*A));
+    OPENSSL_clear_free(z, 2 * n * sizeof(*z));
+    EVP_MD_free(sha512);
+    return r;
+}
+
 int X25519(uint8_t out_shared_key[32], const uint8_t private_key[32],
            const uint8_t peer_public_value[32])
 {
@@ -5642,3 +5924,98 @@ void X25519_public_from_private(uint8_t out_public_value[32],
 
     OPENSSL_cleanse(e, sizeof(e));
 }
+
+#ifdef X25519_LADDER_X4
+/*
+ * Computes the projective u-coordinates of the public values of four
+ * private keys at a time, with the ladder from the base point u=9, and
+ * leaves them in |u| and |v| as for the scalar path. Returns the number
+ * of keys done, which is 0 if the ladder isn't supported.
+ */
+static size_t x25519_public_from_private_x4(size_t n, fe *u, fe *v,
+                                            const uint8_t *const *private_keys)
+{
+    uint64_t xz[2][10][4], x1[10][4], k[4][4];
+    uint8_t e[32];
+    size_t i, done;
+    int w, j, lane;
+
+    memset(x1, 0, sizeof(x1));
+    for (lane = 0; lane < 4; lane++)
+        x1[0][lane] = 9;
+
+    for (done = 0; n - done >= 4; done += 4) {
+        for (lane = 0; lane < 4; lane++) {
+            memcpy(e, private_keys[done + lane], 32);
+            e[0] &= 248;
+            e[31] &= 127;
+            e[31] |= 64;
+            for (w = 0; w < 4; w++)
+                k[w][lane] = load_8(e + 8 * w);
+        }
+
+        if (!x25519_ladder_x4(xz, (const uint64_t (*)[4])x1,
+                              (const uint64_t (*)[4])k))
+            break;
+
+        for (lane = 0; lane < 4; lane++) {
+            i = done + lane;
+            for (j = 0; j < 10; j++) {
+                u[i][j] = (int32_t)xz[0][j][lane];
+                v[i][j] = (int32_t)xz[1][j][lane];
+            }
+        }
+    }
+
+    OPENSSL_cleanse(e, sizeof(e));
+    OPENSSL_cleanse(k, sizeof(k));
+    OPENSSL_cleanse(xz, sizeof(xz));
+    return done;
+}
+#endif
+
+int X25519_public_from_private_batch(size_t n,
+                                     uint8_t *const *out_public_values,
+                                     const uint8_t *const *private_keys)
+{
+    uint8_t e[32];
+    ge_p3 A;
+    fe *uv = NULL;
+    size_t i = 0;
+
+    if (n == 0)
+        return 1;
+
+    /*
+     * u_i = (Z_i+Y_i)/(Z_i-Y_i), the numerators are followed by the
+     * denominators and their inverses.
+     */
+    if (n > SIZE_MAX / (3 * sizeof(*uv))
+        || (uv = OPENSSL_malloc(3 * n * sizeof(*uv))) == NULL)
+        return 0;
+
+#ifdef X25519_LADDER_X4
+    i = x25519_public_from_private_x4(n, uv, uv + n, private_keys);
+#endif
+    for (; i < n; i++) {
+        memcpy(e, private_keys[i], 32);
+        e[0] &= 248;
+        e[31] &= 127;
+        e[31] |= 64;
+
+        ge_scalarmult_base(&A, e);
+        fe_add(uv[i], A.Z, A.Y);
+        fe_sub(uv[n + i], A.Z, A.Y);
+    }
+
+    fe_batch_invert(uv + 2 * n, uv + n, n);
+    for (i = 0; i < n; i++) {
+        fe_mul(uv[i], uv[i], uv[2 * n + i]);
+        fe_tobytes(out_public_values[i], uv[i]);
+    }
+
+    OPENSSL_cleanse(e, sizeof(e));
+    OPENSSL_cleanse(&A, sizeof(A));
+    OPENSSL_clear_free(uv, 3 * n * sizeof(*uv));
+    return 1;
+}
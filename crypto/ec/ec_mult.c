@@ -18,6 +18,7 @@
 #include <openssl/err.h>
 
 #include "internal/cryptlib.h"
+#include "internal/constant_time.h"
 #include "crypto/bn.h"
 #include "ec_local.h"
 #include "internal/refcount.h"
@@ -44,10 +45,27 @@ struct ec_pre_comp_st {
                                  * generator: 'num' pointers to EC_POINT
                                  * objects followed by a NULL */
     size_t num;                 /* numblocks * 2^(w-1) */
+    /* comb for constant time multiplication of the generator */
+    size_t comb_cols;           /* number of comb columns per table */
+    int comb_words;             /* words per affine coordinate */
+    BN_ULONG *comb;             /* EC_COMB_TABLES * (2^EC_COMB_TEETH - 1)
+                                 * affine points as X, Y word arrays */
+    EC_POINT *comb_offset;      /* starting value of the accumulator */
+    EC_POINT *comb_fixup;       /* removes the doubled offset again */
     CRYPTO_REF_COUNT references;
     CRYPTO_RWLOCK *lock;
 };
 
+/*
+ * Comb parameters: the scalar is split into EC_COMB_TEETH rows, and every
+ * row into EC_COMB_TABLES blocks, see ec_scalar_mul_comb().
+ */
+#define EC_COMB_TEETH   4
+#define EC_COMB_TABLES  2
+
+static const EC_PRE_COMP *ec_pre_comp_get(const EC_GROUP *group,
+                                          BN_CTX *ctx);
+
 static EC_PRE_COMP *ec_pre_comp_new(const EC_GROUP *group)
 {
     EC_PRE_COMP *ret = NULL;
@@ -103,6 +121,9 @@ void EC_ec_pre_comp_free(EC_PRE_COMP *pre)
             EC_POINT_free(*pts);
         OPENSSL_free(pre->points);
     }
+    OPENSSL_free(pre->comb);
+    EC_POINT_free(pre->comb_offset);
+    EC_POINT_free(pre->comb_fixup);
     CRYPTO_THREAD_lock_free(pre->lock);
     OPENSSL_free(pre);
 }
@@ -384,6 +405,165 @@ int ec_scalar_mul_ladder(const EC_GROUP *group, EC_POINT *r,
     return ret;
 }
 
+/*-
+ * This function computes scalar * generator using the comb precomputed by
+ * ec_comb_precompute(), with the same timing attack defenses as
+ * ec_scalar_mul_ladder():
+ *
+ * The scalar is viewed as EC_COMB_TEETH rows of |block| bits, each split
+ * into EC_COMB_TABLES blocks of |cols| bits.  Entry i of table k is the sum
+ * of 2^(j * block + k * cols) * generator over the bits j set in i, so one
+ * column of the comb costs one doubling and EC_COMB_TABLES additions.
+ *
+ * Every table lookup reads all entries, and an addition is performed even
+ * for a zero index, its result being discarded with a conditional swap. To
+ * avoid the point at infinity the accumulator starts at a fixed multiple of
+ * the generator, which is subtracted again at the end.
+ *
+ * `scalar` must be non-negative and fit in the comb, otherwise use
+ * ec_scalar_mul_ladder().
+ *
+ * Returns 1 on success, 0 otherwise.
+ */
+static int ec_scalar_mul_comb(const EC_GROUP *group, EC_POINT *r,
+                              const BIGNUM *scalar, const EC_PRE_COMP *pre,
+                              BN_CTX *ctx)
+{
+    EC_POINT *sel = NULL, *sum = NULL;
+    BIGNUM *k, *t;
+    BN_ULONG *kd = NULL, *xy, mask;
+    const BN_ULONG *tab;
+    size_t block = pre->comb_cols * EC_COMB_TABLES;
+    size_t entries = ((size_t)1 << EC_COMB_TEETH) - 1;
+    size_t c, i, j, n, idx, pos, add;
+    int words = pre->comb_words, group_top, Z_is_one;
+    int kwords = (EC_COMB_TEETH * block + BN_BITS2 - 1) / BN_BITS2;
+    int ret = 0;
+
+    BN_CTX_start(ctx);
+    k = BN_CTX_get(ctx);
+    t = BN_CTX_get(ctx);
+    if (t == NULL
+        || bn_wexpand(k, kwords) == NULL
+        || bn_wexpand(t, 2 * words) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    if ((sel = EC_POINT_new(group)) == NULL
+        || (sum = EC_POINT_new(group)) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    /*
+     * Copy the scalar into a zero padded buffer, so that reading its bits
+     * does not depend on scalar->top.
+     */
+    if (!bn_copy_words(bn_get_words(k), scalar, kwords)) {
+        ERR_raise(ERR_LIB_EC, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    kd = bn_get_words(k);
+    xy = bn_get_words(t);
+
+    if (!EC_POINT_copy(r, pre->comb_offset)
+        || !EC_POINT_copy(sel, pre->comb_offset)) {
+        ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+        goto err;
+    }
+
+    /*
+     * Blind the projective coordinates of the accumulator, as
+     * ec_GFp_simple_ladder_pre() does. This also clears r->Z_is_one, so
+     * that whether r is affine, which selects faster paths in the point
+     * addition and doubling, does not depend on the first digits.
+     */
+    if (!ec_point_blind_coordinates(group, r, ctx)) {
+        ERR_raise(ERR_LIB_EC, EC_R_POINT_COORDINATES_BLIND_FAILURE);
+        goto err;
+    }
+
+    EC_POINT_BN_set_flags(r, BN_FLG_CONSTTIME);
+    EC_POINT_BN_set_flags(sel, BN_FLG_CONSTTIME);
+    EC_POINT_BN_set_flags(sum, BN_FLG_CONSTTIME);
+
+    group_top = bn_get_top(group->field);
+    if ((bn_wexpand(sum->X, group_top) == NULL)
+        || (bn_wexpand(sum->Y, group_top) == NULL)
+        || (bn_wexpand(sum->Z, group_top) == NULL)
+        || (bn_wexpand(r->X, group_top) == NULL)
+        || (bn_wexpand(r->Y, group_top) == NULL)
+        || (bn_wexpand(r->Z, group_top) == NULL)) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+
+#define EC_POINT_CSWAP(c, a, b, w, t) do {         \
+        BN_consttime_swap(c, (a)->X, (b)->X, w);   \
+        BN_consttime_swap(c, (a)->Y, (b)->Y, w);   \
+        BN_consttime_swap(c, (a)->Z, (b)->Z, w);   \
+        t = ((a)->Z_is_one ^ (b)->Z_is_one) & (c); \
+        (a)->Z_is_one ^= (t);                      \
+        (b)->Z_is_one ^= (t);                      \
+} while(0)
+
+    for (c = pre->comb_cols; c-- > 0;) {
+        if (c != pre->comb_cols - 1 && !EC_POINT_dbl(group, r, r, ctx)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+            goto err;
+        }
+
+        for (n = 0; n < EC_COMB_TABLES; n++) {
+            idx = 0;
+            for (j = 0; j < EC_COMB_TEETH; j++) {
+                pos = j * block + n * pre->comb_cols + c;
+                idx |= ((kd[pos / BN_BITS2] >> (pos % BN_BITS2)) & 1) << j;
+            }
+
+            /* There is no entry 0, use entry 1 and discard the sum */
+            add = ~constant_time_is_zero_s(idx) & 1;
+            idx |= add ^ 1;
+
+            tab = pre->comb + n * entries * 2 * words;
+            memset(xy, 0, sizeof(*xy) * 2 * words);
+            for (i = 1; i <= entries; i++, tab += 2 * words) {
+                mask = (BN_ULONG)0 - (constant_time_eq_s(i, idx) & 1);
+                for (j = 0; j < (size_t)(2 * words); j++)
+                    xy[j] |= tab[j] & mask;
+            }
+            if (!bn_set_words(sel->X, xy, words)
+                || !bn_set_words(sel->Y, xy + words, words)) {
+                ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+                goto err;
+            }
+
+            if (!EC_POINT_add(group, sum, r, sel, ctx)) {
+                ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+                goto err;
+            }
+            EC_POINT_CSWAP(add, r, sum, group_top, Z_is_one);
+        }
+    }
+#undef EC_POINT_CSWAP
+
+    if (!EC_POINT_add(group, r, r, pre->comb_fixup, ctx)) {
+        ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+        goto err;
+    }
+
+    ret = 1;
+
+ err:
+    if (kd != NULL)
+        OPENSSL_cleanse(kd, sizeof(*kd) * kwords);
+    EC_POINT_clear_free(sel);
+    EC_POINT_clear_free(sum);
+    BN_CTX_end(ctx);
+
+    return ret;
+}
+
 #undef EC_POINT_BN_set_flags
 
 /*
@@ -400,6 +580,180 @@ int ec_scalar_mul_ladder(const EC_GROUP *group, EC_POINT *r,
                   (b) >=   20 ? 2 : \
                   1))
 
+/*
+ * Multi-scalar multiplications with at least this many points use
+ * Pippenger's bucket method instead of interleaved wNAFs, see
+ * ec_pippenger_mul().
+ */
+#define EC_PIPPENGER_MIN_POINTS 80
+
+/*-
+ * Computes
+ *      \sum scalars[i]*points[i] + scalar*generator
+ * using Pippenger's bucket method. Every scalar is recoded into signed
+ * base 2^c digits in [-2^(c-1), 2^(c-1)]. For each window, starting from the
+ * most significant one, every point is added to (or, for a negative digit,
+ * its negation is subtracted from) the bucket for the absolute value of its
+ * digit, after which the weighted sum of the buckets is obtained with a
+ * running sum: 2^(c-1) * B[2^(c-1)] + ... + 2 * B[2] + B[1].
+ *
+ * The cost is about (bits / c) * (num + 2^c) point additions, compared to
+ * about num * (bits / (w + 1) + 2^(w-1)) for the interleaved wNAF method, so
+ * this only pays off for a large number of points. Like the wNAF method, the
+ * execution time depends on the scalars, so this must only be used with
+ * public scalars.
+ */
+static int ec_pippenger_mul(const EC_GROUP *group, EC_POINT *r,
+                            const BIGNUM *scalar, size_t num,
+                            const EC_POINT *points[],
+                            const BIGNUM *scalars[], BN_CTX *ctx)
+{
+    size_t total = num + (scalar != NULL);
+    size_t nbuckets, nwin, i, b;
+    EC_POINT **pts = NULL, **buckets = NULL;
+    EC_POINT *acc = NULL, *sum = NULL, *tot = NULL;
+    int *digits = NULL;
+    int c, j, w, bits = 1, best_c = 1, ret = 0;
+    size_t cost, best_cost = 0;
+
+    for (i = 0; i < total; i++) {
+        const BIGNUM *k = i < num ? scalars[i] : scalar;
+
+        if (BN_num_bits(k) > bits)
+            bits = BN_num_bits(k);
+    }
+
+    /*
+     * Pick the window size with the lowest estimated number of additions;
+     * the extra window takes the carry out of the most significant digit.
+     */
+    for (c = 1; c <= 16; c++) {
+        cost = ((size_t)bits / c + 1) * (total + ((size_t)1 << c));
+        if (best_cost == 0 || cost < best_cost) {
+            best_cost = cost;
+            best_c = c;
+        }
+    }
+    c = best_c;
+    nwin = (size_t)bits / c + 1;
+    nbuckets = (size_t)1 << (c - 1);
+
+    if (total > OPENSSL_MALLOC_MAX_NELEMS(EC_POINT *) / 2
+        || total > OPENSSL_MALLOC_MAX_NELEMS(int) / nwin) {
+        ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    pts = OPENSSL_zalloc(sizeof(*pts) * 2 * total);
+    buckets = OPENSSL_zalloc(sizeof(*buckets) * nbuckets);
+    digits = OPENSSL_malloc(sizeof(*digits) * total * nwin);
+    if (pts == NULL || buckets == NULL || digits == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    /*
+     * The points and their negations, in affine coordinates to make the
+     * bucket additions cheaper.
+     */
+    for (i = 0; i < total; i++) {
+        const EC_POINT *p = i < num ? points[i] : group->generator;
+
+        if (p == NULL) {
+            ERR_raise(ERR_LIB_EC, EC_R_UNDEFINED_GENERATOR);
+            goto err;
+        }
+        if ((pts[i] = EC_POINT_dup(p, group)) == NULL)
+            goto err;
+    }
+    if (group->meth->points_make_affine == NULL
+        || !group->meth->points_make_affine(group, total, pts, ctx))
+        goto err;
+    for (i = 0; i < total; i++) {
+        if ((pts[total + i] = EC_POINT_dup(pts[i], group)) == NULL
+            || !EC_POINT_invert(group, pts[total + i], ctx))
+            goto err;
+    }
+
+    for (i = 0; i < total; i++) {
+        const BIGNUM *k = i < num ? scalars[i] : scalar;
+        int neg = BN_is_negative(k), carry = 0, d;
+
+        for (w = 0; (size_t)w < nwin; w++) {
+            for (d = 0, j = c - 1; j >= 0; j--)
+                d = (d << 1) | BN_is_bit_set(k, w * c + j);
+            d += carry;
+            carry = d > (int)nbuckets;
+            if (carry)
+                d -= 1 << c;
+            digits[i * nwin + w] = neg ? -d : d;
+        }
+    }
+
+    for (b = 0; b < nbuckets; b++)
+        if ((buckets[b] = EC_POINT_new(group)) == NULL)
+            goto err;
+    if ((acc = EC_POINT_new(group)) == NULL
+        || (sum = EC_POINT_new(group)) == NULL
+        || (tot = EC_POINT_new(group)) == NULL)
+        goto err;
+    if (!EC_POINT_set_to_infinity(group, acc))
+        goto err;
+
+    for (w = (int)nwin - 1; w >= 0; w--) {
+        if (!EC_POINT_is_at_infinity(group, acc))
+            for (j = 0; j < c; j++)
+                if (!EC_POINT_dbl(group, acc, acc, ctx))
+                    goto err;
+
+        for (b = 0; b < nbuckets; b++)
+            if (!EC_POINT_set_to_infinity(group, buckets[b]))
+                goto err;
+        for (i = 0; i < total; i++) {
+            int d = digits[i * nwin + w];
+
+            if (d > 0) {
+                if (!EC_POINT_add(group, buckets[d - 1], buckets[d - 1],
+                                  pts[i], ctx))
+                    goto err;
+            } else if (d < 0) {
+                if (!EC_POINT_add(group, buckets[-d - 1], buckets[-d - 1],
+                                  pts[total + i], ctx))
+                    goto err;
+            }
+        }
+
+        if (!EC_POINT_set_to_infinity(group, sum)
+            || !EC_POINT_set_to_infinity(group, tot))
+            goto err;
+        for (b = nbuckets; b > 0; b--) {
+            if (!EC_POINT_add(group, sum, sum, buckets[b - 1], ctx)
+                || !EC_POINT_add(group, tot, tot, sum, ctx))
+                goto err;
+        }
+        if (!EC_POINT_add(group, acc, acc, tot, ctx))
+            goto err;
+    }
+
+    if (!EC_POINT_copy(r, acc))
+        goto err;
+    ret = 1;
+
+ err:
+    if (pts != NULL)
+        for (i = 0; i < 2 * total; i++)
+            EC_POINT_free(pts[i]);
+    if (buckets != NULL)
+        for (b = 0; b < nbuckets; b++)
+            EC_POINT_free(buckets[b]);
+    OPENSSL_free(pts);
+    OPENSSL_free(buckets);
+    OPENSSL_free(digits);
+    EC_POINT_free(acc);
+    EC_POINT_free(sum);
+    EC_POINT_free(tot);
+    return ret;
+}
+
 /*-
  * Compute
  *      \sum scalars[i]*points[i],
@@ -448,8 +802,17 @@ int ec_wNAF_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *scalar,
              * generation of EC cryptosystems (i.e. ECDSA keygen and sign setup,
              * ECDH keygen/first half), where the scalar is always secret. This
              * is why we ignore if BN_FLG_CONSTTIME is actually set and we
-             * always call the ladder version.
+             * always call the ladder version, or the comb version if the
+             * generator has been precomputed.
              */
+            pre_comp = ec_pre_comp_get(group, ctx);
+            if (pre_comp != NULL && pre_comp->comb != NULL
+                && !BN_is_negative(scalar)
+                && (size_t)BN_num_bits(scalar)
+                   <= pre_comp->comb_cols * EC_COMB_TABLES * EC_COMB_TEETH
+                && EC_POINT_cmp(group, group->generator, pre_comp->points[0],
+                                ctx) == 0)
+                return ec_scalar_mul_comb(group, r, scalar, pre_comp, ctx);
             return ec_scalar_mul_ladder(group, r, scalar, NULL, ctx);
         }
         if ((scalar == NULL) && (num == 1) && (scalars[0] != group->order)) {
@@ -464,6 +827,9 @@ int ec_wNAF_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *scalar,
         }
     }
 
+    if (num + (scalar != NULL) >= EC_PIPPENGER_MIN_POINTS)
+        return ec_pippenger_mul(group, r, scalar, num, points, scalars, ctx);
+
     if (scalar != NULL) {
         generator = EC_GROUP_get0_generator(group);
         if (generator == NULL) {
@@ -473,7 +839,7 @@ int ec_wNAF_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *scalar,
 
         /* look if we can use precomputed multiples of generator */
 
-        pre_comp = group->pre_comp.ec;
+        pre_comp = ec_pre_comp_get(group, ctx);
         if (pre_comp && pre_comp->numblocks
             && (EC_POINT_cmp(group, generator, pre_comp->points[0], ctx) ==
                 0)) {
@@ -806,10 +1172,136 @@ int ec_wNAF_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *scalar,
     return ret;
 }
 
+/*
+ * Computes the comb used by ec_scalar_mul_comb().  If the group is unusual
+ * enough that an entry is the point at infinity, no comb is created and
+ * ec_scalar_mul_ladder() is used instead.
+ */
+static int ec_comb_precompute(const EC_GROUP *group, EC_PRE_COMP *pre_comp,
+                              BN_CTX *ctx)
+{
+    EC_POINT **points = NULL, **tab, *base = NULL, *offset, *fixup;
+    BIGNUM *x;
+    BN_ULONG *comb = NULL, *d;
+    size_t entries = ((size_t)1 << EC_COMB_TEETH) - 1;
+    size_t num = entries * EC_COMB_TABLES + 2;
+    size_t cols, i, j, k, t;
+    int words, ret = 0;
+
+    cols = (BN_num_bits(group->order) + EC_COMB_TEETH * EC_COMB_TABLES - 1)
+           / (EC_COMB_TEETH * EC_COMB_TABLES);
+    words = bn_get_top(group->field);
+
+    BN_CTX_start(ctx);
+    if ((x = BN_CTX_get(ctx)) == NULL)
+        goto err;
+
+    points = OPENSSL_zalloc(sizeof(*points) * num);
+    comb = OPENSSL_malloc(sizeof(*comb) * 2 * words * (num - 2));
+    if (points == NULL || comb == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    for (i = 0; i < num; i++) {
+        if ((points[i] = EC_POINT_new(group)) == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+    }
+    if ((base = EC_POINT_new(group)) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    offset = points[num - 2];
+    fixup = points[num - 1];
+
+    if (!EC_POINT_copy(base, group->generator))
+        goto err;
+
+    /*
+     * base = 2^(t * cols) * generator = 2^(j * block + k * cols) * generator
+     * completes the entries of table k whose highest set bit is j.
+     */
+    for (t = 0; t < EC_COMB_TEETH * EC_COMB_TABLES; t++) {
+        j = t / EC_COMB_TABLES;
+        k = t % EC_COMB_TABLES;
+        tab = points + k * entries;
+
+        if (t > 0)
+            for (i = 0; i < cols; i++)
+                if (!EC_POINT_dbl(group, base, base, ctx))
+                    goto err;
+
+        /* Entry i is stored at tab[i - 1] */
+        if (!EC_POINT_copy(tab[((size_t)1 << j) - 1], base))
+            goto err;
+        for (i = ((size_t)1 << j) + 1; i < (size_t)2 << j; i++)
+            if (!EC_POINT_add(group, tab[i - 1],
+                              tab[i - ((size_t)1 << j) - 1], base, ctx))
+                goto err;
+    }
+
+    /*
+     * The accumulator starts at x(generator) * generator, a multiple without
+     * any relation to the table entries, which has been doubled cols - 1
+     * times at the end.
+     */
+    if (!EC_POINT_get_affine_coordinates(group, group->generator, x, NULL,
+                                         ctx)
+        || !BN_nnmod(x, x, group->order, ctx)
+        || !ec_scalar_mul_ladder(group, offset, x, NULL, ctx)
+        || !EC_POINT_copy(fixup, offset))
+        goto err;
+    for (i = 1; i < cols; i++)
+        if (!EC_POINT_dbl(group, fixup, fixup, ctx))
+            goto err;
+    if (!EC_POINT_invert(group, fixup, ctx))
+        goto err;
+
+    if (group->meth->points_make_affine == NULL
+        || !group->meth->points_make_affine(group, num, points, ctx))
+        goto err;
+
+    for (i = 0; i < num; i++)
+        if (EC_POINT_is_at_infinity(group, points[i])) {
+            ret = 1;
+            goto err;
+        }
+
+    for (i = 0, d = comb; i < num - 2; i++, d += 2 * words) {
+        if (!bn_copy_words(d, points[i]->X, words)
+            || !bn_copy_words(d + words, points[i]->Y, words)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_INTERNAL_ERROR);
+            goto err;
+        }
+    }
+
+    pre_comp->comb_cols = cols;
+    pre_comp->comb_words = words;
+    pre_comp->comb = comb;
+    comb = NULL;
+    pre_comp->comb_offset = offset;
+    pre_comp->comb_fixup = fixup;
+    points[num - 2] = points[num - 1] = NULL;
+    ret = 1;
+
+ err:
+    BN_CTX_end(ctx);
+    if (points != NULL) {
+        for (i = 0; i < num; i++)
+            EC_POINT_free(points[i]);
+        OPENSSL_free(points);
+    }
+    OPENSSL_free(comb);
+    EC_POINT_free(base);
+    return ret;
+}
+
 /*-
- * ec_wNAF_precompute_mult()
+ * ec_pre_comp_build()
  * creates an EC_PRE_COMP object with preprecomputed multiples of the generator
- * for use with wNAF splitting as implemented in ec_wNAF_mul().
+ * for use with wNAF splitting as implemented in ec_wNAF_mul(), and the comb
+ * used by ec_scalar_mul_comb().
  *
  * 'pre_comp->points' is an array of multiples of the generator
  * of the following form:
@@ -826,24 +1318,21 @@ int ec_wNAF_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *scalar,
  * points[2^(w-1)*numblocks-1]     = (2^(w-1)) *  2^(blocksize*(numblocks-1)) * generator
  * points[2^(w-1)*numblocks]       = NULL
  */
-int ec_wNAF_precompute_mult(EC_GROUP *group, BN_CTX *ctx)
+static EC_PRE_COMP *ec_pre_comp_build(const EC_GROUP *group, BN_CTX *ctx)
 {
     const EC_POINT *generator;
     EC_POINT *tmp_point = NULL, *base = NULL, **var;
     const BIGNUM *order;
     size_t i, bits, w, pre_points_per_block, blocksize, numblocks, num;
     EC_POINT **points = NULL;
-    EC_PRE_COMP *pre_comp;
-    int ret = 0;
+    EC_PRE_COMP *pre_comp, *ret = NULL;
     int used_ctx = 0;
 #ifndef FIPS_MODULE
     BN_CTX *new_ctx = NULL;
 #endif
 
-    /* if there is an old EC_PRE_COMP object, throw it away */
-    EC_pre_comp_free(group);
     if ((pre_comp = ec_pre_comp_new(group)) == NULL)
-        return 0;
+        return NULL;
 
     generator = EC_GROUP_get0_generator(group);
     if (generator == NULL) {
@@ -964,9 +1453,12 @@ int ec_wNAF_precompute_mult(EC_GROUP *group, BN_CTX *ctx)
     pre_comp->points = points;
     points = NULL;
     pre_comp->num = num;
-    SETPRECOMP(group, ec, pre_comp);
+
+    if (!ec_comb_precompute(group, pre_comp, ctx))
+        goto err;
+
+    ret = pre_comp;
     pre_comp = NULL;
-    ret = 1;
 
  err:
     if (used_ctx)
@@ -987,7 +1479,140 @@ int ec_wNAF_precompute_mult(EC_GROUP *group, BN_CTX *ctx)
     return ret;
 }
 
+int ec_wNAF_precompute_mult(EC_GROUP *group, BN_CTX *ctx)
+{
+    EC_PRE_COMP *pre_comp;
+
+    /* if there is an old EC_PRE_COMP object, throw it away */
+    EC_pre_comp_free(group);
+    if ((pre_comp = ec_pre_comp_build(group, ctx)) == NULL)
+        return 0;
+    SETPRECOMP(group, ec, pre_comp);
+    return 1;
+}
+
 int ec_wNAF_have_precompute_mult(const EC_GROUP *group)
 {
     return HAVEPRECOMP(group, ec);
 }
+
+/*
+ * Precomputation for named curves, built the first time a curve is used in a
+ * library context and shared read-only by all EC_GROUPs of that curve and
+ * method from then on.  Groups with precomputation of their own, from
+ * EC_GROUP_precompute_mult(), keep using that.
+ */
+typedef struct {
+    int curve_name;
+    const EC_METHOD *meth;
+    EC_PRE_COMP *pre_comp;      /* NULL if precomputation failed */
+} EC_PRE_COMP_CACHE_ENTRY;
+
+typedef struct {
+    CRYPTO_RWLOCK *lock;
+    EC_PRE_COMP_CACHE_ENTRY *entries;
+    size_t num;
+    size_t size;
+} EC_PRE_COMP_CACHE;
+
+static void *ec_pre_comp_cache_new(OSSL_LIB_CTX *libctx)
+{
+    EC_PRE_COMP_CACHE *cache = OPENSSL_zalloc(sizeof(*cache));
+
+    if (cache == NULL)
+        return NULL;
+
+    cache->lock = CRYPTO_THREAD_lock_new();
+    if (cache->lock == NULL) {
+        OPENSSL_free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static void ec_pre_comp_cache_free(void *vcache)
+{
+    EC_PRE_COMP_CACHE *cache = vcache;
+    size_t i;
+
+    if (cache == NULL)
+        return;
+
+    for (i = 0; i < cache->num; i++)
+        EC_ec_pre_comp_free(cache->entries[i].pre_comp);
+    OPENSSL_free(cache->entries);
+    CRYPTO_THREAD_lock_free(cache->lock);
+    OPENSSL_free(cache);
+}
+
+static const OSSL_LIB_CTX_METHOD ec_pre_comp_cache_method = {
+    ec_pre_comp_cache_new,
+    ec_pre_comp_cache_free,
+};
+
+static EC_PRE_COMP_CACHE_ENTRY *ec_pre_comp_cache_find(EC_PRE_COMP_CACHE *cache,
+                                                       const EC_GROUP *group)
+{
+    size_t i;
+
+    for (i = 0; i < cache->num; i++)
+        if (cache->entries[i].curve_name == group->curve_name
+            && cache->entries[i].meth == group->meth)
+            return &cache->entries[i];
+    return NULL;
+}
+
+static const EC_PRE_COMP *ec_pre_comp_get(const EC_GROUP *group,
+                                          BN_CTX *ctx)
+{
+    EC_PRE_COMP_CACHE *cache;
+    EC_PRE_COMP_CACHE_ENTRY *ent, *tmp;
+    EC_PRE_COMP *pre_comp;
+
+    if (HAVEPRECOMP(group, ec))
+        return group->pre_comp.ec;
+    if (group->curve_name == NID_undef || group->generator == NULL)
+        return NULL;
+
+    cache = ossl_lib_ctx_get_data(group->libctx, OSSL_LIB_CTX_EC_PRE_COMP_INDEX,
+                                  &ec_pre_comp_cache_method);
+    if (cache == NULL || !CRYPTO_THREAD_read_lock(cache->lock))
+        return NULL;
+    ent = ec_pre_comp_cache_find(cache, group);
+    pre_comp = ent != NULL ? ent->pre_comp : NULL;
+    CRYPTO_THREAD_unlock(cache->lock);
+    if (ent != NULL)
+        return pre_comp;
+
+    /* Failing to precompute is not an error, it is just slower */
+    ERR_set_mark();
+    pre_comp = ec_pre_comp_build(group, ctx);
+    ERR_pop_to_mark();
+    if (pre_comp != NULL)
+        pre_comp->group = NULL;     /* it outlives |group| */
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock)) {
+        EC_ec_pre_comp_free(pre_comp);
+        return NULL;
+    }
+    ent = ec_pre_comp_cache_find(cache, group);
+    if (ent == NULL && cache->num == cache->size) {
+        tmp = OPENSSL_realloc(cache->entries,
+                              sizeof(*tmp) * (cache->size + 8));
+        if (tmp != NULL) {
+            cache->entries = tmp;
+            cache->size += 8;
+        }
+    }
+    if (ent == NULL && cache->num < cache->size) {
+        ent = &cache->entries[cache->num++];
+        ent->curve_name = group->curve_name;
+        ent->meth = group->meth;
+        ent->pre_comp = pre_comp;
+        pre_comp = NULL;
+    }
+    EC_ec_pre_comp_free(pre_comp);
+    pre_comp = ent != NULL ? ent->pre_comp : NULL;
+    CRYPTO_THREAD_unlock(cache->lock);
+    return pre_comp;
+}
@@ -13,6 +13,7 @@
  */
 #include "internal/deprecated.h"
 
+#include <limits.h>
 #include <string.h>
 #include <openssl/err.h>
 #include <openssl/obj_mac.h>
@@ -322,6 +323,282 @@ ECDSA_SIG *ecdsa_simple_sign_sig(const unsigned char *dgst, int dgst_len,
     return ret;
 }
 
+/*
+ * Montgomery's trick: set out[i] to the inverse of a[i] for the |n| non-zero
+ * values in |a|, using a single call to |inv| and 3 * (n - 1) Montgomery
+ * multiplications.  Both |a| and |out| are in the Montgomery domain of
+ * |mont|.  |inv| works on plain values and is expected to be either
+ * constant time or blinded; everything else is done on fixed-top values.
+ */
+static int ecdsa_batch_inverse(const EC_GROUP *group, BIGNUM *out[],
+                               BIGNUM *const a[], size_t n, BN_MONT_CTX *mont,
+                               int (*inv)(const EC_GROUP *group, BIGNUM *r,
+                                          const BIGNUM *x, BN_CTX *ctx),
+                               BN_CTX *ctx)
+{
+    BIGNUM *u;
+    size_t i;
+    int ret = 0;
+
+    BN_CTX_start(ctx);
+    if ((u = BN_CTX_get(ctx)) == NULL)
+        goto err;
+
+    /* out[i] := a[0] * ... * a[i] */
+    if (BN_copy(out[0], a[0]) == NULL)
+        goto err;
+    for (i = 1; i < n; i++)
+        if (!bn_mul_mont_fixed_top(out[i], out[i - 1], a[i], mont, ctx))
+            goto err;
+
+    /* u := (a[0] * ... * a[n - 1])^-1 */
+    if (!BN_from_montgomery(u, out[n - 1], mont, ctx)
+        || !inv(group, u, u, ctx)
+        || !bn_to_mont_fixed_top(u, u, mont, ctx))
+        goto err;
+
+    for (i = n - 1; i > 0; i--) {
+        /* out[i] := a[i]^-1 and u := (a[0] * ... * a[i - 1])^-1 */
+        if (!bn_mul_mont_fixed_top(out[i], u, out[i - 1], mont, ctx)
+            || !bn_mul_mont_fixed_top(u, u, a[i], mont, ctx))
+            goto err;
+    }
+    if (BN_copy(out[0], u) == NULL)
+        goto err;
+    ret = 1;
+ err:
+    BN_CTX_end(ctx);
+    return ret;
+}
+
+/*
+ * Inversion modulo the field prime, on plain (unencoded) values.  The affine
+ * x coordinate of the Jacobian point (x : 1 : x) is x / x^2 = 1 / x, so this
+ * borrows the group's own constant time inversion.
+ */
+static int ecdsa_field_inverse(const EC_GROUP *group, BIGNUM *r,
+                               const BIGNUM *x, BN_CTX *ctx)
+{
+    EC_POINT *p;
+    int ret;
+
+    if ((p = EC_POINT_new(group)) == NULL)
+        return 0;
+    ret = ec_GFp_simple_set_Jprojective_coordinates_GFp(group, p, x,
+                                                         BN_value_one(), x,
+                                                         ctx)
+        && EC_POINT_get_affine_coordinates(group, p, r, NULL, ctx);
+    EC_POINT_clear_free(p);
+    return ret;
+}
+
+/*
+ * Sign |n| digests with the same key.  Each signature is computed as in
+ * ecdsa_simple_sign_sig(), but the n inversions of k modulo
+ * the order and the n inversions of Z needed to get x(kG) out of Jacobian
+ * coordinates are each replaced by a single inversion and a few Montgomery
+ * multiplications per signature.  Single digests, and keys and groups that
+ * are not handled by ecdsa_simple_sign_sig() on a prime field, are signed
+ * one at a time.
+ */
+int ossl_ecdsa_sign_batch(EC_KEY *eckey, size_t n,
+                          const unsigned char *const dgst[],
+                          const size_t dgstlen[], ECDSA_SIG *sigs[])
+{
+    BIGNUM **bn = NULL, **k, **kinv, **X, **Z, **Zinv, **m;
+    EC_POINT **R = NULL;
+    BN_CTX *ctx = NULL;
+    BN_MONT_CTX *fmont = NULL;
+    const EC_GROUP *group;
+    const BIGNUM *order, *priv_key;
+    int order_bits, dlen, ok = 0;
+    size_t i;
+
+    if (eckey == NULL || (group = EC_KEY_get0_group(eckey)) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+    if ((priv_key = EC_KEY_get0_private_key(eckey)) == NULL) {
+        ERR_raise(ERR_LIB_EC, EC_R_MISSING_PRIVATE_KEY);
+        return 0;
+    }
+    if (!EC_KEY_can_sign(eckey)) {
+        ERR_raise(ERR_LIB_EC, EC_R_CURVE_DOES_NOT_SUPPORT_SIGNING);
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        if (dgstlen[i] > INT_MAX) {
+            ERR_raise(ERR_LIB_EC, EC_R_INVALID_DIGEST);
+            return 0;
+        }
+        sigs[i] = NULL;
+    }
+    if (n == 0)
+        return 1;
+
+    if (n == 1
+        || eckey->meth->sign_sig != ossl_ecdsa_sign_sig
+        || group->meth->ecdsa_sign_sig != ecdsa_simple_sign_sig
+        || group->meth->field_type != NID_X9_62_prime_field
+        || group->mont_data == NULL) {
+        for (i = 0; i < n; i++)
+            if ((sigs[i] = ECDSA_do_sign(dgst[i], (int)dgstlen[i],
+                                         eckey)) == NULL)
+                goto err;
+        return 1;
+    }
+
+    order = EC_GROUP_get0_order(group);
+    order_bits = BN_num_bits(order);
+
+    if ((ctx = BN_CTX_secure_new_ex(eckey->libctx)) == NULL
+        || (fmont = BN_MONT_CTX_new()) == NULL
+        || (bn = OPENSSL_zalloc(6 * n * sizeof(*bn))) == NULL
+        || (R = OPENSSL_zalloc(n * sizeof(*R))) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    k = bn;
+    kinv = bn + n;
+    X = bn + 2 * n;
+    Z = bn + 3 * n;
+    Zinv = bn + 4 * n;
+    m = bn + 5 * n;
+    for (i = 0; i < 6 * n; i++) {
+        if ((bn[i] = BN_secure_new()) == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+    }
+    if (!BN_MONT_CTX_set(fmont, group->field, ctx)) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    for (i = 0; i < n; i++) {
+        if ((R[i] = EC_POINT_new(group)) == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+            goto err;
+        }
+
+        /* Truncate the digest exactly as ecdsa_simple_sign_sig() does */
+        dlen = (int)dgstlen[i];
+        if (8 * dlen > order_bits)
+            dlen = (order_bits + 7) / 8;
+        if (!BN_bin2bn(dgst[i], dlen, m[i])
+            || ((8 * dlen > order_bits)
+                && !BN_rshift(m[i], m[i], 8 - (order_bits & 0x7)))) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+
+        /* Preallocate space */
+        if (!BN_set_bit(k[i], order_bits))
+            goto err;
+        do {
+            if (!BN_generate_dsa_nonce(k[i], order, priv_key,
+                                       dgst[i], dlen, ctx)) {
+                ERR_raise(ERR_LIB_EC, EC_R_RANDOM_NUMBER_GENERATION_FAILED);
+                goto err;
+            }
+        } while (BN_is_zero(k[i]));
+
+        if (!EC_POINT_mul(group, R[i], k[i], NULL, NULL, ctx)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+            goto err;
+        }
+
+        /*
+         * Take the Jacobian X and Z of kG out of the group's field encoding,
+         * and move Z^2 and k into the Montgomery domains of the field and of
+         * the order respectively.
+         */
+        if (group->meth->field_decode != NULL) {
+            if (!group->meth->field_decode(group, X[i], R[i]->X, ctx)
+                || !group->meth->field_decode(group, Z[i], R[i]->Z, ctx)) {
+                ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+                goto err;
+            }
+        } else if (BN_copy(X[i], R[i]->X) == NULL
+                   || BN_copy(Z[i], R[i]->Z) == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+        if (!bn_to_mont_fixed_top(Z[i], Z[i], fmont, ctx)
+            || !bn_mul_mont_fixed_top(Z[i], Z[i], Z[i], fmont, ctx)
+            || !bn_to_mont_fixed_top(k[i], k[i], group->mont_data, ctx)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+    }
+
+    if (!ecdsa_batch_inverse(group, Zinv, Z, n, fmont,
+                             ecdsa_field_inverse, ctx)
+        || !ecdsa_batch_inverse(group, kinv, k, n, group->mont_data,
+                                ec_group_do_inverse_ord, ctx)) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    for (i = 0; i < n; i++) {
+        BIGNUM *r, *s;
+
+        if ((sigs[i] = ECDSA_SIG_new()) == NULL
+            || (sigs[i]->r = BN_new()) == NULL
+            || (sigs[i]->s = BN_new()) == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+        r = sigs[i]->r;
+        s = sigs[i]->s;
+
+        /*
+         * r := X / Z^2 mod order and s := k^-1 * (m + r * priv_key).  As in
+         * ecdsa_simple_sign_sig(), with only one multiplicand in the
+         * Montgomery domain the product comes out as a plain value.
+         */
+        if (!BN_mod_mul_montgomery(r, X[i], Zinv[i], fmont, ctx)
+            || !BN_nnmod(r, r, order, ctx)
+            || !bn_to_mont_fixed_top(s, r, group->mont_data, ctx)
+            || !bn_mul_mont_fixed_top(s, s, priv_key, group->mont_data, ctx)
+            || !bn_mod_add_fixed_top(s, s, m[i], order)
+            || !BN_mod_mul_montgomery(s, s, kinv[i], group->mont_data,
+                                      ctx)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+
+        if (BN_is_zero(r) || BN_is_zero(s)) {
+            /* Vanishingly unlikely: start this one over on its own */
+            ECDSA_SIG_free(sigs[i]);
+            sigs[i] = ecdsa_simple_sign_sig(dgst[i], (int)dgstlen[i],
+                                            NULL, NULL, eckey);
+            if (sigs[i] == NULL)
+                goto err;
+        }
+    }
+
+    ok = 1;
+ err:
+    if (!ok) {
+        for (i = 0; i < n; i++) {
+            ECDSA_SIG_free(sigs[i]);
+            sigs[i] = NULL;
+        }
+    }
+    if (bn != NULL)
+        for (i = 0; i < 6 * n; i++)
+            BN_clear_free(bn[i]);
+    OPENSSL_free(bn);
+    if (R != NULL)
+        for (i = 0; i < n; i++)
+            EC_POINT_clear_free(R[i]);
+    OPENSSL_free(R);
+    BN_MONT_CTX_free(fmont);
+    BN_CTX_free(ctx);
+    return ok;
+}
+
 /*-
  * returns
  *      1: correct signature
@@ -0,0 +1,1948 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * ECDSA low level APIs are deprecated for public use, but still ok for
+ * internal use.
+ */
+#include "internal/deprecated.h"
+
+/*
+ * A 64-bit implementation of the NIST P-384 elliptic curve point multiplication
+ *
+ * OpenSSL integration, the field representation and group operations follow
+ * ecp_nistp224.c and ecp_nistp521.c: field elements are held in 56-bit limbs
+ * with enough headroom to add and subtract them without carrying, and
+ * products are reduced using the special form of p.
+ */
+
+#include <openssl/e_os2.h>
+
+#include <string.h>
+#include <openssl/err.h>
+#include "ec_local.h"
+
+#if defined(__SIZEOF_INT128__) && __SIZEOF_INT128__==16
+  /* even with gcc, the typedef won't work for 32-bit platforms */
+typedef __uint128_t uint128_t;  /* nonstandard; implemented by gcc on 64-bit
+                                 * platforms */
+typedef __int128_t int128_t;
+#else
+# error "Your compiler doesn't appear to support 128-bit integer types"
+#endif
+
+typedef uint8_t u8;
+typedef uint64_t u64;
+
+/*
+ * The underlying field. P384 operates over GF(2^384-2^128-2^96+2^32-1). We
+ * can serialize an element of this field into 48 bytes. We call this an
+ * felem_bytearray.
+ */
+
+typedef u8 felem_bytearray[48];
+
+/*
+ * These are the parameters of P384, taken from FIPS 186-3, section D.1.2.4.
+ * These values are big-endian.
+ */
+static const felem_bytearray nistp384_curve_params[5] = {
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, /* p */
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe,
+     0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, /* a = -3 */
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe,
+     0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xfc},
+    {0xb3, 0x31, 0x2f, 0xa7, 0xe2, 0x3e, 0xe7, 0xe4, /* b */
+     0x98, 0x8e, 0x05, 0x6b, 0xe3, 0xf8, 0x2d, 0x19,
+     0x18, 0x1d, 0x9c, 0x6e, 0xfe, 0x81, 0x41, 0x12,
+     0x03, 0x14, 0x08, 0x8f, 0x50, 0x13, 0x87, 0x5a,
+     0xc6, 0x56, 0x39, 0x8d, 0x8a, 0x2e, 0xd1, 0x9d,
+     0x2a, 0x85, 0xc8, 0xed, 0xd3, 0xec, 0x2a, 0xef},
+    {0xaa, 0x87, 0xca, 0x22, 0xbe, 0x8b, 0x05, 0x37, /* x */
+     0x8e, 0xb1, 0xc7, 0x1e, 0xf3, 0x20, 0xad, 0x74,
+     0x6e, 0x1d, 0x3b, 0x62, 0x8b, 0xa7, 0x9b, 0x98,
+     0x59, 0xf7, 0x41, 0xe0, 0x82, 0x54, 0x2a, 0x38,
+     0x55, 0x02, 0xf2, 0x5d, 0xbf, 0x55, 0x29, 0x6c,
+     0x3a, 0x54, 0x5e, 0x38, 0x72, 0x76, 0x0a, 0xb7},
+    {0x36, 0x17, 0xde, 0x4a, 0x96, 0x26, 0x2c, 0x6f, /* y */
+     0x5d, 0x9e, 0x98, 0xbf, 0x92, 0x92, 0xdc, 0x29,
+     0xf8, 0xf4, 0x1d, 0xbd, 0x28, 0x9a, 0x14, 0x7c,
+     0xe9, 0xda, 0x31, 0x13, 0xb5, 0xf0, 0xb8, 0xc0,
+     0x0a, 0x60, 0xb1, 0xce, 0x1d, 0x7e, 0x81, 0x9d,
+     0x7a, 0x43, 0x1d, 0x7c, 0x90, 0xea, 0x0e, 0x5f}
+};
+
+/*-
+ * The representation of field elements.
+ * ------------------------------------
+ *
+ * We represent field elements with seven values. These are either 64 or 128
+ * bits and the field element represented is:
+ *   v[0]*2^0 + v[1]*2^56 + v[2]*2^112 + ... + v[6]*2^336  (mod p)
+ * Each of the seven values is called a 'limb'. Since the limbs are spaced only
+ * 56 bits apart, but are greater than 56 bits in length, the most significant
+ * bits of each limb overlap with the least significant bits of the next.
+ *
+ * A field element with 64-bit limbs is an 'felem'. One with 128-bit limbs is a
+ * 'widefelem', which has thirteen limbs to hold the result of a multiplication
+ * of two felems.
+ */
+
+#define NLIMBS 7
+
+typedef uint64_t limb;
+typedef uint64_t limb_aX __attribute((__aligned__(1)));
+typedef uint128_t widelimb;
+typedef limb felem[NLIMBS];
+typedef widelimb widefelem[2 * NLIMBS - 1];
+
+static const limb bottom56bits = 0x00ffffffffffffff;
+static const limb bottom48bits = 0x0000ffffffffffff;
+
+/* This is 2^384-2^128-2^96+2^32-1, in six 64-bit words */
+static const u64 kPrime[6] = {
+    0x00000000ffffffff, 0xffffffff00000000, 0xfffffffffffffffe,
+    0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff
+};
+
+/* This is 2^384 mod p = 2^128 + 2^96 - 2^32 + 1, in six 64-bit words */
+static const u64 kTwo384[6] = {
+    0xffffffff00000001, 0x00000000ffffffff, 0x0000000000000001, 0, 0, 0
+};
+
+/*
+ * bin48_to_felem takes a little-endian byte array and converts it into
+ * the limb representation.
+ */
+static void bin48_to_felem(felem out, const u8 in[48])
+{
+    out[0] = *((const limb *)(in)) & bottom56bits;
+    out[1] = (*((const limb_aX *)(in + 7))) & bottom56bits;
+    out[2] = (*((const limb_aX *)(in + 14))) & bottom56bits;
+    out[3] = (*((const limb_aX *)(in + 21))) & bottom56bits;
+    out[4] = (*((const limb_aX *)(in + 28))) & bottom56bits;
+    out[5] = (*((const limb_aX *)(in + 35))) & bottom56bits;
+    out[6] = (*((const limb_aX *)(in + 40))) >> 16;
+}
+
+/*
+ * felem_to_bin48 serializes an felem, whose limbs must be less than 2^56,
+ * into a little endian, 48 byte array.
+ */
+static void felem_to_bin48(u8 out[48], const felem in)
+{
+    unsigned i;
+
+    for (i = 0; i < 7; ++i) {
+        out[i] = in[0] >> (8 * i);
+        out[i + 7] = in[1] >> (8 * i);
+        out[i + 14] = in[2] >> (8 * i);
+        out[i + 21] = in[3] >> (8 * i);
+        out[i + 28] = in[4] >> (8 * i);
+        out[i + 35] = in[5] >> (8 * i);
+    }
+    for (i = 0; i < 6; ++i)
+        out[i + 42] = in[6] >> (8 * i);
+}
+
+/* BN_to_felem converts an OpenSSL BIGNUM into an felem */
+static int BN_to_felem(felem out, const BIGNUM *bn)
+{
+    felem_bytearray b_out;
+    int num_bytes;
+
+    if (BN_is_negative(bn)) {
+        ERR_raise(ERR_LIB_EC, EC_R_BIGNUM_OUT_OF_RANGE);
+        return 0;
+    }
+    num_bytes = BN_bn2lebinpad(bn, b_out, sizeof(b_out));
+    if (num_bytes < 0) {
+        ERR_raise(ERR_LIB_EC, EC_R_BIGNUM_OUT_OF_RANGE);
+        return 0;
+    }
+    bin48_to_felem(out, b_out);
+    return 1;
+}
+
+/* felem_to_BN converts an felem into an OpenSSL BIGNUM */
+static BIGNUM *felem_to_BN(BIGNUM *out, const felem in)
+{
+    felem_bytearray b_out;
+
+    felem_to_bin48(b_out, in);
+    return BN_lebin2bn(b_out, sizeof(b_out), out);
+}
+
+/*-
+ * Field operations
+ * ----------------
+ */
+
+static void felem_one(felem out)
+{
+    out[0] = 1;
+    out[1] = 0;
+    out[2] = 0;
+    out[3] = 0;
+    out[4] = 0;
+    out[5] = 0;
+    out[6] = 0;
+}
+
+static void felem_assign(felem out, const felem in)
+{
+    out[0] = in[0];
+    out[1] = in[1];
+    out[2] = in[2];
+    out[3] = in[3];
+    out[4] = in[4];
+    out[5] = in[5];
+    out[6] = in[6];
+}
+
+/* felem_sum64 sets out = out + in. */
+static void felem_sum64(felem out, const felem in)
+{
+    out[0] += in[0];
+    out[1] += in[1];
+    out[2] += in[2];
+    out[3] += in[3];
+    out[4] += in[4];
+    out[5] += in[5];
+    out[6] += in[6];
+}
+
+/* felem_scalar sets out = in * scalar */
+static void felem_scalar(felem out, const felem in, limb scalar)
+{
+    out[0] = in[0] * scalar;
+    out[1] = in[1] * scalar;
+    out[2] = in[2] * scalar;
+    out[3] = in[3] * scalar;
+    out[4] = in[4] * scalar;
+    out[5] = in[5] * scalar;
+    out[6] = in[6] * scalar;
+}
+
+/* felem_scalar64 sets out = out * scalar */
+static void felem_scalar64(felem out, limb scalar)
+{
+    out[0] *= scalar;
+    out[1] *= scalar;
+    out[2] *= scalar;
+    out[3] *= scalar;
+    out[4] *= scalar;
+    out[5] *= scalar;
+    out[6] *= scalar;
+}
+
+/* felem_scalar128 sets out = out * scalar */
+static void felem_scalar128(widefelem out, limb scalar)
+{
+    out[0] *= scalar;
+    out[1] *= scalar;
+    out[2] *= scalar;
+    out[3] *= scalar;
+    out[4] *= scalar;
+    out[5] *= scalar;
+    out[6] *= scalar;
+    out[7] *= scalar;
+    out[8] *= scalar;
+    out[9] *= scalar;
+    out[10] *= scalar;
+    out[11] *= scalar;
+    out[12] *= scalar;
+}
+
+/*-
+ * felem_neg sets |out| to |-in|
+ * On entry:
+ *   in[i] < 2^56
+ * On exit:
+ *   out[i] < 2^57
+ */
+static void felem_neg(felem out, const felem in)
+{
+    /*
+     * In order to prevent underflow, we subtract from 0 mod p. This multiple
+     * of p has 2^56 <= limbs < 2^57.
+     */
+    static const limb two56 = ((limb) 1) << 56;
+
+    out[0] = (two56 + 0x000100fffffeff) - in[0];
+    out[1] = (two56 + 0xfefeffffffffff) - in[1];
+    out[2] = (two56 + 0xfffffffefefffe) - in[2];
+    out[3] = (two56 + 0xfffffffffffffe) - in[3];
+    out[4] = (two56 + 0xfffffffffffffe) - in[4];
+    out[5] = (two56 + 0xfffffffffffffe) - in[5];
+    out[6] = (two56 + 0x00fffffffffffe) - in[6];
+}
+
+/*-
+ * felem_diff64 subtracts |in| from |out|
+ * On entry:
+ *   in[i] < 2^60
+ * On exit:
+ *   out[i] < out[i] + 2^61
+ */
+static void felem_diff64(felem out, const felem in)
+{
+    /*
+     * In order to prevent underflow, we add 0 mod p before subtracting. This
+     * multiple of p has 2^60 <= limbs < 2^60 + 2^56.
+     */
+    static const limb two60 = ((limb) 1) << 60;
+
+    out[0] += (two60 + 0x001000ffffefff) - in[0];
+    out[1] += (two60 + 0xeffefffffffff0) - in[1];
+    out[2] += (two60 + 0xffffffeffeffef) - in[2];
+    out[3] += (two60 + 0xffffffffffffef) - in[3];
+    out[4] += (two60 + 0xffffffffffffef) - in[4];
+    out[5] += (two60 + 0xffffffffffffef) - in[5];
+    out[6] += (two60 + 0x00ffffffffffef) - in[6];
+}
+
+/*-
+ * felem_diff_128_64 subtracts |in| from |out|
+ * On entry:
+ *   in[i] < 2^60
+ * On exit:
+ *   out[i] < out[i] + 2^61
+ */
+static void felem_diff_128_64(widefelem out, const felem in)
+{
+    /* the same multiple of p as in felem_diff64 */
+    static const limb two60 = ((limb) 1) << 60;
+
+    out[0] += (two60 + 0x001000ffffefff) - in[0];
+    out[1] += (two60 + 0xeffefffffffff0) - in[1];
+    out[2] += (two60 + 0xffffffeffeffef) - in[2];
+    out[3] += (two60 + 0xffffffffffffef) - in[3];
+    out[4] += (two60 + 0xffffffffffffef) - in[4];
+    out[5] += (two60 + 0xffffffffffffef) - in[5];
+    out[6] += (two60 + 0x00ffffffffffef) - in[6];
+}
+
+/*-
+ * felem_diff128 subtracts |in| from |out|
+ * On entry:
+ *   in[i] < 2^118
+ * On exit:
+ *   out[i] < out[i] + 2^119
+ */
+static void felem_diff128(widefelem out, const widefelem in)
+{
+    /*
+     * In order to prevent underflow, we add 0 mod p before subtracting. This
+     * multiple of p has 2^118 <= limbs < 2^118 + 2^56.
+     */
+    static const widelimb two118 = ((widelimb) 1) << 118;
+
+    out[0] += (two118 + 0x803fffffbfbfc0) - in[0];
+    out[1] += (two118 + 0xbfffffbfffffc0) - in[1];
+    out[2] += (two118 + 0x7fffffbf7fff3f) - in[2];
+    out[3] += (two118 + 0x7fffffbf803fbf) - in[3];
+    out[4] += (two118 + 0x803fffbf7fbfbf) - in[4];
+    out[5] += (two118 + 0xc03fffbfffbfbf) - in[5];
+    out[6] += (two118 + 0x003fffbfffbfbf) - in[6];
+    out[7] += two118 - in[7];
+    out[8] += two118 - in[8];
+    out[9] += two118 - in[9];
+    out[10] += two118 - in[10];
+    out[11] += two118 - in[11];
+    out[12] += two118 - in[12];
+}
+
+/*-
+ * felem_square sets |out| = |in|^2
+ * On entry:
+ *   in[i] < 2^62
+ * On exit:
+ *   out[i] < 7 * max(in[i]) * max(in[i])
+ */
+static void felem_square(widefelem out, const felem in)
+{
+    felem inx2;
+    felem_scalar(inx2, in, 2);
+
+    out[0] = ((widelimb) in[0]) * in[0];
+    out[1] = ((widelimb) in[0]) * inx2[1];
+    out[2] = ((widelimb) in[0]) * inx2[2] + ((widelimb) in[1]) * in[1];
+    out[3] = ((widelimb) in[0]) * inx2[3] + ((widelimb) in[1]) * inx2[2];
+    out[4] = ((widelimb) in[0]) * inx2[4] + ((widelimb) in[1]) * inx2[3] +
+             ((widelimb) in[2]) * in[2];
+    out[5] = ((widelimb) in[0]) * inx2[5] + ((widelimb) in[1]) * inx2[4] +
+             ((widelimb) in[2]) * inx2[3];
+    out[6] = ((widelimb) in[0]) * inx2[6] + ((widelimb) in[1]) * inx2[5] +
+             ((widelimb) in[2]) * inx2[4] + ((widelimb) in[3]) * in[3];
+    out[7] = ((widelimb) in[1]) * inx2[6] + ((widelimb) in[2]) * inx2[5] +
+             ((widelimb) in[3]) * inx2[4];
+    out[8] = ((widelimb) in[2]) * inx2[6] + ((widelimb) in[3]) * inx2[5] +
+             ((widelimb) in[4]) * in[4];
+    out[9] = ((widelimb) in[3]) * inx2[6] + ((widelimb) in[4]) * inx2[5];
+    out[10] = ((widelimb) in[4]) * inx2[6] + ((widelimb) in[5]) * in[5];
+    out[11] = ((widelimb) in[5]) * inx2[6];
+    out[12] = ((widelimb) in[6]) * in[6];
+}
+
+/*-
+ * felem_mul sets |out| = |in1| * |in2|
+ * On entry:
+ *   max(in1[i]) * max(in2[i]) < 2^124
+ * On exit:
+ *   out[i] < 7 * max(in1[i]) * max(in2[i])
+ */
+static void felem_mul(widefelem out, const felem in1, const felem in2)
+{
+    out[0] = ((widelimb) in1[0]) * in2[0];
+    out[1] = ((widelimb) in1[0]) * in2[1] + ((widelimb) in1[1]) * in2[0];
+    out[2] = ((widelimb) in1[0]) * in2[2] + ((widelimb) in1[1]) * in2[1] +
+             ((widelimb) in1[2]) * in2[0];
+    out[3] = ((widelimb) in1[0]) * in2[3] + ((widelimb) in1[1]) * in2[2] +
+             ((widelimb) in1[2]) * in2[1] + ((widelimb) in1[3]) * in2[0];
+    out[4] = ((widelimb) in1[0]) * in2[4] + ((widelimb) in1[1]) * in2[3] +
+             ((widelimb) in1[2]) * in2[2] + ((widelimb) in1[3]) * in2[1] +
+             ((widelimb) in1[4]) * in2[0];
+    out[5] = ((widelimb) in1[0]) * in2[5] + ((widelimb) in1[1]) * in2[4] +
+             ((widelimb) in1[2]) * in2[3] + ((widelimb) in1[3]) * in2[2] +
+             ((widelimb) in1[4]) * in2[1] + ((widelimb) in1[5]) * in2[0];
+    out[6] = ((widelimb) in1[0]) * in2[6] + ((widelimb) in1[1]) * in2[5] +
+             ((widelimb) in1[2]) * in2[4] + ((widelimb) in1[3]) * in2[3] +
+             ((widelimb) in1[4]) * in2[2] + ((widelimb) in1[5]) * in2[1] +
+             ((widelimb) in1[6]) * in2[0];
+    out[7] = ((widelimb) in1[1]) * in2[6] + ((widelimb) in1[2]) * in2[5] +
+             ((widelimb) in1[3]) * in2[4] + ((widelimb) in1[4]) * in2[3] +
+             ((widelimb) in1[5]) * in2[2] + ((widelimb) in1[6]) * in2[1];
+    out[8] = ((widelimb) in1[2]) * in2[6] + ((widelimb) in1[3]) * in2[5] +
+             ((widelimb) in1[4]) * in2[4] + ((widelimb) in1[5]) * in2[3] +
+             ((widelimb) in1[6]) * in2[2];
+    out[9] = ((widelimb) in1[3]) * in2[6] + ((widelimb) in1[4]) * in2[5] +
+             ((widelimb) in1[5]) * in2[4] + ((widelimb) in1[6]) * in2[3];
+    out[10] = ((widelimb) in1[4]) * in2[6] + ((widelimb) in1[5]) * in2[5] +
+              ((widelimb) in1[6]) * in2[4];
+    out[11] = ((widelimb) in1[5]) * in2[6] + ((widelimb) in1[6]) * in2[5];
+    out[12] = ((widelimb) in1[6]) * in2[6];
+}
+
+/*-
+ * felem_reduce converts a widefelem to an felem.
+ * On entry:
+ *   in[i] < 2^127
+ * On exit:
+ *   out[i] < 2^56
+ *
+ * The input is first carried into fifteen 56-bit limbs. Everything at and
+ * above 2^384, call it H, is then folded back down as
+ * H*(2^128 + 2^96 - 2^32 + 1). The first fold leaves a value below 2^546,
+ * the second one a value below 2^384 + 2^291. The -2^32 term makes the
+ * intermediate limbs signed, which relies on >> being an arithmetic shift
+ * for negative values, as it is with all compilers supporting int128_t.
+ */
+static void felem_reduce(felem out, const widefelem in)
+{
+    limb r[15], h[8];
+    int128_t acc[10];
+    widelimb t;
+
+    t = in[0];
+    r[0] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[1];
+    r[1] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[2];
+    r[2] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[3];
+    r[3] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[4];
+    r[4] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[5];
+    r[5] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[6];
+    r[6] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[7];
+    r[7] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[8];
+    r[8] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[9];
+    r[9] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[10];
+    r[10] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[11];
+    r[11] = (limb)t & bottom56bits;
+    t = (t >> 56) + in[12];
+    r[12] = (limb)t & bottom56bits;
+    t >>= 56;
+    r[13] = (limb)t & bottom56bits;
+    r[14] = (limb)(t >> 56);
+    /* r[i] < 2^56, r[14] < 2^16 */
+
+    /* H in 56-bit limbs, h[7] < 2^24 */
+    h[0] = (r[6] >> 48) | ((r[7] << 8) & bottom56bits);
+    h[1] = (r[7] >> 48) | ((r[8] << 8) & bottom56bits);
+    h[2] = (r[8] >> 48) | ((r[9] << 8) & bottom56bits);
+    h[3] = (r[9] >> 48) | ((r[10] << 8) & bottom56bits);
+    h[4] = (r[10] >> 48) | ((r[11] << 8) & bottom56bits);
+    h[5] = (r[11] >> 48) | ((r[12] << 8) & bottom56bits);
+    h[6] = (r[12] >> 48) | ((r[13] << 8) & bottom56bits);
+    h[7] = (r[13] >> 48) | (r[14] << 8);
+
+    /* 2^128 = 2^16*2^112, 2^96 = 2^40*2^56 */
+    acc[0] = (int128_t)r[0] + h[0] - ((int128_t)h[0] << 32);
+    acc[1] = (int128_t)r[1] + h[1] - ((int128_t)h[1] << 32)
+             + ((int128_t)h[0] << 40);
+    acc[2] = (int128_t)r[2] + h[2] - ((int128_t)h[2] << 32)
+             + ((int128_t)h[1] << 40) + ((int128_t)h[0] << 16);
+    acc[3] = (int128_t)r[3] + h[3] - ((int128_t)h[3] << 32)
+             + ((int128_t)h[2] << 40) + ((int128_t)h[1] << 16);
+    acc[4] = (int128_t)r[4] + h[4] - ((int128_t)h[4] << 32)
+             + ((int128_t)h[3] << 40) + ((int128_t)h[2] << 16);
+    acc[5] = (int128_t)r[5] + h[5] - ((int128_t)h[5] << 32)
+             + ((int128_t)h[4] << 40) + ((int128_t)h[3] << 16);
+    acc[6] = (int128_t)(r[6] & bottom48bits) + h[6]
+             - ((int128_t)h[6] << 32) + ((int128_t)h[5] << 40)
+             + ((int128_t)h[4] << 16);
+    acc[7] = (int128_t)h[7] - ((int128_t)h[7] << 32)
+             + ((int128_t)h[6] << 40) + ((int128_t)h[5] << 16);
+    acc[8] = ((int128_t)h[7] << 40) + ((int128_t)h[6] << 16);
+    acc[9] = (int128_t)h[7] << 16;
+    /* |acc[i]| < 2^97 */
+
+    acc[1] += acc[0] >> 56;
+    r[0] = (limb)acc[0] & bottom56bits;
+    acc[2] += acc[1] >> 56;
+    r[1] = (limb)acc[1] & bottom56bits;
+    acc[3] += acc[2] >> 56;
+    r[2] = (limb)acc[2] & bottom56bits;
+    acc[4] += acc[3] >> 56;
+    r[3] = (limb)acc[3] & bottom56bits;
+    acc[5] += acc[4] >> 56;
+    r[4] = (limb)acc[4] & bottom56bits;
+    acc[6] += acc[5] >> 56;
+    r[5] = (limb)acc[5] & bottom56bits;
+    acc[7] += acc[6] >> 56;
+    r[6] = (limb)acc[6] & bottom56bits;
+    acc[8] += acc[7] >> 56;
+    r[7] = (limb)acc[7] & bottom56bits;
+    acc[9] += acc[8] >> 56;
+    r[8] = (limb)acc[8] & bottom56bits;
+    r[9] = (limb)acc[9];
+    /* the value is non-negative and less than 2^546, so r[9] < 2^42 */
+
+    h[0] = (r[6] >> 48) | ((r[7] << 8) & bottom56bits);
+    h[1] = (r[7] >> 48) | ((r[8] << 8) & bottom56bits);
+    h[2] = (r[8] >> 48) | (r[9] << 8);
+
+    acc[0] = (int128_t)r[0] + h[0] - ((int128_t)h[0] << 32);
+    acc[1] = (int128_t)r[1] + h[1] - ((int128_t)h[1] << 32)
+             + ((int128_t)h[0] << 40);
+    acc[2] = (int128_t)r[2] + h[2] - ((int128_t)h[2] << 32)
+             + ((int128_t)h[1] << 40) + ((int128_t)h[0] << 16);
+    acc[3] = (int128_t)r[3] + ((int128_t)h[2] << 40) + ((int128_t)h[1] << 16);
+    acc[4] = (int128_t)r[4] + ((int128_t)h[2] << 16);
+
+    acc[1] += acc[0] >> 56;
+    out[0] = (limb)acc[0] & bottom56bits;
+    acc[2] += acc[1] >> 56;
+    out[1] = (limb)acc[1] & bottom56bits;
+    acc[3] += acc[2] >> 56;
+    out[2] = (limb)acc[2] & bottom56bits;
+    acc[4] += acc[3] >> 56;
+    out[3] = (limb)acc[3] & bottom56bits;
+    acc[5] = (acc[4] >> 56) + r[5];
+    out[4] = (limb)acc[4] & bottom56bits;
+    acc[6] = (acc[5] >> 56) + (r[6] & bottom48bits);
+    out[5] = (limb)acc[5] & bottom56bits;
+    out[6] = (limb)acc[6];
+    /* the value is less than 2^384 + 2^291, so out[6] <= 2^48 */
+}
+
+static void felem_square_reduce(felem out, const felem in)
+{
+    widefelem tmp;
+    felem_square(tmp, in);
+    felem_reduce(out, tmp);
+}
+
+static void felem_mul_reduce(felem out, const felem in1, const felem in2)
+{
+    widefelem tmp;
+    felem_mul(tmp, in1, in2);
+    felem_reduce(out, tmp);
+}
+
+/*-
+ * felem_inv calculates |out| = |in|^{-1}
+ *
+ * Based on Fermat's Little Theorem:
+ *   a^p = a (mod p)
+ *   a^{p-1} = 1 (mod p)
+ *   a^{p-2} = a^{-1} (mod p)
+ */
+static void felem_inv(felem out, const felem in)
+{
+    felem ftmp, ftmp2, x2, x3, x15, x30, x32;
+    unsigned i;
+
+    felem_square_reduce(ftmp, in);
+    felem_mul_reduce(x2, ftmp, in);     /* 2^2 - 1 */
+    felem_square_reduce(ftmp, x2);
+    felem_mul_reduce(x3, ftmp, in);     /* 2^3 - 1 */
+    felem_assign(ftmp, x3);
+    for (i = 0; i < 3; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^6 - 2^3 */
+    felem_mul_reduce(ftmp2, ftmp, x3);  /* 2^6 - 1 */
+    felem_assign(ftmp, ftmp2);
+    for (i = 0; i < 6; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^12 - 2^6 */
+    felem_mul_reduce(ftmp, ftmp, ftmp2); /* 2^12 - 1 */
+    for (i = 0; i < 3; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^15 - 2^3 */
+    felem_mul_reduce(x15, ftmp, x3);    /* 2^15 - 1 */
+    felem_assign(ftmp, x15);
+    for (i = 0; i < 15; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^30 - 2^15 */
+    felem_mul_reduce(x30, ftmp, x15);   /* 2^30 - 1 */
+    felem_square_reduce(ftmp, x30);
+    felem_square_reduce(ftmp, ftmp);    /* 2^32 - 2^2 */
+    felem_mul_reduce(x32, ftmp, x2);    /* 2^32 - 1 */
+    felem_assign(ftmp, x30);
+    for (i = 0; i < 30; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^60 - 2^30 */
+    felem_mul_reduce(ftmp2, ftmp, x30); /* 2^60 - 1 */
+    felem_assign(ftmp, ftmp2);
+    for (i = 0; i < 60; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^120 - 2^60 */
+    felem_mul_reduce(ftmp2, ftmp, ftmp2); /* 2^120 - 1 */
+    felem_assign(ftmp, ftmp2);
+    for (i = 0; i < 120; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^240 - 2^120 */
+    felem_mul_reduce(ftmp, ftmp, ftmp2); /* 2^240 - 1 */
+    for (i = 0; i < 15; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^255 - 2^15 */
+    felem_mul_reduce(ftmp, ftmp, x15);  /* 2^255 - 1 */
+    for (i = 0; i < 33; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^288 - 2^33 */
+    felem_mul_reduce(ftmp, ftmp, x32);  /* 2^288 - 2^32 - 1 */
+    for (i = 0; i < 94; i++)
+        felem_square_reduce(ftmp, ftmp); /* 2^382 - 2^126 - 2^94 */
+    felem_mul_reduce(ftmp, ftmp, x30);  /* 2^382 - 2^126 - 2^94 + 2^30 - 1 */
+    felem_square_reduce(ftmp, ftmp);
+    felem_square_reduce(ftmp, ftmp);    /* 2^384 - 2^128 - 2^96 + 2^32 - 4 */
+    felem_mul_reduce(out, ftmp, in);    /* 2^384 - 2^128 - 2^96 + 2^32 - 3 */
+}
+
+/*-
+ * felem_contract converts |in| to its unique, minimal representation.
+ * On entry:
+ *   in[i] < 2^62
+ * On exit:
+ *   out < p, out[i] < 2^56
+ *
+ * This is done on six 64-bit words: any excess above 2^384 is folded down
+ * twice using 2^384 mod p, which leaves a value below 2^384 < 2*p, so that
+ * a single conditional subtraction of p finishes the job.
+ */
+static void felem_contract(felem out, const felem in)
+{
+    felem tmp;
+    u64 t[6], d[6], hi, borrow, mask;
+    widelimb acc;
+    unsigned i, j;
+
+    felem_assign(tmp, in);
+    tmp[1] += tmp[0] >> 56;
+    tmp[0] &= bottom56bits;
+    tmp[2] += tmp[1] >> 56;
+    tmp[1] &= bottom56bits;
+    tmp[3] += tmp[2] >> 56;
+    tmp[2] &= bottom56bits;
+    tmp[4] += tmp[3] >> 56;
+    tmp[3] &= bottom56bits;
+    tmp[5] += tmp[4] >> 56;
+    tmp[4] &= bottom56bits;
+    tmp[6] += tmp[5] >> 56;
+    tmp[5] &= bottom56bits;
+    /* tmp[6] < 2^62 + 2^7 */
+
+    t[0] = tmp[0] | (tmp[1] << 56);
+    t[1] = (tmp[1] >> 8) | (tmp[2] << 48);
+    t[2] = (tmp[2] >> 16) | (tmp[3] << 40);
+    t[3] = (tmp[3] >> 24) | (tmp[4] << 32);
+    t[4] = (tmp[4] >> 32) | (tmp[5] << 24);
+    t[5] = (tmp[5] >> 40) | (tmp[6] << 16);
+    hi = tmp[6] >> 48;
+
+    /*
+     * The first fold leaves hi <= 1 and, if it is 1, a lower part small
+     * enough for the second one not to carry out again.
+     */
+    for (j = 0; j < 2; j++) {
+        acc = 0;
+        for (i = 0; i < 6; i++) {
+            acc += (widelimb)t[i] + (widelimb)hi * kTwo384[i];
+            t[i] = (u64)acc;
+            acc >>= 64;
+        }
+        hi = (u64)acc;
+    }
+
+    borrow = 0;
+    for (i = 0; i < 6; i++) {
+        acc = (widelimb)t[i] - kPrime[i] - borrow;
+        d[i] = (u64)acc;
+        borrow = (u64)(acc >> 64) & 1;
+    }
+    /* keep |t| if the subtraction borrowed */
+    mask = 0 - borrow;
+    for (i = 0; i < 6; i++)
+        t[i] = (t[i] & mask) | (d[i] & ~mask);
+
+    out[0] = t[0] & bottom56bits;
+    out[1] = ((t[0] >> 56) | (t[1] << 8)) & bottom56bits;
+    out[2] = ((t[1] >> 48) | (t[2] << 16)) & bottom56bits;
+    out[3] = ((t[2] >> 40) | (t[3] << 24)) & bottom56bits;
+    out[4] = ((t[3] >> 32) | (t[4] << 32)) & bottom56bits;
+    out[5] = ((t[4] >> 24) | (t[5] << 40)) & bottom56bits;
+    out[6] = t[5] >> 16;
+}
+
+/*
+ * felem_is_zero returns a limb with all bits set if |in| == 0 (mod p) and 0
+ * otherwise.
+ * On entry:
+ *   in[i] < 2^62
+ */
+static limb felem_is_zero(const felem in)
+{
+    felem ftmp;
+    limb is_zero;
+
+    felem_contract(ftmp, in);
+    is_zero = ftmp[0] | ftmp[1] | ftmp[2] | ftmp[3] | ftmp[4] | ftmp[5]
+              | ftmp[6];
+    /* ftmp[i] < 2^56, so the top bit is only set if is_zero was 0 */
+    is_zero--;
+    return 0 - (is_zero >> 63);
+}
+
+static int felem_is_zero_int(const void *in)
+{
+    return (int)(felem_is_zero(in) & ((limb) 1));
+}
+
+/*-
+ * Group operations
+ * ----------------
+ *
+ * Building on top of the field operations we have the operations on the
+ * elliptic curve group itself. Points on the curve are represented in Jacobian
+ * coordinates, whose limbs are less than 2^57 */
+
+/*-
+ * point_double calculates 2*(x_in, y_in, z_in)
+ *
+ * The method is taken from:
+ *   http://hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-3.html#doubling-dbl-2001-b
+ *
+ * Outputs can equal corresponding inputs, i.e., x_out == x_in is allowed.
+ * while x_out == y_in is not (maybe this works, but it's not tested). */
+static void
+point_double(felem x_out, felem y_out, felem z_out,
+             const felem x_in, const felem y_in, const felem z_in)
+{
+    widefelem tmp, tmp2;
+    felem delta, gamma, beta, alpha, ftmp, ftmp2;
+
+    felem_assign(ftmp, x_in);
+    felem_assign(ftmp2, x_in);
+
+    /* delta = z^2 */
+    felem_square(tmp, z_in);
+    felem_reduce(delta, tmp);   /* delta[i] < 2^56 */
+
+    /* gamma = y^2 */
+    felem_square(tmp, y_in);
+    felem_reduce(gamma, tmp);   /* gamma[i] < 2^56 */
+
+    /* beta = x*gamma */
+    felem_mul(tmp, x_in, gamma);
+    felem_reduce(beta, tmp);    /* beta[i] < 2^56 */
+
+    /* alpha = 3*(x-delta)*(x+delta) */
+    felem_diff64(ftmp, delta);
+    /* ftmp[i] < 2^57 + 2^61 < 2^62 */
+    felem_sum64(ftmp2, delta);
+    /* ftmp2[i] < 2^57 + 2^56 < 2^58 */
+    felem_scalar64(ftmp2, 3);
+    /* ftmp2[i] < 3*2^58 < 2^60 */
+    felem_mul(tmp, ftmp, ftmp2);
+    /* tmp[i] < 7*2^62*2^60 < 2^125 */
+    felem_reduce(alpha, tmp);
+
+    /* x' = alpha^2 - 8*beta */
+    felem_square(tmp, alpha);
+    /* tmp[i] < 7*2^112 < 2^115 */
+    felem_assign(ftmp, beta);
+    felem_scalar64(ftmp, 8);
+    /* ftmp[i] < 8*2^56 = 2^59 */
+    felem_diff_128_64(tmp, ftmp);
+    /* tmp[i] < 2^115 + 2^61 */
+    felem_reduce(x_out, tmp);
+
+    /* z' = (y + z)^2 - gamma - delta */
+    felem_sum64(delta, gamma);
+    /* delta[i] < 2^57 */
+    felem_assign(ftmp, y_in);
+    felem_sum64(ftmp, z_in);
+    /* ftmp[i] < 2^58 */
+    felem_square(tmp, ftmp);
+    /* tmp[i] < 7*2^116 < 2^119 */
+    felem_diff_128_64(tmp, delta);
+    /* tmp[i] < 2^119 + 2^61 */
+    felem_reduce(z_out, tmp);
+
+    /* y' = alpha*(4*beta - x') - 8*gamma^2 */
+    felem_scalar64(beta, 4);
+    /* beta[i] < 2^58 */
+    felem_diff64(beta, x_out);
+    /* beta[i] < 2^58 + 2^61 < 2^62 */
+    felem_mul(tmp, alpha, beta);
+    /* tmp[i] < 7*2^56*2^62 < 2^121 */
+    felem_square(tmp2, gamma);
+    /* tmp2[i] < 7*2^112 < 2^115 */
+    felem_scalar128(tmp2, 8);
+    /* tmp2[i] < 8*2^115 = 2^118 */
+    felem_diff128(tmp, tmp2);
+    /* tmp[i] < 2^121 + 2^119 < 2^122 */
+    felem_reduce(y_out, tmp);
+}
+
+/* copy_conditional copies in to out iff mask is all ones. */
+static void copy_conditional(felem out, const felem in, limb mask)
+{
+    unsigned i;
+    for (i = 0; i < NLIMBS; ++i) {
+        const limb tmp = mask & (in[i] ^ out[i]);
+        out[i] ^= tmp;
+    }
+}
+
+/*-
+ * point_add calculates (x1, y1, z1) + (x2, y2, z2)
+ *
+ * The method is taken from
+ *   http://hyperelliptic.org/EFD/g1p/auto-shortw-jacobian-3.html#addition-add-2007-bl,
+ * adapted for mixed addition (z2 = 1, or z2 = 0 for the point at infinity).
+ *
+ * This function includes a branch for checking whether the two input points
+ * are equal (while not equal to the point at infinity). See comment below
+ * on constant-time.
+ */
+static void point_add(felem x3, felem y3, felem z3,
+                      const felem x1, const felem y1, const felem z1,
+                      const int mixed, const felem x2, const felem y2,
+                      const felem z2)
+{
+    felem ftmp, ftmp2, ftmp3, ftmp4, ftmp5, ftmp6, x_out, y_out, z_out;
+    widefelem tmp, tmp2;
+    limb x_equal, y_equal, z1_is_zero, z2_is_zero;
+    limb points_equal;
+
+    z1_is_zero = felem_is_zero(z1);
+    z2_is_zero = felem_is_zero(z2);
+
+    /* ftmp = z1z1 = z1**2 */
+    felem_square(tmp, z1);
+    felem_reduce(ftmp, tmp);
+
+    if (!mixed) {
+        /* ftmp2 = z2z2 = z2**2 */
+        felem_square(tmp, z2);
+        felem_reduce(ftmp2, tmp);
+
+        /* u1 = ftmp3 = x1*z2z2 */
+        felem_mul(tmp, x1, ftmp2);
+        felem_reduce(ftmp3, tmp);
+
+        /* ftmp5 = z1 + z2 */
+        felem_assign(ftmp5, z1);
+        felem_sum64(ftmp5, z2);
+        /* ftmp5[i] < 2^58 */
+
+        /* ftmp5 = (z1 + z2)**2 - z1z1 - z2z2 = 2*z1z2 */
+        felem_square(tmp, ftmp5);
+        /* tmp[i] < 7*2^116 < 2^119 */
+        felem_diff_128_64(tmp, ftmp);
+        /* tmp[i] < 2^119 + 2^61 */
+        felem_diff_128_64(tmp, ftmp2);
+        /* tmp[i] < 2^119 + 2^62 */
+        felem_reduce(ftmp5, tmp);
+
+        /* ftmp2 = z2 * z2z2 */
+        felem_mul(tmp, ftmp2, z2);
+        felem_reduce(ftmp2, tmp);
+
+        /* s1 = ftmp6 = y1 * z2**3 */
+        felem_mul(tmp, y1, ftmp2);
+        felem_reduce(ftmp6, tmp);
+    } else {
+        /*
+         * We'll assume z2 = 1 (special case z2 = 0 is handled later)
+         */
+
+        /* u1 = ftmp3 = x1*z2z2 */
+        felem_assign(ftmp3, x1);
+
+        /* ftmp5 = 2*z1z2 */
+        felem_scalar(ftmp5, z1, 2);
+
+        /* s1 = ftmp6 = y1 * z2**3 */
+        felem_assign(ftmp6, y1);
+    }
+    /* ftmp3[i] < 2^57, ftmp5[i] < 2^58, ftmp6[i] < 2^57 */
+
+    /* u2 = x2*z1z1 */
+    felem_mul(tmp, x2, ftmp);
+    /* tmp[i] < 7*2^113 < 2^116 */
+
+    /* h = ftmp4 = u2 - u1 */
+    felem_diff_128_64(tmp, ftmp3);
+    /* tmp[i] < 2^116 + 2^61 */
+    felem_reduce(ftmp4, tmp);
+
+    x_equal = felem_is_zero(ftmp4);
+
+    /* z_out = ftmp5 * h */
+    felem_mul(tmp, ftmp5, ftmp4);
+    felem_reduce(z_out, tmp);
+
+    /* ftmp = z1 * z1z1 */
+    felem_mul(tmp, ftmp, z1);
+    felem_reduce(ftmp, tmp);
+
+    /* s2 = tmp = y2 * z1**3 */
+    felem_mul(tmp, y2, ftmp);
+    /* tmp[i] < 7*2^113 < 2^116 */
+
+    /* r = ftmp5 = (s2 - s1)*2 */
+    felem_diff_128_64(tmp, ftmp6);
+    /* tmp[i] < 2^116 + 2^61 */
+    felem_reduce(ftmp5, tmp);
+    y_equal = felem_is_zero(ftmp5);
+    felem_scalar64(ftmp5, 2);
+    /* ftmp5[i] < 2^57 */
+
+    /*
+     * The formulae are incorrect if the points are equal, in affine coordinates
+     * (X_1, Y_1) == (X_2, Y_2), so we check for this and do doubling if this
+     * happens.
+     *
+     * We use bitwise operations to avoid potential side-channels introduced by
+     * the short-circuiting behaviour of boolean operators.
+     *
+     * The special case of either point being the point at infinity (z1 and/or
+     * z2 are zero), is handled separately later on in this function, so we
+     * avoid jumping to point_double here in those special cases.
+     */
+    points_equal = (x_equal & y_equal & (~z1_is_zero) & (~z2_is_zero));
+
+    if (points_equal) {
+        /*
+         * This is not constant-time, but as in ecp_nistp521.c it can only
+         * happen for a handful of scalars close to the group order, in the
+         * last addition of the scalar multiplication.
+         */
+        point_double(x3, y3, z3, x1, y1, z1);
+        return;
+    }
+
+    /* I = ftmp = (2h)**2 */
+    felem_assign(ftmp, ftmp4);
+    felem_scalar64(ftmp, 2);
+    /* ftmp[i] < 2^57 */
+    felem_square(tmp, ftmp);
+    /* tmp[i] < 7*2^114 < 2^117 */
+    felem_reduce(ftmp, tmp);
+
+    /* J = ftmp2 = h * I */
+    felem_mul(tmp, ftmp4, ftmp);
+    felem_reduce(ftmp2, tmp);
+
+    /* V = ftmp4 = U1 * I */
+    felem_mul(tmp, ftmp3, ftmp);
+    felem_reduce(ftmp4, tmp);
+
+    /* x_out = r**2 - J - 2V */
+    felem_square(tmp, ftmp5);
+    /* tmp[i] < 7*2^114 < 2^117 */
+    felem_diff_128_64(tmp, ftmp2);
+    /* tmp[i] < 2^117 + 2^61 */
+    felem_assign(ftmp3, ftmp4);
+    felem_scalar64(ftmp4, 2);
+    /* ftmp4[i] < 2^57 */
+    felem_diff_128_64(tmp, ftmp4);
+    /* tmp[i] < 2^117 + 2^62 */
+    felem_reduce(x_out, tmp);
+
+    /* y_out = r(V-x_out) - 2 * s1 * J */
+    felem_diff64(ftmp3, x_out);
+    /* ftmp3[i] < 2^56 + 2^61 < 2^62 */
+    felem_mul(tmp, ftmp5, ftmp3);
+    /* tmp[i] < 7*2^57*2^62 < 2^122 */
+    felem_mul(tmp2, ftmp6, ftmp2);
+    /* tmp2[i] < 7*2^57*2^56 < 2^116 */
+    felem_scalar128(tmp2, 2);
+    /* tmp2[i] < 2^117 */
+    felem_diff128(tmp, tmp2);
+    /* tmp[i] < 2^122 + 2^119 < 2^123 */
+    felem_reduce(y_out, tmp);
+
+    copy_conditional(x_out, x2, z1_is_zero);
+    copy_conditional(x_out, x1, z2_is_zero);
+    copy_conditional(y_out, y2, z1_is_zero);
+    copy_conditional(y_out, y1, z2_is_zero);
+    copy_conditional(z_out, z2, z1_is_zero);
+    copy_conditional(z_out, z1, z2_is_zero);
+    felem_assign(x3, x_out);
+    felem_assign(y3, y_out);
+    felem_assign(z3, z_out);
+}
+
+/*-
+ * Base point pre computation
+ * --------------------------
+ *
+ * Two different sorts of precomputed tables are used in the following code.
+ * Each contain various points on the curve, where each point is three field
+ * elements (x, y, z).
+ *
+ * For the base point table, z is usually 1 (0 for the point at infinity).
+ * This table has 2 * 16 elements, starting with the following:
+ * index | bits    | point
+ * ------+---------+------------------------------
+ *     0 | 0 0 0 0 | 0G
+ *     1 | 0 0 0 1 | 1G
+ *     2 | 0 0 1 0 | 2^96G
+ *     3 | 0 0 1 1 | (2^96 + 1)G
+ *     4 | 0 1 0 0 | 2^192G
+ *     5 | 0 1 0 1 | (2^192 + 1)G
+ *     6 | 0 1 1 0 | (2^192 + 2^96)G
+ *     7 | 0 1 1 1 | (2^192 + 2^96 + 1)G
+ *     8 | 1 0 0 0 | 2^288G
+ *     9 | 1 0 0 1 | (2^288 + 1)G
+ *    10 | 1 0 1 0 | (2^288 + 2^96)G
+ *    11 | 1 0 1 1 | (2^288 + 2^96 + 1)G
+ *    12 | 1 1 0 0 | (2^288 + 2^192)G
+ *    13 | 1 1 0 1 | (2^288 + 2^192 + 1)G
+ *    14 | 1 1 1 0 | (2^288 + 2^192 + 2^96)G
+ *    15 | 1 1 1 1 | (2^288 + 2^192 + 2^96 + 1)G
+ * followed by a copy of this with each element multiplied by 2^48.
+ *
+ * The reason for this is so that we can clock bits into four different
+ * locations when doing simple scalar multiplies against the base point,
+ * and then another four locations using the second 16 elements.
+ *
+ * Tables for other points have table[i] = iG for i in 0 .. 16. */
+
+/* gmul is the table of precomputed base points */
+static const felem gmul[2][16][3] = {
+    {
+     {{0, 0, 0, 0, 0, 0, 0},
+      {0, 0, 0, 0, 0, 0, 0},
+      {0, 0, 0, 0, 0, 0, 0}},
+     {{0x545e3872760ab7, 0xf25dbf55296c3a, 0xe082542a385502, 0x8ba79b9859f741,
+       0x20ad746e1d3b62, 0x05378eb1c71ef3, 0x00aa87ca22be8b},
+      {0x431d7c90ea0e5f, 0xb1ce1d7e819d7a, 0x13b5f0b8c00a60, 0x289a147ce9da31,
+       0x92dc29f8f41dbd, 0x2c6f5d9e98bf92, 0x003617de4a9626},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xc1b328d8ee21c9, 0x0c91558717db39, 0x8b3f8686a92c3e, 0x18141b1a4b5880,
+       0xca7abc43603909, 0xbd1bd6e98b0d37, 0x00f532389a060c},
+      {0x7e183923d86ecd, 0x31b1085a4e9a7a, 0x5abe64360331ea, 0xa2124163bc40ce,
+       0x3a82babd22cfb2, 0x8e696f04caa2de, 0x00b9d2852cc3b3},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x4e5246eb09a0e5, 0xbe1132cdf03c26, 0x835faefa4ff8f4, 0x17a31b22da9d54,
+       0xf06145bbbc4fd0, 0x2cabc3decd0c86, 0x00528ef1670a5f},
+      {0x1e9858c14f0dd6, 0x38a809cb75248a, 0xb4c87fed225505, 0x631d058dbd60ca,
+       0x1dcf14f8b76fdd, 0xf56c5803eaa11a, 0x007b9b1fbe7bcc},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x28b09aaa03bd53, 0x5458a4f52d78a6, 0x894d10ddeaba06, 0x8a3e297ddb2987,
+       0x421279b42a31af, 0x19c440f7f9e706, 0x00c19e0b4c8001},
+      {0x2d0fc5e6c88c41, 0xaa6de639d85882, 0xd135f6ebf2af68, 0xe3567af9c1c7ca,
+       0x5b77f6577a30ea, 0xb301e5a0191d1f, 0x0016f3fdbf0356},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x991560aa133909, 0xdbb1c6cb001730, 0x24b860fae69097, 0x70b375ddd37de4,
+       0x6ce3a39bb183b2, 0x3088567a6233cd, 0x00aab8bb9f0fdc},
+      {0xc5b981600ad5a6, 0x73f2d62faa4416, 0xb3c9747bf3ebdf, 0x15eb04ac6d955b,
+       0x2050b5f6005fc8, 0x6d28f0af01d128, 0x0048942f81314f},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x2211217716605e, 0xd2c89ef281c820, 0x99567d63422347, 0x77c0f03f54ba45,
+       0x367444ce0fba30, 0xa0527022f802cb, 0x007334a936a9a6},
+      {0x461f68d658a01a, 0xd519c2bd0efab5, 0x8f697a92800a64, 0x7d0e017a9e2eee,
+       0xbd4ccd8e5d9b89, 0xc9261f7c5c367c, 0x007ffceff7f632},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x0ae2e60e758344, 0x707a371a2ca530, 0x105052dd32451c, 0x4862b95425651d,
+       0x81ef13bf88de7f, 0x090efafce26e03, 0x00dc916c17960e},
+      {0x17cc44026b0889, 0x1ff19b42441bed, 0x78cc16069795c0, 0x0ba04a35408964,
+       0x1c295252d154b8, 0xca0ab3d92ea470, 0x00266e8a40d69e},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xbfc2c04905ca71, 0x450ad156f761e4, 0xdbd08848c2f33a, 0xa23096863d8b29,
+       0x4972d7097da395, 0xaa12211905035f, 0x00b2d1055817cb},
+      {0xcebb55753ee324, 0xb07c6924666fdd, 0x744ecf1a68e87a, 0x2e6236c09b475d,
+       0xfd056bf82be8f5, 0xcbd2237c0dba3c, 0x00354cd872c3c6},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x104d24708d4cee, 0x6958819cf0438d, 0xfaf0712210197d, 0x5c20155847fc87,
+       0x1ef638103df785, 0xbfec30b0a9e861, 0x0000b19ac8fdfe},
+      {0x0e8d6fd201e03e, 0x969c2228ff5fd4, 0x82636164c5bb7c, 0xe754220d688102,
+       0xf6edc4cdbb3cd2, 0x60311418fe25e9, 0x00a72f91059ee3},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xd2c273b769737a, 0x245197d53ffd64, 0x4be86c46bd2cc0, 0x685e926dc3b6ac,
+       0x203a3617e9411f, 0xb27e136df36b75, 0x003f9561e08bf0},
+      {0x6ff8d527e990a7, 0xe586f9867a60dd, 0x478554e014c34b, 0x6f52e4cbea0887,
+       0x2ab641cfced664, 0x95874b1a5a2041, 0x000b06f0063962},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x4c0dd285651f82, 0x51e7785d3ef704, 0x6188e95532325c, 0x522c2931b83a18,
+       0x80f137539f94ad, 0x66d715274e5b89, 0x009fd7b010df0f},
+      {0xa7b94a4064e4c0, 0xba4525d7d211e4, 0x54be8a04e3d44e, 0x149033de0a806b,
+       0x739246929226bd, 0x0225795f6fa3c9, 0x00321aa9a3b926},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xbcc2f58b707b8e, 0xb5191d92898349, 0x567d49c7802901, 0x4c6a99642e4c29,
+       0xee3e13ebd1cff8, 0x68f72caebbd316, 0x0036a543eea87a},
+      {0xb41c29b569946d, 0xe7d43ef2267e75, 0x72d4b3394d1510, 0x8fbd85d1912350,
+       0xa6784758eaff04, 0xe41cd349ab0378, 0x00f277bacda50e},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xb056585f863bbd, 0xdc5ab483283d10, 0x09dc7c421de92c, 0x6d01a5a8ebb312,
+       0x8b6a513afcbd79, 0x7aebe2b067caa0, 0x00026e0dc2e8cb},
+      {0xc3502902dde18a, 0x5facd8c6cf36d8, 0x0110781e4564c1, 0x1f3443d817ea27,
+       0x7461a5d68d1ffc, 0x24e14be256378c, 0x00ae8866bad8ef},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x3a78d0d265a91c, 0xf8ef6c8f83d3ac, 0xde8fd8d8171a29, 0xc42bf748ef98fd,
+       0xa73dc7df459ea1, 0xfa2d14dafc3981, 0x00b03dfa54c52a},
+      {0x406f6e6c0d2ce7, 0x0b2b41fd72cacc, 0x0678f602ddcd12, 0x8accf229ef5d90,
+       0x6d908af5f8a2d1, 0x85f2aafd1fcfce, 0x002ce2885a0e6d},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x109a0ec62666de, 0x2e757ffcd01e89, 0x69c48b5ab0c8c1, 0xf983ac6ca82061,
+       0x977d234bc2fdcf, 0xc96a59cfca7155, 0x001264cb335766},
+      {0x6913812e014b4b, 0x8707e4483ec56b, 0x0cffb1975831d2, 0x65a5f248cbf719,
+       0x3b4f69b66717a0, 0xa376d94ad8fac5, 0x00119ebeeea1a1},
+      {1, 0, 0, 0, 0, 0, 0}}},
+    {
+     {{0, 0, 0, 0, 0, 0, 0},
+      {0, 0, 0, 0, 0, 0, 0},
+      {0, 0, 0, 0, 0, 0, 0}},
+     {{0x12e340f47168ac, 0xd3a09008070591, 0xa1cc7fdedf3917, 0x8512e48ab6971d,
+       0xf6297ecbd8aa25, 0xb6a3804100caa7, 0x00f19c3f9b433e},
+      {0xe0b1762d8b523f, 0x78cb39d2cf6c45, 0x8bee4928be1b70, 0x5a620149af40b6,
+       0x38904565d24d48, 0x090c4a1e9b515d, 0x00ae61a171f610},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x5e0f5d2805e596, 0xa01d262810506f, 0x53ee0d124b89bb, 0xbadc49fb712e12,
+       0xf0c000d214b583, 0xc3ef049f9294aa, 0x004e5a9dfe6ac2},
+      {0x5622c691013e25, 0x321bced6e71496, 0x3d0051e0574b8f, 0x7a5e5a25b5a060,
+       0x6b571281a2b658, 0xf1717bdd7fa630, 0x00526f1b07f6ac},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xff5ece88f05154, 0xbe4f62091c2c9b, 0xb4fc1b7102b008, 0xbf37e0c6bc5cd1,
+       0x12eb0e1eadfda0, 0x4fcf1c4a42aae9, 0x00aef19fb9e788},
+      {0x1276425b94e7af, 0xa2a398102462b8, 0x5834e2fa7ae591, 0xe9413a45ca4d2b,
+       0x783cd6fe84fc47, 0x532f7814995822, 0x0023d1ed959bb5},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xde52c7a213e83b, 0x92d055db2392b3, 0x7fa76f70c9464a, 0x455c1c820f5490,
+       0x1bfebcf03811a5, 0xfa7fdbc082aba7, 0x00c6b405288edf},
+      {0x7bb07de3636016, 0x9e9a4c00333ac0, 0x0753eec12112b2, 0x640707c9888e19,
+       0x519fa164acc0d1, 0xeafbb78ca0ff03, 0x005c88fb72c6c4},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xbd2b8ef75508fc, 0xf29262bfd0c558, 0x30142ab328a91b, 0x632c89cf88d90e,
+       0x2d6788729f12b6, 0x4dc6c892750221, 0x00e5003a3f2915},
+      {0x90953325010799, 0x8d422bb5ff4b0c, 0x3576aa7b5fe70c, 0xa1c6f02e1c1a2a,
+       0x0ab45f38569944, 0xd7abb580ce6abc, 0x0064aa8ae383c9},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x6f396e7c41cec4, 0xcf56bdb3029a58, 0xffdc28f3ff6273, 0xadcbfafc3e31b2,
+       0x0a9a632084e14d, 0xe1dff39aa51ad4, 0x00d1af43828307},
+      {0x285854d1474980, 0xb3be7bd30cbff4, 0x16bdb54eeb6f9c, 0x4202560e69efed,
+       0x181994b6456f62, 0x7bc3726ea875f8, 0x00a922c4508358},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x0829822360374b, 0x95a7bae9408424, 0x1074a33f398368, 0x4266b4fd8631b5,
+       0xa51be58e09378b, 0x5e12e75930f90f, 0x00a06ea7d1fd03},
+      {0x20ab1e5cb6a429, 0x4118cb96b0e94f, 0x8963edba69630c, 0xb2dc37cba862b0,
+       0x77b186a7a42760, 0xc396405292fe38, 0x00abc08adc6dd6},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xb2e4383f385d2b, 0x8ac4932b516d35, 0xfe51a3599f6e66, 0xd12c0f3a8a1646,
+       0x6da385aee309ab, 0xe9430231423bc4, 0x00f23c10b4637e},
+      {0xbc215d22248e00, 0x47e3d45f6553c0, 0x71daad7d1d9ed4, 0x1f2d8179af0847,
+       0x7bb3fdee94bf70, 0xac781e8c72ad26, 0x00c425de168de7},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xa51c99470f3a77, 0x228125d95dd3d8, 0x3e2a5fab8d8d6a, 0x5ac2cb2b57fa04,
+       0x628e690677506d, 0xfe6d134c04ee53, 0x0089d95ca20ecc},
+      {0xc443936ee36b40, 0x6703663f07f9c4, 0x1eeb5d4d0bddba, 0x94b962cc03e7dd,
+       0x13cdb6f9d5c477, 0x47a5eb8ffdb312, 0x009d9927dab768},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xad4eb3c058ec50, 0x3e243165e00596, 0xabc2c17c13243b, 0x10135494b483ca,
+       0xcc3b8e97a8dc97, 0x69f824f2c4750d, 0x0057d89c1ff7e7},
+      {0xda442a7bc53acb, 0x1e5a7fb230cd3d, 0x4137b0654b143b, 0x506caa55e86618,
+       0x2efddfae713a85, 0x71ca4c177b58ee, 0x00b3ad81083541},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xdb76932d4575b7, 0x73dfc259599ab6, 0xbbdc10b088830d, 0xd4ace4b2d93c90,
+       0x0b8d5bcec529b5, 0x1953db269d5d57, 0x001ac4c02a73b1},
+      {0x4d4a8e642fd505, 0x4f3d58d2377703, 0x3eaefe54c00b1d, 0x4d8743d300d28d,
+       0x82d9cf31b3a326, 0x62048ac60d5abf, 0x00ebc5abc0e494},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xd0739bc0539803, 0x6bd6cbbec2f6d3, 0x554f8e076ba512, 0xa5ef3a9a014976,
+       0xa01bd3fd7bdc2b, 0x90ee0d2ee2a8ef, 0x00a905806485a3},
+      {0xaa5cc6f93f855d, 0x63117347e35a32, 0x673141361c0a58, 0x0c0cc8b191209b,
+       0xf4841d38f98f25, 0x6edf8de6ffdd57, 0x00f5af1a9ac251},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0xbd9de80856efa9, 0x27c03c66ad4cbd, 0x86aa0dd7a0a36f, 0x1314a5c1408ca4,
+       0xc4c80f3e877b51, 0x642956fec23eee, 0x00217186f9324d},
+      {0xd788ad470678f0, 0x5c3555f895260b, 0x358fdae64162b9, 0x54304321ef9454,
+       0xe02dc8f8e08661, 0x97edfa9ccf772b, 0x00d419dae5f120},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x9366612dc6971d, 0x2082d99b377eb9, 0x7bee5f6ee7b09d, 0xe8826c629f3759,
+       0xcabf536e23d920, 0x3ff4bea835af08, 0x003d245181ea77},
+      {0x68abef0506d4c9, 0x2a29c53f53e148, 0xcc5817bdbc91a3, 0x48d6b592c1ed17,
+       0x9a972a20f09153, 0xa6a5459978de71, 0x00701432ee05a1},
+      {1, 0, 0, 0, 0, 0, 0}},
+     {{0x306c550ef05a18, 0xc94dff356193fa, 0x2d27730e609791, 0x70831c35c0c6a1,
+       0x449c11f5b0702a, 0x111645872e8c32, 0x0006c21a5723a4},
+      {0x704be004e4de38, 0xe051aab21335ce, 0xeac9d2f3c924c3, 0x92b962d5bf3fc7,
+       0xa8e06c5fffb892, 0x0e750660f04217, 0x00b00515a9c0bf},
+      {1, 0, 0, 0, 0, 0, 0}}}
+};
+
+/*
+ * select_point selects the |idx|th point from a precomputation table and
+ * copies it to out.
+ */
+ /* pre_comp below is of the size provided in |size| */
+static void select_point(const limb idx, unsigned int size,
+                         const felem pre_comp[][3], felem out[3])
+{
+    unsigned i, j;
+    limb *outlimbs = &out[0][0];
+
+    memset(out, 0, sizeof(*out) * 3);
+
+    for (i = 0; i < size; i++) {
+        const limb *inlimbs = &pre_comp[i][0][0];
+        limb mask = i ^ idx;
+        mask |= mask >> 4;
+        mask |= mask >> 2;
+        mask |= mask >> 1;
+        mask &= 1;
+        mask--;
+        for (j = 0; j < NLIMBS * 3; j++)
+            outlimbs[j] |= inlimbs[j] & mask;
+    }
+}
+
+/* get_bit returns the |i|th bit in |in| */
+static char get_bit(const felem_bytearray in, int i)
+{
+    if ((i < 0) || (i >= 384))
+        return 0;
+    return (in[i >> 3] >> (i & 7)) & 1;
+}
+
+/*
+ * Interleaved point multiplication using precomputed point multiples: The
+ * small point multiples 0*P, 1*P, ..., 16*P are in pre_comp[], the scalars
+ * in scalars[]. If g_scalar is non-NULL, we also add this multiple of the
+ * generator, using certain (large) precomputed multiples in g_pre_comp.
+ * Output point (X, Y, Z) is stored in x_out, y_out, z_out
+ */
+static void batch_mul(felem x_out, felem y_out, felem z_out,
+                      const felem_bytearray scalars[],
+                      const unsigned num_points, const u8 *g_scalar,
+                      const int mixed, const felem pre_comp[][17][3],
+                      const felem g_pre_comp[2][16][3])
+{
+    int i, skip;
+    unsigned num, gen_mul = (g_scalar != NULL);
+    felem nq[3], tmp[4];
+    limb bits;
+    u8 sign, digit;
+
+    /* set nq to the point at infinity */
+    memset(nq, 0, sizeof(nq));
+
+    /*
+     * Loop over all scalars msb-to-lsb, interleaving additions of multiples
+     * of the generator (two in each of the last 48 rounds) and additions of
+     * other points multiples (every 5th round).
+     */
+    skip = 1;                   /* save two point operations in the first
+                                 * round */
+    for (i = (num_points ? 383 : 47); i >= 0; --i) {
+        /* double */
+        if (!skip)
+            point_double(nq[0], nq[1], nq[2], nq[0], nq[1], nq[2]);
+
+        /* add multiples of the generator */
+        if (gen_mul && (i <= 47)) {
+            /* first, look 48 bits upwards */
+            bits = get_bit(g_scalar, i + 336) << 3;
+            bits |= get_bit(g_scalar, i + 240) << 2;
+            bits |= get_bit(g_scalar, i + 144) << 1;
+            bits |= get_bit(g_scalar, i + 48);
+            /* select the point to add, in constant time */
+            select_point(bits, 16, g_pre_comp[1], tmp);
+
+            if (!skip) {
+                /* Arg 1 below is for "mixed" */
+                point_add(nq[0], nq[1], nq[2],
+                          nq[0], nq[1], nq[2], 1, tmp[0], tmp[1], tmp[2]);
+            } else {
+                memcpy(nq, tmp, 3 * sizeof(felem));
+                skip = 0;
+            }
+
+            /* second, look at the current position */
+            bits = get_bit(g_scalar, i + 288) << 3;
+            bits |= get_bit(g_scalar, i + 192) << 2;
+            bits |= get_bit(g_scalar, i + 96) << 1;
+            bits |= get_bit(g_scalar, i);
+            /* select the point to add, in constant time */
+            select_point(bits, 16, g_pre_comp[0], tmp);
+            /* Arg 1 below is for "mixed" */
+            point_add(nq[0], nq[1], nq[2],
+                      nq[0], nq[1], nq[2], 1, tmp[0], tmp[1], tmp[2]);
+        }
+
+        /* do other additions every 5 doublings */
+        if (num_points && (i % 5 == 0)) {
+            /* loop over all scalars */
+            for (num = 0; num < num_points; ++num) {
+                bits = get_bit(scalars[num], i + 4) << 5;
+                bits |= get_bit(scalars[num], i + 3) << 4;
+                bits |= get_bit(scalars[num], i + 2) << 3;
+                bits |= get_bit(scalars[num], i + 1) << 2;
+                bits |= get_bit(scalars[num], i) << 1;
+                bits |= get_bit(scalars[num], i - 1);
+                ec_GFp_nistp_recode_scalar_bits(&sign, &digit, bits);
+
+                /*
+                 * select the point to add or subtract, in constant time
+                 */
+                select_point(digit, 17, pre_comp[num], tmp);
+                felem_neg(tmp[3], tmp[1]); /* (X, -Y, Z) is the negative
+                                            * point */
+                copy_conditional(tmp[1], tmp[3], (-(limb) sign));
+
+                if (!skip) {
+                    point_add(nq[0], nq[1], nq[2],
+                              nq[0], nq[1], nq[2],
+                              mixed, tmp[0], tmp[1], tmp[2]);
+                } else {
+                    memcpy(nq, tmp, 3 * sizeof(felem));
+                    skip = 0;
+                }
+            }
+        }
+    }
+    felem_assign(x_out, nq[0]);
+    felem_assign(y_out, nq[1]);
+    felem_assign(z_out, nq[2]);
+}
+
+/* Precomputation for the group generator. */
+struct nistp384_pre_comp_st {
+    felem g_pre_comp[2][16][3];
+    CRYPTO_REF_COUNT references;
+    CRYPTO_RWLOCK *lock;
+};
+
+const EC_METHOD *ossl_ec_GFp_nistp384_method(void)
+{
+    static const EC_METHOD ret = {
+        EC_FLAGS_DEFAULT_OCT,
+        NID_X9_62_prime_field,
+        ec_GFp_nistp384_group_init,
+        ec_GFp_simple_group_finish,
+        ec_GFp_simple_group_clear_finish,
+        ec_GFp_nist_group_copy,
+        ec_GFp_nistp384_group_set_curve,
+        ec_GFp_simple_group_get_curve,
+        ec_GFp_simple_group_get_degree,
+        ec_group_simple_order_bits,
+        ec_GFp_simple_group_check_discriminant,
+        ec_GFp_simple_point_init,
+        ec_GFp_simple_point_finish,
+        ec_GFp_simple_point_clear_finish,
+        ec_GFp_simple_point_copy,
+        ec_GFp_simple_point_set_to_infinity,
+        ec_GFp_simple_point_set_affine_coordinates,
+        ec_GFp_nistp384_point_get_affine_coordinates,
+        0 /* point_set_compressed_coordinates */ ,
+        0 /* point2oct */ ,
+        0 /* oct2point */ ,
+        ec_GFp_simple_add,
+        ec_GFp_simple_dbl,
+        ec_GFp_simple_invert,
+        ec_GFp_simple_is_at_infinity,
+        ec_GFp_simple_is_on_curve,
+        ec_GFp_simple_cmp,
+        ec_GFp_simple_make_affine,
+        ec_GFp_simple_points_make_affine,
+        ec_GFp_nistp384_points_mul,
+        ec_GFp_nistp384_precompute_mult,
+        ec_GFp_nistp384_have_precompute_mult,
+        ec_GFp_nist_field_mul,
+        ec_GFp_nist_field_sqr,
+        0 /* field_div */ ,
+        ec_GFp_simple_field_inv,
+        0 /* field_encode */ ,
+        0 /* field_decode */ ,
+        0,                      /* field_set_to_one */
+        ec_key_simple_priv2oct,
+        ec_key_simple_oct2priv,
+        0, /* set private */
+        ec_key_simple_generate_key,
+        ec_key_simple_check_key,
+        ec_key_simple_generate_public_key,
+        0, /* keycopy */
+        0, /* keyfinish */
+        ecdh_simple_compute_key,
+        ecdsa_simple_sign_setup,
+        ecdsa_simple_sign_sig,
+        ecdsa_simple_verify_sig,
+        0, /* field_inverse_mod_ord */
+        0, /* blind_coordinates */
+        0, /* ladder_pre */
+        0, /* ladder_step */
+        0  /* ladder_post */
+    };
+
+    return &ret;
+}
+
+/******************************************************************************/
+/*
+ * FUNCTIONS TO MANAGE PRECOMPUTATION
+ */
+
+static NISTP384_PRE_COMP *nistp384_pre_comp_new(void)
+{
+    NISTP384_PRE_COMP *ret = OPENSSL_zalloc(sizeof(*ret));
+
+    if (ret == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+        return ret;
+    }
+
+    ret->references = 1;
+
+    ret->lock = CRYPTO_THREAD_lock_new();
+    if (ret->lock == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+        OPENSSL_free(ret);
+        return NULL;
+    }
+    return ret;
+}
+
+NISTP384_PRE_COMP *EC_nistp384_pre_comp_dup(NISTP384_PRE_COMP *p)
+{
+    int i;
+    if (p != NULL)
+        CRYPTO_UP_REF(&p->references, &i, p->lock);
+    return p;
+}
+
+void EC_nistp384_pre_comp_free(NISTP384_PRE_COMP *p)
+{
+    int i;
+
+    if (p == NULL)
+        return;
+
+    CRYPTO_DOWN_REF(&p->references, &i, p->lock);
+    REF_PRINT_COUNT("EC_nistp384", x);
+    if (i > 0)
+        return;
+    REF_ASSERT_ISNT(i < 0);
+
+    CRYPTO_THREAD_lock_free(p->lock);
+    OPENSSL_free(p);
+}
+
+/******************************************************************************/
+/*
+ * OPENSSL EC_METHOD FUNCTIONS
+ */
+
+int ec_GFp_nistp384_group_init(EC_GROUP *group)
+{
+    int ret;
+    ret = ec_GFp_simple_group_init(group);
+    group->a_is_minus3 = 1;
+    return ret;
+}
+
+int ec_GFp_nistp384_group_set_curve(EC_GROUP *group, const BIGNUM *p,
+                                    const BIGNUM *a, const BIGNUM *b,
+                                    BN_CTX *ctx)
+{
+    int ret = 0;
+    BIGNUM *curve_p, *curve_a, *curve_b;
+#ifndef FIPS_MODULE
+    BN_CTX *new_ctx = NULL;
+
+    if (ctx == NULL)
+        ctx = new_ctx = BN_CTX_new();
+#endif
+    if (ctx == NULL)
+        return 0;
+
+    BN_CTX_start(ctx);
+    curve_p = BN_CTX_get(ctx);
+    curve_a = BN_CTX_get(ctx);
+    curve_b = BN_CTX_get(ctx);
+    if (curve_b == NULL)
+        goto err;
+    BN_bin2bn(nistp384_curve_params[0], sizeof(felem_bytearray), curve_p);
+    BN_bin2bn(nistp384_curve_params[1], sizeof(felem_bytearray), curve_a);
+    BN_bin2bn(nistp384_curve_params[2], sizeof(felem_bytearray), curve_b);
+    if ((BN_cmp(curve_p, p)) || (BN_cmp(curve_a, a)) || (BN_cmp(curve_b, b))) {
+        ERR_raise(ERR_LIB_EC, EC_R_WRONG_CURVE_PARAMETERS);
+        goto err;
+    }
+    group->field_mod_func = BN_nist_mod_384;
+    ret = ec_GFp_simple_group_set_curve(group, p, a, b, ctx);
+ err:
+    BN_CTX_end(ctx);
+#ifndef FIPS_MODULE
+    BN_CTX_free(new_ctx);
+#endif
+    return ret;
+}
+
+/*
+ * Takes the Jacobian coordinates (X, Y, Z) of a point and returns (X', Y') =
+ * (X/Z^2, Y/Z^3)
+ */
+int ec_GFp_nistp384_point_get_affine_coordinates(const EC_GROUP *group,
+                                                 const EC_POINT *point,
+                                                 BIGNUM *x, BIGNUM *y,
+                                                 BN_CTX *ctx)
+{
+    felem z1, z2, x_in, y_in, x_out, y_out;
+    widefelem tmp;
+
+    if (EC_POINT_is_at_infinity(group, point)) {
+        ERR_raise(ERR_LIB_EC, EC_R_POINT_AT_INFINITY);
+        return 0;
+    }
+    if ((!BN_to_felem(x_in, point->X)) || (!BN_to_felem(y_in, point->Y)) ||
+        (!BN_to_felem(z1, point->Z)))
+        return 0;
+    felem_inv(z2, z1);
+    felem_square(tmp, z2);
+    felem_reduce(z1, tmp);
+    felem_mul(tmp, x_in, z1);
+    felem_reduce(x_in, tmp);
+    felem_contract(x_out, x_in);
+    if (x != NULL) {
+        if (!felem_to_BN(x, x_out)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            return 0;
+        }
+    }
+    felem_mul(tmp, z1, z2);
+    felem_reduce(z1, tmp);
+    felem_mul(tmp, y_in, z1);
+    felem_reduce(y_in, tmp);
+    felem_contract(y_out, y_in);
+    if (y != NULL) {
+        if (!felem_to_BN(y, y_out)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * points below is of size |num|, and tmp_felems is of size |num+1|.
+ * Plain pointers rather than array parameters, so that GCC does not take
+ * the first row of g_pre_comp as the bound of |points| when both halves of
+ * it are made affine at once (-Wstringop-overflow).
+ */
+static void make_points_affine(size_t num, felem (*points)[3],
+                               felem *tmp_felems)
+{
+    /*
+     * Runs in constant time, unless an input is the point at infinity (which
+     * normally shouldn't happen).
+     */
+    ec_GFp_nistp_points_make_affine_internal(num,
+                                             points,
+                                             sizeof(felem),
+                                             tmp_felems,
+                                             (void (*)(void *))felem_one,
+                                             felem_is_zero_int,
+                                             (void (*)(void *, const void *))
+                                             felem_assign,
+                                             (void (*)(void *, const void *))
+                                             felem_square_reduce,
+                                             (void (*)
+                                              (void *, const void *,
+                                               const void *))
+                                             felem_mul_reduce,
+                                             (void (*)(void *, const void *))
+                                             felem_inv,
+                                             (void (*)(void *, const void *))
+                                             felem_contract);
+}
+
+/*
+ * Computes scalar*generator + \sum scalars[i]*points[i], ignoring NULL
+ * values Result is stored in r (r can equal one of the inputs).
+ */
+int ec_GFp_nistp384_points_mul(const EC_GROUP *group, EC_POINT *r,
+                               const BIGNUM *scalar, size_t num,
+                               const EC_POINT *points[],
+                               const BIGNUM *scalars[], BN_CTX *ctx)
+{
+    int ret = 0;
+    int j;
+    int mixed = 0;
+    BIGNUM *x, *y, *z, *tmp_scalar;
+    felem_bytearray g_secret;
+    felem_bytearray *secrets = NULL;
+    felem (*pre_comp)[17][3] = NULL;
+    felem *tmp_felems = NULL;
+    unsigned i;
+    int num_bytes;
+    int have_pre_comp = 0;
+    size_t num_points = num;
+    felem x_in, y_in, z_in, x_out, y_out, z_out;
+    NISTP384_PRE_COMP *pre = NULL;
+    felem(*g_pre_comp)[16][3] = NULL;
+    EC_POINT *generator = NULL;
+    const EC_POINT *p = NULL;
+    const BIGNUM *p_scalar = NULL;
+
+    BN_CTX_start(ctx);
+    x = BN_CTX_get(ctx);
+    y = BN_CTX_get(ctx);
+    z = BN_CTX_get(ctx);
+    tmp_scalar = BN_CTX_get(ctx);
+    if (tmp_scalar == NULL)
+        goto err;
+
+    if (scalar != NULL) {
+        pre = group->pre_comp.nistp384;
+        if (pre)
+            /* we have precomputation, try to use it */
+            g_pre_comp = &pre->g_pre_comp[0];
+        else
+            /* try to use the standard precomputation */
+            g_pre_comp = (felem(*)[16][3]) gmul;
+        generator = EC_POINT_new(group);
+        if (generator == NULL)
+            goto err;
+        /* get the generator from precomputation */
+        if (!felem_to_BN(x, g_pre_comp[0][1][0]) ||
+            !felem_to_BN(y, g_pre_comp[0][1][1]) ||
+            !felem_to_BN(z, g_pre_comp[0][1][2])) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+        if (!ec_GFp_simple_set_Jprojective_coordinates_GFp(group, generator, x,
+                                                           y, z, ctx))
+            goto err;
+        if (0 == EC_POINT_cmp(group, generator, group->generator, ctx))
+            /* precomputation matches generator */
+            have_pre_comp = 1;
+        else
+            /*
+             * we don't have valid precomputation: treat the generator as a
+             * random point
+             */
+            num_points++;
+    }
+
+    if (num_points > 0) {
+        if (num_points >= 2) {
+            /*
+             * unless we precompute multiples for just one point, converting
+             * those into affine form is time well spent
+             */
+            mixed = 1;
+        }
+        secrets = OPENSSL_zalloc(sizeof(*secrets) * num_points);
+        pre_comp = OPENSSL_zalloc(sizeof(*pre_comp) * num_points);
+        if (mixed)
+            tmp_felems =
+                OPENSSL_malloc(sizeof(*tmp_felems) * (num_points * 17 + 1));
+        if ((secrets == NULL) || (pre_comp == NULL)
+            || (mixed && (tmp_felems == NULL))) {
+            ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+
+        /*
+         * we treat NULL scalars as 0, and NULL points as points at infinity,
+         * i.e., they contribute nothing to the linear combination
+         */
+        for (i = 0; i < num_points; ++i) {
+            if (i == num) {
+                /*
+                 * we didn't have a valid precomputation, so we pick the
+                 * generator
+                 */
+                p = EC_GROUP_get0_generator(group);
+                p_scalar = scalar;
+            } else {
+                /* the i^th point */
+                p = points[i];
+                p_scalar = scalars[i];
+            }
+            if ((p_scalar != NULL) && (p != NULL)) {
+                /* reduce scalar to 0 <= scalar < 2^384 */
+                if ((BN_num_bits(p_scalar) > 384)
+                    || (BN_is_negative(p_scalar))) {
+                    /*
+                     * this is an unusual input, and we don't guarantee
+                     * constant-timeness
+                     */
+                    if (!BN_nnmod(tmp_scalar, p_scalar, group->order, ctx)) {
+                        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+                        goto err;
+                    }
+                    num_bytes = BN_bn2lebinpad(tmp_scalar,
+                                               secrets[i], sizeof(secrets[i]));
+                } else {
+                    num_bytes = BN_bn2lebinpad(p_scalar,
+                                               secrets[i], sizeof(secrets[i]));
+                }
+                if (num_bytes < 0) {
+                    ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+                    goto err;
+                }
+                /* precompute multiples */
+                if ((!BN_to_felem(x_out, p->X)) ||
+                    (!BN_to_felem(y_out, p->Y)) ||
+                    (!BN_to_felem(z_out, p->Z)))
+                    goto err;
+                memcpy(pre_comp[i][1][0], x_out, sizeof(felem));
+                memcpy(pre_comp[i][1][1], y_out, sizeof(felem));
+                memcpy(pre_comp[i][1][2], z_out, sizeof(felem));
+                for (j = 2; j <= 16; ++j) {
+                    if (j & 1) {
+                        point_add(pre_comp[i][j][0], pre_comp[i][j][1],
+                                  pre_comp[i][j][2], pre_comp[i][1][0],
+                                  pre_comp[i][1][1], pre_comp[i][1][2], 0,
+                                  pre_comp[i][j - 1][0],
+                                  pre_comp[i][j - 1][1],
+                                  pre_comp[i][j - 1][2]);
+                    } else {
+                        point_double(pre_comp[i][j][0], pre_comp[i][j][1],
+                                     pre_comp[i][j][2], pre_comp[i][j / 2][0],
+                                     pre_comp[i][j / 2][1],
+                                     pre_comp[i][j / 2][2]);
+                    }
+                }
+            }
+        }
+        if (mixed)
+            make_points_affine(num_points * 17, pre_comp[0], tmp_felems);
+    }
+
+    /* the scalar for the generator */
+    if ((scalar != NULL) && (have_pre_comp)) {
+        memset(g_secret, 0, sizeof(g_secret));
+        /* reduce scalar to 0 <= scalar < 2^384 */
+        if ((BN_num_bits(scalar) > 384) || (BN_is_negative(scalar))) {
+            /*
+             * this is an unusual input, and we don't guarantee
+             * constant-timeness
+             */
+            if (!BN_nnmod(tmp_scalar, scalar, group->order, ctx)) {
+                ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+                goto err;
+            }
+            num_bytes = BN_bn2lebinpad(tmp_scalar, g_secret, sizeof(g_secret));
+        } else {
+            num_bytes = BN_bn2lebinpad(scalar, g_secret, sizeof(g_secret));
+        }
+        /* do the multiplication with generator precomputation */
+        batch_mul(x_out, y_out, z_out,
+                  (const felem_bytearray(*))secrets, num_points,
+                  g_secret,
+                  mixed, (const felem(*)[17][3])pre_comp,
+                  (const felem(*)[16][3])g_pre_comp);
+    } else {
+        /* do the multiplication without generator precomputation */
+        batch_mul(x_out, y_out, z_out,
+                  (const felem_bytearray(*))secrets, num_points,
+                  NULL, mixed, (const felem(*)[17][3])pre_comp, NULL);
+    }
+    felem_contract(x_in, x_out);
+    felem_contract(y_in, y_out);
+    felem_contract(z_in, z_out);
+    if ((!felem_to_BN(x, x_in)) || (!felem_to_BN(y, y_in)) ||
+        (!felem_to_BN(z, z_in))) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+    ret = ec_GFp_simple_set_Jprojective_coordinates_GFp(group, r, x, y, z, ctx);
+
+ err:
+    BN_CTX_end(ctx);
+    EC_POINT_free(generator);
+    OPENSSL_free(secrets);
+    OPENSSL_free(pre_comp);
+    OPENSSL_free(tmp_felems);
+    return ret;
+}
+
+int ec_GFp_nistp384_precompute_mult(EC_GROUP *group, BN_CTX *ctx)
+{
+    int ret = 0;
+    NISTP384_PRE_COMP *pre = NULL;
+    int i, j;
+    BIGNUM *x, *y;
+    EC_POINT *generator = NULL;
+    felem tmp_felems[32];
+#ifndef FIPS_MODULE
+    BN_CTX *new_ctx = NULL;
+#endif
+
+    /* throw away old precomputation */
+    EC_pre_comp_free(group);
+
+#ifndef FIPS_MODULE
+    if (ctx == NULL)
+        ctx = new_ctx = BN_CTX_new();
+#endif
+    if (ctx == NULL)
+        return 0;
+
+    BN_CTX_start(ctx);
+    x = BN_CTX_get(ctx);
+    y = BN_CTX_get(ctx);
+    if (y == NULL)
+        goto err;
+    /* get the generator */
+    if (group->generator == NULL)
+        goto err;
+    generator = EC_POINT_new(group);
+    if (generator == NULL)
+        goto err;
+    BN_bin2bn(nistp384_curve_params[3], sizeof(felem_bytearray), x);
+    BN_bin2bn(nistp384_curve_params[4], sizeof(felem_bytearray), y);
+    if (!EC_POINT_set_affine_coordinates(group, generator, x, y, ctx))
+        goto err;
+    if ((pre = nistp384_pre_comp_new()) == NULL)
+        goto err;
+    /*
+     * if the generator is the standard one, use built-in precomputation
+     */
+    if (0 == EC_POINT_cmp(group, generator, group->generator, ctx)) {
+        memcpy(pre->g_pre_comp, gmul, sizeof(pre->g_pre_comp));
+        goto done;
+    }
+    if ((!BN_to_felem(pre->g_pre_comp[0][1][0], group->generator->X)) ||
+        (!BN_to_felem(pre->g_pre_comp[0][1][1], group->generator->Y)) ||
+        (!BN_to_felem(pre->g_pre_comp[0][1][2], group->generator->Z)))
+        goto err;
+    /*
+     * compute 2^96*G, 2^192*G, 2^288*G for the first table, 2^48*G,
+     * 2^144*G, 2^240*G, 2^336*G for the second one
+     */
+    for (i = 1; i <= 8; i <<= 1) {
+        point_double(pre->g_pre_comp[1][i][0], pre->g_pre_comp[1][i][1],
+                     pre->g_pre_comp[1][i][2], pre->g_pre_comp[0][i][0],
+                     pre->g_pre_comp[0][i][1], pre->g_pre_comp[0][i][2]);
+        for (j = 0; j < 47; ++j) {
+            point_double(pre->g_pre_comp[1][i][0], pre->g_pre_comp[1][i][1],
+                         pre->g_pre_comp[1][i][2], pre->g_pre_comp[1][i][0],
+                         pre->g_pre_comp[1][i][1], pre->g_pre_comp[1][i][2]);
+        }
+        if (i == 8)
+            break;
+        point_double(pre->g_pre_comp[0][2 * i][0],
+                     pre->g_pre_comp[0][2 * i][1],
+                     pre->g_pre_comp[0][2 * i][2], pre->g_pre_comp[1][i][0],
+                     pre->g_pre_comp[1][i][1], pre->g_pre_comp[1][i][2]);
+        for (j = 0; j < 47; ++j) {
+            point_double(pre->g_pre_comp[0][2 * i][0],
+                         pre->g_pre_comp[0][2 * i][1],
+                         pre->g_pre_comp[0][2 * i][2],
+                         pre->g_pre_comp[0][2 * i][0],
+                         pre->g_pre_comp[0][2 * i][1],
+                         pre->g_pre_comp[0][2 * i][2]);
+        }
+    }
+    for (i = 0; i < 2; i++) {
+        /* g_pre_comp[i][0] is the point at infinity */
+        memset(pre->g_pre_comp[i][0], 0, sizeof(pre->g_pre_comp[i][0]));
+        /* the remaining multiples */
+        /* 2^96*G + 2^192*G resp. 2^144*G + 2^240*G */
+        point_add(pre->g_pre_comp[i][6][0], pre->g_pre_comp[i][6][1],
+                  pre->g_pre_comp[i][6][2], pre->g_pre_comp[i][4][0],
+                  pre->g_pre_comp[i][4][1], pre->g_pre_comp[i][4][2],
+                  0, pre->g_pre_comp[i][2][0], pre->g_pre_comp[i][2][1],
+                  pre->g_pre_comp[i][2][2]);
+        /* 2^96*G + 2^288*G resp. 2^144*G + 2^336*G */
+        point_add(pre->g_pre_comp[i][10][0], pre->g_pre_comp[i][10][1],
+                  pre->g_pre_comp[i][10][2], pre->g_pre_comp[i][8][0],
+                  pre->g_pre_comp[i][8][1], pre->g_pre_comp[i][8][2],
+                  0, pre->g_pre_comp[i][2][0], pre->g_pre_comp[i][2][1],
+                  pre->g_pre_comp[i][2][2]);
+        /* 2^192*G + 2^288*G resp. 2^240*G + 2^336*G */
+        point_add(pre->g_pre_comp[i][12][0], pre->g_pre_comp[i][12][1],
+                  pre->g_pre_comp[i][12][2], pre->g_pre_comp[i][8][0],
+                  pre->g_pre_comp[i][8][1], pre->g_pre_comp[i][8][2],
+                  0, pre->g_pre_comp[i][4][0], pre->g_pre_comp[i][4][1],
+                  pre->g_pre_comp[i][4][2]);
+        /*
+         * 2^96*G + 2^192*G + 2^288*G resp. 2^144*G + 2^240*G + 2^336*G
+         */
+        point_add(pre->g_pre_comp[i][14][0], pre->g_pre_comp[i][14][1],
+                  pre->g_pre_comp[i][14][2], pre->g_pre_comp[i][12][0],
+                  pre->g_pre_comp[i][12][1], pre->g_pre_comp[i][12][2],
+                  0, pre->g_pre_comp[i][2][0], pre->g_pre_comp[i][2][1],
+                  pre->g_pre_comp[i][2][2]);
+        for (j = 1; j < 8; ++j) {
+            /* odd multiples: add G resp. 2^48*G */
+            point_add(pre->g_pre_comp[i][2 * j + 1][0],
+                      pre->g_pre_comp[i][2 * j + 1][1],
+                      pre->g_pre_comp[i][2 * j + 1][2],
+                      pre->g_pre_comp[i][2 * j][0],
+                      pre->g_pre_comp[i][2 * j][1],
+                      pre->g_pre_comp[i][2 * j][2], 0,
+                      pre->g_pre_comp[i][1][0], pre->g_pre_comp[i][1][1],
+                      pre->g_pre_comp[i][1][2]);
+        }
+    }
+    make_points_affine(31, &(pre->g_pre_comp[0][1]), tmp_felems);
+
+ done:
+    SETPRECOMP(group, nistp384, pre);
+    ret = 1;
+    pre = NULL;
+ err:
+    BN_CTX_end(ctx);
+    EC_POINT_free(generator);
+#ifndef FIPS_MODULE
+    BN_CTX_free(new_ctx);
+#endif
+    EC_nistp384_pre_comp_free(pre);
+    return ret;
+}
+
+int ec_GFp_nistp384_have_precompute_mult(const EC_GROUP *group)
+{
+    return HAVEPRECOMP(group, nistp384);
+}
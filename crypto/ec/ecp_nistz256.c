@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2014-2021 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2014, Intel Corporation. All Rights Reserved.
  * Copyright (c) 2015, CloudFlare, Inc.
  *
@@ -786,6 +786,132 @@ __owur static int ecp_nistz256_windowed_mul(const EC_GROUP *group,
     return ret;
 }
 
+/*
+ * Multi-scalar multiplications with at least this many points use
+ * ecp_nistz256_pippenger_mul() instead of ecp_nistz256_windowed_mul().
+ */
+#define P256_PIPPENGER_MIN_POINTS 80
+
+/*
+ * r = sum(scalar[i]*point[i]) using Pippenger's bucket method, as in
+ * ec_pippenger_mul(). Unlike ecp_nistz256_windowed_mul() this is not constant
+ * time, so it is only used for a large number of points, where the scalars
+ * are public (e.g. batch signature verification).
+ */
+__owur static int ecp_nistz256_pippenger_mul(const EC_GROUP *group,
+                                             P256_POINT *r,
+                                             const BIGNUM **scalar,
+                                             const EC_POINT **point,
+                                             size_t num, BN_CTX *ctx)
+{
+    size_t i, b, nbuckets, cost, best_cost = 0;
+    unsigned int c, best_c = 1, nwin, w, j, pos;
+    int d, carry, ret = 0;
+    int *digits = NULL;
+    P256_POINT *pts = NULL, *buckets = NULL;
+    ALIGN32 P256_POINT sum, tot, neg;
+    BN_ULONG k[P256_LIMBS];
+
+    for (c = 1; c <= 16; c++) {
+        cost = (256 / c + 1) * (num + ((size_t)1 << c));
+        if (best_cost == 0 || cost < best_cost) {
+            best_cost = cost;
+            best_c = c;
+        }
+    }
+    c = best_c;
+    nwin = 256 / c + 1;
+    nbuckets = (size_t)1 << (c - 1);
+
+    if (num > OPENSSL_MALLOC_MAX_NELEMS(P256_POINT)
+        || num > OPENSSL_MALLOC_MAX_NELEMS(int) / nwin
+        || (pts = OPENSSL_malloc(num * sizeof(*pts))) == NULL
+        || (buckets = OPENSSL_malloc(nbuckets * sizeof(*buckets))) == NULL
+        || (digits = OPENSSL_malloc(num * nwin * sizeof(*digits))) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    for (i = 0; i < num; i++) {
+        const BIGNUM *s = scalar[i];
+
+        if ((BN_num_bits(s) > 256) || BN_is_negative(s)) {
+            BIGNUM *mod;
+
+            if ((mod = BN_CTX_get(ctx)) == NULL)
+                goto err;
+            if (!BN_nnmod(mod, s, group->order, ctx)) {
+                ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+                goto err;
+            }
+            s = mod;
+        }
+        if (!bn_copy_words(k, s, P256_LIMBS)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_INTERNAL_ERROR);
+            goto err;
+        }
+
+        /* Signed base 2^c digits in [-2^(c-1), 2^(c-1)] */
+        for (w = 0, carry = 0; w < nwin; w++) {
+            for (d = 0, j = c; j-- > 0;) {
+                pos = w * c + j;
+                d <<= 1;
+                if (pos < 256)
+                    d |= (int)(k[pos / BN_BITS2] >> (pos % BN_BITS2)) & 1;
+            }
+            d += carry;
+            carry = d > (int)nbuckets;
+            if (carry)
+                d -= 1 << c;
+            digits[i * nwin + w] = d;
+        }
+
+        if (!ecp_nistz256_bignum_to_field_elem(pts[i].X, point[i]->X)
+            || !ecp_nistz256_bignum_to_field_elem(pts[i].Y, point[i]->Y)
+            || !ecp_nistz256_bignum_to_field_elem(pts[i].Z, point[i]->Z)) {
+            ERR_raise(ERR_LIB_EC, EC_R_COORDINATES_OUT_OF_RANGE);
+            goto err;
+        }
+    }
+
+    /* The point at infinity has Z == 0 */
+    memset(r, 0, sizeof(*r));
+    for (w = nwin; w-- > 0;) {
+        for (j = 0; w != nwin - 1 && j < c; j++)
+            ecp_nistz256_point_double(r, r);
+
+        memset(buckets, 0, nbuckets * sizeof(*buckets));
+        for (i = 0; i < num; i++) {
+            d = digits[i * nwin + w];
+            if (d > 0) {
+                ecp_nistz256_point_add(&buckets[d - 1], &buckets[d - 1],
+                                       &pts[i]);
+            } else if (d < 0) {
+                memcpy(neg.X, pts[i].X, sizeof(neg.X));
+                ecp_nistz256_neg(neg.Y, pts[i].Y);
+                memcpy(neg.Z, pts[i].Z, sizeof(neg.Z));
+                ecp_nistz256_point_add(&buckets[-d - 1], &buckets[-d - 1],
+                                       &neg);
+            }
+        }
+
+        memset(&sum, 0, sizeof(sum));
+        memset(&tot, 0, sizeof(tot));
+        for (b = nbuckets; b > 0; b--) {
+            ecp_nistz256_point_add(&sum, &sum, &buckets[b - 1]);
+            ecp_nistz256_point_add(&tot, &tot, &sum);
+        }
+        ecp_nistz256_point_add(r, r, &tot);
+    }
+
+    ret = 1;
+ err:
+    OPENSSL_free(pts);
+    OPENSSL_free(buckets);
+    OPENSSL_free(digits);
+    return ret;
+}
+
 /* Coordinates of G, for which we have precomputed tables */
 static const BN_ULONG def_xG[P256_LIMBS] = {
     TOBN(0x79e730d4, 0x18a9143c), TOBN(0x75ba95fc, 0x5fedb601),
@@ -1148,8 +1274,14 @@ __owur static int ecp_nistz256_points_mul(const EC_GROUP *group,
         if (p_is_infinity)
             out = &p.p;
 
-        if (!ecp_nistz256_windowed_mul(group, out, scalars, points, num, ctx))
+        if (num >= P256_PIPPENGER_MIN_POINTS) {
+            if (!ecp_nistz256_pippenger_mul(group, out, scalars, points, num,
+                                            ctx))
+                goto err;
+        } else if (!ecp_nistz256_windowed_mul(group, out, scalars, points,
+                                              num, ctx)) {
             goto err;
+        }
 
         if (!p_is_infinity)
             ecp_nistz256_point_add(&p.p, &p.p, out);
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -610,6 +610,57 @@ int EVP_Digest(const void *data, size_t count,
     return ret;
 }
 
+int EVP_Digest_multi(const EVP_MD *type, size_t n,
+                     const unsigned char *const data[], size_t count,
+                     unsigned char *const md[], size_t size)
+{
+    EVP_MD_CTX *ctx;
+    size_t i;
+    int xof, ret = 0;
+
+    if (type == NULL || (n > 0 && (data == NULL || md == NULL))) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+    xof = (EVP_MD_flags(type) & EVP_MD_FLAG_XOF) != 0;
+    if (!xof && size != (size_t)EVP_MD_size(type)) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_INVALID_LENGTH);
+        return 0;
+    }
+
+    if (n == 0)
+        return 1;
+
+    if ((ctx = EVP_MD_CTX_new()) == NULL)
+        return 0;
+    EVP_MD_CTX_set_flags(ctx, EVP_MD_CTX_FLAG_ONESHOT);
+    /*
+     * Initialise first, so that the implementation used is found the same
+     * way as for a single message, and let it hash all messages at once if
+     * it can.
+     */
+    if (!EVP_DigestInit_ex(ctx, type, NULL))
+        goto err;
+    if (ctx->digest->prov != NULL && ctx->digest->digest_multi != NULL) {
+        ret = ctx->digest->digest_multi(ossl_provider_ctx(ctx->digest->prov),
+                                        n, data, count, md, size);
+        goto err;
+    }
+
+    for (i = 0; i < n; i++) {
+        if ((i > 0 && !EVP_DigestInit_ex(ctx, type, NULL))
+                || !EVP_DigestUpdate(ctx, data[i], count))
+            goto err;
+        if (xof ? !EVP_DigestFinalXOF(ctx, md[i], size)
+                : !EVP_DigestFinal_ex(ctx, md[i], NULL))
+            goto err;
+    }
+    ret = 1;
+ err:
+    EVP_MD_CTX_free(ctx);
+    return ret;
+}
+
 int EVP_MD_get_params(const EVP_MD *digest, OSSL_PARAM params[])
 {
     if (digest != NULL && digest->get_params != NULL)
@@ -908,6 +959,11 @@ static void *evp_md_from_dispatch(int name_id,
                 md->digest = OSSL_FUNC_digest_digest(fns);
             /* We don't increment fnct for this as it is stand alone */
             break;
+        case OSSL_FUNC_DIGEST_DIGEST_MULTI:
+            if (md->digest_multi == NULL)
+                md->digest_multi = OSSL_FUNC_digest_digest_multi(fns);
+            /* This is optional as well */
+            break;
         case OSSL_FUNC_DIGEST_FREECTX:
             if (md->freectx == NULL) {
                 md->freectx = OSSL_FUNC_digest_freectx(fns);
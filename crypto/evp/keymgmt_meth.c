@@ -1,5 +1,5 @@
 /*
- * Copyright 2019-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2019-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -84,6 +84,10 @@ static void *keymgmt_from_dispatch(int name_id,
             if (keymgmt->gen_cleanup == NULL)
                 keymgmt->gen_cleanup = OSSL_FUNC_keymgmt_gen_cleanup(fns);
             break;
+        case OSSL_FUNC_KEYMGMT_GEN_BATCH:
+            if (keymgmt->gen_batch == NULL)
+                keymgmt->gen_batch = OSSL_FUNC_keymgmt_gen_batch(fns);
+            break;
         case OSSL_FUNC_KEYMGMT_FREE:
             if (keymgmt->free == NULL)
                 keymgmt->free = OSSL_FUNC_keymgmt_free(fns);
@@ -185,7 +189,8 @@ static void *keymgmt_from_dispatch(int name_id,
         || (exportfncnt != 0 && exportfncnt != 2)
         || (keymgmt->gen != NULL
             && (keymgmt->gen_init == NULL
-                || keymgmt->gen_cleanup == NULL))) {
+                || keymgmt->gen_cleanup == NULL))
+        || (keymgmt->gen_batch != NULL && keymgmt->gen == NULL)) {
         EVP_KEYMGMT_free(keymgmt);
         ERR_raise(ERR_LIB_EVP, EVP_R_INVALID_PROVIDER_FUNCTIONS);
         return NULL;
@@ -349,6 +354,15 @@ void *evp_keymgmt_gen(const EVP_KEYMGMT *keymgmt, void *genctx,
     return keymgmt->gen(genctx, cb, cbarg);
 }
 
+int evp_keymgmt_gen_batch(const EVP_KEYMGMT *keymgmt, void *genctx,
+                          size_t n, void *keydata[],
+                          OSSL_CALLBACK *cb, void *cbarg)
+{
+    if (keymgmt->gen_batch == NULL)
+        return 0;
+    return keymgmt->gen_batch(genctx, n, keydata, cb, cbarg);
+}
+
 void evp_keymgmt_gen_cleanup(const EVP_KEYMGMT *keymgmt, void *genctx)
 {
     if (keymgmt->gen != NULL)
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2006-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -264,6 +264,79 @@ int EVP_PKEY_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY **ppkey)
     return EVP_PKEY_gen(ctx, ppkey);
 }
 
+int EVP_PKEY_keygen_batch(EVP_PKEY_CTX *ctx, size_t n, EVP_PKEY *ppkeys[])
+{
+    void **keydata = NULL;
+    size_t i;
+    int ret = 0;
+    /* Legacy compatible keygen callback info, only used with provider impls */
+    int gentmp[2];
+
+    if (ppkeys == NULL)
+        return -1;
+    for (i = 0; i < n; i++)
+        ppkeys[i] = NULL;
+
+    if (ctx == NULL) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATION_NOT_SUPPORTED_FOR_THIS_KEYTYPE);
+        return -2;
+    }
+    if (ctx->operation != EVP_PKEY_OP_KEYGEN) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATON_NOT_INITIALIZED);
+        return -1;
+    }
+
+    /* Keys generated from a template are done one by one */
+    if (ctx->op.keymgmt.genctx == NULL
+        || ctx->keymgmt->gen_batch == NULL
+        || ctx->pkey != NULL)
+        goto one_by_one;
+
+    if (n == 0)
+        return 1;
+    if ((keydata = OPENSSL_zalloc(n * sizeof(*keydata))) == NULL) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_MALLOC_FAILURE);
+        return -1;
+    }
+
+    /* See EVP_PKEY_gen() */
+    ctx->keygen_info = gentmp;
+    ctx->keygen_info_count = 2;
+    ret = evp_keymgmt_gen_batch(ctx->keymgmt, ctx->op.keymgmt.genctx, n,
+                                keydata, ossl_callback_to_pkey_gencb, ctx);
+    ctx->keygen_info = NULL;
+    if (ret <= 0)
+        goto err;
+
+    for (i = 0; i < n; i++) {
+        if ((ppkeys[i] = evp_keymgmt_util_make_pkey(ctx->keymgmt,
+                                                    keydata[i])) == NULL) {
+            ret = -1;
+            goto err;
+        }
+        keydata[i] = NULL;
+        ppkeys[i]->type = ctx->legacy_keytype;
+    }
+    OPENSSL_free(keydata);
+    return 1;
+
+ one_by_one:
+    for (i = 0; i < n; i++)
+        if ((ret = EVP_PKEY_keygen(ctx, &ppkeys[i])) <= 0)
+            goto err;
+    return 1;
+
+ err:
+    for (i = 0; i < n; i++) {
+        EVP_PKEY_free(ppkeys[i]);
+        ppkeys[i] = NULL;
+        if (keydata != NULL && keydata[i] != NULL)
+            evp_keymgmt_freedata(ctx->keymgmt, keydata[i]);
+    }
+    OPENSSL_free(keydata);
+    return ret;
+}
+
 void EVP_PKEY_CTX_set_cb(EVP_PKEY_CTX *ctx, EVP_PKEY_gen_cb *cb)
 {
     ctx->pkey_gencb = cb;
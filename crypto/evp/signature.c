@@ -74,6 +74,11 @@ static void *evp_signature_from_dispatch(int name_id,
             signature->sign = OSSL_FUNC_signature_sign(fns);
             signfncnt++;
             break;
+        case OSSL_FUNC_SIGNATURE_SIGN_BATCH:
+            if (signature->sign_batch != NULL)
+                break;
+            signature->sign_batch = OSSL_FUNC_signature_sign_batch(fns);
+            break;
         case OSSL_FUNC_SIGNATURE_VERIFY_INIT:
             if (signature->verify_init != NULL)
                 break;
@@ -152,6 +157,12 @@ static void *evp_signature_from_dispatch(int name_id,
             signature->digest_verify
                 = OSSL_FUNC_signature_digest_verify(fns);
             break;
+        case OSSL_FUNC_SIGNATURE_DIGEST_VERIFY_BATCH:
+            if (signature->digest_verify_batch != NULL)
+                break;
+            signature->digest_verify_batch
+                = OSSL_FUNC_signature_digest_verify_batch(fns);
+            break;
         case OSSL_FUNC_SIGNATURE_FREECTX:
             if (signature->freectx != NULL)
                 break;
@@ -575,6 +586,46 @@ int EVP_PKEY_sign(EVP_PKEY_CTX *ctx,
         return ctx->pmeth->sign(ctx, sig, siglen, tbs, tbslen);
 }
 
+int EVP_PKEY_sign_batch(EVP_PKEY_CTX *ctx, size_t n,
+                        unsigned char *const sigs[], size_t siglens[],
+                        const unsigned char *const tbs[],
+                        const size_t tbslens[])
+{
+    size_t i, sigsize = SIZE_MAX;
+    int ret;
+
+    if (ctx == NULL) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATION_NOT_SUPPORTED_FOR_THIS_KEYTYPE);
+        return -2;
+    }
+
+    if (ctx->operation != EVP_PKEY_OP_SIGN) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATON_NOT_INITIALIZED);
+        return -1;
+    }
+
+    if (ctx->op.sig.sigprovctx == NULL
+        || ctx->op.sig.signature->sign_batch == NULL)
+        goto one_by_one;
+
+    if (sigs != NULL)
+        for (i = 0; i < n; i++)
+            if (siglens[i] < sigsize)
+                sigsize = siglens[i];
+
+    return ctx->op.sig.signature->sign_batch(ctx->op.sig.sigprovctx, n,
+                                             sigs, siglens, sigsize,
+                                             tbs, tbslens);
+ one_by_one:
+    for (i = 0; i < n; i++) {
+        ret = EVP_PKEY_sign(ctx, sigs == NULL ? NULL : sigs[i], &siglens[i],
+                            tbs[i], tbslens[i]);
+        if (ret <= 0)
+            return ret;
+    }
+    return 1;
+}
+
 int EVP_PKEY_verify_init(EVP_PKEY_CTX *ctx)
 {
     return evp_pkey_signature_init(ctx, EVP_PKEY_OP_VERIFY);
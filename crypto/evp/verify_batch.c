@@ -0,0 +1,231 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include "internal/cryptlib.h"
+#include "crypto/evp.h"
+#include "evp_local.h"
+
+/*
+ * A batch of signatures to verify all at once.  Signatures whose provider
+ * implementation has a batch verification function (in the default provider
+ * currently only Ed25519) are verified together with it, which is faster
+ * than verifying them one by one; all the other ones are verified one by
+ * one with EVP_DigestVerify().
+ */
+
+typedef struct {
+    EVP_PKEY *pkey;
+    char *mdname;
+    const unsigned char *sig;
+    size_t siglen;
+    const unsigned char *tbs;
+    size_t tbslen;
+} EVP_VERIFY_BATCH_ENTRY;
+
+struct evp_verify_batch_st {
+    OSSL_LIB_CTX *libctx;
+    char *propq;
+    EVP_VERIFY_BATCH_ENTRY *entries;
+    size_t num;
+    size_t max;
+};
+
+EVP_VERIFY_BATCH *EVP_VERIFY_BATCH_new(OSSL_LIB_CTX *libctx,
+                                       const char *propq)
+{
+    EVP_VERIFY_BATCH *batch = OPENSSL_zalloc(sizeof(*batch));
+
+    if (batch == NULL) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_MALLOC_FAILURE);
+        return NULL;
+    }
+    batch->libctx = libctx;
+    if (propq != NULL && (batch->propq = OPENSSL_strdup(propq)) == NULL) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_MALLOC_FAILURE);
+        OPENSSL_free(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+void EVP_VERIFY_BATCH_free(EVP_VERIFY_BATCH *batch)
+{
+    size_t i;
+
+    if (batch == NULL)
+        return;
+    for (i = 0; i < batch->num; i++) {
+        EVP_PKEY_free(batch->entries[i].pkey);
+        OPENSSL_free(batch->entries[i].mdname);
+    }
+    OPENSSL_free(batch->entries);
+    OPENSSL_free(batch->propq);
+    OPENSSL_free(batch);
+}
+
+int EVP_VERIFY_BATCH_add(EVP_VERIFY_BATCH *batch, EVP_PKEY *pkey,
+                         const char *mdname,
+                         const unsigned char *sig, size_t siglen,
+                         const unsigned char *tbs, size_t tbslen)
+{
+    EVP_VERIFY_BATCH_ENTRY *e;
+
+    if (batch == NULL || pkey == NULL || sig == NULL
+            || (tbs == NULL && tbslen != 0)) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+
+    if (batch->num == batch->max) {
+        size_t max = batch->max == 0 ? 8 : batch->max * 2;
+
+        e = OPENSSL_realloc(batch->entries, max * sizeof(*e));
+        if (e == NULL) {
+            ERR_raise(ERR_LIB_EVP, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        batch->entries = e;
+        batch->max = max;
+    }
+
+    e = &batch->entries[batch->num];
+    memset(e, 0, sizeof(*e));
+    if (mdname != NULL && (e->mdname = OPENSSL_strdup(mdname)) == NULL) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    if (!EVP_PKEY_up_ref(pkey)) {
+        OPENSSL_free(e->mdname);
+        return 0;
+    }
+    e->pkey = pkey;
+    e->sig = sig;
+    e->siglen = siglen;
+    e->tbs = tbs;
+    e->tbslen = tbslen;
+
+    batch->num++;
+    return 1;
+}
+
+int EVP_VERIFY_BATCH_num(const EVP_VERIFY_BATCH *batch)
+{
+    return batch == NULL ? 0 : (int)batch->num;
+}
+
+/*
+ * The provider signature implementation that |mctx| was initialised with,
+ * if it can verify signatures in batches.
+ */
+static EVP_SIGNATURE *batch_signature(const EVP_MD_CTX *mctx)
+{
+    const EVP_PKEY_CTX *pctx = mctx->pctx;
+
+    if (pctx == NULL || !EVP_PKEY_CTX_IS_SIGNATURE_OP(pctx)
+            || pctx->op.sig.sigprovctx == NULL
+            || pctx->op.sig.signature->digest_verify_batch == NULL)
+        return NULL;
+    return pctx->op.sig.signature;
+}
+
+int EVP_VERIFY_BATCH_verify(EVP_VERIFY_BATCH *batch)
+{
+    EVP_MD_CTX **mctxs = NULL;
+    EVP_SIGNATURE *signature;
+    EVP_VERIFY_BATCH_ENTRY *e;
+    void **provctxs = NULL;
+    const unsigned char **sigs = NULL, **tbs = NULL;
+    size_t *siglens = NULL, *tbslens = NULL, *idx = NULL;
+    unsigned char *done = NULL;
+    size_t i, j, m, num;
+    int ret = 0;
+
+    if (batch == NULL) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+    if ((num = batch->num) == 0)
+        return 1;
+
+    mctxs = OPENSSL_zalloc(num * sizeof(*mctxs));
+    provctxs = OPENSSL_malloc(num * sizeof(*provctxs));
+    sigs = OPENSSL_malloc(num * sizeof(*sigs));
+    tbs = OPENSSL_malloc(num * sizeof(*tbs));
+    siglens = OPENSSL_malloc(num * sizeof(*siglens));
+    tbslens = OPENSSL_malloc(num * sizeof(*tbslens));
+    idx = OPENSSL_malloc(num * sizeof(*idx));
+    done = OPENSSL_zalloc(num);
+    if (mctxs == NULL || provctxs == NULL || sigs == NULL || tbs == NULL
+            || siglens == NULL || tbslens == NULL || idx == NULL
+            || done == NULL) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_MALLOC_FAILURE);
+        goto end;
+    }
+
+    /* Fetch the implementation for each signature from the batch's libctx */
+    for (i = 0; i < num; i++) {
+        e = &batch->entries[i];
+        if ((mctxs[i] = EVP_MD_CTX_new()) == NULL
+                || EVP_DigestVerifyInit_ex(mctxs[i], NULL, e->mdname,
+                                           batch->libctx, batch->propq,
+                                           e->pkey) <= 0)
+            goto end;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (done[i])
+            continue;
+
+        /* Gather all the signatures for the same batching implementation */
+        m = 0;
+        if ((signature = batch_signature(mctxs[i])) != NULL)
+            for (j = i; j < num; j++)
+                if (!done[j] && batch_signature(mctxs[j]) == signature)
+                    idx[m++] = j;
+
+        /* There is nothing to gain for a single signature */
+        if (m > 1) {
+            for (j = 0; j < m; j++) {
+                e = &batch->entries[idx[j]];
+                provctxs[j] = mctxs[idx[j]]->pctx->op.sig.sigprovctx;
+                sigs[j] = e->sig;
+                siglens[j] = e->siglen;
+                tbs[j] = e->tbs;
+                tbslens[j] = e->tbslen;
+                done[idx[j]] = 1;
+            }
+            if (!signature->digest_verify_batch(provctxs, m, sigs, siglens,
+                                                tbs, tbslens))
+                goto end;
+        } else {
+            e = &batch->entries[i];
+            if (EVP_DigestVerify(mctxs[i], e->sig, e->siglen,
+                                 e->tbs, e->tbslen) <= 0)
+                goto end;
+            done[i] = 1;
+        }
+    }
+    ret = 1;
+
+ end:
+    for (i = 0; mctxs != NULL && i < num; i++)
+        EVP_MD_CTX_free(mctxs[i]);
+    OPENSSL_free(mctxs);
+    OPENSSL_free(provctxs);
+    OPENSSL_free(sigs);
+    OPENSSL_free(tbs);
+    OPENSSL_free(siglens);
+    OPENSSL_free(tbslens);
+    OPENSSL_free(idx);
+    OPENSSL_free(done);
+    return ret;
+}
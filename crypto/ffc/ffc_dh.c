@@ -1,5 +1,5 @@
 /*
- * Copyright 2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2020-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -9,6 +9,8 @@
 
 #include "internal/ffc.h"
 #include "internal/nelem.h"
+#include "internal/cryptlib.h"
+#include "crypto/bn.h"
 #include "crypto/bn_dh.h"
 #include "e_os.h" /* strcasecmp */
 
@@ -152,3 +154,110 @@ int ossl_ffc_named_group_set_pqg(FFC_PARAMS *ffc, const DH_NAMED_GROUP *group)
     return 1;
 }
 #endif
+
+#ifndef OPENSSL_NO_DH
+/*
+ * Fixed-base comb tables for the generators of the named groups.  They are
+ * built the first time a group is used in a library context and are then
+ * shared read-only by all keys and threads.
+ */
+typedef struct {
+    CRYPTO_RWLOCK *lock;
+    BN_MONT_COMB *comb[OSSL_NELEM(dh_named_groups)];
+} FFC_COMB_CACHE;
+
+static void *ffc_comb_ossl_ctx_new(OSSL_LIB_CTX *libctx)
+{
+    FFC_COMB_CACHE *cache = OPENSSL_zalloc(sizeof(*cache));
+
+    if (cache == NULL)
+        return NULL;
+
+    cache->lock = CRYPTO_THREAD_lock_new();
+    if (cache->lock == NULL) {
+        OPENSSL_free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static void ffc_comb_ossl_ctx_free(void *vcache)
+{
+    FFC_COMB_CACHE *cache = vcache;
+    size_t i;
+
+    if (cache == NULL)
+        return;
+
+    for (i = 0; i < OSSL_NELEM(cache->comb); i++)
+        bn_mont_comb_free(cache->comb[i]);
+    CRYPTO_THREAD_lock_free(cache->lock);
+    OPENSSL_free(cache);
+}
+
+static const OSSL_LIB_CTX_METHOD ffc_comb_ossl_ctx_method = {
+    ffc_comb_ossl_ctx_new,
+    ffc_comb_ossl_ctx_free,
+};
+
+static const BN_MONT_COMB *ffc_named_group_get_comb(OSSL_LIB_CTX *libctx,
+                                                    const DH_NAMED_GROUP *group,
+                                                    BN_CTX *ctx)
+{
+    FFC_COMB_CACHE *cache;
+    BN_MONT_COMB *comb, *newcomb;
+    size_t i = group - dh_named_groups;
+
+    cache = ossl_lib_ctx_get_data(libctx, OSSL_LIB_CTX_FFC_COMB_INDEX,
+                                  &ffc_comb_ossl_ctx_method);
+    if (cache == NULL)
+        return NULL;
+
+    if (!CRYPTO_THREAD_read_lock(cache->lock))
+        return NULL;
+    comb = cache->comb[i];
+    CRYPTO_THREAD_unlock(cache->lock);
+    if (comb != NULL)
+        return comb;
+
+    /* Private keys are less than q, so the table only needs to cover q */
+    newcomb = bn_mont_comb_new(group->g, group->p, BN_num_bits(group->q),
+                               ctx);
+    if (newcomb == NULL)
+        return NULL;
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock)) {
+        bn_mont_comb_free(newcomb);
+        return NULL;
+    }
+    if (cache->comb[i] == NULL) {
+        cache->comb[i] = newcomb;
+        newcomb = NULL;
+    }
+    comb = cache->comb[i];
+    CRYPTO_THREAD_unlock(cache->lock);
+    bn_mont_comb_free(newcomb);
+    return comb;
+}
+
+/*
+ * Computes r = g^e mod p in constant time for the generator g of |group|,
+ * using a precomputed fixed-base table.  Returns 1 on success, 0 on error
+ * and -1 if |e| is too large for the table, in which case the caller should
+ * use a general exponentiation.
+ */
+int ossl_ffc_named_group_exp_g(OSSL_LIB_CTX *libctx,
+                               const DH_NAMED_GROUP *group, BIGNUM *r,
+                               const BIGNUM *e, BN_CTX *ctx)
+{
+    const BN_MONT_COMB *comb;
+
+    if (BN_num_bits(e) > BN_num_bits(group->q))
+        return -1;
+
+    comb = ffc_named_group_get_comb(libctx, group, ctx);
+    if (comb == NULL)
+        return 0;
+    return bn_mod_exp_mont_comb(r, e, comb, ctx);
+}
+#endif
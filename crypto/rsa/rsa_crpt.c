@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -17,6 +17,7 @@
 #include <openssl/crypto.h>
 #include "internal/cryptlib.h"
 #include "crypto/bn.h"
+#include "crypto/cryptlib.h"
 #include <openssl/rand.h>
 #include "rsa_local.h"
 
@@ -173,3 +174,179 @@ BN_BLINDING *RSA_setup_blinding(RSA *rsa, BN_CTX *in_ctx)
 
     return ret;
 }
+
+/*
+ * Per-thread blinding.
+ *
+ * Every thread keeps a small cache of BN_BLINDING structures for the RSA keys
+ * it has recently used, so that concurrent private key operations on the same
+ * key never share (and never have to lock) a blinding factor.  Each cached
+ * blinding has its own update counter.  Entries are keyed by an identifier
+ * that is unique within the RSA object's library context rather than by the
+ * RSA pointer, so a freed key can never be confused with a new key allocated
+ * at the same address.  Stale entries are simply evicted or released when the
+ * thread stops.
+ */
+#define RSA_BLINDING_CACHE_SIZE 8
+
+typedef struct {
+    uint64_t id;
+    int dirty_cnt;
+    BN_BLINDING *blinding;
+} RSA_THREAD_BLINDING;
+
+typedef struct {
+    RSA_THREAD_BLINDING ent[RSA_BLINDING_CACHE_SIZE];
+    size_t next;
+} RSA_THREAD_BLINDINGS;
+
+typedef struct {
+    CRYPTO_RWLOCK *lock;
+    uint64_t next_id;
+    CRYPTO_THREAD_LOCAL local;
+} RSA_BLINDING_GLOBAL;
+
+static void *rsa_blinding_ossl_ctx_new(OSSL_LIB_CTX *libctx)
+{
+    RSA_BLINDING_GLOBAL *gbl = OPENSSL_zalloc(sizeof(*gbl));
+
+    if (gbl == NULL)
+        return NULL;
+
+    gbl->lock = CRYPTO_THREAD_lock_new();
+    if (gbl->lock == NULL)
+        goto err;
+
+    if (!CRYPTO_THREAD_init_local(&gbl->local, NULL))
+        goto err;
+
+    return gbl;
+
+ err:
+    CRYPTO_THREAD_lock_free(gbl->lock);
+    OPENSSL_free(gbl);
+    return NULL;
+}
+
+static void rsa_blinding_ossl_ctx_free(void *vgbl)
+{
+    RSA_BLINDING_GLOBAL *gbl = vgbl;
+
+    if (gbl == NULL)
+        return;
+
+    CRYPTO_THREAD_lock_free(gbl->lock);
+    CRYPTO_THREAD_cleanup_local(&gbl->local);
+    OPENSSL_free(gbl);
+}
+
+static const OSSL_LIB_CTX_METHOD rsa_blinding_ossl_ctx_method = {
+    rsa_blinding_ossl_ctx_new,
+    rsa_blinding_ossl_ctx_free,
+};
+
+static RSA_BLINDING_GLOBAL *rsa_blinding_get_global(OSSL_LIB_CTX *libctx)
+{
+    return ossl_lib_ctx_get_data(libctx, OSSL_LIB_CTX_RSA_BLINDING_INDEX,
+                                 &rsa_blinding_ossl_ctx_method);
+}
+
+static void rsa_blinding_delete_thread_state(void *arg)
+{
+    OSSL_LIB_CTX *ctx = arg;
+    RSA_BLINDING_GLOBAL *gbl = rsa_blinding_get_global(ctx);
+    RSA_THREAD_BLINDINGS *tb;
+    size_t i;
+
+    if (gbl == NULL)
+        return;
+
+    tb = CRYPTO_THREAD_get_local(&gbl->local);
+    CRYPTO_THREAD_set_local(&gbl->local, NULL);
+    if (tb == NULL)
+        return;
+    for (i = 0; i < RSA_BLINDING_CACHE_SIZE; i++)
+        BN_BLINDING_free(tb->ent[i].blinding);
+    OPENSSL_free(tb);
+}
+
+/*
+ * Give |rsa| a fresh blinding identifier from its library context.  This must
+ * be called whenever the library context of an RSA object changes.
+ */
+int ossl_rsa_blinding_new_id(RSA *rsa)
+{
+    RSA_BLINDING_GLOBAL *gbl = rsa_blinding_get_global(rsa->libctx);
+
+    rsa->blinding_id = 0;
+    if (gbl == NULL)
+        return 0;
+
+    if (!CRYPTO_THREAD_write_lock(gbl->lock))
+        return 0;
+    rsa->blinding_id = ++gbl->next_id;
+    CRYPTO_THREAD_unlock(gbl->lock);
+    return 1;
+}
+
+/*
+ * Return the calling thread's blinding for |rsa|, creating it if required.
+ * The result is owned by the thread's cache and must not be freed; it is
+ * valid until the next call for a different key on the same thread.
+ */
+BN_BLINDING *ossl_rsa_get_thread_blinding(RSA *rsa, BN_CTX *ctx)
+{
+    RSA_BLINDING_GLOBAL *gbl;
+    RSA_THREAD_BLINDINGS *tb;
+    RSA_THREAD_BLINDING *ent = NULL;
+    OSSL_LIB_CTX *libctx;
+    size_t i;
+
+    if (rsa->blinding_id == 0
+            || (gbl = rsa_blinding_get_global(rsa->libctx)) == NULL)
+        return NULL;
+
+    tb = CRYPTO_THREAD_get_local(&gbl->local);
+    if (tb == NULL) {
+        libctx = ossl_lib_ctx_get_concrete(rsa->libctx);
+        if ((tb = OPENSSL_zalloc(sizeof(*tb))) == NULL) {
+            ERR_raise(ERR_LIB_RSA, ERR_R_MALLOC_FAILURE);
+            return NULL;
+        }
+        if (!ossl_init_thread_start(NULL, libctx,
+                                    rsa_blinding_delete_thread_state)
+                || !CRYPTO_THREAD_set_local(&gbl->local, tb)) {
+            OPENSSL_free(tb);
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < RSA_BLINDING_CACHE_SIZE; i++) {
+        if (tb->ent[i].id == rsa->blinding_id) {
+            ent = &tb->ent[i];
+            if (ent->dirty_cnt == rsa->dirty_cnt)
+                return ent->blinding;
+            break;
+        }
+    }
+
+    if (ent == NULL) {
+        for (i = 0; i < RSA_BLINDING_CACHE_SIZE; i++)
+            if (tb->ent[i].blinding == NULL)
+                break;
+        if (i == RSA_BLINDING_CACHE_SIZE) {
+            i = tb->next;
+            tb->next = (tb->next + 1) % RSA_BLINDING_CACHE_SIZE;
+        }
+        ent = &tb->ent[i];
+    }
+
+    BN_BLINDING_free(ent->blinding);
+    ent->id = 0;
+    ent->blinding = RSA_setup_blinding(rsa, ctx);
+    if (ent->blinding == NULL)
+        return NULL;
+    ent->id = rsa->blinding_id;
+    ent->dirty_cnt = rsa->dirty_cnt;
+    return ent->blinding;
+}
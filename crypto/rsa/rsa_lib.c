@@ -117,6 +117,11 @@ static RSA *rsa_new_intern(ENGINE *engine, OSSL_LIB_CTX *libctx)
     }
 #endif
 
+    if (!ossl_rsa_blinding_new_id(ret)) {
+        ERR_raise(ERR_LIB_RSA, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
     if ((ret->meth->init != NULL) && !ret->meth->init(ret)) {
         ERR_raise(ERR_LIB_RSA, ERR_R_INIT_FAIL);
         goto err;
@@ -172,7 +177,6 @@ void RSA_free(RSA *r)
     sk_RSA_PRIME_INFO_pop_free(r->prime_infos, rsa_multip_info_free);
 #endif
     BN_BLINDING_free(r->blinding);
-    BN_BLINDING_free(r->mt_blinding);
     OPENSSL_free(r->bignum_data);
     OPENSSL_free(r);
 }
@@ -194,9 +198,18 @@ OSSL_LIB_CTX *ossl_rsa_get0_libctx(RSA *r)
     return r->libctx;
 }
 
-void ossl_rsa_set0_libctx(RSA *r, OSSL_LIB_CTX *libctx)
+int ossl_rsa_set0_libctx(RSA *r, OSSL_LIB_CTX *libctx)
 {
     r->libctx = libctx;
+    /* The blinding identifier is only unique within one library context */
+    return ossl_rsa_blinding_new_id(r);
+}
+
+void ossl_rsa_set_keygen_threads(RSA *r, size_t threads)
+{
+    if (threads > RSA_MAX_KEYGEN_THREADS)
+        threads = RSA_MAX_KEYGEN_THREADS;
+    r->keygen_threads = (int)threads;
 }
 
 #ifndef FIPS_MODULE
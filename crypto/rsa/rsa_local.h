@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2006-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -76,6 +76,9 @@ struct rsa_st {
     /* This is used uniquely by OpenSSL provider implementations. */
     RSA_PSS_PARAMS_30 pss_params;
 
+    /* Number of threads used to search for p and q during key generation */
+    int keygen_threads;
+
 #if defined(FIPS_MODULE) && !defined(OPENSSL_NO_ACVP_TESTS)
     RSA_ACVP_TEST *acvp_test;
 #endif
@@ -100,7 +103,8 @@ struct rsa_st {
      */
     char *bignum_data;
     BN_BLINDING *blinding;
-    BN_BLINDING *mt_blinding;
+    /* Identifies this key in the per-thread blinding caches */
+    uint64_t blinding_id;
     CRYPTO_RWLOCK *lock;
 
     int dirty_cnt;
@@ -168,6 +172,12 @@ RSA_PRIME_INFO *rsa_multip_info_new(void);
 int rsa_multip_calc_product(RSA *rsa);
 int rsa_multip_cap(int bits);
 
+/* Upper limit for the number of threads used by key generation */
+#define RSA_MAX_KEYGEN_THREADS 64
+
+int ossl_rsa_blinding_new_id(RSA *rsa);
+BN_BLINDING *ossl_rsa_get_thread_blinding(RSA *rsa, BN_CTX *ctx);
+
 int ossl_rsa_sp800_56b_validate_strength(int nbits, int strength);
 int ossl_rsa_check_pminusq_diff(BIGNUM *diff, const BIGNUM *p, const BIGNUM *q,
                                 int nbits);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2018-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2018-2021 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2018-2019, Oracle and/or its affiliates.  All rights reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -8,10 +8,12 @@
  * https://www.openssl.org/source/license.html
  */
 
+#include <string.h>
 #include <openssl/err.h>
 #include <openssl/bn.h>
 #include <openssl/core.h>
 #include "crypto/bn.h"
+#include "crypto/cryptlib.h"
 #include "crypto/security_bits.h"
 #include "rsa_local.h"
 
@@ -19,6 +21,213 @@
 #define RSA_FIPS1864_MIN_KEYGEN_STRENGTH 112
 #define RSA_FIPS1864_MAX_KEYGEN_STRENGTH 256
 
+/*
+ * State shared by the threads that search for p and q concurrently.  Every
+ * thread generates probable primes following FIPS 186-4 B.3.6 independently;
+ * the first one found becomes p and the first later one that satisfies the
+ * (Step 6) distance checks against p becomes q.
+ */
+typedef struct {
+    CRYPTO_RWLOCK *lock;
+    OSSL_LIB_CTX *libctx;
+    int nbits;
+    const BIGNUM *e;
+    /* The following are protected by |lock| */
+    BIGNUM *p, *Xp, *q, *Xq;
+    int found;
+    int failed;
+} RSA_PRIME_SEARCH;
+
+typedef struct {
+    RSA_PRIME_SEARCH *search;
+    BN_GENCB *cb;
+} RSA_PRIME_SEARCHER;
+
+static int rsa_prime_search_done(RSA_PRIME_SEARCH *search)
+{
+    int done;
+
+    if (!CRYPTO_THREAD_read_lock(search->lock))
+        return 1;
+    done = search->found == 2 || search->failed;
+    CRYPTO_THREAD_unlock(search->lock);
+    return done;
+}
+
+static void rsa_prime_search_fail(RSA_PRIME_SEARCH *search)
+{
+    if (!CRYPTO_THREAD_write_lock(search->lock))
+        return;
+    search->failed = 1;
+    CRYPTO_THREAD_unlock(search->lock);
+}
+
+/*
+ * Forwards progress to the caller's callback (only done on the calling
+ * thread) and aborts the prime tests as soon as the search is over.
+ */
+static int rsa_prime_search_cb(int a, int b, BN_GENCB *gencb)
+{
+    RSA_PRIME_SEARCHER *searcher = BN_GENCB_get_arg(gencb);
+
+    if (searcher->cb != NULL && !BN_GENCB_call(searcher->cb, a, b)) {
+        rsa_prime_search_fail(searcher->search);
+        return 0;
+    }
+    return !rsa_prime_search_done(searcher->search);
+}
+
+/* Returns -1 on error, 0 if the search is not over yet and 1 otherwise */
+static int rsa_prime_search_add(RSA_PRIME_SEARCH *search, const BIGNUM *prime,
+                                const BIGNUM *X, BIGNUM *tmp)
+{
+    int ok = 1;
+
+    if (!CRYPTO_THREAD_write_lock(search->lock))
+        return -1;
+    if (search->found == 0) {
+        if (BN_copy(search->p, prime) == NULL
+                || BN_copy(search->Xp, X) == NULL)
+            ok = -1;
+        else
+            search->found = 1;
+    } else if (search->found == 1) {
+        /* (Step 6) |Xp - Xq| > 2^(nbitlen/2 - 100) */
+        ok = ossl_rsa_check_pminusq_diff(tmp, search->Xp, X, search->nbits);
+        /* (Step 6) |p - q| > 2^(nbitlen/2 - 100) */
+        if (ok > 0)
+            ok = ossl_rsa_check_pminusq_diff(tmp, search->p, prime,
+                                             search->nbits);
+        if (ok > 0
+                && (BN_copy(search->q, prime) == NULL
+                    || BN_copy(search->Xq, X) == NULL))
+            ok = -1;
+        if (ok > 0)
+            search->found = 2;
+    }
+    if (ok < 0)
+        search->failed = 1;
+    ok = search->failed ? -1 : search->found == 2;
+    CRYPTO_THREAD_unlock(search->lock);
+    return ok;
+}
+
+/*
+ * Generates probable primes until the search is over.  |cb| is the caller's
+ * callback, it must only be passed in on the calling thread.
+ */
+static void rsa_prime_search(RSA_PRIME_SEARCH *search, BN_GENCB *cb)
+{
+    RSA_PRIME_SEARCHER searcher;
+    BN_GENCB *gencb = NULL;
+    BN_CTX *ctx = NULL;
+    BIGNUM *prime, *X, *tmp;
+    int ok = 0;
+
+    searcher.search = search;
+    searcher.cb = cb;
+    if ((gencb = BN_GENCB_new()) == NULL
+            || (ctx = BN_CTX_secure_new_ex(search->libctx)) == NULL)
+        goto err;
+    BN_GENCB_set(gencb, rsa_prime_search_cb, &searcher);
+
+    BN_CTX_start(ctx);
+    prime = BN_CTX_get(ctx);
+    X = BN_CTX_get(ctx);
+    tmp = BN_CTX_get(ctx);
+    if (tmp == NULL)
+        goto end;
+    BN_set_flags(prime, BN_FLG_CONSTTIME);
+    BN_set_flags(X, BN_FLG_CONSTTIME);
+
+    while (!rsa_prime_search_done(search)) {
+        if (!bn_rsa_fips186_4_gen_prob_primes(prime, X, NULL, NULL, NULL,
+                                              NULL, NULL, search->nbits,
+                                              search->e, ctx, gencb)) {
+            /* Being aborted because the search is over is not an error */
+            ok = rsa_prime_search_done(search);
+            goto end;
+        }
+        if (rsa_prime_search_add(search, prime, X, tmp) != 0)
+            break;
+    }
+    ok = 1;
+ end:
+    BN_clear(prime);
+    BN_clear(X);
+    BN_CTX_end(ctx);
+ err:
+    if (!ok)
+        rsa_prime_search_fail(search);
+    BN_CTX_free(ctx);
+    BN_GENCB_free(gencb);
+}
+
+static void rsa_prime_search_thread(void *arg)
+{
+    rsa_prime_search(arg, NULL);
+}
+
+/*
+ * Generates p and q like ossl_rsa_fips186_4_gen_prob_primes() but using up to
+ * |threads| threads (including the calling one).  The results are stored in
+ * |rsa|, which must already have p and q allocated.
+ * Returns 1 if successful, or 0 otherwise.
+ */
+static int rsa_fips186_4_gen_prob_primes_threaded(RSA *rsa, int threads,
+                                                  int nbits, const BIGNUM *e,
+                                                  BN_GENCB *cb)
+{
+    RSA_PRIME_SEARCH search;
+    OSSL_CRYPTO_THREAD *workers[RSA_MAX_KEYGEN_THREADS - 1];
+    int i, ret = 0;
+
+    if (threads > RSA_MAX_KEYGEN_THREADS)
+        threads = RSA_MAX_KEYGEN_THREADS;
+
+    memset(&search, 0, sizeof(search));
+    memset(workers, 0, sizeof(workers));
+    search.libctx = rsa->libctx;
+    search.nbits = nbits;
+    search.e = e;
+    search.p = rsa->p;
+    search.q = rsa->q;
+    search.lock = CRYPTO_THREAD_lock_new();
+    search.Xp = BN_secure_new();
+    search.Xq = BN_secure_new();
+    if (search.lock == NULL || search.Xp == NULL || search.Xq == NULL) {
+        ERR_raise(ERR_LIB_RSA, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    /*
+     * Threads that cannot be started are simply not used, at worst the
+     * calling thread does all of the work.
+     */
+    for (i = 0; i < threads - 1; i++)
+        workers[i] = ossl_crypto_thread_start(rsa_prime_search_thread,
+                                              &search);
+
+    /* Errors caused by aborting the search once it is complete are dropped */
+    ERR_set_mark();
+    rsa_prime_search(&search, cb);
+
+    for (i = 0; i < threads - 1; i++)
+        if (workers[i] != NULL)
+            ossl_crypto_thread_join(workers[i]);
+
+    ret = !search.failed && search.found == 2;
+    if (ret)
+        ERR_pop_to_mark();
+    else
+        ERR_clear_last_mark();
+ err:
+    BN_clear_free(search.Xp);
+    BN_clear_free(search.Xq);
+    CRYPTO_THREAD_lock_free(search.lock);
+    return ret;
+}
+
 /*
  * Generate probable primes 'p' & 'q'. See FIPS 186-4 Section B.3.6
  * "Generation of Probable Primes with Conditions Based on Auxiliary Probable
@@ -120,6 +329,19 @@ int ossl_rsa_fips186_4_gen_prob_primes(RSA *rsa, RSA_ACVP_TEST *test,
     BN_set_flags(rsa->p, BN_FLG_CONSTTIME);
     BN_set_flags(rsa->q, BN_FLG_CONSTTIME);
 
+    /*
+     * Test values must be used as given, so only search for p and q in
+     * parallel when they are generated from scratch.
+     */
+    if (rsa->keygen_threads > 1 && test == NULL) {
+        if (!rsa_fips186_4_gen_prob_primes_threaded(rsa, rsa->keygen_threads,
+                                                    nbits, e, cb))
+            goto err;
+        rsa->dirty_cnt++;
+        ret = 1;
+        goto err;
+    }
+
     /* (Step 4) Generate p, Xp */
     if (!bn_rsa_fips186_4_gen_prob_primes(rsa->p, Xpo, p1, p2, Xp, Xp1, Xp2,
                                           nbits, e, ctx, cb))
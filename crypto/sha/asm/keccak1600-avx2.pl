@@ -1,5 +1,5 @@
 #!/usr/bin/env perl
-# Copyright 2017-2020 The OpenSSL Project Authors. All Rights Reserved.
+# Copyright 2017-2021 The OpenSSL Project Authors. All Rights Reserved.
 #
 # Licensed under the Apache License 2.0 (the "License").  You may not use
 # this file except in compliance with the License.  You can obtain a copy
@@ -53,6 +53,35 @@
 # with vpermq() represent Pi circular permutation in chosen layout. Note
 # that first step is permutation-free.] A[0][0] is loaded to register of
 # its own, to all lanes. [A[0][0] is not part of Pi permutation or Rho.]
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+		=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.19) + ($1>=2.22) + ($1>=2.25);
+}
+
+if (!$avx && `$ENV{CC} -v 2>&1` =~ /((?:clang|LLVM) version|.*based on LLVM) ([0-9]+\.[0-9]+)/) {
+	$avx = ($2>=3.0) + ($2>3.0) + ($2>=7.0);
+}
+
+# Non-volatile %xmm registers are not preserved as required by Windows
+# ABI, so this module is not used there, see keccak1600-x86_64.pl.
+$avx=0 if ($win64);
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
 # Digits in variables' names denote right-most coordinates:
 
 my ($A00,	# [0][0] [0][0] [0][0] [0][0]		# %ymm0
@@ -281,11 +310,55 @@ ___
 my ($A_flat,$inp,$len,$bsz) = ("%rdi","%rsi","%rdx","%rcx");
 my  $out = $inp;	# in squeeze
 
+# A[5][5] is kept in straight linear order in memory, same as in other
+# modules, and is shuffled to magic order through aligned transfer area
+# on stack [at |$ptr-96|] upon load and back upon store.
+
+sub load_A {
+my $ptr = shift;
+
+for (my $i=0; $i<25; $i++) {
+$code.=<<___;
+	mov	8*$i-96($A_flat),%rax
+	mov	%rax,$A_jagged[$i]-96($ptr)
+___
+}
+$code.=<<___;
+	vpbroadcastq	32*0-96($ptr),$A00	# load A[5][5]
+	vmovdqa		32*1-96($ptr),$A01
+	vmovdqa		32*2-96($ptr),$A20
+	vmovdqa		32*3-96($ptr),$A31
+	vmovdqa		32*4-96($ptr),$A21
+	vmovdqa		32*5-96($ptr),$A41
+	vmovdqa		32*6-96($ptr),$A11
+___
+}
+
+sub store_A {
+my $ptr = shift;
+
+$code.=<<___;
+	vmovq		%xmm0,32*0-96($ptr)	# store A[5][5]
+	vmovdqa		$A01,32*1-96($ptr)
+	vmovdqa		$A20,32*2-96($ptr)
+	vmovdqa		$A31,32*3-96($ptr)
+	vmovdqa		$A21,32*4-96($ptr)
+	vmovdqa		$A41,32*5-96($ptr)
+	vmovdqa		$A11,32*6-96($ptr)
+___
+for (my $i=0; $i<25; $i++) {
+$code.=<<___;
+	mov	$A_jagged[$i]-96($ptr),%rax
+	mov	%rax,8*$i-96($A_flat)
+___
+}
+}
+
 $code.=<<___;
-.globl	SHA3_absorb
-.type	SHA3_absorb,\@function
+.globl	SHA3_absorb_avx2
+.type	SHA3_absorb_avx2,\@function
 .align	32
-SHA3_absorb:
+SHA3_absorb_avx2:
 	mov	%rsp,%r11
 
 	lea	-240(%rsp),%rsp
@@ -297,13 +370,9 @@ SHA3_absorb:
 
 	vzeroupper
 
-	vpbroadcastq	-96($A_flat),$A00	# load A[5][5]
-	vmovdqu		8+32*0-96($A_flat),$A01
-	vmovdqu		8+32*1-96($A_flat),$A20
-	vmovdqu		8+32*2-96($A_flat),$A31
-	vmovdqu		8+32*3-96($A_flat),$A21
-	vmovdqu		8+32*4-96($A_flat),$A41
-	vmovdqu		8+32*5-96($A_flat),$A11
+___
+	&load_A("%r10");
+$code.=<<___;
 
 	vpxor		@T[0],@T[0],@T[0]
 	vmovdqa		@T[0],32*2-96(%r10)	# zero transfer area on stack
@@ -348,45 +417,40 @@ $code.=<<___;
 	jmp	.Loop_absorb_avx2
 
 .Ldone_absorb_avx2:
-	vmovq	%xmm0,-96($A_flat)
-	vmovdqu	$A01,8+32*0-96($A_flat)
-	vmovdqu	$A20,8+32*1-96($A_flat)
-	vmovdqu	$A31,8+32*2-96($A_flat)
-	vmovdqu	$A21,8+32*3-96($A_flat)
-	vmovdqu	$A41,8+32*4-96($A_flat)
-	vmovdqu	$A11,8+32*5-96($A_flat)
+___
+	&store_A("%r10");
+$code.=<<___;
 
 	vzeroupper
 
 	lea	(%r11),%rsp
 	lea	($len,$bsz),%rax		# return value
 	ret
-.size	SHA3_absorb,.-SHA3_absorb
+.size	SHA3_absorb_avx2,.-SHA3_absorb_avx2
 
-.globl	SHA3_squeeze
-.type	SHA3_squeeze,\@function
+.globl	SHA3_squeeze_avx2
+.type	SHA3_squeeze_avx2,\@function
 .align	32
-SHA3_squeeze:
+SHA3_squeeze_avx2:
 	mov	%rsp,%r11
 
+	lea	-240(%rsp),%rsp
+	and	\$-32,%rsp
+
 	lea	96($A_flat),$A_flat
+	lea	96(%rsp),%r10
 	shr	\$3,$bsz
 
 	vzeroupper
 
-	vpbroadcastq	-96($A_flat),$A00
-	vpxor		@T[0],@T[0],@T[0]
-	vmovdqu		8+32*0-96($A_flat),$A01
-	vmovdqu		8+32*1-96($A_flat),$A20
-	vmovdqu		8+32*2-96($A_flat),$A31
-	vmovdqu		8+32*3-96($A_flat),$A21
-	vmovdqu		8+32*4-96($A_flat),$A41
-	vmovdqu		8+32*5-96($A_flat),$A11
+___
+	&load_A("%r10");
+$code.=<<___;
 
 	mov	$bsz,%rax
 
 .Loop_squeeze_avx2:
-	mov	@A_jagged[$i]-96($A_flat),%r8
+	mov	0-96($A_flat),%r8
 ___
 for (my $i=0; $i<25; $i++) {
 $code.=<<___;
@@ -397,20 +461,17 @@ $code.=<<___;
 	je	.Ldone_squeeze_avx2
 	dec	%eax
 	je	.Lextend_output_avx2
-	mov	@A_jagged[$i+1]-120($A_flat),%r8
+	mov	8*($i+1)-96($A_flat),%r8
 ___
 }
 $code.=<<___;
 .Lextend_output_avx2:
 	call	__KeccakF1600
 
-	vmovq	%xmm0,-96($A_flat)
-	vmovdqu	$A01,8+32*0-96($A_flat)
-	vmovdqu	$A20,8+32*1-96($A_flat)
-	vmovdqu	$A31,8+32*2-96($A_flat)
-	vmovdqu	$A21,8+32*3-96($A_flat)
-	vmovdqu	$A41,8+32*4-96($A_flat)
-	vmovdqu	$A11,8+32*5-96($A_flat)
+	lea	96(%rsp),%r10
+___
+	&store_A("%r10");
+$code.=<<___;
 
 	mov	$bsz,%rax
 	jmp	.Loop_squeeze_avx2
@@ -430,7 +491,7 @@ $code.=<<___;
 
 	lea	(%r11),%rsp
 	ret
-.size	SHA3_squeeze,.-SHA3_squeeze
+.size	SHA3_squeeze_avx2,.-SHA3_squeeze_avx2
 
 .align	64
 rhotates_left:
@@ -476,6 +537,5 @@ iotas:
 .asciz	"Keccak-1600 absorb and squeeze for AVX2, CRYPTOGAMS by <appro\@openssl.org>"
 ___
 
-$output=pop and open STDOUT,">$output";
-print $code;
+print $code if ($avx>1);
 close STDOUT or die "error closing STDOUT: $!";
@@ -1,5 +1,5 @@
 #!/usr/bin/env perl
-# Copyright 2017-2020 The OpenSSL Project Authors. All Rights Reserved.
+# Copyright 2017-2021 The OpenSSL Project Authors. All Rights Reserved.
 #
 # Licensed under the Apache License 2.0 (the "License").  You may not use
 # this file except in compliance with the License.  You can obtain a copy
@@ -101,7 +101,37 @@
 # are laid down to be independent of each other. In the essence I traded
 # 20 blend instructions for 3 permutations. The result is 13% faster
 # than KCP on Skylake-X, and >40% on Knights Landing.
-#
+
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+		=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.19) + ($1>=2.22) + ($1>=2.25);
+}
+
+if (!$avx && `$ENV{CC} -v 2>&1` =~ /((?:clang|LLVM) version|.*based on LLVM) ([0-9]+\.[0-9]+)/) {
+	$avx = ($2>=3.0) + ($2>3.0) + ($2>=7.0);
+}
+
+# Non-volatile %xmm registers are not preserved as required by Windows
+# ABI, so this module is not used there, see keccak1600-x86_64.pl.
+$avx=0 if ($win64);
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
+########################################################################
 # As implied, data is loaded in straight linear order. Digits in
 # variables' names represent coordinates of right-most element of
 # loaded data chunk:
@@ -280,10 +310,10 @@ my ($A_flat,$inp,$len,$bsz) = ("%rdi","%rsi","%rdx","%rcx");
 my  $out = $inp;	# in squeeze
 
 $code.=<<___;
-.globl	SHA3_absorb
-.type	SHA3_absorb,\@function
+.globl	SHA3_absorb_avx512
+.type	SHA3_absorb_avx512,\@function
 .align	32
-SHA3_absorb:
+SHA3_absorb_avx512:
 	mov	%rsp,%r11
 
 	lea	-320(%rsp),%rsp
@@ -384,12 +414,12 @@ $code.=<<___;
 	lea	(%r11),%rsp
 	lea	($len,$bsz),%rax		# return value
 	ret
-.size	SHA3_absorb,.-SHA3_absorb
+.size	SHA3_absorb_avx512,.-SHA3_absorb_avx512
 
-.globl	SHA3_squeeze
-.type	SHA3_squeeze,\@function
+.globl	SHA3_squeeze_avx512
+.type	SHA3_squeeze_avx512,\@function
 .align	32
-SHA3_squeeze:
+SHA3_squeeze_avx512:
 	mov	%rsp,%r11
 
 	lea	96($A_flat),$A_flat
@@ -484,7 +514,7 @@ SHA3_squeeze:
 
 	lea	(%r11),%rsp
 	ret
-.size	SHA3_squeeze,.-SHA3_squeeze
+.size	SHA3_squeeze_avx512,.-SHA3_squeeze_avx512
 
 .align	64
 theta_perm:
@@ -545,6 +575,5 @@ iotas:
 .asciz	"Keccak-1600 absorb and squeeze for AVX-512F, CRYPTOGAMS by <appro\@openssl.org>"
 ___
 
-$output=pop and open STDOUT,">$output";
-print $code;
+print $code if ($avx>2);
 close STDOUT or die "error closing STDOUT: $!";
@@ -0,0 +1,228 @@
+#!/usr/bin/env perl
+# Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+#
+# Keccak-1600 for x86_64, four independent states at a time.
+#
+# int KeccakF1600_x4(uint64_t A[25][4]);
+#
+# The four states are interleaved lane by lane, so that each %ymm
+# register holds the same lane of all of them and every step of the
+# permutation is plain vertical SIMD. Unlike single-state modules
+# there are no shuffles, which is why it's not limited to Intel CPUs.
+# It's KECCAK_2X implementation (see sha/keccak1600.c): states are
+# held in memory and rounds alternate between input and temporary
+# buffer on stack, one output row at a time. AVX512VL is used for
+# rotates and Chi when available. Returns 0 without touching the
+# states if processor doesn't support AVX2, so that caller can fall
+# back to processing states one by one.
+
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+		=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.19) + ($1>=2.22) + ($1>=2.25);
+}
+
+if (!$avx && `$ENV{CC} -v 2>&1` =~ /((?:clang|LLVM) version|.*based on LLVM) ([0-9]+\.[0-9]+)/) {
+	$avx = ($2>=3.0) + ($2>3.0) + ($2>=7.0);
+}
+
+# Non-volatile %xmm registers are not preserved as required by Windows
+# ABI, so only the stub is generated there.
+$avx=0 if ($win64);
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
+my $A_flat = "%rdi";
+my @C = map("%ymm$_",(0..4));
+my @D = map("%ymm$_",(5..9));
+my @B = map("%ymm$_",(10..14));
+my $T = "%ymm15";
+
+my @rhotates = ([  0,  1, 62, 28, 27 ],
+		[ 36, 44,  6, 55, 20 ],
+		[  3, 10, 43, 25, 39 ],
+		[ 41, 45, 15, 21,  8 ],
+		[ 18,  2, 61, 56, 14 ]);
+
+sub ROL {
+my ($dst,$src,$n,$vl) = @_;
+
+    if ($vl) {
+	$code.="	vprolq		\$$n,$src,$dst\n";
+    } elsif ($n == 1) {
+	$code.=<<___;
+	vpsrlq		\$63,$src,$T
+	vpaddq		$src,$src,$dst
+	vpor		$T,$dst,$dst
+___
+    } else {
+	$code.=<<___;
+	vpsllq		\$$n,$src,$T
+	vpsrlq		\$`64-$n`,$src,$dst
+	vpor		$T,$dst,$dst
+___
+    }
+}
+
+# Lane [y][x] of the four states is at 32*(5*y+x) from |$src| and |$dst|,
+# iotas are at (%r10).
+
+sub Round {
+my ($src,$dst,$vl) = @_;
+my ($x,$y);
+
+    ######################################### Theta
+    for ($x=0; $x<5; $x++) {
+	$code.="	vmovdqu		32*$x($src),$C[$x]\n";
+	for ($y=1; $y<5; $y++) {
+	    $code.="	vpxor		`32*(5*$y+$x)`($src),$C[$x],$C[$x]\n";
+	}
+    }
+    for ($x=0; $x<5; $x++) {
+	&ROL($D[$x],$C[($x+1)%5],1,$vl);
+	$code.="	vpxor		$C[($x+4)%5],$D[$x],$D[$x]\n";
+    }
+
+    for ($y=0; $y<5; $y++) {
+	######################################### Rho, Pi
+	# A[y][x] = ROL(T[x][(3*y+x)%5], rhotates[x][(3*y+x)%5])
+	for ($x=0; $x<5; $x++) {
+	    my $sx = (3*$y+$x)%5;
+	    my $n = $rhotates[$x][$sx];
+
+	    $code.="	vpxor		`32*(5*$x+$sx)`($src),$D[$sx],$B[$x]\n";
+	    &ROL($B[$x],$B[$x],$n,$vl)	if ($n);
+	}
+	######################################### Chi, Iota
+	for ($x=0; $x<5; $x++) {
+	    if ($vl) {
+		$code.=<<___;
+	vmovdqa		$B[$x],$T
+	vpternlogq	\$0xD2,$B[($x+2)%5],$B[($x+1)%5],$T
+___
+	    } else {
+		$code.=<<___;
+	vpandn		$B[($x+2)%5],$B[($x+1)%5],$T
+	vpxor		$B[$x],$T,$T
+___
+	    }
+	    $code.="	vpxor		(%r10),$T,$T\n"	if ($x==0 && $y==0);
+	    $code.="	vmovdqu		$T,`32*(5*$y+$x)`($dst)\n";
+	}
+    }
+}
+
+$code.=<<___;
+.text
+
+.extern	OPENSSL_ia32cap_P
+
+.globl	KeccakF1600_x4
+.type	KeccakF1600_x4,\@function,1
+.align	32
+KeccakF1600_x4:
+.cfi_startproc
+___
+$code.=<<___	if ($avx>1);
+	mov	OPENSSL_ia32cap_P+8(%rip),%r10d
+___
+$code.=<<___	if ($avx>2);
+	test	%r10d,%r10d		# check for AVX512VL
+	js	.LKeccakF1600_x4_avx512vl
+___
+$code.=<<___	if ($avx>1);
+	test	\$`1<<5`,%r10d		# check for AVX2
+	jnz	.LKeccakF1600_x4_avx2
+___
+$code.=<<___;
+	xor	%eax,%eax		# not supported
+	ret
+___
+
+foreach my $vl (0..1) {
+my $sfx = $vl ? "avx512vl" : "avx2";
+
+next if ($avx <= 1+$vl);
+
+$code.=<<___;
+
+.align	32
+.LKeccakF1600_x4_$sfx:
+	mov	%rsp,%r11
+.cfi_def_cfa_register	%r11
+	sub	\$25*32,%rsp		# temporary states
+	and	\$-32,%rsp
+
+	lea	iotas_x4(%rip),%r10
+	mov	\$12,%eax
+	jmp	.Loop_x4_$sfx
+
+.align	32
+.Loop_x4_$sfx:
+___
+	&Round($A_flat,"%rsp",$vl);
+$code.=<<___;
+	lea	32(%r10),%r10
+___
+	&Round("%rsp",$A_flat,$vl);
+$code.=<<___;
+	lea	32(%r10),%r10
+
+	dec	%eax
+	jnz	.Loop_x4_$sfx
+
+	vzeroupper
+
+	mov	%r11,%rsp
+.cfi_def_cfa_register	%rsp
+	mov	\$1,%eax
+	ret
+___
+}
+
+$code.=<<___;
+.cfi_endproc
+.size	KeccakF1600_x4,.-KeccakF1600_x4
+___
+
+$code.=<<___	if ($avx>1);
+.align	64
+iotas_x4:
+___
+foreach (0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
+	 0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
+	 0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
+	 0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+	 0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
+	 0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
+	 0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
+	 0x8000000000008080, 0x0000000080000001, 0x8000000080008008) {
+    my $iota = sprintf("0x%016x",$_);
+
+    $code.="	.quad	$iota,$iota,$iota,$iota\n"	if ($avx>1);
+}
+$code.=<<___;
+.asciz	"Keccak-1600 x4 for x86_64, CRYPTOGAMS by <appro\@openssl.org>"
+___
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+print $code;
+close STDOUT or die "error closing STDOUT: $!";
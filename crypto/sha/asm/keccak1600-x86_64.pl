@@ -1,5 +1,5 @@
 #!/usr/bin/env perl
-# Copyright 2017-2020 The OpenSSL Project Authors. All Rights Reserved.
+# Copyright 2017-2021 The OpenSSL Project Authors. All Rights Reserved.
 #
 # Licensed under the Apache License 2.0 (the "License").  You may not use
 # this file except in compliance with the License.  You can obtain a copy
@@ -62,10 +62,35 @@ $0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
 ( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
 die "can't locate x86_64-xlate.pl";
 
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+		=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.19) + ($1>=2.22) + ($1>=2.25);
+}
+
+if (!$avx && `$ENV{CC} -v 2>&1` =~ /((?:clang|LLVM) version|.*based on LLVM) ([0-9]+\.[0-9]+)/) {
+	$avx = ($2>=3.0) + ($2>3.0) + ($2>=7.0);
+}
+
+# The AVX2 and AVX-512 modules don't save non-volatile %xmm registers
+# as required by Windows ABI, so they are not used there.
+$avx=0 if ($win64);
+
 open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
     or die "can't call $xlate: $!";
 *STDOUT=*OUT;
 
+$code.=<<___	if ($avx>1);
+.extern	OPENSSL_ia32cap_P
+.extern	SHA3_absorb_avx2
+.extern	SHA3_squeeze_avx2
+___
+$code.=<<___	if ($avx>2);
+.extern	SHA3_absorb_avx512
+.extern	SHA3_squeeze_avx512
+.extern	SHA3_absorb_avx512vl
+.extern	SHA3_squeeze_avx512vl
+___
+
 my @A = map([ 8*$_-100, 8*($_+1)-100, 8*($_+2)-100,
               8*($_+3)-100, 8*($_+4)-100 ], (0,5,10,15,20));
 
@@ -417,6 +442,28 @@ $code.=<<___;
 .align	32
 SHA3_absorb:
 .cfi_startproc
+___
+$code.=<<___	if ($avx>1);
+	mov	OPENSSL_ia32cap_P+8(%rip),%r10d
+___
+$code.=<<___	if ($avx>2);
+	test	\$`1<<16`,%r10d		# check for AVX512F
+	jz	.Labsorb_no_avx512
+	cmp	\$1024,$len		# zmm registers only pay off on
+	jae	SHA3_absorb_avx512	# longer inputs
+	test	%r10d,%r10d		# check for AVX512VL
+	js	SHA3_absorb_avx512vl
+	jmp	SHA3_absorb_avx512
+.Labsorb_no_avx512:
+___
+$code.=<<___	if ($avx>1);
+	test	\$`1<<5`,%r10d		# check for AVX2
+	jz	.Labsorb_scalar
+	testl	\$`1<<30`,OPENSSL_ia32cap_P(%rip)	# and that it's Intel CPU
+	jnz	SHA3_absorb_avx2
+.Labsorb_scalar:
+___
+$code.=<<___;
 	push	%rbx
 .cfi_push	%rbx
 	push	%rbp
@@ -512,6 +559,32 @@ $code.=<<___;
 .align	32
 SHA3_squeeze:
 .cfi_startproc
+___
+# Squeezing no more than a block is just a copy, vector code is used
+# only when more output is to be generated.
+$code.=<<___	if ($avx>1);
+	cmp	%rcx,%rdx
+	jbe	.Lsqueeze_scalar
+	mov	OPENSSL_ia32cap_P+8(%rip),%r10d
+___
+$code.=<<___	if ($avx>2);
+	test	\$`1<<16`,%r10d		# check for AVX512F
+	jz	.Lsqueeze_no_avx512
+	cmp	\$1024,%rdx
+	jae	SHA3_squeeze_avx512
+	test	%r10d,%r10d		# check for AVX512VL
+	js	SHA3_squeeze_avx512vl
+	jmp	SHA3_squeeze_avx512
+.Lsqueeze_no_avx512:
+___
+$code.=<<___	if ($avx>1);
+	test	\$`1<<5`,%r10d		# check for AVX2
+	jz	.Lsqueeze_scalar
+	testl	\$`1<<30`,OPENSSL_ia32cap_P(%rip)	# and that it's Intel CPU
+	jnz	SHA3_squeeze_avx2
+.Lsqueeze_scalar:
+___
+$code.=<<___;
 	push	%r12
 .cfi_push	%r12
 	push	%r13
@@ -598,6 +671,8 @@ iotas:
 ___
 
 foreach (split("\n",$code)) {
+	s/\`([^\`]*)\`/eval($1)/ge;
+
 	# Below replacement results in 11.2 on Sandy Bridge, 9.4 on
 	# Haswell, but it hurts other processors by up to 2-3-4x...
 	#s/rol\s+(\$[0-9]+),(%[a-z][a-z0-9]+)/shld\t$1,$2,$2/;
@@ -1,5 +1,5 @@
 /*
- * Copyright 2017-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2017-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -8,6 +8,7 @@
  */
 
 #include <string.h>
+#include <openssl/crypto.h>
 #include "internal/sha3.h"
 
 void SHA3_squeeze(uint64_t A[5][5], unsigned char *out, size_t len, size_t r);
@@ -107,3 +108,78 @@ int ossl_sha3_final(unsigned char *md, KECCAK1600_CTX *ctx)
 
     return 1;
 }
+
+#if defined(KECCAK1600_ASM) && (defined(__x86_64) || defined(_M_AMD64))
+int KeccakF1600_x4(uint64_t A[25][4]);
+
+/* Lanes are little-endian, which is how x86_64 stores them as well */
+static uint64_t load64(const unsigned char *p)
+{
+    uint64_t r;
+
+    memcpy(&r, p, sizeof(r));
+    return r;
+}
+
+/*
+ * Hash four messages of the same length at once with the interleaved
+ * 4-way permutation. Returns 0 without writing anything if it's not
+ * supported by the processor, in which case caller is expected to fall
+ * back to processing messages one by one.
+ */
+int ossl_sha3_x4(unsigned char *const out[4], size_t outlen,
+                 const unsigned char *const in[4], size_t inlen,
+                 unsigned char pad, size_t bitlen)
+{
+    uint64_t A[25][4];
+    unsigned char buf[KECCAK1600_WIDTH / 8 - 32];
+    size_t bsz = SHA3_BLOCKSIZE(bitlen), off = 0, i, j, k, n;
+
+    if (bsz > sizeof(buf))
+        return 0;
+
+    memset(A, 0, sizeof(A));
+
+    for (; inlen - off >= bsz; off += bsz) {
+        for (i = 0; i < bsz / 8; i++)
+            for (j = 0; j < 4; j++)
+                A[i][j] ^= load64(in[j] + off + 8 * i);
+        if (!KeccakF1600_x4(A))
+            return 0;
+    }
+
+    /* Pad the data with 10*1, see ossl_sha3_final() */
+    for (j = 0; j < 4; j++) {
+        n = inlen - off;
+        memset(buf, 0, bsz);
+        memcpy(buf, in[j] + off, n);
+        buf[n] = pad;
+        buf[bsz - 1] |= 0x80;
+        for (i = 0; i < bsz / 8; i++)
+            A[i][j] ^= load64(buf + 8 * i);
+    }
+    if (!KeccakF1600_x4(A))
+        return 0;
+
+    for (off = 0; ; ) {
+        n = outlen - off < bsz ? outlen - off : bsz;
+        for (j = 0; j < 4; j++)
+            for (k = 0; k < n; k += 8)
+                memcpy(out[j] + off + k, &A[k / 8][j], n - k < 8 ? n - k : 8);
+        if ((off += n) == outlen)
+            break;
+        (void)KeccakF1600_x4(A);
+    }
+    OPENSSL_cleanse(A, sizeof(A));
+    OPENSSL_cleanse(buf, sizeof(buf));
+
+    return 1;
+}
+#else
+int ossl_sha3_x4(unsigned char *const out[4], size_t outlen,
+                 const unsigned char *const in[4], size_t inlen,
+                 unsigned char pad, size_t bitlen)
+{
+    return 0;
+}
+#endif
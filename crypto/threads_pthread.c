@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -12,6 +12,7 @@
 
 #include <openssl/crypto.h>
 #include "internal/cryptlib.h"
+#include "crypto/cryptlib.h"
 
 #if defined(__sun)
 # include <atomic.h>
@@ -180,6 +181,50 @@ int CRYPTO_THREAD_compare_id(CRYPTO_THREAD_ID a, CRYPTO_THREAD_ID b)
     return pthread_equal(a, b);
 }
 
+struct ossl_crypto_thread_st {
+    pthread_t thread;
+    void (*routine)(void *);
+    void *arg;
+};
+
+static void *crypto_thread_run(void *vthread)
+{
+    OSSL_CRYPTO_THREAD *thread = vthread;
+
+    thread->routine(thread->arg);
+# ifndef FIPS_MODULE
+    OPENSSL_thread_stop();
+# endif
+    return NULL;
+}
+
+OSSL_CRYPTO_THREAD *ossl_crypto_thread_start(void (*routine)(void *),
+                                             void *arg)
+{
+    OSSL_CRYPTO_THREAD *thread = OPENSSL_zalloc(sizeof(*thread));
+
+    if (thread == NULL)
+        return NULL;
+    thread->routine = routine;
+    thread->arg = arg;
+    if (pthread_create(&thread->thread, NULL, crypto_thread_run, thread) != 0) {
+        OPENSSL_free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+int ossl_crypto_thread_join(OSSL_CRYPTO_THREAD *thread)
+{
+    int ret;
+
+    if (thread == NULL)
+        return 0;
+    ret = pthread_join(thread->thread, NULL) == 0;
+    OPENSSL_free(thread);
+    return ret;
+}
+
 int CRYPTO_atomic_add(int *val, int amount, int *ret, CRYPTO_RWLOCK *lock)
 {
 # if defined(__GNUC__) && defined(__ATOMIC_ACQ_REL)
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -12,6 +12,7 @@
 #endif
 
 #include <openssl/crypto.h>
+#include "crypto/cryptlib.h"
 
 #if defined(OPENSSL_THREADS) && !defined(CRYPTO_TDEBUG) && defined(OPENSSL_SYS_WINDOWS)
 
@@ -153,6 +154,52 @@ int CRYPTO_THREAD_compare_id(CRYPTO_THREAD_ID a, CRYPTO_THREAD_ID b)
     return (a == b);
 }
 
+struct ossl_crypto_thread_st {
+    HANDLE handle;
+    void (*routine)(void *);
+    void *arg;
+};
+
+static DWORD WINAPI crypto_thread_run(LPVOID vthread)
+{
+    OSSL_CRYPTO_THREAD *thread = vthread;
+
+    thread->routine(thread->arg);
+# ifndef FIPS_MODULE
+    OPENSSL_thread_stop();
+# endif
+    return 0;
+}
+
+OSSL_CRYPTO_THREAD *ossl_crypto_thread_start(void (*routine)(void *),
+                                             void *arg)
+{
+    OSSL_CRYPTO_THREAD *thread = OPENSSL_zalloc(sizeof(*thread));
+
+    if (thread == NULL)
+        return NULL;
+    thread->routine = routine;
+    thread->arg = arg;
+    thread->handle = CreateThread(NULL, 0, crypto_thread_run, thread, 0, NULL);
+    if (thread->handle == NULL) {
+        OPENSSL_free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+int ossl_crypto_thread_join(OSSL_CRYPTO_THREAD *thread)
+{
+    int ret;
+
+    if (thread == NULL)
+        return 0;
+    ret = WaitForSingleObject(thread->handle, INFINITE) == WAIT_OBJECT_0;
+    CloseHandle(thread->handle);
+    OPENSSL_free(thread);
+    return ret;
+}
+
 int CRYPTO_atomic_add(int *val, int amount, int *ret, CRYPTO_RWLOCK *lock)
 {
     *ret = (int)InterlockedExchangeAdd((long volatile *)val, (long)amount) + amount;
@@ -19,24 +19,55 @@
 #endif
 
 #include <openssl/x509.h>
+#include "crypto/ctype.h"
 #include "crypto/x509.h"
+#include "internal/o_dir.h"
 #include "x509_local.h"
 
+/* Maximum number of entries of the negative lookup cache */
+#define BY_DIR_NEGATIVE_MAX     1024
+
 struct lookup_dir_hashes_st {
     unsigned long hash;
     int suffix;
 };
 
+/*
+ * Entry of the in-memory index of a directory, see X509_L_DIR_INDEX. The
+ * arrays are indexed by 0 for certificates and 1 for CRLs.
+ */
+typedef struct {
+    unsigned long hash;
+    int num[2];                 /* consecutive files from suffix 0 */
+    int loaded[2];              /* number of those loaded into the store */
+} BY_DIR_INDEX_ENTRY;
+
+DEFINE_LHASH_OF(BY_DIR_INDEX_ENTRY);
+
+/* Name that was not found, see X509_L_DIR_NEGATIVE_TTL */
+typedef struct {
+    unsigned long hash;
+    X509_LOOKUP_TYPE type;
+    X509_NAME *name;
+    time_t expires;
+} BY_DIR_NEGATIVE;
+
+DEFINE_LHASH_OF(BY_DIR_NEGATIVE);
+
 struct lookup_dir_entry_st {
     char *dir;
     int dir_type;
     STACK_OF(BY_DIR_HASH) *hashes;
+    LHASH_OF(BY_DIR_INDEX_ENTRY) *index; /* NULL if not indexed */
 };
 
 typedef struct lookup_dir_st {
     BUF_MEM *buffer;
     STACK_OF(BY_DIR_ENTRY) *dirs;
     CRYPTO_RWLOCK *lock;
+    int indexed;
+    time_t negative_ttl;
+    LHASH_OF(BY_DIR_NEGATIVE) *negative;
 } BY_DIR;
 
 static int dir_ctrl(X509_LOOKUP *ctx, int cmd, const char *argp, long argl,
@@ -45,6 +76,9 @@ static int dir_ctrl(X509_LOOKUP *ctx, int cmd, const char *argp, long argl,
 static int new_dir(X509_LOOKUP *lu);
 static void free_dir(X509_LOOKUP *lu);
 static int add_cert_dir(BY_DIR *ctx, const char *dir, int type);
+static int by_dir_reindex(BY_DIR *ctx, int on);
+static int by_dir_set_negative_ttl(BY_DIR *ctx, long ttl);
+static void by_dir_negative_flush(BY_DIR *ctx);
 static int get_cert_by_subject(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
                                const X509_NAME *name, X509_OBJECT *ret);
 static int get_cert_by_subject_ex(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
@@ -91,6 +125,18 @@ static int dir_ctrl(X509_LOOKUP *ctx, int cmd, const char *argp, long argl,
             }
         } else
             ret = add_cert_dir(ld, argp, (int)argl);
+        /* The names not found so far may be in the new directories */
+        by_dir_negative_flush(ld);
+        break;
+    case X509_L_DIR_INDEX:
+        ret = by_dir_reindex(ld, argl != 0);
+        break;
+    case X509_L_DIR_NEGATIVE_TTL:
+        ret = by_dir_set_negative_ttl(ld, argl);
+        break;
+    case X509_L_DIR_RELOAD:
+        ret = by_dir_reindex(ld, ld->indexed);
+        by_dir_negative_flush(ld);
         break;
     }
     return ret;
@@ -110,6 +156,9 @@ static int new_dir(X509_LOOKUP *lu)
         goto err;
     }
     a->dirs = NULL;
+    a->indexed = 0;
+    a->negative_ttl = 0;
+    a->negative = NULL;
     a->lock = CRYPTO_THREAD_lock_new();
     if (a->lock == NULL) {
         BUF_MEM_free(a->buffer);
@@ -139,10 +188,354 @@ static int by_dir_hash_cmp(const BY_DIR_HASH *const *a,
     return 0;
 }
 
+static unsigned long by_dir_index_entry_hash(const BY_DIR_INDEX_ENTRY *e)
+{
+    return e->hash;
+}
+
+static int by_dir_index_entry_cmp(const BY_DIR_INDEX_ENTRY *a,
+                                  const BY_DIR_INDEX_ENTRY *b)
+{
+    return a->hash == b->hash ? 0 : a->hash > b->hash ? 1 : -1;
+}
+
+static void by_dir_index_entry_free(BY_DIR_INDEX_ENTRY *e)
+{
+    OPENSSL_free(e);
+}
+
+static void by_dir_index_free(LHASH_OF(BY_DIR_INDEX_ENTRY) *index)
+{
+    lh_BY_DIR_INDEX_ENTRY_doall(index, by_dir_index_entry_free);
+    lh_BY_DIR_INDEX_ENTRY_free(index);
+}
+
+/* File name of the form hash.N or hash.rN, as found in the directory */
+typedef struct {
+    unsigned long hash;
+    int crl;
+    int suffix;
+} BY_DIR_FILE;
+
+static int by_dir_file_cmp(const void *a, const void *b)
+{
+    const BY_DIR_FILE *fa = a, *fb = b;
+
+    if (fa->hash != fb->hash)
+        return fa->hash > fb->hash ? 1 : -1;
+    if (fa->crl != fb->crl)
+        return fa->crl - fb->crl;
+    return fa->suffix - fb->suffix;
+}
+
+static int by_dir_parse_name(const char *name, BY_DIR_FILE *f)
+{
+    int i;
+
+    f->hash = 0;
+    for (i = 0; i < 8; i++) {
+        if (!ossl_isxdigit(name[i]))
+            return 0;
+        f->hash = (f->hash << 4) | OPENSSL_hexchar2int(name[i]);
+    }
+    if (name[8] != '.')
+        return 0;
+    name += 9;
+    f->crl = *name == 'r' || *name == 'R';
+    if (f->crl)
+        name++;
+
+    /* The path is rebuilt with %d, so no leading zeros */
+    if (!ossl_isdigit(*name) || (name[0] == '0' && ossl_isdigit(name[1])))
+        return 0;
+    for (f->suffix = 0; ossl_isdigit(*name); name++) {
+        if (f->suffix > (INT_MAX - 9) / 10)
+            return 0;
+        f->suffix = f->suffix * 10 + (*name - '0');
+    }
+#ifdef OPENSSL_SYS_VMS
+    /* Ignore the file version */
+    if (*name == ';')
+        return 1;
+#endif
+    return *name == '\0';
+}
+
+/*
+ * Scans the directory |dir| and returns an index of the certificates and
+ * CRLs it contains, or NULL on error. A directory that cannot be read gives
+ * an empty index, like it gives no objects when it is not indexed.
+ */
+static LHASH_OF(BY_DIR_INDEX_ENTRY) *by_dir_index_new(const char *dir)
+{
+    LHASH_OF(BY_DIR_INDEX_ENTRY) *index;
+    OPENSSL_DIR_CTX *d = NULL;
+    BY_DIR_FILE *files = NULL, *tmp;
+    BY_DIR_INDEX_ENTRY *e = NULL;
+    size_t i, n = 0, max = 0;
+    const char *fn;
+
+    index = lh_BY_DIR_INDEX_ENTRY_new(by_dir_index_entry_hash,
+                                      by_dir_index_entry_cmp);
+    if (index == NULL)
+        goto err;
+
+    while ((fn = OPENSSL_DIR_read(&d, dir)) != NULL) {
+        if (n == max) {
+            max = max == 0 ? 64 : max * 2;
+            tmp = OPENSSL_realloc(files, max * sizeof(*files));
+            if (tmp == NULL)
+                goto err;
+            files = tmp;
+        }
+        if (by_dir_parse_name(fn, &files[n]))
+            n++;
+    }
+    if (d != NULL)
+        OPENSSL_DIR_end(&d);
+
+    /*
+     * Like in the lookup without index, only count the files up to the
+     * first gap in the sequence of suffixes.
+     */
+    if (n > 0)
+        qsort(files, n, sizeof(*files), by_dir_file_cmp);
+    for (i = 0; i < n; i++) {
+        if (e == NULL || e->hash != files[i].hash) {
+            if ((e = OPENSSL_zalloc(sizeof(*e))) == NULL)
+                goto err;
+            e->hash = files[i].hash;
+            (void)lh_BY_DIR_INDEX_ENTRY_insert(index, e);
+            if (lh_BY_DIR_INDEX_ENTRY_error(index)) {
+                OPENSSL_free(e);
+                goto err;
+            }
+        }
+        if (files[i].suffix == e->num[files[i].crl])
+            e->num[files[i].crl]++;
+    }
+    OPENSSL_free(files);
+    return index;
+
+ err:
+    ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
+    if (d != NULL)
+        OPENSSL_DIR_end(&d);
+    OPENSSL_free(files);
+    by_dir_index_free(index);
+    return NULL;
+}
+
+/*
+ * Builds the index of all directories if |on| is set and frees them
+ * otherwise. Also used to rebuild them after the directories have changed.
+ * On error nothing is changed.
+ */
+static int by_dir_reindex(BY_DIR *ctx, int on)
+{
+    LHASH_OF(BY_DIR_INDEX_ENTRY) **index = NULL, *old;
+    BY_DIR_ENTRY *ent;
+    int i, n = sk_BY_DIR_ENTRY_num(ctx->dirs), ret = 0;
+
+    if (n > 0 && (index = OPENSSL_zalloc(n * sizeof(*index))) == NULL) {
+        ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    for (i = 0; on && i < n; i++) {
+        ent = sk_BY_DIR_ENTRY_value(ctx->dirs, i);
+        if ((index[i] = by_dir_index_new(ent->dir)) == NULL)
+            goto end;
+    }
+
+    if (!CRYPTO_THREAD_write_lock(ctx->lock))
+        goto end;
+    for (i = 0; i < n; i++) {
+        ent = sk_BY_DIR_ENTRY_value(ctx->dirs, i);
+        old = ent->index;
+        ent->index = index[i];
+        index[i] = old;
+    }
+    ctx->indexed = on;
+    CRYPTO_THREAD_unlock(ctx->lock);
+    ret = 1;
+
+ end:
+    /* The old indexes on success, the new ones on error */
+    for (i = 0; i < n; i++)
+        by_dir_index_free(index[i]);
+    OPENSSL_free(index);
+    return ret;
+}
+
+/*
+ * If |ent| is indexed, sets |*start| and |*end| to the range of suffixes of
+ * the objects of type |type| and hash |h| that remain to be loaded and
+ * returns 1. Otherwise returns 0.
+ */
+static int by_dir_index_range(BY_DIR *ctx, BY_DIR_ENTRY *ent,
+                              X509_LOOKUP_TYPE type, unsigned long h,
+                              int *start, int *end)
+{
+    BY_DIR_INDEX_ENTRY tmp, *e;
+    int t = type == X509_LU_CRL, ret;
+
+    if (!CRYPTO_THREAD_read_lock(ctx->lock))
+        return 0;
+    ret = ent->index != NULL;
+    *start = *end = 0;
+    tmp.hash = h;
+    if (ret && (e = lh_BY_DIR_INDEX_ENTRY_retrieve(ent->index, &tmp)) != NULL) {
+        *start = e->loaded[t];
+        *end = e->num[t];
+    }
+    CRYPTO_THREAD_unlock(ctx->lock);
+    return ret;
+}
+
+/* Records that the indexed objects up to suffix |k| have been loaded */
+static void by_dir_index_loaded(BY_DIR *ctx, BY_DIR_ENTRY *ent,
+                                X509_LOOKUP_TYPE type, unsigned long h, int k)
+{
+    BY_DIR_INDEX_ENTRY tmp, *e;
+    int t = type == X509_LU_CRL;
+
+    if (!CRYPTO_THREAD_write_lock(ctx->lock))
+        return;
+    tmp.hash = h;
+    /* The index may have been rebuilt in the meantime */
+    if (ent->index != NULL
+            && (e = lh_BY_DIR_INDEX_ENTRY_retrieve(ent->index, &tmp)) != NULL
+            && e->loaded[t] < k)
+        e->loaded[t] = k;
+    CRYPTO_THREAD_unlock(ctx->lock);
+}
+
+static unsigned long by_dir_negative_hash(const BY_DIR_NEGATIVE *e)
+{
+    return e->hash ^ (unsigned long)e->type;
+}
+
+static int by_dir_negative_cmp(const BY_DIR_NEGATIVE *a,
+                               const BY_DIR_NEGATIVE *b)
+{
+    if (a->type != b->type)
+        return a->type - b->type;
+    return X509_NAME_cmp(a->name, b->name);
+}
+
+static void by_dir_negative_free(BY_DIR_NEGATIVE *e)
+{
+    if (e == NULL)
+        return;
+    X509_NAME_free(e->name);
+    OPENSSL_free(e);
+}
+
+/* Must be called with the lock held */
+static void by_dir_negative_flush_locked(BY_DIR *ctx)
+{
+    lh_BY_DIR_NEGATIVE_doall(ctx->negative, by_dir_negative_free);
+    lh_BY_DIR_NEGATIVE_flush(ctx->negative);
+}
+
+static void by_dir_negative_flush(BY_DIR *ctx)
+{
+    if (!CRYPTO_THREAD_write_lock(ctx->lock))
+        return;
+    by_dir_negative_flush_locked(ctx);
+    CRYPTO_THREAD_unlock(ctx->lock);
+}
+
+static int by_dir_set_negative_ttl(BY_DIR *ctx, long ttl)
+{
+    LHASH_OF(BY_DIR_NEGATIVE) *negative = NULL, *old;
+
+    if (ttl < 0) {
+        ERR_raise(ERR_LIB_X509, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+    if (ttl > 0) {
+        negative = lh_BY_DIR_NEGATIVE_new(by_dir_negative_hash,
+                                          by_dir_negative_cmp);
+        if (negative == NULL) {
+            ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+    }
+    if (!CRYPTO_THREAD_write_lock(ctx->lock)) {
+        lh_BY_DIR_NEGATIVE_free(negative);
+        return 0;
+    }
+    old = ctx->negative;
+    ctx->negative = negative;
+    ctx->negative_ttl = (time_t)ttl;
+    CRYPTO_THREAD_unlock(ctx->lock);
+
+    lh_BY_DIR_NEGATIVE_doall(old, by_dir_negative_free);
+    lh_BY_DIR_NEGATIVE_free(old);
+    return 1;
+}
+
+/*
+ * Called when an object is added to the store of |lu|: a name that was not
+ * found may now be, so forget the names not found if |lu| is a directory.
+ */
+void x509_lookup_dir_flush_negative(X509_LOOKUP *lu)
+{
+    if (lu->method == &x509_dir_lookup && lu->method_data != NULL)
+        by_dir_negative_flush((BY_DIR *)lu->method_data);
+}
+
+/* Returns 1 if |name| was recently looked up without success */
+static int by_dir_negative_hit(BY_DIR *ctx, X509_LOOKUP_TYPE type,
+                               unsigned long h, const X509_NAME *name)
+{
+    BY_DIR_NEGATIVE tmp, *e;
+    int hit = 0;
+
+    tmp.hash = h;
+    tmp.type = type;
+    tmp.name = (X509_NAME *)name;
+    if (!CRYPTO_THREAD_read_lock(ctx->lock))
+        return 0;
+    if (ctx->negative != NULL
+            && (e = lh_BY_DIR_NEGATIVE_retrieve(ctx->negative, &tmp)) != NULL)
+        hit = time(NULL) < e->expires;
+    CRYPTO_THREAD_unlock(ctx->lock);
+    return hit;
+}
+
+static void by_dir_negative_add(BY_DIR *ctx, X509_LOOKUP_TYPE type,
+                                unsigned long h, const X509_NAME *name)
+{
+    BY_DIR_NEGATIVE *e = NULL, *old = NULL;
+
+    if (!CRYPTO_THREAD_write_lock(ctx->lock))
+        return;
+    if (ctx->negative != NULL
+            && (e = OPENSSL_malloc(sizeof(*e))) != NULL
+            && (e->name = X509_NAME_dup(name)) != NULL) {
+        e->hash = h;
+        e->type = type;
+        e->expires = time(NULL) + ctx->negative_ttl;
+        /* Names are not looked up in order, so just start again when full */
+        if (lh_BY_DIR_NEGATIVE_num_items(ctx->negative) >= BY_DIR_NEGATIVE_MAX)
+            by_dir_negative_flush_locked(ctx);
+        old = lh_BY_DIR_NEGATIVE_insert(ctx->negative, e);
+        if (lh_BY_DIR_NEGATIVE_error(ctx->negative))
+            old = e;
+    } else if (e != NULL) {
+        OPENSSL_free(e);
+    }
+    CRYPTO_THREAD_unlock(ctx->lock);
+    by_dir_negative_free(old);
+}
+
 static void by_dir_entry_free(BY_DIR_ENTRY *ent)
 {
     OPENSSL_free(ent->dir);
     sk_BY_DIR_HASH_pop_free(ent->hashes, by_dir_hash_free);
+    by_dir_index_free(ent->index);
     OPENSSL_free(ent);
 }
 
@@ -151,11 +544,24 @@ static void free_dir(X509_LOOKUP *lu)
     BY_DIR *a = (BY_DIR *)lu->method_data;
 
     sk_BY_DIR_ENTRY_pop_free(a->dirs, by_dir_entry_free);
+    lh_BY_DIR_NEGATIVE_doall(a->negative, by_dir_negative_free);
+    lh_BY_DIR_NEGATIVE_free(a->negative);
     BUF_MEM_free(a->buffer);
     CRYPTO_THREAD_lock_free(a->lock);
     OPENSSL_free(a);
 }
 
+static int by_dir_is_indexed(BY_DIR *ctx)
+{
+    int indexed;
+
+    if (!CRYPTO_THREAD_read_lock(ctx->lock))
+        return 0;
+    indexed = ctx->indexed;
+    CRYPTO_THREAD_unlock(ctx->lock);
+    return indexed;
+}
+
 static int add_cert_dir(BY_DIR *ctx, const char *dir, int type)
 {
     int j;
@@ -200,10 +606,16 @@ static int add_cert_dir(BY_DIR *ctx, const char *dir, int type)
             ent->dir_type = type;
             ent->hashes = sk_BY_DIR_HASH_new(by_dir_hash_cmp);
             ent->dir = OPENSSL_strndup(ss, len);
+            ent->index = NULL;
             if (ent->dir == NULL || ent->hashes == NULL) {
                 by_dir_entry_free(ent);
                 return 0;
             }
+            if (by_dir_is_indexed(ctx)
+                    && (ent->index = by_dir_index_new(ent->dir)) == NULL) {
+                by_dir_entry_free(ent);
+                return 0;
+            }
             if (!sk_BY_DIR_ENTRY_push(ctx->dirs, ent)) {
                 by_dir_entry_free(ent);
                 ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
@@ -214,34 +626,72 @@ static int add_cert_dir(BY_DIR *ctx, const char *dir, int type)
     return 1;
 }
 
+/* Puts the name of the file with hash |h| and suffix |k| of |ent| in |b| */
+static void by_dir_path(BUF_MEM *b, const BY_DIR_ENTRY *ent, unsigned long h,
+                        const char *postfix, int k)
+{
+    char c = '/';
+
+#ifdef OPENSSL_SYS_VMS
+    c = ent->dir[strlen(ent->dir) - 1];
+    if (c != ':' && c != '>' && c != ']') {
+        /*
+         * If no separator is present, we assume the directory
+         * specifier is a logical name, and add a colon.  We really
+         * should use better VMS routines for merging things like
+         * this, but this will do for now... -- Richard Levitte
+         */
+        c = ':';
+    } else {
+        c = '\0';
+    }
+
+    if (c == '\0') {
+        /*
+         * This is special.  When c == '\0', no directory separator
+         * should be added.
+         */
+        BIO_snprintf(b->data, b->max,
+                     "%s%08lx.%s%d", ent->dir, h, postfix, k);
+    } else
+#endif
+    {
+        BIO_snprintf(b->data, b->max,
+                     "%s%c%08lx.%s%d", ent->dir, c, h, postfix, k);
+    }
+}
+
+/* Returns the number of objects loaded from |file| or 0 on error */
+static int by_dir_load(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
+                       const char *file, int dir_type,
+                       OSSL_LIB_CTX *libctx, const char *propq)
+{
+    if (type == X509_LU_X509)
+        return X509_load_cert_file_ex(xl, file, dir_type, libctx, propq);
+    if (type == X509_LU_CRL)
+        return X509_load_crl_file(xl, file, dir_type);
+    /* else case will caught higher up */
+    return 0;
+}
+
 static int get_cert_by_subject_ex(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
                                   const X509_NAME *name, X509_OBJECT *ret,
                                   OSSL_LIB_CTX *libctx, const char *propq)
 {
     BY_DIR *ctx;
-    union {
-        X509 st_x509;
-        X509_CRL crl;
-    } data;
     int ok = 0;
-    int i, j, k;
+    int i, j, k, end;
     unsigned long h;
     BUF_MEM *b = NULL;
-    X509_OBJECT stmp, *tmp;
+    X509_OBJECT *tmp;
     const char *postfix = "";
 
     if (name == NULL)
         return 0;
 
-    stmp.type = type;
-    if (type == X509_LU_X509) {
-        data.st_x509.cert_info.subject = (X509_NAME *)name; /* won't modify it */
-        stmp.data.x509 = &data.st_x509;
-    } else if (type == X509_LU_CRL) {
-        data.crl.crl.issuer = (X509_NAME *)name; /* won't modify it */
-        stmp.data.crl = &data.crl;
+    if (type == X509_LU_CRL) {
         postfix = "r";
-    } else {
+    } else if (type != X509_LU_X509) {
         ERR_raise(ERR_LIB_X509, X509_R_WRONG_LOOKUP_TYPE);
         goto finish;
     }
@@ -255,9 +705,11 @@ static int get_cert_by_subject_ex(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
     h = X509_NAME_hash_ex(name, libctx, propq, &i);
     if (i == 0)
         goto finish;
+    if (by_dir_negative_hit(ctx, type, h, name))
+        goto finish;
     for (i = 0; i < sk_BY_DIR_ENTRY_num(ctx->dirs); i++) {
         BY_DIR_ENTRY *ent;
-        int idx;
+        int idx, indexed;
         BY_DIR_HASH htmp, *hent;
 
         ent = sk_BY_DIR_ENTRY_value(ctx->dirs, i);
@@ -266,86 +718,66 @@ static int get_cert_by_subject_ex(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
             ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
             goto finish;
         }
-        if (type == X509_LU_CRL && ent->hashes) {
-            htmp.hash = h;
-            CRYPTO_THREAD_read_lock(ctx->lock);
-            idx = sk_BY_DIR_HASH_find(ent->hashes, &htmp);
-            if (idx >= 0) {
-                hent = sk_BY_DIR_HASH_value(ent->hashes, idx);
-                k = hent->suffix;
-            } else {
-                hent = NULL;
-                k = 0;
+        hent = NULL;
+        indexed = by_dir_index_range(ctx, ent, type, h, &k, &end);
+        if (indexed) {
+            /*
+             * The index tells which files exist, so only the ones that have
+             * not been loaded yet are read, and the filesystem is not
+             * accessed at all once they have been.
+             */
+            for (; k < end; k++) {
+                by_dir_path(b, ent, h, postfix, k);
+                if (by_dir_load(xl, type, b->data, ent->dir_type,
+                                libctx, propq) == 0)
+                    break;
             }
-            CRYPTO_THREAD_unlock(ctx->lock);
+            by_dir_index_loaded(ctx, ent, type, h, k);
         } else {
-            k = 0;
-            hent = NULL;
-        }
-        for (;;) {
-            char c = '/';
-
-#ifdef OPENSSL_SYS_VMS
-            c = ent->dir[strlen(ent->dir) - 1];
-            if (c != ':' && c != '>' && c != ']') {
-                /*
-                 * If no separator is present, we assume the directory
-                 * specifier is a logical name, and add a colon.  We really
-                 * should use better VMS routines for merging things like
-                 * this, but this will do for now... -- Richard Levitte
-                 */
-                c = ':';
+            if (type == X509_LU_CRL && ent->hashes) {
+                htmp.hash = h;
+                CRYPTO_THREAD_read_lock(ctx->lock);
+                idx = sk_BY_DIR_HASH_find(ent->hashes, &htmp);
+                if (idx >= 0) {
+                    hent = sk_BY_DIR_HASH_value(ent->hashes, idx);
+                    k = hent->suffix;
+                } else {
+                    hent = NULL;
+                    k = 0;
+                }
+                CRYPTO_THREAD_unlock(ctx->lock);
             } else {
-                c = '\0';
-            }
-
-            if (c == '\0') {
-                /*
-                 * This is special.  When c == '\0', no directory separator
-                 * should be added.
-                 */
-                BIO_snprintf(b->data, b->max,
-                             "%s%08lx.%s%d", ent->dir, h, postfix, k);
-            } else
-#endif
-            {
-                BIO_snprintf(b->data, b->max,
-                             "%s%c%08lx.%s%d", ent->dir, c, h, postfix, k);
+                k = 0;
+                hent = NULL;
             }
+            for (;;) {
+                by_dir_path(b, ent, h, postfix, k);
 #ifndef OPENSSL_NO_POSIX_IO
 # ifdef _WIN32
 #  define stat _stat
 # endif
-            {
-                struct stat st;
-                if (stat(b->data, &st) < 0)
-                    break;
-            }
+                {
+                    struct stat st;
+                    if (stat(b->data, &st) < 0)
+                        break;
+                }
 #endif
-            /* found one. */
-            if (type == X509_LU_X509) {
-                if ((X509_load_cert_file_ex(xl, b->data, ent->dir_type, libctx,
-                                            propq)) == 0)
-                    break;
-            } else if (type == X509_LU_CRL) {
-                if ((X509_load_crl_file(xl, b->data, ent->dir_type)) == 0)
+                /* found one. */
+                if (by_dir_load(xl, type, b->data, ent->dir_type,
+                                libctx, propq) == 0)
                     break;
+                k++;
             }
-            /* else case will caught higher up */
-            k++;
         }
 
         /*
          * we have added it to the cache so now pull it out again
          */
-        X509_STORE_lock(xl->store_ctx);
-        j = sk_X509_OBJECT_find(xl->store_ctx->objs, &stmp);
-        tmp = sk_X509_OBJECT_value(xl->store_ctx->objs, j);
-        X509_STORE_unlock(xl->store_ctx);
+        tmp = x509_store_retrieve_by_subject(xl->store_ctx, type, name);
 
         /* If a CRL, update the last file suffix added for this */
 
-        if (type == X509_LU_CRL) {
+        if (type == X509_LU_CRL && !indexed) {
             CRYPTO_THREAD_write_lock(ctx->lock);
             /*
              * Look for entry again in case another thread added an entry
@@ -395,6 +827,7 @@ static int get_cert_by_subject_ex(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
             goto finish;
         }
     }
+    by_dir_negative_add(ctx, type, h, name);
  finish:
     BUF_MEM_free(b);
     return ok;
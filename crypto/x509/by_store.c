@@ -164,14 +164,13 @@ static int by_store_subject_ex(X509_LOOKUP *ctx, X509_LOOKUP_TYPE type,
     OSSL_STORE_SEARCH *criterion =
         OSSL_STORE_SEARCH_by_name((X509_NAME *)name); /* won't modify it */
     int ok = by_store(ctx, type, criterion, ret, libctx, propq);
-    STACK_OF(X509_OBJECT) *store_objects =
-        X509_STORE_get0_objects(X509_LOOKUP_get_store(ctx));
     X509_OBJECT *tmp = NULL;
 
     OSSL_STORE_SEARCH_free(criterion);
 
     if (ok)
-        tmp = X509_OBJECT_retrieve_by_subject(store_objects, type, name);
+        tmp = x509_store_retrieve_by_subject(X509_LOOKUP_get_store(ctx),
+                                             type, name);
 
     ok = 0;
     if (tmp != NULL) {
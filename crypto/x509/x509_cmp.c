@@ -15,6 +15,7 @@
 #include <openssl/x509v3.h>
 #include <openssl/core_names.h>
 #include "crypto/x509.h"
+#include "x509_local.h"
 
 int X509_issuer_and_serial_cmp(const X509 *a, const X509 *b)
 {
@@ -251,6 +252,10 @@ int X509_NAME_cmp(const X509_NAME *a, const X509_NAME *b)
             return -2;
     }
 
+    /* Equal canonical encodings are interned, see x_name.c */
+    if (a->canon == b->canon)
+        return 0;
+
     ret = a->canon_enclen - b->canon_enclen;
     if (ret == 0 && a->canon_enclen != 0)
         ret = memcmp(a->canon_enc, b->canon_enc, a->canon_enclen);
@@ -263,17 +268,33 @@ unsigned long X509_NAME_hash_ex(const X509_NAME *x, OSSL_LIB_CTX *libctx,
 {
     unsigned long ret = 0;
     unsigned char md[SHA_DIGEST_LENGTH];
-    EVP_MD *sha1 = EVP_MD_fetch(libctx, "SHA1", propq);
+    EVP_MD *sha1;
+    /*
+     * The hash is shared by all the names with the same encoding.  It's only
+     * cached for the default library context, other ones may not be able to
+     * compute it.
+     */
+    int cache = propq == NULL && ossl_lib_ctx_is_default(libctx);
 
     /* Make sure X509_NAME structure contains valid cached encoding */
     i2d_X509_NAME(x, NULL);
     if (ok != NULL)
         *ok = 0;
+
+    if (cache && x509_name_get_cached_hash(x, &ret)) {
+        if (ok != NULL)
+            *ok = 1;
+        return ret;
+    }
+
+    sha1 = EVP_MD_fetch(libctx, "SHA1", propq);
     if (sha1 != NULL
         && EVP_Digest(x->canon_enc, x->canon_enclen, md, NULL, sha1, NULL)) {
         ret = (((unsigned long)md[0]) | ((unsigned long)md[1] << 8L) |
                ((unsigned long)md[2] << 16L) | ((unsigned long)md[3] << 24L)
                ) & 0xffffffffL;
+        if (cache)
+            x509_name_set_cached_hash(x, ret);
         if (ok != NULL)
             *ok = 1;
     }
@@ -106,6 +106,34 @@ struct x509_lookup_st {
     X509_STORE *store_ctx;      /* who owns us */
 };
 
+/*
+ * All objects in an X509_STORE of the same type and with the same subject
+ * name (issuer name for CRLs), in the order they were added.
+ */
+typedef struct x509_object_bucket_st {
+    X509_LOOKUP_TYPE type;
+    const X509_NAME *name;      /* of the first object, not owned */
+    STACK_OF(X509_OBJECT) *objs;
+} X509_OBJECT_BUCKET;
+
+DEFINE_LHASH_OF(X509_OBJECT_BUCKET);
+
+/*
+ * An immutable copy of the index of a read mostly X509_STORE. It is shared
+ * by the X509_STORE_CTXs using the store, which search it without locking.
+ */
+struct x509_store_snapshot_st {
+    LHASH_OF(X509_OBJECT_BUCKET) *index;
+    int error;                  /* set if copying the index failed */
+    CRYPTO_REF_COUNT references;
+    CRYPTO_RWLOCK *lock;
+};
+typedef struct x509_store_snapshot_st X509_STORE_SNAPSHOT;
+
+/* Cache of successful verifications, see x509_vcache.c */
+typedef struct x509_vcache_st X509_VCACHE;
+#define X509_VCACHE_KEY_LEN     32      /* SHA-256 */
+
 /*
  * This is used to hold everything.  It is used for all certificate
  * validation.  Once we have a certificate chain, the 'verify' function is
@@ -115,6 +143,11 @@ struct x509_store_st {
     /* The following is a cache of trusted certs */
     int cache;                  /* if true, stash any hits */
     STACK_OF(X509_OBJECT) *objs; /* Cache of all objects */
+    LHASH_OF(X509_OBJECT_BUCKET) *objs_index; /* |objs| by type and name */
+    int read_mostly;            /* if true, publish snapshots of the index */
+    X509_STORE_SNAPSHOT *snapshot; /* current snapshot, may be NULL */
+    int snapshot_stale;         /* if true, |snapshot| misses changes */
+    X509_VCACHE *verify_cache;  /* NULL if verifications are not cached */
     /* These are external lookup methods */
     STACK_OF(X509_LOOKUP) *get_cert_methods;
     X509_VERIFY_PARAM *param;
@@ -157,5 +190,22 @@ DEFINE_STACK_OF(STACK_OF_X509_NAME_ENTRY)
 
 void x509_set_signature_info(X509_SIG_INFO *siginf, const X509_ALGOR *alg,
                              const ASN1_STRING *sig);
+X509_OBJECT *x509_store_retrieve_by_subject(X509_STORE *store,
+                                            X509_LOOKUP_TYPE type,
+                                            const X509_NAME *name);
+X509_STORE_SNAPSHOT *x509_store_snapshot_get1(X509_STORE *store);
+void x509_store_snapshot_free(X509_STORE_SNAPSHOT *snap);
+int x509_vcache_key(X509_STORE_CTX *ctx, unsigned char *key,
+                    uint64_t *generation);
+int x509_vcache_get(X509_VCACHE *vc, X509_STORE_CTX *ctx,
+                    const unsigned char *key);
+void x509_vcache_put(X509_VCACHE *vc, const X509_STORE_CTX *ctx,
+                     const unsigned char *key, uint64_t generation);
+void x509_vcache_flush(X509_VCACHE *vc);
+void x509_vcache_free(X509_VCACHE *vc);
+void x509_lookup_dir_flush_negative(X509_LOOKUP *lu);
 int x509_likely_issued(X509 *issuer, X509 *subject);
 int x509_signing_allowed(const X509 *issuer, const X509 *subject);
+unsigned long x509_name_canon_hash(const X509_NAME *a);
+int x509_name_get_cached_hash(const X509_NAME *a, unsigned long *hash);
+void x509_name_set_cached_hash(const X509_NAME *a, unsigned long hash);
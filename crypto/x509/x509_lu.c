@@ -177,6 +177,293 @@ static int x509_object_cmp(const X509_OBJECT *const *a,
     return ret;
 }
 
+/*
+ * The objects in a store are indexed by type and subject name (issuer name
+ * for CRLs), so that all the objects for a name can be found without having
+ * to sort and search the whole store. The index uses the canonical encoding
+ * of the names, exactly like X509_NAME_cmp().
+ */
+static int x509_name_canon_ok(const X509_NAME *name)
+{
+    if (name->canon_enc == NULL || name->modified)
+        return i2d_X509_NAME(name, NULL) >= 0;
+    return 1;
+}
+
+static unsigned long x509_object_bucket_hash(const X509_OBJECT_BUCKET *b)
+{
+    return x509_name_canon_hash(b->name) ^ (unsigned long)b->type;
+}
+
+static int x509_object_bucket_cmp(const X509_OBJECT_BUCKET *a,
+                                  const X509_OBJECT_BUCKET *b)
+{
+    if (a->type != b->type)
+        return a->type < b->type ? -1 : 1;
+    return X509_NAME_cmp(a->name, b->name);
+}
+
+static void x509_object_bucket_free(X509_OBJECT_BUCKET *b)
+{
+    sk_X509_OBJECT_free(b->objs);
+    OPENSSL_free(b);
+}
+
+static const X509_NAME *x509_object_name(const X509_OBJECT *obj)
+{
+    switch (obj->type) {
+    case X509_LU_X509:
+        return X509_get_subject_name(obj->data.x509);
+    case X509_LU_CRL:
+        return X509_CRL_get_issuer(obj->data.crl);
+    case X509_LU_NONE:
+        break;
+    }
+    return NULL;
+}
+
+/*
+ * Returns all objects of type |type| for |name| in |index|, or NULL if there
+ * are none.
+ */
+static STACK_OF(X509_OBJECT)
+    *x509_index_bucket(LHASH_OF(X509_OBJECT_BUCKET) *index,
+                       X509_LOOKUP_TYPE type, const X509_NAME *name)
+{
+    X509_OBJECT_BUCKET tmp, *b;
+
+    if (name == NULL || !x509_name_canon_ok(name))
+        return NULL;
+
+    tmp.type = type;
+    tmp.name = name;
+    b = lh_X509_OBJECT_BUCKET_retrieve(index, &tmp);
+    if (b == NULL || sk_X509_OBJECT_num(b->objs) <= 0)
+        return NULL;
+    return b->objs;
+}
+
+/* As x509_index_bucket(), must be called with the store locked */
+static STACK_OF(X509_OBJECT) *x509_store_bucket(X509_STORE *store,
+                                                X509_LOOKUP_TYPE type,
+                                                const X509_NAME *name)
+{
+    return x509_index_bucket(store->objs_index, type, name);
+}
+
+/*
+ * As x509_index_bucket(), for the snapshot of the store held by |ctx|. No
+ * locking is needed, but objects added to the store after |ctx| was
+ * initialised are not found.
+ */
+static STACK_OF(X509_OBJECT) *x509_ctx_bucket(const X509_STORE_CTX *ctx,
+                                              X509_LOOKUP_TYPE type,
+                                              const X509_NAME *name)
+{
+    if (ctx->snapshot == NULL)
+        return NULL;
+    return x509_index_bucket(ctx->snapshot->index, type, name);
+}
+
+/* Must be called with the store locked for writing */
+static int x509_store_index_add(X509_STORE *store, X509_OBJECT *obj)
+{
+    X509_OBJECT_BUCKET tmp, *b;
+
+    tmp.type = obj->type;
+    tmp.name = x509_object_name(obj);
+    if (tmp.name == NULL || !x509_name_canon_ok(tmp.name))
+        return 0;
+
+    b = lh_X509_OBJECT_BUCKET_retrieve(store->objs_index, &tmp);
+    if (b == NULL) {
+        if ((b = OPENSSL_malloc(sizeof(*b))) == NULL)
+            return 0;
+        *b = tmp;
+        if ((b->objs = sk_X509_OBJECT_new_null()) == NULL) {
+            OPENSSL_free(b);
+            return 0;
+        }
+        (void)lh_X509_OBJECT_BUCKET_insert(store->objs_index, b);
+        if (lh_X509_OBJECT_BUCKET_error(store->objs_index)) {
+            x509_object_bucket_free(b);
+            return 0;
+        }
+    }
+    return sk_X509_OBJECT_push(b->objs, obj) > 0;
+}
+
+/*-
+ * Read mostly stores
+ * ==================
+ *
+ * Once a store is read mostly, changes to it are published in a new snapshot,
+ * which is a copy of the index of its objects. Snapshots are never modified
+ * once published. X509_STORE_CTX_init() takes a reference on the current one,
+ * so that the lookups done while verifying need not lock the store at all.
+ * Changes only mark the current snapshot as stale, the next snapshot is made
+ * by the first X509_STORE_CTX_init() after them, so that adding many objects
+ * in a row, e.g. when loading a file, copies the index once rather than once
+ * per object.
+ * Objects are only removed from a store when it is freed, so snapshots need
+ * not hold references on the objects themselves.
+ */
+
+IMPLEMENT_LHASH_DOALL_ARG(X509_OBJECT_BUCKET, X509_STORE_SNAPSHOT);
+
+static void x509_snapshot_copy_bucket(X509_OBJECT_BUCKET *b,
+                                      X509_STORE_SNAPSHOT *snap)
+{
+    X509_OBJECT_BUCKET *copy;
+
+    if (snap->error)
+        return;
+
+    if ((copy = OPENSSL_malloc(sizeof(*copy))) == NULL
+            || (copy->objs = sk_X509_OBJECT_dup(b->objs)) == NULL) {
+        OPENSSL_free(copy);
+        snap->error = 1;
+        return;
+    }
+    copy->type = b->type;
+    copy->name = b->name;
+    (void)lh_X509_OBJECT_BUCKET_insert(snap->index, copy);
+    if (lh_X509_OBJECT_BUCKET_error(snap->index)) {
+        x509_object_bucket_free(copy);
+        snap->error = 1;
+    }
+}
+
+void x509_store_snapshot_free(X509_STORE_SNAPSHOT *snap)
+{
+    int i;
+
+    if (snap == NULL)
+        return;
+
+    CRYPTO_DOWN_REF(&snap->references, &i, snap->lock);
+    REF_PRINT_COUNT("X509_STORE_SNAPSHOT", snap);
+    if (i > 0)
+        return;
+    REF_ASSERT_ISNT(i < 0);
+
+    lh_X509_OBJECT_BUCKET_doall(snap->index, x509_object_bucket_free);
+    lh_X509_OBJECT_BUCKET_free(snap->index);
+    CRYPTO_THREAD_lock_free(snap->lock);
+    OPENSSL_free(snap);
+}
+
+static X509_STORE_SNAPSHOT *x509_store_snapshot_new(X509_STORE *store)
+{
+    X509_STORE_SNAPSHOT *snap = OPENSSL_zalloc(sizeof(*snap));
+
+    if (snap == NULL)
+        return NULL;
+
+    snap->references = 1;
+    if ((snap->lock = CRYPTO_THREAD_lock_new()) == NULL
+            || (snap->index =
+                lh_X509_OBJECT_BUCKET_new(x509_object_bucket_hash,
+                                          x509_object_bucket_cmp)) == NULL) {
+        x509_store_snapshot_free(snap);
+        return NULL;
+    }
+
+    lh_X509_OBJECT_BUCKET_doall_X509_STORE_SNAPSHOT(store->objs_index,
+                                                    x509_snapshot_copy_bucket,
+                                                    snap);
+    if (snap->error) {
+        x509_store_snapshot_free(snap);
+        return NULL;
+    }
+    return snap;
+}
+
+/*
+ * Replaces the snapshot of |store| by a copy of its current index. If that
+ * fails there is no snapshot, so that X509_STORE_CTXs fall back to locking
+ * the store rather than miss objects, and it is tried again next time. Must
+ * be called with the store locked for writing.
+ */
+static int x509_store_publish(X509_STORE *store)
+{
+    X509_STORE_SNAPSHOT *snap = NULL;
+
+    if (store->read_mostly)
+        snap = x509_store_snapshot_new(store);
+    x509_store_snapshot_free(store->snapshot);
+    store->snapshot = snap;
+    store->snapshot_stale = store->read_mostly && snap == NULL;
+    return !store->read_mostly || snap != NULL;
+}
+
+/* Must be called with the store locked */
+static X509_STORE_SNAPSHOT *x509_store_snapshot_get1_locked(X509_STORE *store)
+{
+    X509_STORE_SNAPSHOT *snap = store->snapshot;
+    int i;
+
+    if (snap != NULL && CRYPTO_UP_REF(&snap->references, &i, snap->lock) <= 0)
+        snap = NULL;
+    return snap;
+}
+
+/*
+ * Returns a new reference to the current snapshot of |store|, if any,
+ * publishing the changes made since the previous one first.
+ */
+X509_STORE_SNAPSHOT *x509_store_snapshot_get1(X509_STORE *store)
+{
+    X509_STORE_SNAPSHOT *snap = NULL;
+    int stale;
+
+    if (!CRYPTO_THREAD_read_lock(store->lock))
+        return NULL;
+    if (!(stale = store->snapshot_stale))
+        snap = x509_store_snapshot_get1_locked(store);
+    CRYPTO_THREAD_unlock(store->lock);
+    if (!stale)
+        return snap;
+
+    if (!X509_STORE_lock(store))
+        return NULL;
+    /* Another thread may have published it in the meantime */
+    if (store->snapshot_stale)
+        (void)x509_store_publish(store);
+    snap = x509_store_snapshot_get1_locked(store);
+    X509_STORE_unlock(store);
+    return snap;
+}
+
+int X509_STORE_set_read_mostly(X509_STORE *store, int on)
+{
+    int ret;
+
+    if (!X509_STORE_lock(store))
+        return 0;
+    store->read_mostly = on != 0;
+    ret = x509_store_publish(store);
+    if (!ret) {
+        ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
+        store->read_mostly = 0;
+    }
+    X509_STORE_unlock(store);
+    return ret;
+}
+
+X509_OBJECT *x509_store_retrieve_by_subject(X509_STORE *store,
+                                            X509_LOOKUP_TYPE type,
+                                            const X509_NAME *name)
+{
+    X509_OBJECT *ret;
+
+    if (!CRYPTO_THREAD_read_lock(store->lock))
+        return NULL;
+    ret = sk_X509_OBJECT_value(x509_store_bucket(store, type, name), 0);
+    CRYPTO_THREAD_unlock(store->lock);
+    return ret;
+}
+
 X509_STORE *X509_STORE_new(void)
 {
     X509_STORE *ret = OPENSSL_zalloc(sizeof(*ret));
@@ -189,6 +476,12 @@ X509_STORE *X509_STORE_new(void)
         ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
         goto err;
     }
+    ret->objs_index = lh_X509_OBJECT_BUCKET_new(x509_object_bucket_hash,
+                                                x509_object_bucket_cmp);
+    if (ret->objs_index == NULL) {
+        ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
     ret->cache = 1;
     if ((ret->get_cert_methods = sk_X509_LOOKUP_new_null()) == NULL) {
         ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
@@ -214,6 +507,7 @@ X509_STORE *X509_STORE_new(void)
 
 err:
     X509_VERIFY_PARAM_free(ret->param);
+    lh_X509_OBJECT_BUCKET_free(ret->objs_index);
     sk_X509_OBJECT_free(ret->objs);
     sk_X509_LOOKUP_free(ret->get_cert_methods);
     OPENSSL_free(ret);
@@ -241,6 +535,10 @@ void X509_STORE_free(X509_STORE *vfy)
         X509_LOOKUP_free(lu);
     }
     sk_X509_LOOKUP_free(sk);
+    x509_store_snapshot_free(vfy->snapshot);
+    x509_vcache_free(vfy->verify_cache);
+    lh_X509_OBJECT_BUCKET_doall(vfy->objs_index, x509_object_bucket_free);
+    lh_X509_OBJECT_BUCKET_free(vfy->objs_index);
     sk_X509_OBJECT_pop_free(vfy->objs, X509_OBJECT_free);
 
     CRYPTO_free_ex_data(CRYPTO_EX_INDEX_X509_STORE, vfy, &vfy->ex_data);
@@ -320,10 +618,10 @@ int X509_STORE_CTX_get_by_subject(const X509_STORE_CTX *vs,
     stmp.type = X509_LU_NONE;
     stmp.data.ptr = NULL;
 
-
-    X509_STORE_lock(store);
-    tmp = X509_OBJECT_retrieve_by_subject(store->objs, type, name);
-    X509_STORE_unlock(store);
+    if (vs->snapshot != NULL)
+        tmp = sk_X509_OBJECT_value(x509_ctx_bucket(vs, type, name), 0);
+    else
+        tmp = x509_store_retrieve_by_subject(store, type, name);
 
     if (tmp == NULL || type == X509_LU_CRL) {
         for (i = 0; i < sk_X509_LOOKUP_num(store->get_cert_methods); i++) {
@@ -348,9 +646,34 @@ int X509_STORE_CTX_get_by_subject(const X509_STORE_CTX *vs,
     return 1;
 }
 
+/*
+ * Returns the object in |store| that is the same as |x|, or NULL if there is
+ * none. Must be called with the store locked.
+ */
+static X509_OBJECT *x509_store_retrieve_match(X509_STORE *store,
+                                              const X509_OBJECT *x)
+{
+    STACK_OF(X509_OBJECT) *objs;
+    X509_OBJECT *obj;
+    int i;
+
+    objs = x509_store_bucket(store, x->type, x509_object_name(x));
+    for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+        obj = sk_X509_OBJECT_value(objs, i);
+        if (x->type == X509_LU_X509) {
+            if (!X509_cmp(obj->data.x509, x->data.x509))
+                return obj;
+        } else if (X509_CRL_match(obj->data.crl, x->data.crl) == 0) {
+            return obj;
+        }
+    }
+    return NULL;
+}
+
 static int x509_store_add(X509_STORE *store, void *x, int crl) {
     X509_OBJECT *obj;
-    int ret = 0, added = 0;
+    X509_LOOKUP *lu;
+    int i, ret = 0, added = 0;
 
     if (x == NULL)
         return 0;
@@ -372,11 +695,21 @@ static int x509_store_add(X509_STORE *store, void *x, int crl) {
     }
 
     X509_STORE_lock(store);
-    if (X509_OBJECT_retrieve_match(store->objs, obj)) {
+    if (x509_store_retrieve_match(store, obj)) {
         ret = 1;
-    } else {
-        added = sk_X509_OBJECT_push(store->objs, obj);
-        ret = added != 0;
+    } else if (sk_X509_OBJECT_push(store->objs, obj)) {
+        added = x509_store_index_add(store, obj);
+        if (!added)
+            (void)sk_X509_OBJECT_pop(store->objs);
+        ret = added;
+    }
+    if (added) {
+        store->snapshot_stale = store->read_mostly;
+        x509_vcache_flush(store->verify_cache);
+        for (i = 0; i < sk_X509_LOOKUP_num(store->get_cert_methods); i++) {
+            lu = sk_X509_LOOKUP_value(store->get_cert_methods, i);
+            x509_lookup_dir_flush_negative(lu);
+        }
     }
     X509_STORE_unlock(store);
 
@@ -566,7 +899,8 @@ STACK_OF(X509) *X509_STORE_get1_all_certs(X509_STORE *store)
     }
     if ((sk = sk_X509_new_null()) == NULL)
         return NULL;
-    X509_STORE_lock(store);
+    if (!CRYPTO_THREAD_read_lock(store->lock))
+        goto err_free;
     objs = X509_STORE_get0_objects(store);
     for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
         X509 *cert = X509_OBJECT_get0_X509(sk_X509_OBJECT_value(objs, i));
@@ -575,72 +909,82 @@ STACK_OF(X509) *X509_STORE_get1_all_certs(X509_STORE *store)
             && !X509_add_cert(sk, cert, X509_ADD_FLAG_UP_REF))
             goto err;
     }
-    X509_STORE_unlock(store);
+    CRYPTO_THREAD_unlock(store->lock);
     return sk;
 
  err:
-    X509_STORE_unlock(store);
+    CRYPTO_THREAD_unlock(store->lock);
+ err_free:
     sk_X509_pop_free(sk, X509_free);
     return NULL;
 }
 
+static STACK_OF(X509) *x509_objects_get1_certs(STACK_OF(X509_OBJECT) *objs)
+{
+    STACK_OF(X509) *sk = sk_X509_new_null();
+    int i;
+
+    if (sk == NULL)
+        return NULL;
+    for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+        if (!X509_add_cert(sk, sk_X509_OBJECT_value(objs, i)->data.x509,
+                           X509_ADD_FLAG_UP_REF)) {
+            sk_X509_pop_free(sk, X509_free);
+            return NULL;
+        }
+    }
+    return sk;
+}
+
 STACK_OF(X509) *X509_STORE_CTX_get1_certs(X509_STORE_CTX *ctx,
                                           const X509_NAME *nm)
 {
-    int i, idx, cnt;
     STACK_OF(X509) *sk = NULL;
-    X509 *x;
-    X509_OBJECT *obj;
+    STACK_OF(X509_OBJECT) *objs;
+    X509_OBJECT *xobj;
     X509_STORE *store = ctx->store;
 
     if (store == NULL)
         return NULL;
 
-    X509_STORE_lock(store);
-    idx = x509_object_idx_cnt(store->objs, X509_LU_X509, nm, &cnt);
-    if (idx < 0) {
-        /*
-         * Nothing found in cache: do lookup to possibly add new objects to
-         * cache
-         */
-        X509_OBJECT *xobj = X509_OBJECT_new();
-
-        X509_STORE_unlock(store);
-
-        if (xobj == NULL)
-            return NULL;
-        if (!X509_STORE_CTX_get_by_subject(ctx, X509_LU_X509, nm, xobj)) {
-            X509_OBJECT_free(xobj);
-            return NULL;
-        }
-        X509_OBJECT_free(xobj);
-        X509_STORE_lock(store);
-        idx = x509_object_idx_cnt(store->objs, X509_LU_X509, nm, &cnt);
-        if (idx < 0) {
-            X509_STORE_unlock(store);
+    if (ctx->snapshot != NULL) {
+        if ((objs = x509_ctx_bucket(ctx, X509_LU_X509, nm)) != NULL)
+            return x509_objects_get1_certs(objs);
+    } else {
+        if (!CRYPTO_THREAD_read_lock(store->lock))
             return NULL;
-        }
+        if ((objs = x509_store_bucket(store, X509_LU_X509, nm)) != NULL)
+            sk = x509_objects_get1_certs(objs);
+        CRYPTO_THREAD_unlock(store->lock);
+        if (objs != NULL)
+            return sk;
     }
 
-    sk = sk_X509_new_null();
-    for (i = 0; i < cnt; i++, idx++) {
-        obj = sk_X509_OBJECT_value(store->objs, idx);
-        x = obj->data.x509;
-        if (!X509_add_cert(sk, x, X509_ADD_FLAG_UP_REF)) {
-            X509_STORE_unlock(store);
-            sk_X509_pop_free(sk, X509_free);
-            return NULL;
-        }
+    /*
+     * Nothing found in cache: do lookup to possibly add new objects to
+     * cache
+     */
+    if ((xobj = X509_OBJECT_new()) == NULL)
+        return NULL;
+    if (!X509_STORE_CTX_get_by_subject(ctx, X509_LU_X509, nm, xobj)) {
+        X509_OBJECT_free(xobj);
+        return NULL;
     }
-    X509_STORE_unlock(store);
+    X509_OBJECT_free(xobj);
+    if (!CRYPTO_THREAD_read_lock(store->lock))
+        return NULL;
+    if ((objs = x509_store_bucket(store, X509_LU_X509, nm)) != NULL)
+        sk = x509_objects_get1_certs(objs);
+    CRYPTO_THREAD_unlock(store->lock);
     return sk;
 }
 
 STACK_OF(X509_CRL) *X509_STORE_CTX_get1_crls(const X509_STORE_CTX *ctx,
                                              const X509_NAME *nm)
 {
-    int i, idx, cnt;
+    int i;
     STACK_OF(X509_CRL) *sk = sk_X509_CRL_new_null();
+    STACK_OF(X509_OBJECT) *objs;
     X509_CRL *x;
     X509_OBJECT *obj, *xobj = X509_OBJECT_new();
     X509_STORE *store = ctx->store;
@@ -655,30 +999,33 @@ STACK_OF(X509_CRL) *X509_STORE_CTX_get1_crls(const X509_STORE_CTX *ctx,
         return NULL;
     }
     X509_OBJECT_free(xobj);
-    X509_STORE_lock(store);
-    idx = x509_object_idx_cnt(store->objs, X509_LU_CRL, nm, &cnt);
-    if (idx < 0) {
-        X509_STORE_unlock(store);
+    if (!CRYPTO_THREAD_read_lock(store->lock)) {
+        sk_X509_CRL_free(sk);
+        return NULL;
+    }
+    objs = x509_store_bucket(store, X509_LU_CRL, nm);
+    if (objs == NULL) {
+        CRYPTO_THREAD_unlock(store->lock);
         sk_X509_CRL_free(sk);
         return NULL;
     }
 
-    for (i = 0; i < cnt; i++, idx++) {
-        obj = sk_X509_OBJECT_value(store->objs, idx);
+    for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+        obj = sk_X509_OBJECT_value(objs, i);
         x = obj->data.crl;
         if (!X509_CRL_up_ref(x)) {
-            X509_STORE_unlock(store);
+            CRYPTO_THREAD_unlock(store->lock);
             sk_X509_CRL_pop_free(sk, X509_CRL_free);
             return NULL;
         }
         if (!sk_X509_CRL_push(sk, x)) {
-            X509_STORE_unlock(store);
+            CRYPTO_THREAD_unlock(store->lock);
             X509_CRL_free(x);
             sk_X509_CRL_pop_free(sk, X509_CRL_free);
             return NULL;
         }
     }
-    X509_STORE_unlock(store);
+    CRYPTO_THREAD_unlock(store->lock);
     return sk;
 }
 
@@ -710,6 +1057,35 @@ X509_OBJECT *X509_OBJECT_retrieve_match(STACK_OF(X509_OBJECT) *h,
     return NULL;
 }
 
+/*
+ * Sets |*issuer| to the first certificate of |objs| accepted by check_issued()
+ * whose times check, or else to the last one accepted, or to NULL if none is.
+ * Returns 1 if the times of |*issuer| check and 0 otherwise.
+ */
+static int x509_objects_find_issuer(X509 **issuer, X509_STORE_CTX *ctx,
+                                    X509 *x, STACK_OF(X509_OBJECT) *objs)
+{
+    X509_OBJECT *pobj;
+    int i;
+
+    *issuer = NULL;
+    for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+        pobj = sk_X509_OBJECT_value(objs, i);
+        if (ctx->check_issued(ctx, x, pobj->data.x509)) {
+            *issuer = pobj->data.x509;
+            /*
+             * If times check, exit with match,
+             * otherwise keep looking. Leave last
+             * match in issuer so we return nearest
+             * match if no certificate time is OK.
+             */
+            if (x509_check_cert_time(ctx, *issuer, -1))
+                return 1;
+        }
+    }
+    return 0;
+}
+
 /*-
  * Try to get issuer certificate from store. Due to limitations
  * of the API this can only retrieve a single certificate matching
@@ -725,9 +1101,10 @@ X509_OBJECT *X509_OBJECT_retrieve_match(STACK_OF(X509_OBJECT) *h,
 int X509_STORE_CTX_get1_issuer(X509 **issuer, X509_STORE_CTX *ctx, X509 *x)
 {
     const X509_NAME *xn;
-    X509_OBJECT *obj = X509_OBJECT_new(), *pobj = NULL;
+    X509_OBJECT *obj = X509_OBJECT_new();
     X509_STORE *store = ctx->store;
-    int i, ok, idx, ret;
+    X509 *pissuer = NULL;
+    int ok, ret, locked = 0;
 
     if (obj == NULL)
         return -1;
@@ -755,40 +1132,35 @@ int X509_STORE_CTX_get1_issuer(X509 **issuer, X509_STORE_CTX *ctx, X509 *x)
     if (store == NULL)
         return 0;
 
-    /* Else find index of first cert accepted by 'check_issued' */
+    /* Else find the first cert accepted by 'check_issued' */
     ret = 0;
-    X509_STORE_lock(store);
-    idx = X509_OBJECT_idx_by_subject(store->objs, X509_LU_X509, xn);
-    if (idx != -1) {            /* should be true as we've had at least one
-                                 * match */
-        /* Look through all matching certs for suitable issuer */
-        for (i = idx; i < sk_X509_OBJECT_num(store->objs); i++) {
-            pobj = sk_X509_OBJECT_value(store->objs, i);
-            /* See if we've run past the matches */
-            if (pobj->type != X509_LU_X509)
-                break;
-            if (X509_NAME_cmp(xn, X509_get_subject_name(pobj->data.x509)))
-                break;
-            if (ctx->check_issued(ctx, x, pobj->data.x509)) {
-                *issuer = pobj->data.x509;
-                ret = 1;
-                /*
-                 * If times check, exit with match,
-                 * otherwise keep looking. Leave last
-                 * match in issuer so we return nearest
-                 * match if no certificate time is OK.
-                 */
-
-                if (x509_check_cert_time(ctx, *issuer, -1))
-                    break;
-            }
-        }
+    if (!x509_objects_find_issuer(issuer, ctx, x,
+                                  x509_ctx_bucket(ctx, X509_LU_X509, xn))) {
+        /*
+         * The snapshot held by |ctx|, if any, misses the certificates added to
+         * the store since |ctx| was initialised, such as the one a lookup
+         * method has just loaded, so look in the store itself as well. It has
+         * all the certificates of the snapshot, and any issuer found there is
+         * at least as good.
+         */
+        if (!CRYPTO_THREAD_read_lock(store->lock))
+            return -1;
+        locked = 1;
+        (void)x509_objects_find_issuer(&pissuer, ctx, x,
+                                       x509_store_bucket(store, X509_LU_X509,
+                                                         xn));
+        if (pissuer != NULL)
+            *issuer = pissuer;
     }
-    if (*issuer && !X509_up_ref(*issuer)) {
-        *issuer = NULL;
-        ret = -1;
+    if (*issuer != NULL) {
+        ret = 1;
+        if (!X509_up_ref(*issuer)) {
+            *issuer = NULL;
+            ret = -1;
+        }
     }
-    X509_STORE_unlock(store);
+    if (locked)
+        CRYPTO_THREAD_unlock(store->lock);
     return ret;
 }
 
@@ -0,0 +1,352 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Cache of successful certificate verifications, see
+ * X509_STORE_set_verify_cache().
+ *
+ * Entries are keyed by the SHA-256 digest of the verification parameters,
+ * the target certificate and the untrusted certificates, and hold the
+ * verified chain. They are valid from the latest notBefore of the chain
+ * certificates or lastUpdate of the CRLs that were used, until the earliest
+ * notAfter or nextUpdate, so the verification time is not part of the key.
+ *
+ * The whole cache is flushed when objects are added to the store. Each flush
+ * increments a generation counter, which is read before a verification
+ * starts, and its result is only added if the counter has not changed, so
+ * that a verification that raced with a change of the store is not cached.
+ *
+ * Like in the TLS early data anti-replay cache, the entries are kept in two
+ * generations, so that a full cache can be pruned without having to track
+ * the use of each entry. Once the current generation is full, it replaces
+ * the previous one, which is discarded. So lookups only need a read lock.
+ */
+
+#include "internal/cryptlib.h"
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include "crypto/x509.h"
+#include "x509_local.h"
+
+typedef struct {
+    unsigned char key[X509_VCACHE_KEY_LEN];
+    STACK_OF(X509) *chain;
+    int num_untrusted;
+    ASN1_TIME *valid_from;      /* NULL if the result has no start time */
+    ASN1_TIME *expires;         /* NULL if the result does not expire */
+    char *peername;
+} X509_VCACHE_ENTRY;
+
+DEFINE_LHASH_OF(X509_VCACHE_ENTRY);
+
+struct x509_vcache_st {
+    CRYPTO_RWLOCK *lock;
+    unsigned long capacity;     /* of each generation */
+    LHASH_OF(X509_VCACHE_ENTRY) *gen[2]; /* current and previous */
+    uint64_t generation;        /* incremented by each flush */
+};
+
+static unsigned long vcache_entry_hash(const X509_VCACHE_ENTRY *e)
+{
+    /* The key is a digest, so any part of it is a good hash */
+    return ((unsigned long)e->key[0] << 24) | ((unsigned long)e->key[1] << 16)
+        | ((unsigned long)e->key[2] << 8) | e->key[3];
+}
+
+static int vcache_entry_cmp(const X509_VCACHE_ENTRY *a,
+                            const X509_VCACHE_ENTRY *b)
+{
+    return memcmp(a->key, b->key, sizeof(a->key));
+}
+
+static void vcache_entry_free(X509_VCACHE_ENTRY *e)
+{
+    if (e == NULL)
+        return;
+    sk_X509_pop_free(e->chain, X509_free);
+    ASN1_TIME_free(e->valid_from);
+    ASN1_TIME_free(e->expires);
+    OPENSSL_free(e->peername);
+    OPENSSL_free(e);
+}
+
+static void vcache_gen_free(LHASH_OF(X509_VCACHE_ENTRY) *gen)
+{
+    lh_X509_VCACHE_ENTRY_doall(gen, vcache_entry_free);
+    lh_X509_VCACHE_ENTRY_free(gen);
+}
+
+static LHASH_OF(X509_VCACHE_ENTRY) *vcache_gen_new(void)
+{
+    return lh_X509_VCACHE_ENTRY_new(vcache_entry_hash, vcache_entry_cmp);
+}
+
+void x509_vcache_free(X509_VCACHE *vc)
+{
+    if (vc == NULL)
+        return;
+
+    vcache_gen_free(vc->gen[0]);
+    vcache_gen_free(vc->gen[1]);
+    CRYPTO_THREAD_lock_free(vc->lock);
+    OPENSSL_free(vc);
+}
+
+static X509_VCACHE *x509_vcache_new(size_t capacity)
+{
+    X509_VCACHE *vc = OPENSSL_zalloc(sizeof(*vc));
+
+    if (vc == NULL
+            || (vc->lock = CRYPTO_THREAD_lock_new()) == NULL
+            || (vc->gen[0] = vcache_gen_new()) == NULL
+            || (vc->gen[1] = vcache_gen_new()) == NULL) {
+        ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
+        x509_vcache_free(vc);
+        return NULL;
+    }
+    capacity = capacity / 2 + 1;
+    vc->capacity = capacity > ULONG_MAX ? ULONG_MAX : (unsigned long)capacity;
+    return vc;
+}
+
+void x509_vcache_flush(X509_VCACHE *vc)
+{
+    int i;
+
+    if (vc == NULL || !CRYPTO_THREAD_write_lock(vc->lock))
+        return;
+    for (i = 0; i < 2; i++) {
+        lh_X509_VCACHE_ENTRY_doall(vc->gen[i], vcache_entry_free);
+        lh_X509_VCACHE_ENTRY_flush(vc->gen[i]);
+    }
+    vc->generation++;
+    CRYPTO_THREAD_unlock(vc->lock);
+}
+
+static int vcache_update_data(EVP_MD_CTX *mctx, const void *data, size_t len)
+{
+    uint64_t l = len;
+
+    return EVP_DigestUpdate(mctx, &l, sizeof(l))
+        && (len == 0 || EVP_DigestUpdate(mctx, data, len));
+}
+
+static int vcache_update_str(EVP_MD_CTX *mctx, const char *str)
+{
+    return vcache_update_data(mctx, str, str == NULL ? 0 : strlen(str));
+}
+
+static int vcache_update_cert(EVP_MD_CTX *mctx, const EVP_MD *md, X509 *x)
+{
+    unsigned char dgst[EVP_MAX_MD_SIZE];
+    unsigned int len;
+
+    return X509_digest(x, md, dgst, &len)
+        && vcache_update_data(mctx, dgst, len);
+}
+
+static int vcache_update_param(EVP_MD_CTX *mctx, const X509_VERIFY_PARAM *vpm)
+{
+    int64_t v[7];
+    int i;
+
+    /* The check time is not included, see vcache_entry_valid() */
+    v[0] = (int64_t)vpm->flags;
+    v[1] = vpm->purpose;
+    v[2] = vpm->trust;
+    v[3] = vpm->depth;
+    v[4] = vpm->auth_level;
+    v[5] = vpm->hostflags;
+    v[6] = sk_OPENSSL_STRING_num(vpm->hosts);
+    if (!EVP_DigestUpdate(mctx, v, sizeof(v)))
+        return 0;
+
+    for (i = 0; i < sk_OPENSSL_STRING_num(vpm->hosts); i++)
+        if (!vcache_update_str(mctx, sk_OPENSSL_STRING_value(vpm->hosts, i)))
+            return 0;
+    return vcache_update_data(mctx, vpm->email, vpm->emaillen)
+        && vcache_update_data(mctx, vpm->ip, vpm->iplen);
+}
+
+/*
+ * Computes the cache key of the verification to be done with |ctx| into
+ * |key|, and sets |*generation| to the current generation of the cache,
+ * to be passed to x509_vcache_put(). Returns 1 on success or 0 if the
+ * verification cannot be cached.
+ */
+int x509_vcache_key(X509_STORE_CTX *ctx, unsigned char *key,
+                    uint64_t *generation)
+{
+    X509_VCACHE *vc = ctx->store->verify_cache;
+    EVP_MD *md;
+    EVP_MD_CTX *mctx;
+    int i, ok;
+
+    /* Must be read before anything is looked up in the store */
+    if (!CRYPTO_THREAD_read_lock(vc->lock))
+        return 0;
+    *generation = vc->generation;
+    CRYPTO_THREAD_unlock(vc->lock);
+
+    md = EVP_MD_fetch(ctx->libctx, "SHA256", ctx->propq);
+    mctx = EVP_MD_CTX_new();
+    ok = md != NULL && mctx != NULL
+        && EVP_MD_size(md) == X509_VCACHE_KEY_LEN
+        && EVP_DigestInit_ex(mctx, md, NULL)
+        && vcache_update_param(mctx, ctx->param)
+        && vcache_update_str(mctx, ctx->propq)
+        && vcache_update_cert(mctx, md, ctx->cert);
+    for (i = 0; ok && i < sk_X509_num(ctx->untrusted); i++)
+        ok = vcache_update_cert(mctx, md, sk_X509_value(ctx->untrusted, i));
+    ok = ok && EVP_DigestFinal_ex(mctx, key, NULL);
+
+    EVP_MD_CTX_free(mctx);
+    EVP_MD_free(md);
+    return ok;
+}
+
+/*
+ * Returns 1 if the cached result |e| holds at the verification time of
+ * |ctx|, with the same comparisons as check_cert_time() and check_crl_time().
+ */
+static int vcache_entry_valid(const X509_VCACHE_ENTRY *e,
+                              const X509_STORE_CTX *ctx)
+{
+    time_t *ptime = NULL;
+
+    if ((ctx->param->flags & X509_V_FLAG_USE_CHECK_TIME) != 0)
+        ptime = &ctx->param->check_time;
+    return (e->valid_from == NULL || X509_cmp_time(e->valid_from, ptime) < 0)
+        && (e->expires == NULL || X509_cmp_time(e->expires, ptime) > 0);
+}
+
+/*
+ * Looks up the result of the verification with key |key|. If it is cached,
+ * sets up |ctx| as if it had been done and returns 1, otherwise returns 0.
+ */
+int x509_vcache_get(X509_VCACHE *vc, X509_STORE_CTX *ctx,
+                    const unsigned char *key)
+{
+    X509_VCACHE_ENTRY tmp, *e;
+    STACK_OF(X509) *chain = NULL;
+    char *peername = NULL;
+    int num_untrusted = 0, ok = 1;
+
+    memcpy(tmp.key, key, sizeof(tmp.key));
+    if (!CRYPTO_THREAD_read_lock(vc->lock))
+        return 0;
+    if ((e = lh_X509_VCACHE_ENTRY_retrieve(vc->gen[0], &tmp)) == NULL)
+        e = lh_X509_VCACHE_ENTRY_retrieve(vc->gen[1], &tmp);
+    if (e != NULL && vcache_entry_valid(e, ctx)) {
+        num_untrusted = e->num_untrusted;
+        chain = X509_chain_up_ref(e->chain);
+        if (e->peername != NULL)
+            ok = (peername = OPENSSL_strdup(e->peername)) != NULL;
+    }
+    CRYPTO_THREAD_unlock(vc->lock);
+
+    if (chain == NULL || !ok) {
+        sk_X509_pop_free(chain, X509_free);
+        return 0;
+    }
+
+    sk_X509_pop_free(ctx->chain, X509_free);
+    ctx->chain = chain;
+    ctx->num_untrusted = num_untrusted;
+    ctx->error = X509_V_OK;
+    ctx->error_depth = 0;
+    ctx->current_cert = NULL;
+    OPENSSL_free(ctx->param->peername);
+    ctx->param->peername = peername;
+    return 1;
+}
+
+/*
+ * Sets |e->valid_from| and |e->expires| to copies of the times between which
+ * the result of the verification done with |ctx| holds, or NULL if there is
+ * no such bound. Returns 1 on success or 0 on error.
+ */
+static int vcache_validity(const X509_STORE_CTX *ctx, X509_VCACHE_ENTRY *e)
+{
+    const ASN1_TIME *t, *max = ctx->crl_valid_from, *min = ctx->crl_expiry;
+    X509 *x;
+    int i;
+
+    if ((ctx->param->flags & X509_V_FLAG_NO_CHECK_TIME) != 0)
+        return 1;
+
+    for (i = 0; i < sk_X509_num(ctx->chain); i++) {
+        x = sk_X509_value(ctx->chain, i);
+        t = X509_get0_notBefore(x);
+        if (max == NULL || ASN1_TIME_compare(t, max) > 0)
+            max = t;
+        t = X509_get0_notAfter(x);
+        if (min == NULL || ASN1_TIME_compare(t, min) < 0)
+            min = t;
+    }
+    return (max == NULL || (e->valid_from = ASN1_STRING_dup(max)) != NULL)
+        && (min == NULL || (e->expires = ASN1_STRING_dup(min)) != NULL);
+}
+
+/*
+ * Records the result of the successful verification done with |ctx|, unless
+ * the cache was flushed since |generation| was read by x509_vcache_key().
+ */
+void x509_vcache_put(X509_VCACHE *vc, const X509_STORE_CTX *ctx,
+                     const unsigned char *key, uint64_t generation)
+{
+    X509_VCACHE_ENTRY *e = OPENSSL_zalloc(sizeof(*e)), *old;
+    LHASH_OF(X509_VCACHE_ENTRY) *gen;
+
+    if (e == NULL
+            || (e->chain = X509_chain_up_ref(ctx->chain)) == NULL
+            || (ctx->param->peername != NULL
+                && (e->peername = OPENSSL_strdup(ctx->param->peername)) == NULL)
+            || !vcache_validity(ctx, e)) {
+        vcache_entry_free(e);
+        return;
+    }
+    memcpy(e->key, key, sizeof(e->key));
+    e->num_untrusted = ctx->num_untrusted;
+
+    if (!CRYPTO_THREAD_write_lock(vc->lock)) {
+        vcache_entry_free(e);
+        return;
+    }
+    if (vc->generation != generation) {
+        /* The store changed during the verification */
+        CRYPTO_THREAD_unlock(vc->lock);
+        vcache_entry_free(e);
+        return;
+    }
+    if (lh_X509_VCACHE_ENTRY_num_items(vc->gen[0]) >= vc->capacity
+            && (gen = vcache_gen_new()) != NULL) {
+        vcache_gen_free(vc->gen[1]);
+        vc->gen[1] = vc->gen[0];
+        vc->gen[0] = gen;
+    }
+    old = lh_X509_VCACHE_ENTRY_insert(vc->gen[0], e);
+    if (lh_X509_VCACHE_ENTRY_error(vc->gen[0]))
+        old = e;
+    CRYPTO_THREAD_unlock(vc->lock);
+
+    vcache_entry_free(old);
+}
+
+int X509_STORE_set_verify_cache(X509_STORE *store, size_t capacity)
+{
+    X509_VCACHE *vc = NULL;
+
+    if (capacity > 0 && (vc = x509_vcache_new(capacity)) == NULL)
+        return 0;
+
+    x509_vcache_free(store->verify_cache);
+    store->verify_cache = vc;
+    return 1;
+}
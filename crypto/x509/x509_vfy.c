@@ -52,6 +52,8 @@ static int check_id(X509_STORE_CTX *ctx);
 static int check_trust(X509_STORE_CTX *ctx, int num_untrusted);
 static int check_revocation(X509_STORE_CTX *ctx);
 static int check_cert(X509_STORE_CTX *ctx);
+static int check_crl(X509_STORE_CTX *ctx, X509_CRL *crl);
+static int cert_crl(X509_STORE_CTX *ctx, X509_CRL *crl, X509 *x);
 static int check_policy(X509_STORE_CTX *ctx);
 static int get_issuer_sk(X509 **issuer, X509_STORE_CTX *ctx, X509 *x);
 static int check_dane_issuer(X509_STORE_CTX *ctx, int depth);
@@ -194,6 +196,34 @@ static int check_auth_level(X509_STORE_CTX *ctx)
     return 1;
 }
 
+/*
+ * Returns 1 if the outcome of the verification with |ctx| only depends on
+ * the certificates presented, the verification parameters and the contents
+ * of the store, so that a successful one can be cached. CRLs are looked up
+ * on each verification, so when they are checked and the store has lookup
+ * methods, these may have new CRLs that the store does not have yet.
+ */
+static int verify_cacheable(X509_STORE_CTX *ctx)
+{
+    return ctx->store != NULL && ctx->store->verify_cache != NULL
+        && ctx->parent == NULL
+        && ctx->crls == NULL
+        && ((ctx->param->flags & X509_V_FLAG_CRL_CHECK) == 0
+            || sk_X509_LOOKUP_num(ctx->store->get_cert_methods) <= 0)
+        && !DANETLS_ENABLED(ctx->dane)
+        && (ctx->param->flags & X509_V_FLAG_POLICY_CHECK) == 0
+        && ctx->verify_cb == null_callback
+        && ctx->verify == internal_verify
+        && ctx->get_issuer == X509_STORE_CTX_get1_issuer
+        && ctx->check_issued == check_issued
+        && ctx->check_revocation == check_revocation
+        && ctx->get_crl == NULL
+        && ctx->check_crl == check_crl
+        && ctx->cert_crl == cert_crl
+        && ctx->lookup_certs == X509_STORE_CTX_get1_certs
+        && ctx->lookup_crls == X509_STORE_CTX_get1_crls;
+}
+
 static int verify_chain(X509_STORE_CTX *ctx)
 {
     int err;
@@ -250,7 +280,9 @@ int X509_STORE_CTX_verify(X509_STORE_CTX *ctx)
 
 int X509_verify_cert(X509_STORE_CTX *ctx)
 {
-    int ret;
+    unsigned char key[X509_VCACHE_KEY_LEN];
+    uint64_t generation;
+    int ret, cacheable;
 
     if (ctx == NULL) {
         ERR_raise(ERR_LIB_X509, ERR_R_PASSED_NULL_PARAMETER);
@@ -272,6 +304,11 @@ int X509_verify_cert(X509_STORE_CTX *ctx)
         return -1;
     }
 
+    cacheable = verify_cacheable(ctx)
+        && x509_vcache_key(ctx, key, &generation);
+    if (cacheable && x509_vcache_get(ctx->store->verify_cache, ctx, key))
+        return 1;
+
     if (!X509_add_cert_new(&ctx->chain, ctx->cert, X509_ADD_FLAG_UP_REF)) {
         ctx->error = X509_V_ERR_OUT_OF_MEM;
         return -1;
@@ -291,6 +328,9 @@ int X509_verify_cert(X509_STORE_CTX *ctx)
      */
     if (ret <= 0 && ctx->error == X509_V_OK)
         ctx->error = X509_V_ERR_UNSPECIFIED;
+    else if (ret > 0 && cacheable && ctx->error == X509_V_OK
+             && !ctx->crl_times_unknown)
+        x509_vcache_put(ctx->store->verify_cache, ctx, key, generation);
     return ret;
 }
 
@@ -893,6 +933,47 @@ static int check_revocation(X509_STORE_CTX *ctx)
     return 1;
 }
 
+/*
+ * Replaces |*bound| with a copy of |t| if it is NULL, or if |t| is later
+ * (with |later| set) or earlier (otherwise) than it.  Returns 1 on success
+ * or 0 on error.
+ */
+static int note_time_bound(ASN1_TIME **bound, const ASN1_TIME *t, int later)
+{
+    ASN1_TIME *copy;
+    int cmp;
+
+    if (*bound != NULL) {
+        cmp = ASN1_TIME_compare(t, *bound);
+        if (later ? cmp <= 0 : cmp >= 0)
+            return 1;
+    }
+    if ((copy = ASN1_STRING_dup(t)) == NULL)
+        return 0;
+    ASN1_TIME_free(*bound);
+    *bound = copy;
+    return 1;
+}
+
+/*
+ * Keeps track of the latest lastUpdate and earliest nextUpdate of the CRLs
+ * used, which bound the times for which a successful verification can be
+ * cached.
+ */
+static void note_crl_times(X509_STORE_CTX *ctx, const X509_CRL *crl)
+{
+    const ASN1_TIME *last = X509_CRL_get0_lastUpdate(crl);
+    const ASN1_TIME *next = X509_CRL_get0_nextUpdate(crl);
+
+    if (ctx->store == NULL || ctx->store->verify_cache == NULL)
+        return;
+
+    /* On error, make sure the result is not cached at all */
+    if ((last != NULL && !note_time_bound(&ctx->crl_valid_from, last, 1))
+            || (next != NULL && !note_time_bound(&ctx->crl_expiry, next, 0)))
+        ctx->crl_times_unknown = 1;
+}
+
 static int check_cert(X509_STORE_CTX *ctx)
 {
     X509_CRL *crl = NULL, *dcrl = NULL;
@@ -944,6 +1025,9 @@ static int check_cert(X509_STORE_CTX *ctx)
                 goto done;
         }
 
+        note_crl_times(ctx, crl);
+        if (dcrl != NULL)
+            note_crl_times(ctx, dcrl);
         X509_CRL_free(crl);
         X509_CRL_free(dcrl);
         crl = NULL;
@@ -1693,12 +1777,66 @@ int x509_check_cert_time(X509_STORE_CTX *ctx, X509 *x, int depth)
     return 1;
 }
 
+/*
+ * With X509_V_FLAG_BATCH_VERIFY, verify all the signatures of the chain
+ * that can be verified in a batch (currently those made with Ed25519) in
+ * one go.  Returns a bit mask of the depths of the certificates whose
+ * signature is known to be valid, or 0 if the batch did not verify, in which
+ * case internal_verify() checks the signatures one by one to find and report
+ * the bad one.
+ *
+ * Only the certificates whose signature X509_verify() would check exactly
+ * like this are included: the signature of chain[n] with the key of
+ * chain[n + 1], over the cached encoding of its TBSCertificate, and with
+ * a signature BIT STRING as decoded, without unused bits.
+ */
+static uint64_t batch_verify_chain(X509_STORE_CTX *ctx)
+{
+    EVP_VERIFY_BATCH *batch;
+    uint64_t verified = 0;
+    int n, num = sk_X509_num(ctx->chain);
+
+    if ((ctx->param->flags & X509_V_FLAG_BATCH_VERIFY) == 0 || num < 3
+            || (batch = EVP_VERIFY_BATCH_new(ctx->libctx, ctx->propq)) == NULL)
+        return 0;
+
+    for (n = 0; n < num - 1 && n < 64; n++) {
+        X509 *xs = sk_X509_value(ctx->chain, n);
+        X509 *xi = sk_X509_value(ctx->chain, n + 1);
+        EVP_PKEY *pkey = X509_get0_pubkey(xi);
+
+        if (pkey == NULL
+                || OBJ_obj2nid(xs->sig_alg.algorithm) != NID_ED25519
+                || xs->sig_alg.parameter != NULL
+                || X509_ALGOR_cmp(&xs->sig_alg, &xs->cert_info.signature) != 0
+                || (xs->signature.flags & (ASN1_STRING_FLAG_BITS_LEFT | 0x07))
+                   != ASN1_STRING_FLAG_BITS_LEFT
+                || xs->cert_info.enc.enc == NULL
+                || xs->cert_info.enc.modified
+                || !EVP_PKEY_is_a(pkey, "ED25519"))
+            continue;
+        if (!EVP_VERIFY_BATCH_add(batch, pkey, NULL, xs->signature.data,
+                                  xs->signature.length,
+                                  xs->cert_info.enc.enc,
+                                  xs->cert_info.enc.len))
+            goto end;
+        verified |= (uint64_t)1 << n;
+    }
+
+    if (EVP_VERIFY_BATCH_num(batch) < 2 || !EVP_VERIFY_BATCH_verify(batch))
+        verified = 0;
+ end:
+    EVP_VERIFY_BATCH_free(batch);
+    return verified;
+}
+
 /* verify the issuer signatures and cert times of ctx->chain */
 static int internal_verify(X509_STORE_CTX *ctx)
 {
     int n = sk_X509_num(ctx->chain) - 1;
     X509 *xi = sk_X509_value(ctx->chain, n);
     X509 *xs = xi;
+    uint64_t batch_verified;
 
     ctx->error_depth = n;
     if (ctx->bare_ta_signed) {
@@ -1725,6 +1863,10 @@ static int internal_verify(X509_STORE_CTX *ctx)
          */
     }
 
+    ERR_set_mark();
+    batch_verified = batch_verify_chain(ctx);
+    ERR_pop_to_mark();
+
     /*
      * Do not clear ctx->error = 0, it must be "sticky",
      * only the user's callback is allowed to reset errors (at its own peril).
@@ -1773,7 +1915,8 @@ static int internal_verify(X509_STORE_CTX *ctx)
             if ((pkey = X509_get0_pubkey(xi)) == NULL) {
                 CB_FAIL_IF(1, ctx, xi, issuer_depth,
                            X509_V_ERR_UNABLE_TO_DECODE_ISSUER_PUBLIC_KEY);
-            } else {
+            } else if (xs == xi || n >= 64
+                       || (batch_verified & ((uint64_t)1 << n)) == 0) {
                 CB_FAIL_IF(X509_verify(xs, pkey) <= 0,
                            ctx, xs, n, X509_V_ERR_CERT_SIGNATURE_FAILURE);
             }
@@ -2291,6 +2434,10 @@ int X509_STORE_CTX_init(X509_STORE_CTX *ctx, X509_STORE *store, X509 *x509,
     ctx->parent = NULL;
     ctx->dane = NULL;
     ctx->bare_ta_signed = 0;
+    ctx->snapshot = store != NULL ? x509_store_snapshot_get1(store) : NULL;
+    ctx->crl_valid_from = NULL;
+    ctx->crl_expiry = NULL;
+    ctx->crl_times_unknown = 0;
     /* Zero ex_data to make sure we're cleanup-safe */
     memset(&ctx->ex_data, 0, sizeof(ctx->ex_data));
 
@@ -2435,6 +2582,12 @@ void X509_STORE_CTX_cleanup(X509_STORE_CTX *ctx)
     ctx->tree = NULL;
     sk_X509_pop_free(ctx->chain, X509_free);
     ctx->chain = NULL;
+    x509_store_snapshot_free(ctx->snapshot);
+    ctx->snapshot = NULL;
+    ASN1_TIME_free(ctx->crl_valid_from);
+    ctx->crl_valid_from = NULL;
+    ASN1_TIME_free(ctx->crl_expiry);
+    ctx->crl_expiry = NULL;
     CRYPTO_free_ex_data(CRYPTO_EX_INDEX_X509_STORE_CTX, ctx, &(ctx->ex_data));
     memset(&ctx->ex_data, 0, sizeof(ctx->ex_data));
 }
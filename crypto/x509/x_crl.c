@@ -26,6 +26,8 @@ ASN1_SEQUENCE(X509_REVOKED) = {
 } ASN1_SEQUENCE_END(X509_REVOKED)
 
 static int def_crl_verify(X509_CRL *crl, EVP_PKEY *r);
+static void crl_index_free(X509_CRL *crl);
+static void crl_index_build(X509_CRL *crl);
 static int def_crl_lookup(X509_CRL *crl,
                           X509_REVOKED **ret, const ASN1_INTEGER *serial,
                           const X509_NAME *issuer);
@@ -168,6 +170,7 @@ static int crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         ASN1_INTEGER_free(crl->crl_number);
         ASN1_INTEGER_free(crl->base_crl_number);
         sk_GENERAL_NAMES_pop_free(crl->issuers, GENERAL_NAMES_free);
+        crl_index_free(crl);
         /* fall thru */
 
     case ASN1_OP_NEW_POST:
@@ -181,6 +184,8 @@ static int crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         crl->issuers = NULL;
         crl->crl_number = NULL;
         crl->base_crl_number = NULL;
+        crl->revoked_index = NULL;
+        crl->revoked_index_mask = 0;
         break;
 
     case ASN1_OP_D2I_POST:
@@ -246,6 +251,8 @@ static int crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         if (!crl_set_issuers(crl))
             return 0;
 
+        crl_index_build(crl);
+
         if (crl->meth->crl_init) {
             if (crl->meth->crl_init(crl) == 0)
                 return 0;
@@ -264,6 +271,7 @@ static int crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         ASN1_INTEGER_free(crl->crl_number);
         ASN1_INTEGER_free(crl->base_crl_number);
         sk_GENERAL_NAMES_pop_free(crl->issuers, GENERAL_NAMES_free);
+        crl_index_free(crl);
         OPENSSL_free(crl->propq);
         break;
     case ASN1_OP_DUP_POST:
@@ -351,6 +359,8 @@ int X509_CRL_add0_revoked(X509_CRL *crl, X509_REVOKED *rev)
         ERR_raise(ERR_LIB_ASN1, ERR_R_MALLOC_FAILURE);
         return 0;
     }
+    /* Lookups now need to search the revoked entries themselves */
+    crl_index_free(crl);
     inf->enc.modified = 1;
     return 1;
 }
@@ -412,16 +422,90 @@ static int crl_revoked_issuer_match(X509_CRL *crl, const X509_NAME *nm,
 
 }
 
+static uint32_t crl_serial_hash(const ASN1_INTEGER *serial)
+{
+    /* FNV-1a over the sign and the magnitude */
+    uint32_t h = 2166136261U ^ (uint32_t)(serial->type & V_ASN1_NEG);
+    int i;
+
+    for (i = 0; i < serial->length; i++)
+        h = (h ^ serial->data[i]) * 16777619U;
+    return h;
+}
+
+static void crl_index_free(X509_CRL *crl)
+{
+    OPENSSL_free(crl->revoked_index);
+    crl->revoked_index = NULL;
+    crl->revoked_index_mask = 0;
+}
+
+/*
+ * Build the hash table of revoked entries used by def_crl_lookup(). This is
+ * done when the CRL is decoded, so that lookups need neither sort the entries
+ * under a lock nor compare serial numbers along a binary search, which for
+ * large CRLs is costly. The table is only an optimisation: if it cannot be
+ * built, lookups fall back to a binary search.
+ */
+static void crl_index_build(X509_CRL *crl)
+{
+    STACK_OF(X509_REVOKED) *revoked = crl->crl.revoked;
+    X509_REVOKED *rev;
+    int i, num = sk_X509_REVOKED_num(revoked);
+    size_t size, j;
+
+    crl_index_free(crl);
+    if (num <= 0 || (size_t)num > SIZE_MAX / 4 / sizeof(*crl->revoked_index))
+        return;
+
+    /* Open addressing, with a load factor of at most 1/2 */
+    for (size = 16; size < (size_t)num * 2; size <<= 1)
+        continue;
+    crl->revoked_index = OPENSSL_zalloc(size * sizeof(*crl->revoked_index));
+    if (crl->revoked_index == NULL)
+        return;
+    crl->revoked_index_mask = size - 1;
+
+    for (i = 0; i < num; i++) {
+        rev = sk_X509_REVOKED_value(revoked, i);
+        j = crl_serial_hash(&rev->serialNumber) & crl->revoked_index_mask;
+        while (crl->revoked_index[j] != NULL)
+            j = (j + 1) & crl->revoked_index_mask;
+        crl->revoked_index[j] = rev;
+    }
+}
+
+static int crl_revoked_found(X509_REVOKED *rev, X509_REVOKED **ret)
+{
+    if (ret)
+        *ret = rev;
+    if (rev->reason == CRL_REASON_REMOVE_FROM_CRL)
+        return 2;
+    return 1;
+}
+
 static int def_crl_lookup(X509_CRL *crl,
                           X509_REVOKED **ret, const ASN1_INTEGER *serial,
                           const X509_NAME *issuer)
 {
     X509_REVOKED rtmp, *rev;
     int idx, num;
+    size_t j;
 
     if (crl->crl.revoked == NULL)
         return 0;
 
+    if (crl->revoked_index != NULL) {
+        /* Entries with the same serial number may have different issuers */
+        j = crl_serial_hash(serial) & crl->revoked_index_mask;
+        for (; (rev = crl->revoked_index[j]) != NULL;
+             j = (j + 1) & crl->revoked_index_mask)
+            if (ASN1_INTEGER_cmp(&rev->serialNumber, serial) == 0
+                    && crl_revoked_issuer_match(crl, issuer, rev))
+                return crl_revoked_found(rev, ret);
+        return 0;
+    }
+
     /*
      * Sort revoked into serial number order if not already sorted. Do this
      * under a lock to avoid race condition.
@@ -440,13 +524,8 @@ static int def_crl_lookup(X509_CRL *crl,
         rev = sk_X509_REVOKED_value(crl->crl.revoked, idx);
         if (ASN1_INTEGER_cmp(&rev->serialNumber, serial))
             return 0;
-        if (crl_revoked_issuer_match(crl, issuer, rev)) {
-            if (ret)
-                *ret = rev;
-            if (rev->reason == CRL_REASON_REMOVE_FROM_CRL)
-                return 2;
-            return 1;
-        }
+        if (crl_revoked_issuer_match(crl, issuer, rev))
+            return crl_revoked_found(rev, ret);
     }
     return 0;
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -35,6 +35,7 @@ static void x509_name_ex_free(ASN1_VALUE **val, const ASN1_ITEM *it);
 
 static int x509_name_encode(X509_NAME *a);
 static int x509_name_canon(X509_NAME *a);
+static void x509_name_canon_free(struct x509_name_canon_st *c);
 static int asn1_string_canon(ASN1_STRING *out, const ASN1_STRING *in);
 static int i2d_name_canon(const STACK_OF(STACK_OF_X509_NAME_ENTRY) * intname,
                           unsigned char **in);
@@ -120,7 +121,7 @@ static void x509_name_ex_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
 
     BUF_MEM_free(a->bytes);
     sk_X509_NAME_ENTRY_pop_free(a->entries, X509_NAME_ENTRY_free);
-    OPENSSL_free(a->canon_enc);
+    x509_name_canon_free(a->canon);
     OPENSSL_free(a);
     *pval = NULL;
 }
@@ -290,6 +291,281 @@ static int x509_name_ex_print(BIO *out, const ASN1_VALUE **pval,
     return 2;
 }
 
+/*
+ * The canonical encodings of names are interned in a table held by the
+ * default library context, so that all the names with the same canonical
+ * encoding share one reference counted copy. This saves memory in stores
+ * holding many certificates from the same issuers, lets X509_NAME_cmp()
+ * recognise equal names by pointer and lets X509_NAME_hash_ex() hash each
+ * distinct name only once.
+ *
+ * Every entry holds a reference to the table, so that names freed after the
+ * library context can still remove their entry. An entry whose count has
+ * dropped to zero is dead: it is never handed out again, and the thread that
+ * dropped the last reference removes it from the table and frees it.
+ */
+
+typedef struct x509_name_canon_st X509_NAME_CANON;
+
+DEFINE_LHASH_OF(X509_NAME_CANON);
+
+typedef struct {
+    CRYPTO_RWLOCK *lock;        /* protects |names| */
+    CRYPTO_RWLOCK *ref_lock;    /* used if atomics are not available */
+    CRYPTO_REF_COUNT references; /* the library context and every entry */
+    LHASH_OF(X509_NAME_CANON) *names;
+} X509_NAME_CANON_TABLE;
+
+struct x509_name_canon_st {
+    X509_NAME_CANON_TABLE *table;
+    CRYPTO_REF_COUNT references;
+    unsigned long hash;         /* FNV-1a of |data|, used by the table */
+    uint64_t name_hash;         /* X509_NAME_HASH_SET | X509_NAME_hash_ex() */
+    int length;
+    unsigned char *data;        /* allocated with the structure */
+};
+
+#define X509_NAME_HASH_SET      ((uint64_t)1 << 32)
+
+/*
+ * Without a compare-and-swap on reference counts, references are dropped with
+ * the table locked for writing instead.
+ */
+#if defined(HAVE_C11_ATOMICS) && defined(ATOMIC_INT_LOCK_FREE) \
+    && ATOMIC_INT_LOCK_FREE > 0
+# define CANON_LOAD_REF(p) atomic_load_explicit((p), memory_order_relaxed)
+# define CANON_CAS_REF(p, expected, desired)                                 \
+    atomic_compare_exchange_weak_explicit((p), (expected), (desired),       \
+                                          memory_order_relaxed,             \
+                                          memory_order_relaxed)
+#elif defined(HAVE_ATOMICS) && defined(__GNUC__) && defined(__ATOMIC_RELAXED)
+# define CANON_LOAD_REF(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+# define CANON_CAS_REF(p, expected, desired)                                 \
+    __atomic_compare_exchange_n((p), (expected), (desired), 1,              \
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#endif
+
+static unsigned long x509_name_canon_lh_hash(const X509_NAME_CANON *c)
+{
+    return c->hash;
+}
+
+static int x509_name_canon_lh_cmp(const X509_NAME_CANON *a,
+                                  const X509_NAME_CANON *b)
+{
+    if (a->length != b->length)
+        return a->length < b->length ? -1 : 1;
+    return memcmp(a->data, b->data, a->length);
+}
+
+static void x509_name_canon_table_release(X509_NAME_CANON_TABLE *table)
+{
+    int i;
+
+    if (table == NULL)
+        return;
+    CRYPTO_DOWN_REF(&table->references, &i, table->ref_lock);
+    if (i > 0)
+        return;
+    lh_X509_NAME_CANON_free(table->names);
+    CRYPTO_THREAD_lock_free(table->ref_lock);
+    CRYPTO_THREAD_lock_free(table->lock);
+    OPENSSL_free(table);
+}
+
+/* Entries still in use keep the table until the last of them is freed */
+static void x509_name_canon_table_free(void *vtable)
+{
+    x509_name_canon_table_release(vtable);
+}
+
+static void *x509_name_canon_table_new(OSSL_LIB_CTX *libctx)
+{
+    X509_NAME_CANON_TABLE *table = OPENSSL_zalloc(sizeof(*table));
+
+    if (table == NULL)
+        return NULL;
+    table->references = 1;
+    table->lock = CRYPTO_THREAD_lock_new();
+    table->ref_lock = CRYPTO_THREAD_lock_new();
+    table->names = lh_X509_NAME_CANON_new(x509_name_canon_lh_hash,
+                                          x509_name_canon_lh_cmp);
+    if (table->lock == NULL || table->ref_lock == NULL
+            || table->names == NULL) {
+        x509_name_canon_table_release(table);
+        return NULL;
+    }
+    return table;
+}
+
+static const OSSL_LIB_CTX_METHOD x509_name_canon_table_method = {
+    x509_name_canon_table_new,
+    x509_name_canon_table_free,
+};
+
+/* Allocate a table entry with room for |length| bytes of encoding */
+static X509_NAME_CANON *x509_name_canon_new(int length)
+{
+    X509_NAME_CANON_TABLE *table;
+    X509_NAME_CANON *c;
+
+    table = ossl_lib_ctx_get_data(NULL, OSSL_LIB_CTX_X509_NAME_CANON_INDEX,
+                                  &x509_name_canon_table_method);
+    if (table == NULL
+            || (c = OPENSSL_malloc(sizeof(*c) + length)) == NULL) {
+        ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
+        return NULL;
+    }
+    c->table = table;
+    c->references = 1;
+    c->hash = 0;
+    c->name_hash = 0;
+    c->length = length;
+    c->data = (unsigned char *)(c + 1);
+    return c;
+}
+
+/*
+ * Take a reference to |c|, which was found in the table, unless it is dead.
+ * Must be called with the table locked.
+ */
+static int x509_name_canon_up_ref(X509_NAME_CANON *c)
+{
+    int i;
+
+#ifdef CANON_CAS_REF
+    i = CANON_LOAD_REF(&c->references);
+    do {
+        if (i == 0)
+            return 0;
+    } while (!CANON_CAS_REF(&c->references, &i, i + 1));
+#else
+    CRYPTO_UP_REF(&c->references, &i, c->table->ref_lock);
+#endif
+    return 1;
+}
+
+/*
+ * Return the entry of the table with the same encoding as |c|, with its
+ * reference count incremented, or add |c| to the table if there is none.
+ * |c| is freed unless it is returned.
+ */
+static X509_NAME_CANON *x509_name_canon_intern(X509_NAME_CANON *c)
+{
+    X509_NAME_CANON_TABLE *table = c->table;
+    X509_NAME_CANON *ret;
+    int i;
+
+    /* FNV-1a */
+    c->hash = 2166136261UL;
+    for (i = 0; i < c->length; i++)
+        c->hash = ((c->hash ^ c->data[i]) * 16777619UL) & 0xffffffffUL;
+
+    if (!CRYPTO_THREAD_read_lock(table->lock))
+        goto err;
+    ret = lh_X509_NAME_CANON_retrieve(table->names, c);
+    if (ret != NULL && !x509_name_canon_up_ref(ret))
+        ret = NULL;
+    CRYPTO_THREAD_unlock(table->lock);
+    if (ret != NULL) {
+        OPENSSL_free(c);
+        return ret;
+    }
+
+    if (!CRYPTO_THREAD_write_lock(table->lock))
+        goto err;
+    ret = lh_X509_NAME_CANON_retrieve(table->names, c);
+    if (ret == NULL || !x509_name_canon_up_ref(ret)) {
+        /* A dead entry is replaced, and freed by whoever killed it */
+        CRYPTO_UP_REF(&table->references, &i, table->ref_lock);
+        (void)lh_X509_NAME_CANON_insert(table->names, c);
+        if (lh_X509_NAME_CANON_error(table->names)) {
+            CRYPTO_THREAD_unlock(table->lock);
+            CRYPTO_DOWN_REF(&table->references, &i, table->ref_lock);
+            ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+        ret = c;
+    }
+    CRYPTO_THREAD_unlock(table->lock);
+    if (ret != c)
+        OPENSSL_free(c);
+    return ret;
+
+ err:
+    OPENSSL_free(c);
+    return NULL;
+}
+
+static void x509_name_canon_free(X509_NAME_CANON *c)
+{
+    X509_NAME_CANON_TABLE *table;
+    int i;
+
+    if (c == NULL)
+        return;
+    table = c->table;
+
+#ifdef CANON_CAS_REF
+    CRYPTO_DOWN_REF(&c->references, &i, table->ref_lock);
+    if (i > 0)
+        return;
+    /* |c| is dead, nobody else can take a reference to it any more */
+    if (!CRYPTO_THREAD_write_lock(table->lock))
+        return;
+    if (lh_X509_NAME_CANON_retrieve(table->names, c) == c)
+        (void)lh_X509_NAME_CANON_delete(table->names, c);
+    CRYPTO_THREAD_unlock(table->lock);
+#else
+    /*
+     * The last reference is dropped with the table locked for writing, so
+     * that x509_name_canon_intern() cannot find an entry being freed.
+     */
+    if (!CRYPTO_THREAD_write_lock(table->lock))
+        return;
+    CRYPTO_DOWN_REF(&c->references, &i, table->ref_lock);
+    if (i == 0)
+        (void)lh_X509_NAME_CANON_delete(table->names, c);
+    CRYPTO_THREAD_unlock(table->lock);
+    if (i > 0)
+        return;
+#endif
+    OPENSSL_free(c);
+    x509_name_canon_table_release(table);
+}
+
+/*
+ * The following need the canonical encoding of |a| to be up to date, which
+ * i2d_X509_NAME() ensures.
+ */
+unsigned long x509_name_canon_hash(const X509_NAME *a)
+{
+    return a->canon == NULL ? 0 : a->canon->hash;
+}
+
+int x509_name_get_cached_hash(const X509_NAME *a, unsigned long *hash)
+{
+    uint64_t v;
+
+    if (a->canon == NULL || a->modified
+            || !CRYPTO_atomic_load(&a->canon->name_hash, &v,
+                                   a->canon->table->ref_lock)
+            || (v & X509_NAME_HASH_SET) == 0)
+        return 0;
+    *hash = (unsigned long)(v & 0xffffffffUL);
+    return 1;
+}
+
+void x509_name_set_cached_hash(const X509_NAME *a, unsigned long hash)
+{
+    uint64_t v;
+
+    if (a->canon != NULL && !a->modified)
+        (void)CRYPTO_atomic_or(&a->canon->name_hash,
+                               X509_NAME_HASH_SET | (hash & 0xffffffffUL), &v,
+                               a->canon->table->ref_lock);
+}
+
 /*
  * This function generates the canonical encoding of the Name structure. In
  * it all strings are converted to UTF8, leading, trailing and multiple
@@ -306,9 +582,11 @@ static int x509_name_canon(X509_NAME *a)
     STACK_OF(STACK_OF_X509_NAME_ENTRY) *intname;
     STACK_OF(X509_NAME_ENTRY) *entries = NULL;
     X509_NAME_ENTRY *entry, *tmpentry = NULL;
+    X509_NAME_CANON *canon;
     int i, set = -1, ret = 0, len;
 
-    OPENSSL_free(a->canon_enc);
+    x509_name_canon_free(a->canon);
+    a->canon = NULL;
     a->canon_enc = NULL;
     /* Special case: empty X509_NAME => null encoding */
     if (sk_X509_NAME_ENTRY_num(a->entries) == 0) {
@@ -356,17 +634,15 @@ static int x509_name_canon(X509_NAME *a)
     len = i2d_name_canon(intname, NULL);
     if (len < 0)
         goto err;
-    a->canon_enclen = len;
-
-    p = OPENSSL_malloc(a->canon_enclen);
-    if (p == NULL) {
-        ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
+    if ((canon = x509_name_canon_new(len)) == NULL)
         goto err;
-    }
-
-    a->canon_enc = p;
-
+    p = canon->data;
     i2d_name_canon(intname, &p);
+    if ((a->canon = x509_name_canon_intern(canon)) == NULL)
+        goto err;
+
+    a->canon_enc = a->canon->data;
+    a->canon_enclen = len;
 
     ret = 1;
 
@@ -30,6 +30,15 @@ struct X509_pubkey_st {
     ASN1_BIT_STRING *public_key;
     EVP_PKEY *pkey;
 
+    /*
+     * When decoded from DER, |pkey| is only decoded from |public_key| on
+     * first use, under |lock|. |decoded| is then set atomically, so that
+     * later uses need no lock.
+     */
+    CRYPTO_RWLOCK *lock;        /* NULL if |pkey| is always up to date */
+    int decode_done;            /* protected by |lock| */
+    uint64_t decoded;
+
     /* extra data for the callback, used by d2i_PUBKEY_ex */
     OSSL_LIB_CTX *libctx;
     char *propq;
@@ -62,21 +71,22 @@ static int pubkey_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
     if (operation == ASN1_OP_FREE_POST) {
         OPENSSL_free(pubkey->propq);
         EVP_PKEY_free(pubkey->pkey);
+        CRYPTO_THREAD_lock_free(pubkey->lock);
     } else if (operation == ASN1_OP_D2I_POST) {
-        /* Attempt to decode public key and cache in pubkey structure. */
-        EVP_PKEY_free(pubkey->pkey);
-        pubkey->pkey = NULL;
         /*
-         * Opportunistically decode the key but remove any non fatal errors
-         * from the queue. Subsequent explicit attempts to decode/use the key
-         * will return an appropriate error.
+         * Decoding the key can cost much more than decoding the rest of a
+         * certificate, and many certificates are never asked for their key,
+         * so defer it to the first X509_PUBKEY_get0().
          */
-        ERR_set_mark();
-        if (x509_pubkey_decode(&pubkey->pkey, pubkey) == -1) {
-            ERR_clear_last_mark();
+        EVP_PKEY_free(pubkey->pkey);
+        pubkey->pkey = NULL;
+        pubkey->decode_done = 0;
+        pubkey->decoded = 0;
+        if (pubkey->lock == NULL
+                && (pubkey->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+            ERR_raise(ERR_LIB_X509, ERR_R_MALLOC_FAILURE);
             return 0;
         }
-        ERR_pop_to_mark();
     } else if (operation == ASN1_OP_DUP_POST) {
         X509_PUBKEY *old = exarg;
 
@@ -164,6 +174,9 @@ int X509_PUBKEY_set(X509_PUBKEY **x, EVP_PKEY *pkey)
         EVP_PKEY_free(pk->pkey);
 
     pk->pkey = pkey;
+    /* |pk| is not shared yet and |pkey| must not be decoded again */
+    CRYPTO_THREAD_lock_free(pk->lock);
+    pk->lock = NULL;
     return 1;
 
  error:
@@ -213,6 +226,38 @@ static int x509_pubkey_decode(EVP_PKEY **ppkey, const X509_PUBKEY *key)
     return 0;
 }
 
+/*
+ * Returns the cached key of |key|, after decoding it if this has been deferred
+ * and not done yet. Failures to decode are reported by X509_PUBKEY_get0().
+ */
+static EVP_PKEY *x509_pubkey_get0_cached(X509_PUBKEY *key)
+{
+    EVP_PKEY *ret;
+    uint64_t decoded = 0;
+
+    if (key->lock == NULL
+            || (CRYPTO_atomic_load(&key->decoded, &decoded, key->lock)
+                && decoded))
+        return key->pkey;
+
+    if (!CRYPTO_THREAD_write_lock(key->lock))
+        return NULL;
+    if (!key->decode_done) {
+        /* Only fatal errors, such as allocation failures, are retried */
+        ERR_set_mark();
+        if (x509_pubkey_decode(&key->pkey, key) != -1)
+            key->decode_done = 1;
+        ERR_pop_to_mark();
+    }
+    ret = key->pkey;
+    decoded = key->decode_done;
+    CRYPTO_THREAD_unlock(key->lock);
+
+    if (decoded)
+        CRYPTO_atomic_or(&key->decoded, 1, &decoded, key->lock);
+    return ret;
+}
+
 EVP_PKEY *X509_PUBKEY_get0(const X509_PUBKEY *key)
 {
     EVP_PKEY *ret = NULL;
@@ -220,16 +265,15 @@ EVP_PKEY *X509_PUBKEY_get0(const X509_PUBKEY *key)
     if (key == NULL || key->public_key == NULL)
         return NULL;
 
-    if (key->pkey != NULL)
-        return key->pkey;
+    if ((ret = x509_pubkey_get0_cached((X509_PUBKEY *)key)) != NULL)
+        return ret;
 
     /*
-     * When the key ASN.1 is initially parsed an attempt is made to
-     * decode the public key and cache the EVP_PKEY structure. If this
-     * operation fails the cached value will be NULL. Parsing continues
-     * to allow parsing of unknown key types or unsupported forms.
-     * We repeat the decode operation so the appropriate errors are left
-     * in the queue.
+     * The public key is decoded on first use and the EVP_PKEY structure
+     * cached. If this operation fails the cached value will be NULL.
+     * Parsing continues to allow parsing of unknown key types or
+     * unsupported forms. We repeat the decode operation so the appropriate
+     * errors are left in the queue.
      */
     x509_pubkey_decode(&ret, key);
     /* If decode doesn't fail something bad happened */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2014-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -87,6 +87,21 @@ int bn_rshift_fixed_top(BIGNUM *r, const BIGNUM *a, int n);
 int bn_div_fixed_top(BIGNUM *dv, BIGNUM *rem, const BIGNUM *m,
                      const BIGNUM *d, BN_CTX *ctx);
 
+int bn_mod_exp_mont_consttime_x2(BIGNUM *rr1, const BIGNUM *a1,
+                                 const BIGNUM *p1, const BIGNUM *m1,
+                                 BN_MONT_CTX *in_mont1,
+                                 BIGNUM *rr2, const BIGNUM *a2,
+                                 const BIGNUM *p2, const BIGNUM *m2,
+                                 BN_MONT_CTX *in_mont2, BN_CTX *ctx);
+
+typedef struct bn_mont_comb_st BN_MONT_COMB;
+BN_MONT_COMB *bn_mont_comb_new(const BIGNUM *g, const BIGNUM *m, int bits,
+                               BN_CTX *ctx);
+void bn_mont_comb_free(BN_MONT_COMB *comb);
+int bn_mont_comb_bits(const BN_MONT_COMB *comb);
+int bn_mod_exp_mont_comb(BIGNUM *rr, const BIGNUM *p,
+                         const BN_MONT_COMB *comb, BN_CTX *ctx);
+
 #define BN_PRIMETEST_COMPOSITE                    0
 #define BN_PRIMETEST_COMPOSITE_WITH_FACTOR        1
 #define BN_PRIMETEST_COMPOSITE_NOT_POWER_OF_PRIME 2
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2018 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -19,6 +19,17 @@ int ossl_init_thread(void);
 void ossl_cleanup_thread(void);
 void ossl_ctx_thread_stop(void *arg);
 
+/*
+ * Native threads for spreading long running computations over several CPUs.
+ * ossl_crypto_thread_start() returns NULL if threads are not available, in
+ * which case callers must do the work themselves.
+ */
+typedef struct ossl_crypto_thread_st OSSL_CRYPTO_THREAD;
+
+OSSL_CRYPTO_THREAD *ossl_crypto_thread_start(void (*routine)(void *),
+                                             void *arg);
+int ossl_crypto_thread_join(OSSL_CRYPTO_THREAD *thread);
+
 /*
  * OPENSSL_INIT flags. The primary list of these is in crypto.h. Flags below
  * are those omitted from crypto.h because they are "reserved for internal
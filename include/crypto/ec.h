@@ -57,6 +57,17 @@ int ecdh_KDF_X9_63(unsigned char *out, size_t outlen,
                    const unsigned char *sinfo, size_t sinfolen,
                    const EVP_MD *md, OSSL_LIB_CTX *libctx, const char *propq);
 
+/*-
+ * Signs the |n| digests |dgst| with |eckey|, storing the signatures in |sigs|.
+ * Signing many digests with the same key this way shares the modular
+ * inversions between the signatures.
+ * Returns 1 on success and 0 on error, in which case |sigs| holds no
+ * signatures.
+ */
+int ossl_ecdsa_sign_batch(EC_KEY *eckey, size_t n,
+                          const unsigned char *const dgst[],
+                          const size_t dgstlen[], ECDSA_SIG *sigs[]);
+
 int ec_key_public_check(const EC_KEY *eckey, BN_CTX *ctx);
 int ec_key_private_check(const EC_KEY *eckey);
 int ec_key_pairwise_check(const EC_KEY *eckey, BN_CTX *ctx);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2020-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -86,15 +86,38 @@ int X25519(uint8_t out_shared_key[32], const uint8_t private_key[32],
            const uint8_t peer_public_value[32]);
 void X25519_public_from_private(uint8_t out_public_value[32],
                                 const uint8_t private_key[32]);
+/*
+ * Batch versions of X25519_public_from_private() and
+ * ED25519_public_from_private(), which share the field inversion needed to
+ * encode the public keys.  They return 1 on success and 0 on error.
+ */
+int X25519_public_from_private_batch(size_t n,
+                                     uint8_t *const *out_public_values,
+                                     const uint8_t *const *private_keys);
 
 int ED25519_public_from_private(OSSL_LIB_CTX *ctx, uint8_t out_public_key[32],
                                 const uint8_t private_key[32], const char *propq);
+int ED25519_public_from_private_batch(OSSL_LIB_CTX *ctx, size_t n,
+                                      uint8_t *const *out_public_keys,
+                                      const uint8_t *const *private_keys,
+                                      const char *propq);
 int ED25519_sign(uint8_t *out_sig, const uint8_t *message, size_t message_len,
                  const uint8_t public_key[32], const uint8_t private_key[32],
                  OSSL_LIB_CTX *libctx, const char *propq);
 int ED25519_verify(const uint8_t *message, size_t message_len,
                    const uint8_t signature[64], const uint8_t public_key[32],
                    OSSL_LIB_CTX *libctx, const char *propq);
+/*
+ * Returns 1 if all |n| signatures are valid.  This is a cofactored check, so
+ * unlike ED25519_verify() it accepts signatures that are only off by a small
+ * order point, which only the owner of the private key can make.  In the
+ * FIPS module the signatures are checked one by one with ED25519_verify().
+ */
+int ED25519_verify_batch(size_t n, const uint8_t *const *messages,
+                         const size_t *message_lens,
+                         const uint8_t *const *signatures,
+                         const uint8_t *const *public_keys,
+                         OSSL_LIB_CTX *libctx, const char *propq);
 
 int ED448_public_from_private(OSSL_LIB_CTX *ctx, uint8_t out_public_key[57],
                               const uint8_t private_key[57], const char *propq);
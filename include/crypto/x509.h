@@ -37,6 +37,8 @@ struct X509_name_st {
     /* canonical encoding used for rapid Name comparison */
     unsigned char *canon_enc;
     int canon_enclen;
+    /* interned copy holding |canon_enc|, NULL for the empty name */
+    struct x509_name_canon_st *canon;
 } /* X509_NAME */ ;
 
 /* Signature info structure */
@@ -114,6 +116,9 @@ struct X509_crl_st {
     const X509_CRL_METHOD *meth;
     void *meth_data;
     CRYPTO_RWLOCK *lock;
+    /* hash table of the revoked entries by serial number, may be NULL */
+    X509_REVOKED **revoked_index;
+    size_t revoked_index_mask;
 
     OSSL_LIB_CTX *libctx;
     char *propq;
@@ -270,6 +275,15 @@ struct x509_store_ctx_st {      /* X509_STORE_CTX */
     SSL_DANE *dane;
     /* signed via bare TA public key, rather than CA certificate */
     int bare_ta_signed;
+    /* Snapshot of the objects in |store| if it is read mostly */
+    struct x509_store_snapshot_st *snapshot;
+    /*
+     * Latest lastUpdate and earliest nextUpdate of the CRLs used, for the
+     * verification cache
+     */
+    ASN1_TIME *crl_valid_from;
+    ASN1_TIME *crl_expiry;
+    int crl_times_unknown;
 
     OSSL_LIB_CTX *libctx;
     char *propq;
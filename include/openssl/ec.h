@@ -855,6 +855,21 @@ OSSL_DEPRECATEDIN_3_0 int EC_POINTs_mul(const EC_GROUP *group, EC_POINT *r,
                                         BN_CTX *ctx);
 #  endif /* OPENSSL_NO_DEPRECATED_3_0 */
 
+/** Computes r = generator * n + sum_{i=0}^{num-1} p[i] * m[i] where the
+ *  scalars are public, i.e. in variable time when it is faster
+ *  \param  group  underlying EC_GROUP object
+ *  \param  r      EC_POINT object for the result
+ *  \param  n      BIGNUM with the multiplier for the group generator (optional)
+ *  \param  num    number further summands
+ *  \param  p      array of size num of EC_POINT objects
+ *  \param  m      array of size num of BIGNUM objects
+ *  \param  ctx    BN_CTX object (optional)
+ *  \return 1 on success and 0 if an error occurred
+ */
+int EC_POINT_msm(const EC_GROUP *group, EC_POINT *r, const BIGNUM *n,
+                 size_t num, const EC_POINT *p[], const BIGNUM *m[],
+                 BN_CTX *ctx);
+
 /** Computes r = generator * n + q * m
  *  \param  group  underlying EC_GROUP object
  *  \param  r      EC_POINT object for the result
@@ -663,6 +663,9 @@ __owur int EVP_DigestFinal_ex(EVP_MD_CTX *ctx, unsigned char *md,
 __owur int EVP_Digest(const void *data, size_t count,
                           unsigned char *md, unsigned int *size,
                           const EVP_MD *type, ENGINE *impl);
+__owur int EVP_Digest_multi(const EVP_MD *type, size_t n,
+                            const unsigned char *const data[], size_t count,
+                            unsigned char *const md[], size_t size);
 
 __owur int EVP_MD_CTX_copy(EVP_MD_CTX *out, const EVP_MD_CTX *in);
 __owur int EVP_DigestInit(EVP_MD_CTX *ctx, const EVP_MD *type);
@@ -772,6 +775,16 @@ int EVP_DigestVerifyUpdate(EVP_MD_CTX *ctx, const void *data, size_t dsize);
 __owur int EVP_DigestVerifyFinal(EVP_MD_CTX *ctx, const unsigned char *sig,
                                  size_t siglen);
 
+EVP_VERIFY_BATCH *EVP_VERIFY_BATCH_new(OSSL_LIB_CTX *libctx,
+                                       const char *propq);
+void EVP_VERIFY_BATCH_free(EVP_VERIFY_BATCH *batch);
+int EVP_VERIFY_BATCH_add(EVP_VERIFY_BATCH *batch, EVP_PKEY *pkey,
+                         const char *mdname,
+                         const unsigned char *sig, size_t siglen,
+                         const unsigned char *tbs, size_t tbslen);
+int EVP_VERIFY_BATCH_num(const EVP_VERIFY_BATCH *batch);
+__owur int EVP_VERIFY_BATCH_verify(EVP_VERIFY_BATCH *batch);
+
 __owur int EVP_OpenInit(EVP_CIPHER_CTX *ctx, const EVP_CIPHER *type,
                         const unsigned char *ek, int ekl,
                         const unsigned char *iv, EVP_PKEY *priv);
@@ -1756,6 +1769,10 @@ int EVP_PKEY_sign_init(EVP_PKEY_CTX *ctx);
 int EVP_PKEY_sign(EVP_PKEY_CTX *ctx,
                   unsigned char *sig, size_t *siglen,
                   const unsigned char *tbs, size_t tbslen);
+int EVP_PKEY_sign_batch(EVP_PKEY_CTX *ctx, size_t n,
+                        unsigned char *const sigs[], size_t siglens[],
+                        const unsigned char *const tbs[],
+                        const size_t tbslens[]);
 int EVP_PKEY_verify_init(EVP_PKEY_CTX *ctx);
 int EVP_PKEY_verify(EVP_PKEY_CTX *ctx,
                     const unsigned char *sig, size_t siglen,
@@ -1824,6 +1841,7 @@ int EVP_PKEY_paramgen_init(EVP_PKEY_CTX *ctx);
 int EVP_PKEY_paramgen(EVP_PKEY_CTX *ctx, EVP_PKEY **ppkey);
 int EVP_PKEY_keygen_init(EVP_PKEY_CTX *ctx);
 int EVP_PKEY_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY **ppkey);
+int EVP_PKEY_keygen_batch(EVP_PKEY_CTX *ctx, size_t n, EVP_PKEY *ppkeys[]);
 int EVP_PKEY_gen(EVP_PKEY_CTX *ctx, EVP_PKEY **ppkey);
 int EVP_PKEY_check(EVP_PKEY_CTX *ctx);
 int EVP_PKEY_public_check(EVP_PKEY_CTX *ctx);
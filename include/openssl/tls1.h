@@ -139,6 +139,9 @@ extern "C" {
 /* ExtensionType value from RFC4507 */
 # define TLSEXT_TYPE_session_ticket              35
 
+/* ExtensionType value from RFC8879 */
+# define TLSEXT_TYPE_compress_certificate        27
+
 /* As defined for TLS1.3 */
 # define TLSEXT_TYPE_psk                         41
 # define TLSEXT_TYPE_early_data                  42
@@ -213,6 +216,14 @@ extern "C" {
 # define TLSEXT_max_fragment_length_2048        3
 # define TLSEXT_max_fragment_length_4096        4
 
+/* Certificate compression algorithms from RFC8879 */
+# define TLSEXT_comp_cert_none                  0
+# define TLSEXT_comp_cert_zlib                  1
+# define TLSEXT_comp_cert_brotli                2
+# define TLSEXT_comp_cert_zstd                  3
+/* One more than the number of defined values - used as a sentinel */
+# define TLSEXT_comp_cert_limit                 4
+
 int SSL_CTX_set_tlsext_max_fragment_length(SSL_CTX *ctx, uint8_t mode);
 int SSL_set_tlsext_max_fragment_length(SSL *ssl, uint8_t mode);
 
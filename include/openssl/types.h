@@ -121,6 +121,7 @@ typedef struct evp_rand_ctx_st EVP_RAND_CTX;
 typedef struct evp_keyexch_st EVP_KEYEXCH;
 
 typedef struct evp_signature_st EVP_SIGNATURE;
+typedef struct evp_verify_batch_st EVP_VERIFY_BATCH;
 
 typedef struct evp_asym_cipher_st EVP_ASYM_CIPHER;
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2019-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2019-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -106,6 +106,40 @@ static int keccak_final(void *vctx, unsigned char *out, size_t *outl,
     return ret;
 }
 
+/*
+ * Hash |n| messages of |inl| bytes each.  Equally long messages are hashed
+ * four at a time when possible, the rest one by one with |ctx|, which must
+ * have been set up for the digest.
+ */
+static int keccak_digest_multi(KECCAK1600_CTX *ctx, unsigned char pad,
+                               size_t bitlen, int xof, size_t n,
+                               const unsigned char *const in[], size_t inl,
+                               unsigned char *const out[], size_t outsz)
+{
+    size_t i = 0, outl;
+    int ret = 1;
+
+    if (!ossl_prov_is_running())
+        return 0;
+    if (!xof && outsz != ctx->md_size) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_INVALID_DIGEST_LENGTH);
+        return 0;
+    }
+
+    for (; n - i >= 4; i += 4)
+        if (!ossl_sha3_x4(out + i, outsz, in + i, inl, pad, bitlen))
+            break;
+
+    ctx->md_size = outsz;
+    for (; ret && i < n; i++) {
+        ossl_sha3_reset(ctx);
+        ret = keccak_update(ctx, in[i], inl)
+              && keccak_final(ctx, out[i], &outl, outsz);
+    }
+    OPENSSL_cleanse(ctx, sizeof(*ctx));
+    return ret;
+}
+
 /*-
  * Generic software version of the absorb() and final().
  */
@@ -203,6 +237,19 @@ static void *name##_newctx(void *provctx)                                      \
     return ctx;                                                                \
 }
 
+#define SHA3_digest_multi(typ, uname, name, bitlen, pad, xof)                  \
+static OSSL_FUNC_digest_digest_multi_fn name##_digest_multi;                   \
+static int name##_digest_multi(void *provctx, size_t n,                        \
+                               const unsigned char *const in[], size_t inl,    \
+                               unsigned char *const out[], size_t outsz)       \
+{                                                                              \
+    KECCAK1600_CTX kctx, *ctx = &kctx;                                         \
+                                                                               \
+    ossl_sha3_init(ctx, pad, bitlen);                                          \
+    SHA3_SET_MD(uname, typ)                                                    \
+    return keccak_digest_multi(ctx, pad, bitlen, xof, n, in, inl, out, outsz); \
+}
+
 #define KMAC_newctx(uname, bitlen, pad)                                        \
 static OSSL_FUNC_digest_newctx_fn uname##_newctx;                              \
 static void *uname##_newctx(void *provctx)                                     \
@@ -230,13 +277,22 @@ const OSSL_DISPATCH ossl_##name##_functions[] = {                              \
 
 #define PROV_FUNC_SHA3_DIGEST(name, bitlen, blksize, dgstsize, flags)          \
     PROV_FUNC_SHA3_DIGEST_COMMON(name, bitlen, blksize, dgstsize, flags),      \
+    { OSSL_FUNC_DIGEST_DIGEST_MULTI, (void (*)(void))name##_digest_multi },    \
     PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_END
 
-#define PROV_FUNC_SHAKE_DIGEST(name, bitlen, blksize, dgstsize, flags)         \
+#define PROV_FUNC_SHAKE_DIGEST_COMMON(name, bitlen, blksize, dgstsize, flags)  \
     PROV_FUNC_SHA3_DIGEST_COMMON(name, bitlen, blksize, dgstsize, flags),      \
     { OSSL_FUNC_DIGEST_SET_CTX_PARAMS, (void (*)(void))shake_set_ctx_params }, \
     { OSSL_FUNC_DIGEST_SETTABLE_CTX_PARAMS,                                    \
-     (void (*)(void))shake_settable_ctx_params },                              \
+     (void (*)(void))shake_settable_ctx_params }
+
+#define PROV_FUNC_SHAKE_DIGEST(name, bitlen, blksize, dgstsize, flags)         \
+    PROV_FUNC_SHAKE_DIGEST_COMMON(name, bitlen, blksize, dgstsize, flags),     \
+    { OSSL_FUNC_DIGEST_DIGEST_MULTI, (void (*)(void))name##_digest_multi },    \
+    PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_END
+
+#define PROV_FUNC_KMAC_DIGEST(name, bitlen, blksize, dgstsize, flags)          \
+    PROV_FUNC_SHAKE_DIGEST_COMMON(name, bitlen, blksize, dgstsize, flags),     \
     PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_END
 
 static void keccak_freectx(void *vctx)
@@ -284,19 +340,21 @@ static int shake_set_ctx_params(void *vctx, const OSSL_PARAM params[])
 
 #define IMPLEMENT_SHA3_functions(bitlen)                                       \
     SHA3_newctx(sha3, SHA3_##bitlen, sha3_##bitlen, bitlen, '\x06')            \
+    SHA3_digest_multi(sha3, SHA3_##bitlen, sha3_##bitlen, bitlen, '\x06', 0)   \
     PROV_FUNC_SHA3_DIGEST(sha3_##bitlen, bitlen,                               \
                           SHA3_BLOCKSIZE(bitlen), SHA3_MDSIZE(bitlen),         \
                           EVP_MD_FLAG_DIGALGID_ABSENT)
 
 #define IMPLEMENT_SHAKE_functions(bitlen)                                      \
     SHA3_newctx(shake, SHAKE_##bitlen, shake_##bitlen, bitlen, '\x1f')         \
+    SHA3_digest_multi(shake, SHAKE_##bitlen, shake_##bitlen, bitlen, '\x1f', 1)\
     PROV_FUNC_SHAKE_DIGEST(shake_##bitlen, bitlen,                             \
                           SHA3_BLOCKSIZE(bitlen), SHA3_MDSIZE(bitlen),         \
                           EVP_MD_FLAG_XOF)
 #define IMPLEMENT_KMAC_functions(bitlen)                                       \
     KMAC_newctx(keccak_kmac_##bitlen, bitlen, '\x04')                          \
-    PROV_FUNC_SHAKE_DIGEST(keccak_kmac_##bitlen, bitlen,                       \
-                           SHA3_BLOCKSIZE(bitlen), KMAC_MDSIZE(bitlen),        \
+    PROV_FUNC_KMAC_DIGEST(keccak_kmac_##bitlen, bitlen,                        \
+                          SHA3_BLOCKSIZE(bitlen), KMAC_MDSIZE(bitlen),         \
                            EVP_MD_FLAG_XOF)
 
 /* ossl_sha3_224_functions */
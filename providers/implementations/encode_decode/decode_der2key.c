@@ -1,5 +1,5 @@
 /*
- * Copyright 2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2020-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -112,7 +112,7 @@ static OSSL_FUNC_decoder_export_object_fn der2key_export_object;
 
 struct der2key_ctx_st;           /* Forward declaration */
 typedef void *(extract_key_fn)(EVP_PKEY *);
-typedef void (adjust_key_fn)(void *, struct der2key_ctx_st *ctx);
+typedef int (adjust_key_fn)(void *, struct der2key_ctx_st *ctx);
 typedef void (free_key_fn)(void *);
 struct keytype_desc_st {
     const char *keytype_name;
@@ -353,8 +353,11 @@ static int der2key_decode(void *vctx, OSSL_CORE_BIO *cin, int selection,
         }
     }
 
-    if (key != NULL && ctx->desc->adjust_key != NULL)
-        ctx->desc->adjust_key(key, ctx);
+    if (key != NULL && ctx->desc->adjust_key != NULL
+        && !ctx->desc->adjust_key(key, ctx)) {
+        ctx->desc->free_key(key);
+        key = NULL;
+    }
 
  end:
     /*
@@ -418,9 +421,10 @@ static int der2key_export_object(void *vctx,
 # define dh_d2i_key_params              (d2i_of_void *)d2i_DHparams
 # define dh_free                        (free_key_fn *)DH_free
 
-static void dh_adjust(void *key, struct der2key_ctx_st *ctx)
+static int dh_adjust(void *key, struct der2key_ctx_st *ctx)
 {
     ossl_dh_set0_libctx(key, PROV_LIBCTX_OF(ctx->provctx));
+    return 1;
 }
 
 # define dhx_evp_type                   EVP_PKEY_DHX
@@ -442,9 +446,10 @@ static void dh_adjust(void *key, struct der2key_ctx_st *ctx)
 # define dsa_d2i_key_params             (d2i_of_void *)d2i_DSAparams
 # define dsa_free                       (free_key_fn *)DSA_free
 
-static void dsa_adjust(void *key, struct der2key_ctx_st *ctx)
+static int dsa_adjust(void *key, struct der2key_ctx_st *ctx)
 {
     ossl_dsa_set0_libctx(key, PROV_LIBCTX_OF(ctx->provctx));
+    return 1;
 }
 #endif
 
@@ -458,9 +463,10 @@ static void dsa_adjust(void *key, struct der2key_ctx_st *ctx)
 # define ec_d2i_key_params              (d2i_of_void *)d2i_ECParameters
 # define ec_free                        (free_key_fn *)EC_KEY_free
 
-static void ec_adjust(void *key, struct der2key_ctx_st *ctx)
+static int ec_adjust(void *key, struct der2key_ctx_st *ctx)
 {
     ec_key_set0_libctx(key, PROV_LIBCTX_OF(ctx->provctx));
+    return 1;
 }
 
 /*
@@ -468,9 +474,10 @@ static void ec_adjust(void *key, struct der2key_ctx_st *ctx)
  * so no d2i functions to be had.
  */
 
-static void ecx_key_adjust(void *key, struct der2key_ctx_st *ctx)
+static int ecx_key_adjust(void *key, struct der2key_ctx_st *ctx)
 {
     ecx_key_set0_libctx(key, PROV_LIBCTX_OF(ctx->provctx));
+    return 1;
 }
 
 # define ed25519_evp_type               EVP_PKEY_ED25519
@@ -525,9 +532,9 @@ static void ecx_key_adjust(void *key, struct der2key_ctx_st *ctx)
 #define rsa_d2i_key_params              NULL
 #define rsa_free                        (free_key_fn *)RSA_free
 
-static void rsa_adjust(void *key, struct der2key_ctx_st *ctx)
+static int rsa_adjust(void *key, struct der2key_ctx_st *ctx)
 {
-    ossl_rsa_set0_libctx(key, PROV_LIBCTX_OF(ctx->provctx));
+    return ossl_rsa_set0_libctx(key, PROV_LIBCTX_OF(ctx->provctx));
 }
 
 #define rsapss_evp_type                 EVP_PKEY_RSA_PSS
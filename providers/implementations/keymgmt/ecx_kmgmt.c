@@ -1,5 +1,5 @@
 /*
- * Copyright 2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2020-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -40,6 +40,7 @@ static OSSL_FUNC_keymgmt_gen_fn x25519_gen;
 static OSSL_FUNC_keymgmt_gen_fn x448_gen;
 static OSSL_FUNC_keymgmt_gen_fn ed25519_gen;
 static OSSL_FUNC_keymgmt_gen_fn ed448_gen;
+static OSSL_FUNC_keymgmt_gen_batch_fn ecx_gen_batch;
 static OSSL_FUNC_keymgmt_gen_cleanup_fn ecx_gen_cleanup;
 static OSSL_FUNC_keymgmt_load_fn ecx_load;
 static OSSL_FUNC_keymgmt_get_params_fn x25519_get_params;
@@ -652,6 +653,126 @@ static void *ed448_gen(void *genctx, OSSL_CALLBACK *osslcb, void *cbarg)
     return ecx_gen(gctx);
 }
 
+/*
+ * The X25519 and Ed25519 public keys of a batch are computed together,
+ * which shares the field inversion needed to encode them.  Everything else
+ * is generated one key at a time.
+ */
+static int ecx_gen_batch(void *genctx, size_t n, void *keydata[],
+                         OSSL_CALLBACK *osslcb, void *cbarg)
+{
+    struct ecx_gen_ctx *gctx = genctx;
+    OSSL_FUNC_keymgmt_gen_fn *gen = NULL;
+    unsigned char **privkeys = NULL, **pubkeys = NULL, *rnd = NULL;
+    const uint8_t *const *privs;
+    ECX_KEY *key;
+    size_t i;
+    int ret = 0;
+
+    if (!ossl_prov_is_running() || gctx == NULL)
+        return 0;
+    for (i = 0; i < n; i++)
+        keydata[i] = NULL;
+
+    switch (gctx->type) {
+    case ECX_KEY_TYPE_X25519:
+#ifdef S390X_EC_ASM
+        if (OPENSSL_s390xcap_P.pcc[1]
+            & S390X_CAPBIT(S390X_SCALAR_MULTIPLY_X25519))
+            gen = x25519_gen;
+#endif
+        break;
+    case ECX_KEY_TYPE_ED25519:
+#ifdef S390X_EC_ASM
+        if (OPENSSL_s390xcap_P.pcc[1]
+            & S390X_CAPBIT(S390X_SCALAR_MULTIPLY_ED25519)
+            && OPENSSL_s390xcap_P.kdsa[0]
+               & S390X_CAPBIT(S390X_EDDSA_SIGN_ED25519)
+            && OPENSSL_s390xcap_P.kdsa[0]
+               & S390X_CAPBIT(S390X_EDDSA_VERIFY_ED25519))
+            gen = ed25519_gen;
+#endif
+        break;
+    case ECX_KEY_TYPE_X448:
+        gen = x448_gen;
+        break;
+    case ECX_KEY_TYPE_ED448:
+        gen = ed448_gen;
+        break;
+    }
+    /* For parameter generation ecx_gen() just returns blank keys */
+    if (gen == NULL && (gctx->selection & OSSL_KEYMGMT_SELECT_KEYPAIR) == 0)
+        gen = gctx->type == ECX_KEY_TYPE_X25519 ? x25519_gen : ed25519_gen;
+
+    if (gen != NULL) {
+        for (i = 0; i < n; i++)
+            if ((keydata[i] = gen(gctx, osslcb, cbarg)) == NULL)
+                goto err;
+        return 1;
+    }
+
+    if (n > SIZE_MAX / X25519_KEYLEN) {
+        ERR_raise(ERR_LIB_PROV, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+    privkeys = OPENSSL_malloc(n * sizeof(*privkeys));
+    pubkeys = OPENSSL_malloc(n * sizeof(*pubkeys));
+    rnd = OPENSSL_secure_malloc(n * X25519_KEYLEN);
+    if (privkeys == NULL || pubkeys == NULL || rnd == NULL) {
+        ERR_raise(ERR_LIB_PROV, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    for (i = 0; i < n; i++) {
+        key = ecx_key_new(gctx->libctx, gctx->type, 0, gctx->propq);
+        keydata[i] = key;
+        if (key == NULL
+            || (privkeys[i] = ecx_key_allocate_privkey(key)) == NULL) {
+            ERR_raise(ERR_LIB_PROV, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+        pubkeys[i] = key->pubkey;
+    }
+
+    /* Both key types have 32 byte private keys */
+    if (RAND_priv_bytes_ex(gctx->libctx, rnd, n * X25519_KEYLEN) <= 0)
+        goto err;
+    for (i = 0; i < n; i++) {
+        memcpy(privkeys[i], rnd + i * X25519_KEYLEN, X25519_KEYLEN);
+        if (gctx->type == ECX_KEY_TYPE_X25519) {
+            privkeys[i][0] &= 248;
+            privkeys[i][X25519_KEYLEN - 1] &= 127;
+            privkeys[i][X25519_KEYLEN - 1] |= 64;
+        }
+    }
+
+    privs = (const uint8_t *const *)privkeys;
+    if (gctx->type == ECX_KEY_TYPE_X25519) {
+        if (!X25519_public_from_private_batch(n, pubkeys, privs)) {
+            ERR_raise(ERR_LIB_PROV, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+    } else if (!ED25519_public_from_private_batch(gctx->libctx, n, pubkeys,
+                                                  privs, gctx->propq)) {
+        goto err;
+    }
+    for (i = 0; i < n; i++)
+        ((ECX_KEY *)keydata[i])->haspubkey = 1;
+    ret = 1;
+
+ err:
+    if (!ret) {
+        for (i = 0; i < n; i++) {
+            ecx_key_free(keydata[i]);
+            keydata[i] = NULL;
+        }
+    }
+    OPENSSL_free(privkeys);
+    OPENSSL_free(pubkeys);
+    OPENSSL_secure_clear_free(rnd, n * X25519_KEYLEN);
+    return ret;
+}
+
 static void ecx_gen_cleanup(void *genctx)
 {
     struct ecx_gen_ctx *gctx = genctx;
@@ -767,6 +888,7 @@ static int ed448_validate(const void *keydata, int selection)
           (void (*)(void))ecx_gen_settable_params }, \
         { OSSL_FUNC_KEYMGMT_GEN, (void (*)(void))alg##_gen }, \
         { OSSL_FUNC_KEYMGMT_GEN_CLEANUP, (void (*)(void))ecx_gen_cleanup }, \
+        { OSSL_FUNC_KEYMGMT_GEN_BATCH, (void (*)(void))ecx_gen_batch }, \
         { OSSL_FUNC_KEYMGMT_LOAD, (void (*)(void))ecx_load }, \
         { 0, NULL } \
     };
@@ -1,5 +1,5 @@
 /*
- * Copyright 2019-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2019-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -392,6 +392,8 @@ struct rsa_gen_ctx {
     size_t nbits;
     BIGNUM *pub_exp;
     size_t primes;
+    /* Number of threads to search for primes with */
+    size_t threads;
 
     /* For PSS */
     RSA_PSS_PARAMS_30 pss_params;
@@ -470,6 +472,10 @@ static int rsa_gen_set_params(void *genctx, const OSSL_PARAM params[])
     if ((p = OSSL_PARAM_locate_const(params, OSSL_PKEY_PARAM_RSA_PRIMES)) != NULL
         && !OSSL_PARAM_get_size_t(p, &gctx->primes))
         return 0;
+    if ((p = OSSL_PARAM_locate_const(params,
+                                     OSSL_PKEY_PARAM_RSA_THREADS)) != NULL
+        && !OSSL_PARAM_get_size_t(p, &gctx->threads))
+        return 0;
     if ((p = OSSL_PARAM_locate_const(params, OSSL_PKEY_PARAM_RSA_E)) != NULL
         && !OSSL_PARAM_get_BN(p, &gctx->pub_exp))
         return 0;
@@ -489,6 +495,7 @@ static int rsa_gen_set_params(void *genctx, const OSSL_PARAM params[])
 #define rsa_gen_basic                                           \
     OSSL_PARAM_size_t(OSSL_PKEY_PARAM_RSA_BITS, NULL),          \
     OSSL_PARAM_size_t(OSSL_PKEY_PARAM_RSA_PRIMES, NULL),        \
+    OSSL_PARAM_size_t(OSSL_PKEY_PARAM_RSA_THREADS, NULL),       \
     OSSL_PARAM_BN(OSSL_PKEY_PARAM_RSA_E, NULL, 0)
 
 /*
@@ -565,6 +572,7 @@ static void *rsa_gen(void *genctx, OSSL_CALLBACK *osslcb, void *cbarg)
     }
 #endif
 
+    ossl_rsa_set_keygen_threads(rsa_tmp, gctx->threads);
     if (!RSA_generate_multi_prime_key(rsa_tmp,
                                       (int)gctx->nbits, (int)gctx->primes,
                                       gctx->pub_exp, gencb))
@@ -185,6 +185,67 @@ static int ecdsa_sign(void *vctx, unsigned char *sig, size_t *siglen,
     return 1;
 }
 
+static int ecdsa_sign_batch(void *vctx, size_t n,
+                            unsigned char *const sigs[], size_t siglens[],
+                            size_t sigsize, const unsigned char *const tbs[],
+                            const size_t tbslens[])
+{
+    PROV_ECDSA_CTX *ctx = (PROV_ECDSA_CTX *)vctx;
+    ECDSA_SIG **s = NULL;
+    unsigned char *p;
+    size_t i, ecsize = ECDSA_size(ctx->ec);
+    int len, ret = 0;
+
+    if (!ossl_prov_is_running())
+        return 0;
+
+    if (sigs == NULL) {
+        for (i = 0; i < n; i++)
+            siglens[i] = ecsize;
+        return 1;
+    }
+
+#if !defined(OPENSSL_NO_ACVP_TESTS)
+    if (ctx->kattest) {
+        for (i = 0; i < n; i++)
+            if (!ecdsa_sign(vctx, sigs[i], &siglens[i], sigsize,
+                            tbs[i], tbslens[i]))
+                return 0;
+        return 1;
+    }
+#endif
+
+    if (sigsize < ecsize)
+        return 0;
+
+    for (i = 0; i < n; i++)
+        if (ctx->mdsize != 0 && tbslens[i] != ctx->mdsize)
+            return 0;
+
+    if (n == 0)
+        return 1;
+
+    if ((s = OPENSSL_zalloc(n * sizeof(*s))) == NULL) {
+        ERR_raise(ERR_LIB_PROV, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    if (!ossl_ecdsa_sign_batch(ctx->ec, n, tbs, tbslens, s))
+        goto end;
+
+    for (i = 0; i < n; i++) {
+        p = sigs[i];
+        if ((len = i2d_ECDSA_SIG(s[i], &p)) <= 0)
+            goto end;
+        siglens[i] = len;
+    }
+    ret = 1;
+ end:
+    for (i = 0; i < n; i++)
+        ECDSA_SIG_free(s[i]);
+    OPENSSL_free(s);
+    return ret;
+}
+
 static int ecdsa_verify(void *vctx, const unsigned char *sig, size_t siglen,
                         const unsigned char *tbs, size_t tbslen)
 {
@@ -538,6 +599,7 @@ const OSSL_DISPATCH ossl_ecdsa_signature_functions[] = {
     { OSSL_FUNC_SIGNATURE_NEWCTX, (void (*)(void))ecdsa_newctx },
     { OSSL_FUNC_SIGNATURE_SIGN_INIT, (void (*)(void))ecdsa_sign_init },
     { OSSL_FUNC_SIGNATURE_SIGN, (void (*)(void))ecdsa_sign },
+    { OSSL_FUNC_SIGNATURE_SIGN_BATCH, (void (*)(void))ecdsa_sign_batch },
     { OSSL_FUNC_SIGNATURE_VERIFY_INIT, (void (*)(void))ecdsa_verify_init },
     { OSSL_FUNC_SIGNATURE_VERIFY, (void (*)(void))ecdsa_verify },
     { OSSL_FUNC_SIGNATURE_DIGEST_SIGN_INIT,
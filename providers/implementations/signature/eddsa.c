@@ -1,5 +1,5 @@
 /*
- * Copyright 2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2020-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -50,6 +50,7 @@ static OSSL_FUNC_signature_digest_sign_fn ed25519_digest_sign;
 static OSSL_FUNC_signature_digest_sign_fn ed448_digest_sign;
 static OSSL_FUNC_signature_digest_verify_fn ed25519_digest_verify;
 static OSSL_FUNC_signature_digest_verify_fn ed448_digest_verify;
+static OSSL_FUNC_signature_digest_verify_batch_fn ed25519_digest_verify_batch;
 static OSSL_FUNC_signature_freectx_fn eddsa_freectx;
 static OSSL_FUNC_signature_dupctx_fn eddsa_dupctx;
 static OSSL_FUNC_signature_get_ctx_params_fn eddsa_get_ctx_params;
@@ -217,6 +218,61 @@ int ed25519_digest_verify(void *vpeddsactx, const unsigned char *sig,
                           edkey->propq);
 }
 
+/*
+ * All of |vpeddsactxs| have been initialised by eddsa_digest_signverify_init()
+ * with an Ed25519 key.  Returns 1 only if all the signatures are valid.
+ */
+static int ed25519_digest_verify_batch(void *const vpeddsactxs[], size_t n,
+                                       const unsigned char *const sigs[],
+                                       const size_t siglens[],
+                                       const unsigned char *const tbs[],
+                                       const size_t tbslens[])
+{
+    PROV_EDDSA_CTX *peddsactx;
+    const unsigned char **pubkeys;
+    size_t i;
+    int ret = 0;
+
+    if (!ossl_prov_is_running())
+        return 0;
+    if (n == 0)
+        return 1;
+
+    for (i = 0; i < n; i++)
+        if (siglens[i] != ED25519_SIGSIZE)
+            return 0;
+
+#ifdef S390X_EC_ASM
+    if (S390X_CAN_SIGN(ED25519)) {
+        for (i = 0; i < n; i++)
+            if (!ed25519_digest_verify(vpeddsactxs[i], sigs[i], siglens[i],
+                                       tbs[i], tbslens[i]))
+                return 0;
+        return 1;
+    }
+#endif /* S390X_EC_ASM */
+
+    if ((pubkeys = OPENSSL_malloc(n * sizeof(*pubkeys))) == NULL) {
+        ERR_raise(ERR_LIB_PROV, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        peddsactx = (PROV_EDDSA_CTX *)vpeddsactxs[i];
+        if (peddsactx->key == NULL
+                || peddsactx->key->type != ECX_KEY_TYPE_ED25519) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_INVALID_KEY);
+            goto end;
+        }
+        pubkeys[i] = peddsactx->key->pubkey;
+    }
+    peddsactx = (PROV_EDDSA_CTX *)vpeddsactxs[0];
+    ret = ED25519_verify_batch(n, tbs, tbslens, sigs, pubkeys,
+                               peddsactx->libctx, peddsactx->key->propq);
+ end:
+    OPENSSL_free(pubkeys);
+    return ret;
+}
+
 int ed448_digest_verify(void *vpeddsactx, const unsigned char *sig,
                         size_t siglen, const unsigned char *tbs,
                         size_t tbslen)
@@ -308,6 +364,8 @@ const OSSL_DISPATCH ossl_ed25519_signature_functions[] = {
       (void (*)(void))eddsa_digest_signverify_init },
     { OSSL_FUNC_SIGNATURE_DIGEST_VERIFY,
       (void (*)(void))ed25519_digest_verify },
+    { OSSL_FUNC_SIGNATURE_DIGEST_VERIFY_BATCH,
+      (void (*)(void))ed25519_digest_verify_batch },
     { OSSL_FUNC_SIGNATURE_FREECTX, (void (*)(void))eddsa_freectx },
     { OSSL_FUNC_SIGNATURE_DUPCTX, (void (*)(void))eddsa_dupctx },
     { OSSL_FUNC_SIGNATURE_GET_CTX_PARAMS, (void (*)(void))eddsa_get_ctx_params },
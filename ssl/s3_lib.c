@@ -24,6 +24,11 @@
 #define TLS13_NUM_CIPHERS       OSSL_NELEM(tls13_ciphers)
 #define SSL3_NUM_CIPHERS        OSSL_NELEM(ssl3_ciphers)
 #define SSL3_NUM_SCSVS          OSSL_NELEM(ssl3_scsvs)
+#define SSL_NUM_ALL_CIPHERS     (TLS13_NUM_CIPHERS + SSL3_NUM_CIPHERS \
+                                 + SSL3_NUM_SCSVS)
+
+/* Bitmap with one bit per SSL_CIPHER, indexed by SSL_CIPHER.table_idx */
+#define CIPHER_BITMAP_WORDS     ((SSL_NUM_ALL_CIPHERS + 31) / 32)
 
 /* TLSv1.3 downgrade protection sentinel values */
 const unsigned char tls11downgrade[] = {
@@ -3248,11 +3253,25 @@ static int cipher_compare(const void *a, const void *b)
 
 void ssl_sort_cipher_list(void)
 {
+    size_t i;
+    uint32_t idx = 0;
+
     qsort(tls13_ciphers, TLS13_NUM_CIPHERS, sizeof(tls13_ciphers[0]),
           cipher_compare);
     qsort(ssl3_ciphers, SSL3_NUM_CIPHERS, sizeof(ssl3_ciphers[0]),
           cipher_compare);
     qsort(ssl3_scsvs, SSL3_NUM_SCSVS, sizeof(ssl3_scsvs[0]), cipher_compare);
+
+    /*
+     * Every cipher gets a unique dense index so that cipher lists can be
+     * represented as bitmaps, see ssl3_choose_cipher().
+     */
+    for (i = 0; i < TLS13_NUM_CIPHERS; i++)
+        tls13_ciphers[i].table_idx = idx++;
+    for (i = 0; i < SSL3_NUM_CIPHERS; i++)
+        ssl3_ciphers[i].table_idx = idx++;
+    for (i = 0; i < SSL3_NUM_SCSVS; i++)
+        ssl3_scsvs[i].table_idx = idx++;
 }
 
 static int ssl_undefined_function_1(SSL *ssl, unsigned char *r, size_t s,
@@ -3928,6 +3947,7 @@ long ssl3_ctx_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
             ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
             return 0;
         }
+        ssl_cert_clear_comp_shared_chain(ctx->cert);
         break;
 
     case SSL_CTRL_GET_EXTRA_CHAIN_CERTS:
@@ -3940,6 +3960,7 @@ long ssl3_ctx_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
     case SSL_CTRL_CLEAR_EXTRA_CHAIN_CERTS:
         sk_X509_pop_free(ctx->extra_certs, X509_free);
         ctx->extra_certs = NULL;
+        ssl_cert_clear_comp_shared_chain(ctx->cert);
         break;
 
     case SSL_CTRL_CHAIN:
@@ -4100,24 +4121,38 @@ int ssl3_put_cipher_by_char(const SSL_CIPHER *c, WPACKET *pkt, size_t *len)
  *
  * Returns the selected cipher or NULL when no common ciphers.
  */
+static void cipher_bitmap_init(uint32_t *bits, STACK_OF(SSL_CIPHER) *sk)
+{
+    const SSL_CIPHER *c;
+    int i;
+
+    memset(bits, 0, CIPHER_BITMAP_WORDS * sizeof(*bits));
+    for (i = 0; i < sk_SSL_CIPHER_num(sk); i++) {
+        c = sk_SSL_CIPHER_value(sk, i);
+        if (ossl_assert(c->table_idx < SSL_NUM_ALL_CIPHERS))
+            bits[c->table_idx / 32] |= (uint32_t)1 << (c->table_idx % 32);
+    }
+}
+
+static ossl_inline int cipher_bitmap_test(const uint32_t *bits,
+                                          const SSL_CIPHER *c)
+{
+    return c->table_idx < SSL_NUM_ALL_CIPHERS
+           && (bits[c->table_idx / 32] >> (c->table_idx % 32)) & 1;
+}
+
 const SSL_CIPHER *ssl3_choose_cipher(SSL *s, STACK_OF(SSL_CIPHER) *clnt,
                                      STACK_OF(SSL_CIPHER) *srvr)
 {
     const SSL_CIPHER *c, *ret = NULL;
     STACK_OF(SSL_CIPHER) *prio, *allow;
-    int i, ii, ok, prefer_sha256 = 0;
+    int i, ok, prefer_sha256 = 0;
     unsigned long alg_k = 0, alg_a = 0, mask_k = 0, mask_a = 0;
     STACK_OF(SSL_CIPHER) *prio_chacha = NULL;
+    uint32_t allow_bits[CIPHER_BITMAP_WORDS];
 
     /* Let's see which ciphers we can support */
 
-    /*
-     * Do not set the compare functions, because this may lead to a
-     * reordering by "id". We want to keep the original ordering. We may pay
-     * a price in performance during sk_SSL_CIPHER_find(), but would have to
-     * pay with the price of sk_SSL_CIPHER_dup().
-     */
-
     OSSL_TRACE_BEGIN(TLS_CIPHER) {
         BIO_printf(trc_out, "Server has %d from %p:\n",
                    sk_SSL_CIPHER_num(srvr), (void *)srvr);
@@ -4184,6 +4219,12 @@ const SSL_CIPHER *ssl3_choose_cipher(SSL *s, STACK_OF(SSL_CIPHER) *clnt,
         allow = srvr;
     }
 
+    /*
+     * Rather than searching |allow| for every candidate in |prio| we turn it
+     * into a bitmap once, so that the cost is linear in the size of the lists.
+     */
+    cipher_bitmap_init(allow_bits, allow);
+
     if (SSL_IS_TLS13(s)) {
 #ifndef OPENSSL_NO_PSK
         int j;
@@ -4220,6 +4261,10 @@ const SSL_CIPHER *ssl3_choose_cipher(SSL *s, STACK_OF(SSL_CIPHER) *clnt,
              DTLS_VERSION_GT(s->version, c->max_dtls)))
             continue;
 
+        /* Skip ciphers not in the other list before any costlier checks */
+        if (!cipher_bitmap_test(allow_bits, c))
+            continue;
+
         /*
          * Since TLS 1.3 ciphersuites can be used with any auth or
          * key exchange scheme skip tests.
@@ -4258,39 +4303,35 @@ const SSL_CIPHER *ssl3_choose_cipher(SSL *s, STACK_OF(SSL_CIPHER) *clnt,
             if (!ok)
                 continue;
         }
-        ii = sk_SSL_CIPHER_find(allow, c);
-        if (ii >= 0) {
-            /* Check security callback permits this cipher */
-            if (!ssl_security(s, SSL_SECOP_CIPHER_SHARED,
-                              c->strength_bits, 0, (void *)c))
-                continue;
 
-            if ((alg_k & SSL_kECDHE) && (alg_a & SSL_aECDSA)
-                && s->s3.is_probably_safari) {
-                if (!ret)
-                    ret = sk_SSL_CIPHER_value(allow, ii);
-                continue;
-            }
+        /* Check security callback permits this cipher */
+        if (!ssl_security(s, SSL_SECOP_CIPHER_SHARED,
+                          c->strength_bits, 0, (void *)c))
+            continue;
 
-            if (prefer_sha256) {
-                const SSL_CIPHER *tmp = sk_SSL_CIPHER_value(allow, ii);
-
-                /*
-                 * TODO: When there are no more legacy digests we can just use
-                 * OSSL_DIGEST_NAME_SHA2_256 instead of calling OBJ_nid2sn
-                 */
-                if (EVP_MD_is_a(ssl_md(s->ctx, tmp->algorithm2),
-                                       OBJ_nid2sn(NID_sha256))) {
-                    ret = tmp;
-                    break;
-                }
-                if (ret == NULL)
-                    ret = tmp;
-                continue;
+        if ((alg_k & SSL_kECDHE) && (alg_a & SSL_aECDSA)
+            && s->s3.is_probably_safari) {
+            if (!ret)
+                ret = c;
+            continue;
+        }
+
+        if (prefer_sha256) {
+            /*
+             * TODO: When there are no more legacy digests we can just use
+             * OSSL_DIGEST_NAME_SHA2_256 instead of calling OBJ_nid2sn
+             */
+            if (EVP_MD_is_a(ssl_md(s->ctx, c->algorithm2),
+                                   OBJ_nid2sn(NID_sha256))) {
+                ret = c;
+                break;
             }
-            ret = sk_SSL_CIPHER_value(allow, ii);
-            break;
+            if (ret == NULL)
+                ret = c;
+            continue;
         }
+        ret = c;
+        break;
     }
 
     sk_SSL_CIPHER_free(prio_chacha);
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * TLSv1.3 early data anti-replay cache for stateless tickets.
+ *
+ * This implements the "ClientHello recording" approach of RFC8446 section
+ * 8.2, combined with the freshness check on the obfuscated ticket age that
+ * is done when the ticket is decrypted. Because a given ClientHello can only
+ * pass the freshness check during a short period of time, it is sufficient
+ * to remember ClientHellos for slightly longer than that period.
+ *
+ * ClientHellos are identified by their PSK binder, which is a MAC over the
+ * ClientHello and so is unique and uniformly distributed. They are recorded
+ * in Bloom filters, which bounds the memory used whatever the connection
+ * rate. A false positive only means that early data is rejected and the
+ * connection falls back to a full 1-RTT handshake.
+ *
+ * To keep contention between threads low, the cache is split into shards,
+ * each with its own lock. Each shard holds two generations of its filter,
+ * the current and the previous one, which are rotated every |window|
+ * seconds. So a binder is remembered for at least |window| seconds.
+ */
+
+#include <time.h>
+#include "ssl_local.h"
+
+#define ANTI_REPLAY_SHARDS          16
+/* Number of bits set for each entry */
+#define ANTI_REPLAY_HASHES          7
+/* Filter bits per expected entry, for a false positive rate of about 1% */
+#define ANTI_REPLAY_BITS_PER_ENTRY  10
+#define ANTI_REPLAY_MIN_BITS        512
+
+/* Shard index plus one 32 bit word for each hash */
+#define ANTI_REPLAY_MIN_BINDER_LEN  (1 + 4 * ANTI_REPLAY_HASHES)
+
+/*
+ * A ClientHello passes the ticket age check during at most
+ * TICKET_AGE_ALLOWANCE + 1 second (see tls_parse_ctos_psk()).
+ */
+#define ANTI_REPLAY_MIN_WINDOW      (TICKET_AGE_ALLOWANCE / 1000 + 2)
+
+typedef struct {
+    CRYPTO_RWLOCK *lock;
+    time_t gen_start;
+    unsigned char *filter[2];   /* current and previous generation */
+} ANTI_REPLAY_SHARD;
+
+struct ssl_anti_replay_st {
+    time_t window;
+    size_t nbits;               /* per shard and generation, a power of 2 */
+    ANTI_REPLAY_SHARD shards[ANTI_REPLAY_SHARDS];
+};
+
+void ssl_anti_replay_free(SSL_ANTI_REPLAY *ar)
+{
+    size_t i;
+
+    if (ar == NULL)
+        return;
+
+    for (i = 0; i < ANTI_REPLAY_SHARDS; i++) {
+        CRYPTO_THREAD_lock_free(ar->shards[i].lock);
+        OPENSSL_free(ar->shards[i].filter[0]);
+        OPENSSL_free(ar->shards[i].filter[1]);
+    }
+    OPENSSL_free(ar);
+}
+
+static SSL_ANTI_REPLAY *ssl_anti_replay_new(size_t capacity, uint32_t window)
+{
+    SSL_ANTI_REPLAY *ar;
+    size_t i, want, nbytes;
+    time_t now = time(NULL);
+
+    if ((ar = OPENSSL_zalloc(sizeof(*ar))) == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        return NULL;
+    }
+
+    ar->window = window < ANTI_REPLAY_MIN_WINDOW ? ANTI_REPLAY_MIN_WINDOW
+                                                 : window;
+
+    want = capacity / ANTI_REPLAY_SHARDS + 1;
+    if (want > SIZE_MAX / 8 / ANTI_REPLAY_BITS_PER_ENTRY) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        goto err;
+    }
+    want *= ANTI_REPLAY_BITS_PER_ENTRY;
+    for (ar->nbits = ANTI_REPLAY_MIN_BITS; ar->nbits < want; ar->nbits <<= 1)
+        continue;
+    nbytes = ar->nbits / 8;
+
+    for (i = 0; i < ANTI_REPLAY_SHARDS; i++) {
+        ANTI_REPLAY_SHARD *sh = &ar->shards[i];
+
+        sh->gen_start = now;
+        if ((sh->lock = CRYPTO_THREAD_lock_new()) == NULL
+                || (sh->filter[0] = OPENSSL_zalloc(nbytes)) == NULL
+                || (sh->filter[1] = OPENSSL_zalloc(nbytes)) == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+    }
+    return ar;
+
+ err:
+    ssl_anti_replay_free(ar);
+    return NULL;
+}
+
+/* Must be called with the shard lock held */
+static void anti_replay_rotate(SSL_ANTI_REPLAY *ar, ANTI_REPLAY_SHARD *sh,
+                               time_t now)
+{
+    unsigned char *tmp;
+
+    /* Be careful about the clock going backwards */
+    if (now >= sh->gen_start && now - sh->gen_start < ar->window)
+        return;
+
+    if (now >= sh->gen_start && now - sh->gen_start < 2 * ar->window) {
+        /* The current generation becomes the previous one */
+        tmp = sh->filter[1];
+        sh->filter[1] = sh->filter[0];
+        sh->filter[0] = tmp;
+    } else {
+        /* Everything we have is too old */
+        memset(sh->filter[1], 0, ar->nbits / 8);
+    }
+    memset(sh->filter[0], 0, ar->nbits / 8);
+    sh->gen_start = now;
+}
+
+/*
+ * Record the PSK binder |binder| of length |len| as seen. Returns 1 if it has
+ * not been seen before, in which case early data may be accepted, or 0 if it
+ * has (or might have) been seen before or on error.
+ */
+int ssl_anti_replay_check(SSL_ANTI_REPLAY *ar, const unsigned char *binder,
+                          size_t len)
+{
+    ANTI_REPLAY_SHARD *sh;
+    size_t idx[ANTI_REPLAY_HASHES];
+    const unsigned char *p;
+    int i, seen = 1;
+
+    if (ar == NULL || len < ANTI_REPLAY_MIN_BINDER_LEN)
+        return 0;
+
+    sh = &ar->shards[binder[0] % ANTI_REPLAY_SHARDS];
+    for (i = 0, p = binder + 1; i < ANTI_REPLAY_HASHES; i++, p += 4)
+        idx[i] = (((size_t)p[0] << 24) | ((size_t)p[1] << 16)
+                  | ((size_t)p[2] << 8) | p[3]) & (ar->nbits - 1);
+
+    if (!CRYPTO_THREAD_write_lock(sh->lock))
+        return 0;
+
+    anti_replay_rotate(ar, sh, time(NULL));
+    for (i = 0; i < ANTI_REPLAY_HASHES; i++) {
+        unsigned char bit = (unsigned char)(1 << (idx[i] % 8));
+
+        if ((sh->filter[0][idx[i] / 8] & bit) == 0
+                && (sh->filter[1][idx[i] / 8] & bit) == 0)
+            seen = 0;
+        sh->filter[0][idx[i] / 8] |= bit;
+    }
+
+    CRYPTO_THREAD_unlock(sh->lock);
+
+    return !seen;
+}
+
+int SSL_CTX_set_early_data_replay_cache(SSL_CTX *ctx, size_t capacity,
+                                        uint32_t window)
+{
+    SSL_ANTI_REPLAY *ar = NULL;
+
+    if (capacity > 0 && (ar = ssl_anti_replay_new(capacity, window)) == NULL)
+        return 0;
+
+    ssl_anti_replay_free(ctx->anti_replay);
+    ctx->anti_replay = ar;
+    return 1;
+}
@@ -75,7 +75,7 @@ CERT *ssl_cert_new(void)
 CERT *ssl_cert_dup(CERT *cert)
 {
     CERT *ret = OPENSSL_zalloc(sizeof(*ret));
-    int i;
+    int i, j;
 
     if (ret == NULL) {
         ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
@@ -131,6 +131,13 @@ CERT *ssl_cert_dup(CERT *cert)
             memcpy(ret->pkeys[i].serverinfo,
                    cert->pkeys[i].serverinfo, cert->pkeys[i].serverinfo_length);
         }
+        for (j = TLSEXT_comp_cert_none; j < TLSEXT_comp_cert_limit; j++) {
+            if (cpk->comp_cert[j] != NULL) {
+                if (!ssl_comp_cert_up_ref(cpk->comp_cert[j]))
+                    goto err;
+                rpk->comp_cert[j] = cpk->comp_cert[j];
+            }
+        }
     }
 
     /* Configured sigalgs copied across */
@@ -199,6 +206,32 @@ CERT *ssl_cert_dup(CERT *cert)
     return NULL;
 }
 
+/* Discard any pre-compressed Certificate messages for |cpk| */
+void ssl_cert_pkey_clear_comp(CERT_PKEY *cpk)
+{
+    int i;
+
+    for (i = TLSEXT_comp_cert_none; i < TLSEXT_comp_cert_limit; i++) {
+        ssl_comp_cert_free(cpk->comp_cert[i]);
+        cpk->comp_cert[i] = NULL;
+    }
+}
+
+/*
+ * Discard the pre-compressed Certificate messages of every certificate of |c|
+ * that has no chain of its own: their chain is the extra chain certificates
+ * of the SSL_CTX or is built from a store, which has changed.
+ */
+void ssl_cert_clear_comp_shared_chain(CERT *c)
+{
+    int i;
+
+    for (i = 0; i < SSL_PKEY_NUM; i++) {
+        if (c->pkeys[i].chain == NULL)
+            ssl_cert_pkey_clear_comp(&c->pkeys[i]);
+    }
+}
+
 /* Free up and clear all certificates and chains */
 
 void ssl_cert_clear_certs(CERT *c)
@@ -217,6 +250,7 @@ void ssl_cert_clear_certs(CERT *c)
         OPENSSL_free(cpk->serverinfo);
         cpk->serverinfo = NULL;
         cpk->serverinfo_length = 0;
+        ssl_cert_pkey_clear_comp(cpk);
     }
 }
 
@@ -266,6 +300,7 @@ int ssl_cert_set0_chain(SSL *s, SSL_CTX *ctx, STACK_OF(X509) *chain)
     }
     sk_X509_pop_free(cpk->chain, X509_free);
     cpk->chain = chain;
+    ssl_cert_pkey_clear_comp(cpk);
     return 1;
 }
 
@@ -299,6 +334,7 @@ int ssl_cert_add0_chain_cert(SSL *s, SSL_CTX *ctx, X509 *x)
         cpk->chain = sk_X509_new_null();
     if (!cpk->chain || !sk_X509_push(cpk->chain, x))
         return 0;
+    ssl_cert_pkey_clear_comp(cpk);
     return 1;
 }
 
@@ -936,6 +972,7 @@ int ssl_build_cert_chain(SSL *s, SSL_CTX *ctx, int flags)
     }
     sk_X509_pop_free(cpk->chain, X509_free);
     cpk->chain = chain;
+    ssl_cert_pkey_clear_comp(cpk);
     if (rv == 0)
         rv = 1;
  err:
@@ -957,6 +994,8 @@ int ssl_cert_set_cert_store(CERT *c, X509_STORE *store, int chain, int ref)
     *pstore = store;
     if (ref && store)
         X509_STORE_up_ref(store);
+    if (chain)
+        ssl_cert_clear_comp_shared_chain(c);
     return 1;
 }
 
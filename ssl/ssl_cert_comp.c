@@ -0,0 +1,391 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * TLSv1.3 certificate compression (RFC8879) support functions
+ */
+
+#include <openssl/objects.h>
+#include <openssl/comp.h>
+#include "ssl_local.h"
+#include "internal/refcount.h"
+
+/*
+ * Returns the COMP_METHOD used for the RFC8879 algorithm |alg|, or NULL if it
+ * is not available. This is the single place that maps wire values onto
+ * compression libraries: brotli and zstd can be enabled here as soon as
+ * crypto/comp provides one-shot methods for them.
+ */
+static COMP_METHOD *ssl_cert_comp_method(int alg)
+{
+    COMP_METHOD *meth = NULL;
+
+#ifndef OPENSSL_NO_COMP
+    switch (alg) {
+    case TLSEXT_comp_cert_zlib:
+        meth = COMP_zlib_oneshot();
+        break;
+    case TLSEXT_comp_cert_brotli:
+    case TLSEXT_comp_cert_zstd:
+    default:
+        break;
+    }
+    if (meth != NULL && COMP_get_type(meth) == NID_undef)
+        meth = NULL;
+#endif
+
+    return meth;
+}
+
+int ssl_cert_comp_supported(int alg)
+{
+    return ssl_cert_comp_method(alg) != NULL;
+}
+
+void ssl_comp_cert_free(OSSL_COMP_CERT *cc)
+{
+    int i;
+
+    if (cc == NULL)
+        return;
+
+    CRYPTO_DOWN_REF(&cc->references, &i, cc->lock);
+    REF_PRINT_COUNT("OSSL_COMP_CERT", cc);
+    if (i > 0)
+        return;
+    REF_ASSERT_ISNT(i < 0);
+
+    OPENSSL_free(cc->data);
+    CRYPTO_THREAD_lock_free(cc->lock);
+    OPENSSL_free(cc);
+}
+
+int ssl_comp_cert_up_ref(OSSL_COMP_CERT *cc)
+{
+    int i;
+
+    if (CRYPTO_UP_REF(&cc->references, &i, cc->lock) <= 0)
+        return 0;
+
+    REF_PRINT_COUNT("OSSL_COMP_CERT", cc);
+    REF_ASSERT_ISNT(i < 2);
+    return i > 1;
+}
+
+/*
+ * Compress |inlen| bytes at |in| with algorithm |alg| into |out|, which must
+ * have room for at least SSL_CERT_COMP_MAX_LEN(inlen) bytes. The compressed
+ * length is written to |*outlen|. Returns 1 on success or 0 on error.
+ */
+int ssl_cert_comp_compress(int alg, const unsigned char *in, size_t inlen,
+                           unsigned char *out, size_t *outlen)
+{
+    COMP_METHOD *meth = ssl_cert_comp_method(alg);
+    COMP_CTX *comp;
+    size_t max_len = SSL_CERT_COMP_MAX_LEN(inlen);
+    int len;
+
+    /* The uncompressed length is encoded in 24 bits on the wire */
+    if (meth == NULL || inlen == 0 || inlen > 0xffffff) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_COMPRESSION_FAILURE);
+        return 0;
+    }
+
+    if ((comp = COMP_CTX_new(meth)) == NULL) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_COMPRESSION_LIBRARY_ERROR);
+        return 0;
+    }
+    len = COMP_compress_block(comp, out, (int)max_len, (unsigned char *)in,
+                              (int)inlen);
+    COMP_CTX_free(comp);
+    if (len <= 0) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_COMPRESSION_FAILURE);
+        return 0;
+    }
+
+    *outlen = (size_t)len;
+    return 1;
+}
+
+/*
+ * Compress |inlen| bytes of an encoded Certificate message body at |in| with
+ * algorithm |alg|. Returns a new OSSL_COMP_CERT with a reference count of 1
+ * or NULL on error.
+ */
+OSSL_COMP_CERT *ssl_comp_cert_new(int alg, const unsigned char *in,
+                                  size_t inlen)
+{
+    OSSL_COMP_CERT *cc;
+
+    if ((cc = OPENSSL_zalloc(sizeof(*cc))) == NULL
+            || (cc->data = OPENSSL_malloc(SSL_CERT_COMP_MAX_LEN(inlen))) == NULL
+            || (cc->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    if (!ssl_cert_comp_compress(alg, in, inlen, cc->data, &cc->len))
+        goto err;
+
+    cc->references = 1;
+    cc->orig_len = inlen;
+    cc->alg = alg;
+    return cc;
+
+ err:
+    if (cc != NULL) {
+        OPENSSL_free(cc->data);
+        CRYPTO_THREAD_lock_free(cc->lock);
+        OPENSSL_free(cc);
+    }
+    return NULL;
+}
+
+/*
+ * Decompress |inlen| bytes at |in| using algorithm |alg| into |out|, which
+ * must hold exactly |outlen| bytes of decompressed data (the
+ * uncompressed_length announced by the peer). Returns 1 on success or 0 if
+ * the data does not decompress to exactly |outlen| bytes.
+ */
+int ssl_cert_comp_expand(int alg, const unsigned char *in, size_t inlen,
+                         unsigned char *out, size_t outlen)
+{
+    COMP_METHOD *meth = ssl_cert_comp_method(alg);
+    COMP_CTX *comp;
+    int len;
+
+    if (meth == NULL || inlen > INT_MAX || outlen > INT_MAX)
+        return 0;
+
+    if ((comp = COMP_CTX_new(meth)) == NULL)
+        return 0;
+    len = COMP_expand_block(comp, out, (int)outlen, (unsigned char *)in,
+                            (int)inlen);
+    COMP_CTX_free(comp);
+
+    return len >= 0 && (size_t)len == outlen;
+}
+
+static int ssl_set_cert_comp_pref(int *prefs, int *algs, size_t len)
+{
+    int tmp[TLSEXT_comp_cert_limit] = { TLSEXT_comp_cert_none };
+    size_t i, j, n = 0;
+
+    if (len >= TLSEXT_comp_cert_limit) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    for (i = 0; i < len; i++) {
+        if (algs[i] <= TLSEXT_comp_cert_none
+                || algs[i] >= TLSEXT_comp_cert_limit) {
+            ERR_raise(ERR_LIB_SSL, SSL_R_UNSUPPORTED_COMPRESSION_ALGORITHM);
+            return 0;
+        }
+        for (j = 0; j < i; j++) {
+            if (algs[j] == algs[i]) {
+                ERR_raise(ERR_LIB_SSL, SSL_R_DUPLICATE_COMPRESSION_ID);
+                return 0;
+            }
+        }
+        /* Silently skip algorithms that this build cannot use */
+        if (ssl_cert_comp_supported(algs[i]))
+            tmp[n++] = algs[i];
+    }
+
+    memcpy(prefs, tmp, sizeof(tmp));
+    return 1;
+}
+
+int SSL_CTX_set1_cert_comp_preference(SSL_CTX *ctx, int *algs, size_t len)
+{
+    return ssl_set_cert_comp_pref(ctx->cert_comp_prefs, algs, len);
+}
+
+int SSL_set1_cert_comp_preference(SSL *ssl, int *algs, size_t len)
+{
+    return ssl_set_cert_comp_pref(ssl->cert_comp_prefs, algs, len);
+}
+
+/*
+ * Add the certificate |x| and an empty extensions block to |pkt|, and check
+ * that it meets the security level of |ctx|.
+ */
+static int ssl_ctx_add_cert_entry(SSL_CTX *ctx, WPACKET *pkt, X509 *x,
+                                  int is_ee)
+{
+    unsigned char *outbytes;
+    int len, rv;
+
+    if ((rv = ssl_security_cert(NULL, ctx, x, 0, is_ee)) != 1) {
+        ERR_raise(ERR_LIB_SSL, rv);
+        return 0;
+    }
+
+    if ((len = i2d_X509(x, NULL)) < 0) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_BUF_LIB);
+        return 0;
+    }
+    if (!WPACKET_sub_allocate_bytes_u24(pkt, len, &outbytes)
+            || i2d_X509(x, &outbytes) != len
+            || !WPACKET_put_bytes_u16(pkt, 0)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Build the TLSv1.3 server Certificate message body that a connection created
+ * from |ctx| would send for |cpk|, when it adds no certificate extensions.
+ * The chain is selected in the same way as ssl_add_cert_chain() does.
+ */
+static int ssl_ctx_cert_msg_body(SSL_CTX *ctx, CERT_PKEY *cpk, WPACKET *pkt)
+{
+    STACK_OF(X509) *extra_certs;
+    X509_STORE *chain_store;
+    int i, ret = 0;
+
+    extra_certs = cpk->chain != NULL ? cpk->chain : ctx->extra_certs;
+
+    if ((ctx->mode & SSL_MODE_NO_AUTO_CHAIN) != 0 || extra_certs != NULL)
+        chain_store = NULL;
+    else if (ctx->cert->chain_store != NULL)
+        chain_store = ctx->cert->chain_store;
+    else
+        chain_store = ctx->cert_store;
+
+    /* The server's Certificate message always has an empty context */
+    if (!WPACKET_put_bytes_u8(pkt, 0)
+            || !WPACKET_start_sub_packet_u24(pkt)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    if (chain_store != NULL) {
+        X509_STORE_CTX *xs_ctx = X509_STORE_CTX_new_ex(ctx->libctx,
+                                                       ctx->propq);
+        STACK_OF(X509) *chain;
+
+        if (xs_ctx == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        if (!X509_STORE_CTX_init(xs_ctx, chain_store, cpk->x509, NULL)) {
+            X509_STORE_CTX_free(xs_ctx);
+            ERR_raise(ERR_LIB_SSL, ERR_R_X509_LIB);
+            return 0;
+        }
+        /* An incomplete chain is fine, see ssl_add_cert_chain() */
+        (void)X509_verify_cert(xs_ctx);
+        ERR_clear_error();
+        chain = X509_STORE_CTX_get0_chain(xs_ctx);
+        for (i = 0; i < sk_X509_num(chain); i++) {
+            if (!ssl_ctx_add_cert_entry(ctx, pkt, sk_X509_value(chain, i),
+                                        i == 0))
+                break;
+        }
+        ret = i == sk_X509_num(chain);
+        X509_STORE_CTX_free(xs_ctx);
+    } else {
+        if (!ssl_ctx_add_cert_entry(ctx, pkt, cpk->x509, 1))
+            return 0;
+        for (i = 0; i < sk_X509_num(extra_certs); i++) {
+            if (!ssl_ctx_add_cert_entry(ctx, pkt, sk_X509_value(extra_certs, i),
+                                        0))
+                return 0;
+        }
+        ret = 1;
+    }
+
+    if (ret && !WPACKET_close(pkt)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_INTERNAL_ERROR);
+        ret = 0;
+    }
+    return ret;
+}
+
+/*
+ * Build the TLSv1.3 server Certificate message body for |cpk| (an entry in
+ * the CERT of |ctx|) and store it in |cpk| compressed with every algorithm in
+ * |algs|.
+ */
+static int ssl_compress_one_cert(SSL_CTX *ctx, CERT_PKEY *cpk, const int *algs)
+{
+    BUF_MEM *buf = NULL;
+    WPACKET pkt;
+    size_t len;
+    int i, ret = 0;
+
+    if ((buf = BUF_MEM_new()) == NULL
+            || !WPACKET_init(&pkt, buf)) {
+        BUF_MEM_free(buf);
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+
+    if (!ssl_ctx_cert_msg_body(ctx, cpk, &pkt)
+            || !WPACKET_get_total_written(&pkt, &len)
+            || !WPACKET_finish(&pkt)) {
+        WPACKET_cleanup(&pkt);
+        goto err;
+    }
+
+    for (i = 0; algs[i] != TLSEXT_comp_cert_none; i++) {
+        OSSL_COMP_CERT *cc = ssl_comp_cert_new(algs[i],
+                                               (const unsigned char *)buf->data,
+                                               len);
+
+        if (cc == NULL)
+            goto err;
+        ssl_comp_cert_free(cpk->comp_cert[algs[i]]);
+        cpk->comp_cert[algs[i]] = cc;
+    }
+    ret = 1;
+
+ err:
+    BUF_MEM_free(buf);
+    return ret;
+}
+
+int SSL_CTX_compress_certs(SSL_CTX *ctx, int alg)
+{
+    int algs[TLSEXT_comp_cert_limit] = { TLSEXT_comp_cert_none };
+    size_t i;
+
+    if (alg == TLSEXT_comp_cert_none) {
+        memcpy(algs, ctx->cert_comp_prefs, sizeof(algs));
+    } else if (ssl_cert_comp_supported(alg)) {
+        algs[0] = alg;
+    } else {
+        ERR_raise(ERR_LIB_SSL, SSL_R_UNSUPPORTED_COMPRESSION_ALGORITHM);
+        return 0;
+    }
+    if (algs[0] == TLSEXT_comp_cert_none)
+        return 1;
+
+    for (i = 0; i < SSL_PKEY_NUM; i++) {
+        CERT_PKEY *cpk = &ctx->cert->pkeys[i];
+
+        if (cpk->x509 != NULL && !ssl_compress_one_cert(ctx, cpk, algs))
+            return 0;
+    }
+
+    return 1;
+}
+
+int SSL_get_negotiated_client_cert_comp(SSL *s)
+{
+    return s->ext.client_cert_comp;
+}
+
+int SSL_get_negotiated_server_cert_comp(SSL *s)
+{
+    return s->ext.server_cert_comp;
+}
@@ -705,6 +705,8 @@ SSL *SSL_new(SSL_CTX *ctx)
     s->max_early_data = ctx->max_early_data;
     s->recv_max_early_data = ctx->recv_max_early_data;
     s->num_tickets = ctx->num_tickets;
+    memcpy(s->cert_comp_prefs, ctx->cert_comp_prefs,
+           sizeof(s->cert_comp_prefs));
     s->pha_enabled = ctx->pha_enabled;
 
     /* Shallow copy of the ciphersuites stack */
@@ -1217,6 +1219,7 @@ void SSL_free(SSL *s)
     sk_X509_EXTENSION_pop_free(s->ext.ocsp.exts, X509_EXTENSION_free);
 #ifndef OPENSSL_NO_OCSP
     sk_OCSP_RESPID_pop_free(s->ext.ocsp.ids, OCSP_RESPID_free);
+    ssl_ocsp_staple_free(s->ext.ocsp.staple);
 #endif
 #ifndef OPENSSL_NO_CT
     SCT_LIST_free(s->scts);
@@ -2510,8 +2513,12 @@ long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
     case SSL_CTRL_SESS_CACHE_FULL:
         return tsan_load(&ctx->stats.sess_cache_full);
     case SSL_CTRL_MODE:
+        if ((larg & ~ctx->mode & SSL_MODE_NO_AUTO_CHAIN) != 0)
+            ssl_cert_clear_comp_shared_chain(ctx->cert);
         return (ctx->mode |= larg);
     case SSL_CTRL_CLEAR_MODE:
+        if ((larg & ctx->mode & SSL_MODE_NO_AUTO_CHAIN) != 0)
+            ssl_cert_clear_comp_shared_chain(ctx->cert);
         return (ctx->mode &= ~larg);
     case SSL_CTRL_SET_MAX_SEND_FRAGMENT:
         if (larg < 512 || larg > SSL3_RT_MAX_PLAIN_LENGTH)
@@ -3171,6 +3178,10 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
     if (ret->ctlog_store == NULL)
         goto err;
 #endif
+#ifndef OPENSSL_NO_OCSP
+    if ((ret->ocsp_staples = ssl_ocsp_staple_cache_new()) == NULL)
+        goto err2;
+#endif
 
     /* initialize cipher/digest methods table */
     if (!ssl_load_ciphers(ret))
@@ -3409,6 +3420,10 @@ void SSL_CTX_free(SSL_CTX *a)
     OPENSSL_free(a->group_list);
 
     OPENSSL_free(a->sigalg_lookup_cache);
+    ssl_anti_replay_free(a->anti_replay);
+#ifndef OPENSSL_NO_OCSP
+    ssl_ocsp_staple_cache_free(a->ocsp_staples);
+#endif
 
     CRYPTO_THREAD_lock_free(a->lock);
 
@@ -3649,8 +3664,8 @@ void ssl_update_cache(SSL *s, int mode)
          * normally don't do this because by default it's a full stateless ticket
          * with only a dummy session id so there is no reason to cache it,
          * unless:
-         * - we are doing early_data, in which case we cache so that we can
-         *   detect replays
+         * - we are doing early_data without an anti-replay cache, in which
+         *   case we cache so that we can detect replays
          * - the application has set a remove_session_cb so needs to know about
          *   session timeout events
          * - SSL_OP_NO_TICKET is set in which case it is a stateful ticket
@@ -3658,8 +3673,7 @@ void ssl_update_cache(SSL *s, int mode)
         if ((i & SSL_SESS_CACHE_NO_INTERNAL_STORE) == 0
                 && (!SSL_IS_TLS13(s)
                     || !s->server
-                    || (s->max_early_data > 0
-                        && (s->options & SSL_OP_NO_ANTI_REPLAY) == 0)
+                    || SSL_EARLY_DATA_NEEDS_STATEFUL_TICKETS(s)
                     || s->session_ctx->remove_session_cb != NULL
                     || (s->options & SSL_OP_NO_TICKET) != 0))
             SSL_CTX_add_session(s->session_ctx, s->session);
@@ -4451,6 +4465,8 @@ void SSL_CTX_set_cert_store(SSL_CTX *ctx, X509_STORE *store)
 {
     X509_STORE_free(ctx->cert_store);
     ctx->cert_store = store;
+    /* Chains may be built from this store */
+    ssl_cert_clear_comp_shared_chain(ctx->cert);
 }
 
 void SSL_CTX_set1_cert_store(SSL_CTX *ctx, X509_STORE *store)
@@ -5371,6 +5387,94 @@ int SSL_client_hello_get0_ext(SSL *s, unsigned int type, const unsigned char **o
     return 0;
 }
 
+SSL_CLIENT_HELLO_INFO *SSL_CLIENT_HELLO_INFO_new(void)
+{
+    SSL_CLIENT_HELLO_INFO *info = OPENSSL_zalloc(sizeof(*info));
+
+    if (info == NULL)
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+    return info;
+}
+
+void SSL_CLIENT_HELLO_INFO_free(SSL_CLIENT_HELLO_INFO *info)
+{
+    OPENSSL_free(info);
+}
+
+unsigned int
+SSL_client_hello_info_get0_legacy_version(const SSL_CLIENT_HELLO_INFO *info)
+{
+    return info->legacy_version;
+}
+
+size_t SSL_client_hello_info_get0_random(const SSL_CLIENT_HELLO_INFO *info,
+                                         const unsigned char **out)
+{
+    if (info->random == NULL)
+        return 0;
+    if (out != NULL)
+        *out = info->random;
+    return SSL3_RANDOM_SIZE;
+}
+
+size_t SSL_client_hello_info_get0_session_id(const SSL_CLIENT_HELLO_INFO *info,
+                                             const unsigned char **out)
+{
+    if (out != NULL)
+        *out = info->session_id;
+    return info->session_id_len;
+}
+
+size_t SSL_client_hello_info_get0_ciphers(const SSL_CLIENT_HELLO_INFO *info,
+                                          const unsigned char **out)
+{
+    if (out != NULL)
+        *out = info->ciphers;
+    return info->ciphers_len;
+}
+
+size_t
+SSL_client_hello_info_get0_compression_methods(const SSL_CLIENT_HELLO_INFO *info,
+                                               const unsigned char **out)
+{
+    if (out != NULL)
+        *out = info->compression_methods;
+    return info->compression_methods_len;
+}
+
+size_t SSL_client_hello_info_get0_extensions(const SSL_CLIENT_HELLO_INFO *info,
+                                             const unsigned char **out)
+{
+    if (out != NULL)
+        *out = info->extensions;
+    return info->extensions_len;
+}
+
+size_t SSL_client_hello_info_get0_servername(const SSL_CLIENT_HELLO_INFO *info,
+                                             const unsigned char **out)
+{
+    if (out != NULL)
+        *out = info->servername;
+    return info->servername_len;
+}
+
+size_t SSL_client_hello_info_get0_alpn(const SSL_CLIENT_HELLO_INFO *info,
+                                       const unsigned char **out)
+{
+    if (out != NULL)
+        *out = info->alpn;
+    return info->alpn_len;
+}
+
+size_t
+SSL_client_hello_info_get0_supported_versions(const SSL_CLIENT_HELLO_INFO *info,
+                                              const unsigned char **out)
+{
+    if (out != NULL)
+        *out = info->supported_versions;
+    return info->supported_versions_len;
+}
+
 int SSL_free_buffers(SSL *ssl)
 {
     RECORD_LAYER *rl = &ssl->rlayer;
@@ -480,6 +480,7 @@ struct ssl_cipher_st {
     uint32_t algorithm2;        /* Extra flags */
     int32_t strength_bits;      /* Number of bits really used */
     uint32_t alg_bits;          /* Number of bits for algorithm */
+    uint32_t table_idx;         /* Dense index set by ssl_sort_cipher_list() */
 };
 
 /* Used to hold SSL/TLS functions */
@@ -697,6 +698,16 @@ typedef enum {
  */
 # define TICKET_AGE_ALLOWANCE   (10 * 1000)
 
+/*
+ * True if a TLSv1.3 server detects early data replays through single use of
+ * stateful tickets held in the session cache. This is the case if early data
+ * is enabled with anti-replay protection, but no anti-replay cache is set.
+ */
+# define SSL_EARLY_DATA_NEEDS_STATEFUL_TICKETS(s) \
+    ((s)->max_early_data > 0 \
+     && ((s)->options & SSL_OP_NO_ANTI_REPLAY) == 0 \
+     && (s)->session_ctx->anti_replay == NULL)
+
 #define MAX_COMPRESSIONS_SIZE   255
 
 struct ssl_comp_st {
@@ -734,6 +745,29 @@ typedef struct {
     RAW_EXTENSION *pre_proc_exts;
 } CLIENTHELLO_MSG;
 
+/*
+ * The result of SSL_client_hello_parse(), all pointers refer into the
+ * buffer that was parsed
+ */
+struct ssl_client_hello_info_st {
+    unsigned int legacy_version;
+    const unsigned char *random;
+    const unsigned char *session_id;
+    size_t session_id_len;
+    const unsigned char *ciphers;
+    size_t ciphers_len;
+    const unsigned char *compression_methods;
+    size_t compression_methods_len;
+    const unsigned char *extensions;
+    size_t extensions_len;
+    const unsigned char *servername;
+    size_t servername_len;
+    const unsigned char *alpn;
+    size_t alpn_len;
+    const unsigned char *supported_versions;
+    size_t supported_versions_len;
+};
+
 /*
  * Extension index values NOTE: Any updates to these defines should be mirrored
  * with equivalent updates to ext_defs in extensions.c
@@ -763,6 +797,7 @@ typedef enum tlsext_index_en {
     TLSEXT_IDX_cryptopro_bug,
     TLSEXT_IDX_early_data,
     TLSEXT_IDX_certificate_authorities,
+    TLSEXT_IDX_compress_certificate,
     TLSEXT_IDX_padding,
     TLSEXT_IDX_psk,
     /* Dummy index - must always be the last entry */
@@ -832,6 +867,12 @@ typedef struct tls_group_info_st {
 
 # define TLS_GROUP_FFDHE_FOR_TLS1_3 (TLS_GROUP_FFDHE|TLS_GROUP_ONLY_FOR_TLS1_3)
 
+typedef struct ssl_anti_replay_st SSL_ANTI_REPLAY;
+typedef struct ssl_ocsp_staple_cache_st SSL_OCSP_STAPLE_CACHE;
+
+/* Size of the SSL_CTX sigalg hash index, must be a power of 2 */
+# define SSL_SIGALG_INDEX_SIZE  64
+
 struct ssl_ctx_st {
     OSSL_LIB_CTX *libctx;
 
@@ -1153,6 +1194,15 @@ struct ssl_ctx_st {
      */
     uint32_t recv_max_early_data;
 
+    /*
+     * Early data anti-replay cache for use with stateless tickets, or NULL if
+     * replays are detected through single use of stateful tickets.
+     */
+    SSL_ANTI_REPLAY *anti_replay;
+
+    /* Built-in OCSP stapling, with a response per certificate */
+    SSL_OCSP_STAPLE_CACHE *ocsp_staples;
+
     /* TLS1.3 padding callback */
     size_t (*record_padding_cb)(SSL *s, int type, size_t len, void *arg);
     void *record_padding_arg;
@@ -1177,6 +1227,12 @@ struct ssl_ctx_st {
     SSL_async_callback_fn async_cb;
     void *async_cb_arg;
 
+    /*
+     * Certificate compression algorithms (RFC8879) in order of preference,
+     * terminated by TLSEXT_comp_cert_none.
+     */
+    int cert_comp_prefs[TLSEXT_comp_cert_limit];
+
     char *propq;
 
     const EVP_CIPHER *ssl_cipher_methods[SSL_ENC_NUM_IDX];
@@ -1185,6 +1241,12 @@ struct ssl_ctx_st {
 
     /* Cache of all sigalgs we know and whether they are available or not */
     struct sigalg_lookup_st *sigalg_lookup_cache;
+    /*
+     * Open addressing hash index into sigalg_lookup_cache keyed by the
+     * sigalg code point. Each entry is the cache index plus one, or 0 if
+     * empty.
+     */
+    unsigned char sigalg_lookup_index[SSL_SIGALG_INDEX_SIZE];
 
     TLS_GROUP_INFO *group_list;
     size_t group_list_len;
@@ -1199,6 +1261,29 @@ struct ssl_ctx_st {
 
 typedef struct cert_pkey_st CERT_PKEY;
 
+/*
+ * A compressed TLSv1.3 Certificate message body (RFC8879), shared by
+ * reference between the CERT_PKEY of an SSL_CTX and those of its SSLs.
+ */
+typedef struct ossl_comp_cert_st {
+    unsigned char *data;
+    size_t len;
+    size_t orig_len;
+    int alg;
+    CRYPTO_REF_COUNT references;
+    CRYPTO_RWLOCK *lock;
+} OSSL_COMP_CERT;
+
+/* A DER encoded OCSP response to staple, shared between connections */
+typedef struct ssl_ocsp_staple_st {
+    X509 *cert;                 /* The certificate it is about */
+    unsigned char *der;
+    size_t der_len;
+    time_t expires;             /* Its nextUpdate, or 0 if it has none */
+    CRYPTO_REF_COUNT references;
+    CRYPTO_RWLOCK *lock;
+} SSL_OCSP_STAPLE;
+
 struct ssl_st {
     /*
      * protocol version (one of SSL2_VERSION, SSL3_VERSION, TLS1_VERSION,
@@ -1585,6 +1670,8 @@ struct ssl_st {
             /* OCSP response received or to be sent */
             unsigned char *resp;
             size_t resp_len;
+            /* Response from the SSL_CTX staple cache to be sent instead */
+            SSL_OCSP_STAPLE *staple;
         } ocsp;
 
         /* RFC4507 session ticket expected to be received or sent */
@@ -1640,6 +1727,12 @@ struct ssl_st {
         int early_data;
         /* Is the session suitable for early data? */
         int early_data_ok;
+        /*
+         * The binder of the stateless ticket we selected, if early data
+         * using it has to be checked against the anti-replay cache.
+         */
+        unsigned char replay_binder[EVP_MAX_MD_SIZE];
+        size_t replay_binder_len;
 
         /* May be sent by a server in HRR. Must be echoed back in ClientHello */
         unsigned char *tls13_cookie;
@@ -1664,6 +1757,18 @@ struct ssl_st {
          * selected.
          */
         int tick_identity;
+
+        /*
+         * The algorithm to compress our own Certificate message with, chosen
+         * from those the peer advertised, or TLSEXT_comp_cert_none.
+         */
+        int compress_certificate_from_peer;
+        /*
+         * The certificate compression algorithm used for the server and the
+         * client Certificate messages, or TLSEXT_comp_cert_none.
+         */
+        int server_cert_comp;
+        int client_cert_comp;
     } ext;
 
     /*
@@ -1777,6 +1882,9 @@ struct ssl_st {
     SSL_async_callback_fn async_cb;
     void *async_cb_arg;
 
+    /* Certificate compression algorithms (RFC8879) in order of preference */
+    int cert_comp_prefs[TLSEXT_comp_cert_limit];
+
     /*
      * Signature algorithms shared by client and server: cached because these
      * are used most often.
@@ -1944,6 +2052,11 @@ struct cert_pkey_st {
      */
     unsigned char *serverinfo;
     size_t serverinfo_length;
+    /*
+     * Pre-compressed TLSv1.3 Certificate message bodies, indexed by RFC8879
+     * algorithm. See SSL_CTX_compress_certs().
+     */
+    OSSL_COMP_CERT *comp_cert[TLSEXT_comp_cert_limit];
 };
 /* Retrieve Suite B flags */
 # define tls1_suiteb(s)  (s->cert->cert_flags & SSL_CERT_FLAG_SUITEB_128_LOS)
@@ -2375,6 +2488,8 @@ __owur CERT *ssl_cert_new(void);
 __owur CERT *ssl_cert_dup(CERT *cert);
 void ssl_cert_clear_certs(CERT *c);
 void ssl_cert_free(CERT *c);
+void ssl_cert_pkey_clear_comp(CERT_PKEY *cpk);
+void ssl_cert_clear_comp_shared_chain(CERT *c);
 __owur int ssl_generate_session_id(SSL *s, SSL_SESSION *ss);
 __owur int ssl_get_new_session(SSL *s, int session);
 __owur SSL_SESSION *lookup_sess_in_cache(SSL *s, const unsigned char *sess_id,
@@ -2747,6 +2862,33 @@ __owur int ssl_log_secret(SSL *ssl, const char *label,
 #define EARLY_EXPORTER_SECRET_LABEL "EARLY_EXPORTER_SECRET"
 #define EXPORTER_SECRET_LABEL "EXPORTER_SECRET"
 
+/* ssl_cert_comp.c */
+/* Upper bound on the compressed size of |len| bytes of certificate data */
+# define SSL_CERT_COMP_MAX_LEN(len)      ((len) + ((len) >> 8) + 64)
+__owur int ssl_cert_comp_supported(int alg);
+__owur int ssl_cert_comp_compress(int alg, const unsigned char *in,
+                                  size_t inlen, unsigned char *out,
+                                  size_t *outlen);
+__owur OSSL_COMP_CERT *ssl_comp_cert_new(int alg, const unsigned char *in,
+                                         size_t inlen);
+__owur int ssl_comp_cert_up_ref(OSSL_COMP_CERT *cc);
+void ssl_comp_cert_free(OSSL_COMP_CERT *cc);
+__owur int ssl_cert_comp_expand(int alg, const unsigned char *in, size_t inlen,
+                                unsigned char *out, size_t outlen);
+
+/* ssl_antireplay.c */
+__owur int ssl_anti_replay_check(SSL_ANTI_REPLAY *ar,
+                                 const unsigned char *binder, size_t len);
+void ssl_anti_replay_free(SSL_ANTI_REPLAY *ar);
+
+#  ifndef OPENSSL_NO_OCSP
+/* ssl_staple.c */
+__owur SSL_OCSP_STAPLE *ssl_ocsp_staple_get(SSL_CTX *ctx, X509 *x);
+void ssl_ocsp_staple_free(SSL_OCSP_STAPLE *staple);
+SSL_OCSP_STAPLE_CACHE *ssl_ocsp_staple_cache_new(void);
+void ssl_ocsp_staple_cache_free(SSL_OCSP_STAPLE_CACHE *c);
+#  endif
+
 #  ifndef OPENSSL_NO_KTLS
 /* ktls.c */
 int ktls_check_supported_cipher(const SSL *s, const EVP_CIPHER *c,
@@ -269,6 +269,7 @@ static int ssl_set_cert(CERT *c, X509 *x)
     X509_free(c->pkeys[i].x509);
     X509_up_ref(x);
     c->pkeys[i].x509 = x;
+    ssl_cert_pkey_clear_comp(&c->pkeys[i]);
     c->key = &(c->pkeys[i]);
 
     return 1;
@@ -957,6 +958,7 @@ static int ssl_set_cert_and_key(SSL *ssl, SSL_CTX *ctx, X509 *x509, EVP_PKEY *pr
     X509_free(c->pkeys[i].x509);
     X509_up_ref(x509);
     c->pkeys[i].x509 = x509;
+    ssl_cert_pkey_clear_comp(&c->pkeys[i]);
 
     EVP_PKEY_free(c->pkeys[i].privatekey);
     EVP_PKEY_up_ref(privatekey);
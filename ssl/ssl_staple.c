@@ -0,0 +1,670 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Built-in OCSP stapling for servers.
+ *
+ * The SSL_CTX keeps the OCSP response for each of its certificates, DER
+ * encoded, in a reference counted SSL_OCSP_STAPLE.  A handshake that needs it
+ * only takes a reference, so stapling costs no allocation or copy per
+ * handshake.
+ *
+ * When a responder is configured, a new response is fetched halfway through
+ * the validity period of the current one.  The fetch is a non-blocking HTTP
+ * exchange, which is advanced a step at a time by the handshakes that happen
+ * in the meantime or by SSL_CTX_refresh_ocsp_staple().  Only one thread at a
+ * time owns the fetch of a certificate and it advances it without holding the
+ * cache lock, so that the other handshakes never wait for the responder or
+ * for the hostname lookup: until the fetch completes, they keep getting the
+ * current response.
+ */
+
+#include <time.h>
+#include <openssl/ocsp.h>
+#include <openssl/http.h>
+#include "ssl_local.h"
+
+#ifndef OPENSSL_NO_OCSP
+
+/* Seconds to wait before retrying after a failed fetch */
+# define OCSP_STAPLE_RETRY_DELAY    60
+/* Seconds after which a fetch in progress is abandoned */
+# define OCSP_STAPLE_FETCH_TIMEOUT  30
+/* Seconds between fetches when the response has no nextUpdate */
+# define OCSP_STAPLE_NO_NEXT_UPDATE 3600
+/* Tolerated clock skew in seconds when checking thisUpdate */
+# define OCSP_STAPLE_MAX_SKEW       300
+
+/* The response for the certificate at the same index in the CERT */
+typedef struct ocsp_staple_entry_st {
+    SSL_OCSP_STAPLE *staple;    /* The current response, or NULL */
+    time_t refresh_at;          /* When to start fetching a new response */
+    int fetching;               /* Whether a thread is advancing the fetch */
+    /* The fetch in progress, if rctx != NULL */
+    OSSL_HTTP_REQ_CTX *rctx;
+    BIO *bio;
+    X509 *cert;
+    X509 *issuer;
+    time_t fetch_start;
+} OCSP_STAPLE_ENTRY;
+
+struct ssl_ocsp_staple_cache_st {
+    CRYPTO_RWLOCK *lock;
+    int fetch;                  /* Whether to fetch responses */
+    char *responder;            /* NULL to use the one of the certificate */
+    /* Changed when the responder is, to discard the fetches in progress */
+    unsigned int generation;
+    OCSP_STAPLE_ENTRY entries[SSL_PKEY_NUM];
+};
+
+void ssl_ocsp_staple_free(SSL_OCSP_STAPLE *staple)
+{
+    int i;
+
+    if (staple == NULL)
+        return;
+
+    CRYPTO_DOWN_REF(&staple->references, &i, staple->lock);
+    REF_PRINT_COUNT("SSL_OCSP_STAPLE", staple);
+    if (i > 0)
+        return;
+    REF_ASSERT_ISNT(i < 0);
+
+    X509_free(staple->cert);
+    OPENSSL_free(staple->der);
+    CRYPTO_THREAD_lock_free(staple->lock);
+    OPENSSL_free(staple);
+}
+
+static int ocsp_staple_up_ref(SSL_OCSP_STAPLE *staple)
+{
+    int i;
+
+    if (CRYPTO_UP_REF(&staple->references, &i, staple->lock) <= 0)
+        return 0;
+
+    REF_PRINT_COUNT("SSL_OCSP_STAPLE", staple);
+    REF_ASSERT_ISNT(i < 2);
+    return i > 1 ? 1 : 0;
+}
+
+static void ocsp_fetch_end(OCSP_STAPLE_ENTRY *e)
+{
+    OSSL_HTTP_REQ_CTX_free(e->rctx);
+    BIO_free_all(e->bio);
+    X509_free(e->cert);
+    X509_free(e->issuer);
+    e->rctx = NULL;
+    e->bio = NULL;
+    e->cert = NULL;
+    e->issuer = NULL;
+}
+
+SSL_OCSP_STAPLE_CACHE *ssl_ocsp_staple_cache_new(void)
+{
+    SSL_OCSP_STAPLE_CACHE *c;
+
+    if ((c = OPENSSL_zalloc(sizeof(*c))) == NULL
+            || (c->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        OPENSSL_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+void ssl_ocsp_staple_cache_free(SSL_OCSP_STAPLE_CACHE *c)
+{
+    size_t i;
+
+    if (c == NULL)
+        return;
+
+    for (i = 0; i < SSL_PKEY_NUM; i++) {
+        ocsp_fetch_end(&c->entries[i]);
+        ssl_ocsp_staple_free(c->entries[i].staple);
+    }
+    OPENSSL_free(c->responder);
+    CRYPTO_THREAD_lock_free(c->lock);
+    OPENSSL_free(c);
+}
+
+/* The index of |x| in the CERT of |ctx|, or -1 if it is not there */
+static int ocsp_cert_index(SSL_CTX *ctx, X509 *x)
+{
+    int i;
+
+    for (i = 0; i < SSL_PKEY_NUM; i++) {
+        if (ctx->cert->pkeys[i].x509 == x)
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * Returns a new reference to the issuer of the certificate of |cpk|, or NULL
+ * if not found
+ */
+static X509 *ocsp_find_issuer(SSL_CTX *ctx, CERT_PKEY *cpk)
+{
+    STACK_OF(X509) *chains[2];
+    X509_STORE_CTX *sctx;
+    X509 *x = cpk->x509;
+    X509 *issuer = NULL;
+    int i, j;
+
+    chains[0] = cpk->chain;
+    chains[1] = ctx->extra_certs;
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < sk_X509_num(chains[i]); j++) {
+            issuer = sk_X509_value(chains[i], j);
+            if (X509_check_issued(issuer, x) == X509_V_OK)
+                return X509_up_ref(issuer) ? issuer : NULL;
+        }
+    }
+
+    issuer = NULL;
+    if (ctx->cert_store != NULL
+            && (sctx = X509_STORE_CTX_new_ex(ctx->libctx,
+                                             ctx->propq)) != NULL) {
+        if (X509_STORE_CTX_init(sctx, ctx->cert_store, x, NULL)
+                && X509_STORE_CTX_get1_issuer(&issuer, sctx, x) <= 0)
+            issuer = NULL;
+        X509_STORE_CTX_free(sctx);
+    }
+    if (issuer == NULL)
+        ERR_raise(ERR_LIB_SSL, SSL_R_NO_ISSUER_CERTIFICATE);
+    return issuer;
+}
+
+/* The id of |x| in OCSP requests and responses */
+static OCSP_CERTID *ocsp_cert_to_id(SSL_CTX *ctx, X509 *x, X509 *issuer)
+{
+    const EVP_MD *sha1 = ssl_evp_md_fetch(ctx->libctx, NID_sha1, ctx->propq);
+    OCSP_CERTID *id;
+
+    if (sha1 == NULL)
+        return NULL;
+    id = OCSP_cert_to_id(sha1, x, issuer);
+    ssl_evp_md_free(sha1);
+    return id;
+}
+
+/* Seconds from now until |t|, which may be negative */
+static int ocsp_time_from_now(const ASN1_TIME *t, time_t *secs)
+{
+    int days, s;
+
+    if (!ASN1_TIME_diff(&days, &s, NULL, t))
+        return 0;
+    *secs = (time_t)days * 24 * 3600 + s;
+    return 1;
+}
+
+/*
+ * Check that |der| is a currently valid OCSP response about |cert| issued by
+ * |issuer|, signed by the issuer or by a responder it has authorised.
+ * Returns it as a new SSL_OCSP_STAPLE, and sets |*refresh_at| to the time at
+ * which a newer one should be fetched.
+ */
+static SSL_OCSP_STAPLE *ocsp_staple_new(SSL_CTX *ctx,
+                                        const unsigned char *der,
+                                        size_t der_len, X509 *cert,
+                                        X509 *issuer, time_t *refresh_at)
+{
+    SSL_OCSP_STAPLE *staple = NULL;
+    const unsigned char *p = der;
+    OCSP_RESPONSE *resp = NULL;
+    OCSP_BASICRESP *bs = NULL;
+    OCSP_CERTID *id = NULL;
+    STACK_OF(X509) *certs = NULL;
+    X509_STORE *store = NULL;
+    X509 *signer;
+    ASN1_GENERALIZEDTIME *thisupd, *nextupd;
+    time_t now = time(NULL), left, validity;
+    int status, reason;
+
+    if (der_len > LONG_MAX
+            || (resp = d2i_OCSP_RESPONSE(NULL, &p, (long)der_len)) == NULL
+            || OCSP_response_status(resp) != OCSP_RESPONSE_STATUS_SUCCESSFUL
+            || (bs = OCSP_response_get1_basic(resp)) == NULL) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_STATUS_RESPONSE);
+        goto end;
+    }
+
+    /*
+     * The issuer is the trust anchor: either it signed the response itself,
+     * or it issued the certificate of the responder that did.
+     */
+    if ((certs = sk_X509_new_null()) == NULL
+            || !sk_X509_push(certs, issuer)
+            || (store = X509_STORE_new()) == NULL
+            || !X509_STORE_add_cert(store, issuer)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        goto end;
+    }
+    /*
+     * OCSP_basic_verify() would check the signature in the default library
+     * context, so it is checked here and OCSP_basic_verify() only checks
+     * that the signer is allowed to sign the response.
+     */
+    if (!OCSP_resp_get0_signer(bs, &signer, certs)
+            || ASN1_item_verify_ex(ASN1_ITEM_rptr(OCSP_RESPDATA),
+                                   OCSP_resp_get0_tbs_sigalg(bs),
+                                   OCSP_resp_get0_signature(bs),
+                                   OCSP_resp_get0_respdata(bs), NULL,
+                                   X509_get0_pubkey(signer), ctx->libctx,
+                                   ctx->propq) <= 0
+            || OCSP_basic_verify(bs, certs, store,
+                                 OCSP_TRUSTOTHER | OCSP_PARTIAL_CHAIN
+                                 | OCSP_NOSIGS) <= 0
+            || (id = ocsp_cert_to_id(ctx, cert, issuer)) == NULL
+            || !OCSP_resp_find_status(bs, id, &status, &reason, NULL,
+                                      &thisupd, &nextupd)
+            || !OCSP_check_validity(thisupd, nextupd, OCSP_STAPLE_MAX_SKEW,
+                                    -1)) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_STATUS_RESPONSE);
+        goto end;
+    }
+
+    if ((staple = OPENSSL_zalloc(sizeof(*staple))) == NULL
+            || (staple->lock = CRYPTO_THREAD_lock_new()) == NULL
+            || (staple->der = OPENSSL_memdup(der, der_len)) == NULL
+            || !X509_up_ref(cert)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        if (staple != NULL) {
+            CRYPTO_THREAD_lock_free(staple->lock);
+            OPENSSL_free(staple->der);
+            OPENSSL_free(staple);
+        }
+        staple = NULL;
+        goto end;
+    }
+    staple->cert = cert;
+    staple->der_len = der_len;
+    staple->references = 1;
+
+    /* Fetch a new response halfway through the validity period */
+    if (nextupd == NULL) {
+        *refresh_at = now + OCSP_STAPLE_NO_NEXT_UPDATE;
+    } else if (ocsp_time_from_now(nextupd, &left)
+               && ocsp_time_from_now(thisupd, &validity)) {
+        staple->expires = now + left;
+        validity = left - validity;
+        *refresh_at = now + left - validity / 2;
+    } else {
+        *refresh_at = now;
+    }
+    /* Don't hammer a responder that keeps sending old responses */
+    if (*refresh_at < now + OCSP_STAPLE_RETRY_DELAY)
+        *refresh_at = now + OCSP_STAPLE_RETRY_DELAY;
+
+ end:
+    OCSP_CERTID_free(id);
+    X509_STORE_free(store);
+    sk_X509_free(certs);
+    OCSP_BASICRESP_free(bs);
+    OCSP_RESPONSE_free(resp);
+    return staple;
+}
+
+/* Must be called with the cache write lock held */
+static void ocsp_staple_install(OCSP_STAPLE_ENTRY *e, SSL_OCSP_STAPLE *staple,
+                                time_t refresh_at)
+{
+    ssl_ocsp_staple_free(e->staple);
+    e->staple = staple;
+    e->refresh_at = refresh_at;
+}
+
+# ifndef OPENSSL_NO_SOCK
+/*
+ * Prepare the fetch of a new response for the certificate of |cpk| from
+ * |responder|, or from the responder of the certificate if NULL.  This does no
+ * network I/O, the connection is only made by ocsp_fetch_step().  Must be
+ * called by the thread that owns the fetch, without the lock held, as the
+ * issuer may be looked up in a store.
+ */
+static int ocsp_fetch_start(SSL_CTX *ctx, CERT_PKEY *cpk,
+                            OCSP_STAPLE_ENTRY *e, const char *responder,
+                            time_t now)
+{
+    STACK_OF(OPENSSL_STRING) *aia = NULL;
+    const char *url = responder;
+    char *host = NULL, *port = NULL, *path = NULL;
+    OCSP_REQUEST *req = NULL;
+    OCSP_CERTID *id = NULL;
+    int use_ssl, ret = 0;
+
+    if ((e->cert = cpk->x509) == NULL) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_NO_CERTIFICATE_ASSIGNED);
+        return 0;
+    }
+    if (!X509_up_ref(e->cert)) {
+        e->cert = NULL;
+        return 0;
+    }
+    if ((e->issuer = ocsp_find_issuer(ctx, cpk)) == NULL)
+        goto end;
+
+    if (url == NULL) {
+        aia = X509_get1_ocsp(e->cert);
+        url = sk_OPENSSL_STRING_value(aia, 0);
+        if (url == NULL) {
+            ERR_raise(ERR_LIB_SSL, SSL_R_NO_OCSP_RESPONDER);
+            goto end;
+        }
+    }
+    if (!OSSL_HTTP_parse_url(url, &host, &port, NULL, &path, &use_ssl))
+        goto end;
+    if (use_ssl) {
+        ERR_raise_data(ERR_LIB_SSL, ERR_R_UNSUPPORTED,
+                       "OCSP responder over HTTPS: %s", url);
+        goto end;
+    }
+
+    if ((req = OCSP_REQUEST_new()) == NULL
+            || (id = ocsp_cert_to_id(ctx, e->cert, e->issuer)) == NULL
+            || OCSP_request_add0_id(req, id) == NULL)
+        goto end;
+    id = NULL;
+
+    if ((e->bio = BIO_new_connect(host)) == NULL
+            || BIO_set_conn_port(e->bio, port) <= 0
+            || BIO_set_nbio(e->bio, 1) <= 0
+            || (e->rctx = OSSL_HTTP_REQ_CTX_new(e->bio, e->bio, 1, -1, 0, 0,
+                                                "application/ocsp-response",
+                                                1)) == NULL
+            || !OSSL_HTTP_REQ_CTX_set_request_line(e->rctx, NULL, NULL, path)
+            || !OSSL_HTTP_REQ_CTX_add1_header(e->rctx, "Host", host)
+            || !OSSL_HTTP_REQ_CTX_i2d(e->rctx, "application/ocsp-request",
+                                      ASN1_ITEM_rptr(OCSP_REQUEST),
+                                      (ASN1_VALUE *)req))
+        goto end;
+    e->fetch_start = now;
+    ret = 1;
+
+ end:
+    if (!ret)
+        ocsp_fetch_end(e);
+    OCSP_CERTID_free(id);
+    OCSP_REQUEST_free(req);
+    OPENSSL_free(host);
+    OPENSSL_free(port);
+    OPENSSL_free(path);
+    X509_email_free(aia);
+    return ret;
+}
+
+/*
+ * Advance the fetch in progress for |e|.  Returns 1 and sets |*staple| and
+ * |*refresh_at| when a new response has been received, -1 if the fetch is
+ * still in progress or 0 on error.  Must be called by the thread that owns the
+ * fetch, without the lock held: this is where the hostname is looked up and
+ * the responder is waited for.
+ */
+static int ocsp_fetch_step(SSL_CTX *ctx, OCSP_STAPLE_ENTRY *e, time_t now,
+                           SSL_OCSP_STAPLE **staple, time_t *refresh_at)
+{
+    const unsigned char *der;
+    long der_len;
+    int rv;
+
+    rv = OSSL_HTTP_REQ_CTX_nbio(e->rctx);
+    if (rv == -1) {
+        if (now - e->fetch_start < OCSP_STAPLE_FETCH_TIMEOUT)
+            return -1;
+        ERR_raise(ERR_LIB_SSL, SSL_R_OCSP_RESPONDER_TIMEOUT);
+        return 0;
+    }
+    if (rv != 1)
+        return 0;
+
+    der_len = BIO_get_mem_data(OSSL_HTTP_REQ_CTX_get0_mem_bio(e->rctx), &der);
+    if (der_len <= 0
+            || (*staple = ocsp_staple_new(ctx, der, (size_t)der_len, e->cert,
+                                          e->issuer, refresh_at)) == NULL)
+        return 0;
+    return 1;
+}
+
+/*
+ * Advance the fetch of a new response for the certificate at index |idx|,
+ * starting one if it is due.  If |force| is set, a fetch is also started when
+ * there is no response, even before the retry delay is over.  Returns 1 when a
+ * new response has been installed, or if |force| is set and the current one
+ * is not due for renewal, -1 if the fetch is still in progress, possibly in
+ * another thread, or 0 on error or if no fetch was due.
+ */
+static int ocsp_fetch(SSL_CTX *ctx, SSL_OCSP_STAPLE_CACHE *c, int idx,
+                      time_t now, int force)
+{
+    OCSP_STAPLE_ENTRY *e = &c->entries[idx];
+    SSL_OCSP_STAPLE *staple = NULL;
+    char *responder = NULL;
+    unsigned int generation;
+    time_t refresh_at;
+    int start, rv;
+
+    /* Take ownership of the fetch */
+    if (!CRYPTO_THREAD_write_lock(c->lock))
+        return 0;
+    if (e->fetching) {
+        CRYPTO_THREAD_unlock(c->lock);
+        return -1;
+    }
+    if (!c->fetch) {
+        CRYPTO_THREAD_unlock(c->lock);
+        return 0;
+    }
+    if (e->rctx == NULL && now < e->refresh_at
+            && (!force || e->staple != NULL)) {
+        CRYPTO_THREAD_unlock(c->lock);
+        return force;
+    }
+    start = e->rctx == NULL;
+    if (start && c->responder != NULL
+            && (responder = OPENSSL_strdup(c->responder)) == NULL) {
+        CRYPTO_THREAD_unlock(c->lock);
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    e->fetching = 1;
+    generation = c->generation;
+    CRYPTO_THREAD_unlock(c->lock);
+
+    if (start && !ocsp_fetch_start(ctx, &ctx->cert->pkeys[idx], e, responder,
+                                   now))
+        rv = 0;
+    else
+        rv = ocsp_fetch_step(ctx, e, now, &staple, &refresh_at);
+    OPENSSL_free(responder);
+
+    if (!CRYPTO_THREAD_write_lock(c->lock)) {
+        /* Leave the fetch owned, so that nobody else uses it */
+        ssl_ocsp_staple_free(staple);
+        return 0;
+    }
+    e->fetching = 0;
+    if (generation != c->generation) {
+        /* The responder has changed: start over with the new one */
+        ssl_ocsp_staple_free(staple);
+        ocsp_fetch_end(e);
+        rv = 0;
+    } else if (rv == 1) {
+        ocsp_staple_install(e, staple, refresh_at);
+        ocsp_fetch_end(e);
+    } else if (rv == 0) {
+        ocsp_fetch_end(e);
+        e->refresh_at = now + OCSP_STAPLE_RETRY_DELAY;
+    }
+    CRYPTO_THREAD_unlock(c->lock);
+    return rv;
+}
+# endif
+
+/* Must be called with the lock held */
+static SSL_OCSP_STAPLE *ocsp_staple_get_locked(OCSP_STAPLE_ENTRY *e, X509 *x,
+                                               time_t now)
+{
+    SSL_OCSP_STAPLE *staple = e->staple;
+
+    if (staple == NULL || staple->cert != x
+            || (staple->expires != 0 && now >= staple->expires)
+            || !ocsp_staple_up_ref(staple))
+        return NULL;
+    return staple;
+}
+
+/*
+ * Returns a new reference to the response to staple for the certificate |x|,
+ * or NULL if there is none.  Advances the fetch of a new response if it is
+ * due and no other thread is doing so.
+ */
+SSL_OCSP_STAPLE *ssl_ocsp_staple_get(SSL_CTX *ctx, X509 *x)
+{
+    SSL_OCSP_STAPLE_CACHE *c = ctx->ocsp_staples;
+    SSL_OCSP_STAPLE *staple;
+    OCSP_STAPLE_ENTRY *e;
+    time_t now = time(NULL);
+    int idx, due;
+
+    if (c == NULL || x == NULL || (idx = ocsp_cert_index(ctx, x)) < 0
+            || !CRYPTO_THREAD_read_lock(c->lock))
+        return NULL;
+    e = &c->entries[idx];
+    staple = ocsp_staple_get_locked(e, x, now);
+    due = c->fetch && !e->fetching && now >= e->refresh_at;
+    CRYPTO_THREAD_unlock(c->lock);
+
+    if (due) {
+# ifndef OPENSSL_NO_SOCK
+        SSL_OCSP_STAPLE *newer;
+
+        /* A failed fetch is no error for the handshake */
+        ERR_set_mark();
+        if (ocsp_fetch(ctx, c, idx, now, 0) == 1
+                && CRYPTO_THREAD_read_lock(c->lock)) {
+            newer = ocsp_staple_get_locked(e, x, now);
+            CRYPTO_THREAD_unlock(c->lock);
+            if (newer != NULL) {
+                ssl_ocsp_staple_free(staple);
+                staple = newer;
+            }
+        }
+        ERR_pop_to_mark();
+# endif
+    }
+    return staple;
+}
+
+int SSL_CTX_set1_ocsp_staple(SSL_CTX *ctx, const unsigned char *resp,
+                             size_t resplen)
+{
+    SSL_OCSP_STAPLE_CACHE *c = ctx->ocsp_staples;
+    SSL_OCSP_STAPLE *staple;
+    CERT_PKEY *cpk = ctx->cert->key;
+    X509 *issuer;
+    time_t refresh_at;
+
+    if (resp == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+    if (cpk->x509 == NULL) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_NO_CERTIFICATE_ASSIGNED);
+        return 0;
+    }
+    if ((issuer = ocsp_find_issuer(ctx, cpk)) == NULL)
+        return 0;
+    staple = ocsp_staple_new(ctx, resp, resplen, cpk->x509, issuer,
+                             &refresh_at);
+    X509_free(issuer);
+    if (staple == NULL)
+        return 0;
+
+    if (!CRYPTO_THREAD_write_lock(c->lock)) {
+        ssl_ocsp_staple_free(staple);
+        return 0;
+    }
+    ocsp_staple_install(&c->entries[cpk - ctx->cert->pkeys], staple,
+                        refresh_at);
+    CRYPTO_THREAD_unlock(c->lock);
+    return 1;
+}
+
+int SSL_CTX_set_ocsp_staple_responder(SSL_CTX *ctx, const char *url)
+{
+# ifndef OPENSSL_NO_SOCK
+    SSL_OCSP_STAPLE_CACHE *c = ctx->ocsp_staples;
+    char *responder = NULL;
+    size_t i;
+
+    if (url != NULL && (responder = OPENSSL_strdup(url)) == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    if (!CRYPTO_THREAD_write_lock(c->lock)) {
+        OPENSSL_free(responder);
+        return 0;
+    }
+    OPENSSL_free(c->responder);
+    c->responder = responder;
+    c->fetch = 1;
+    /* Start over with the new responder */
+    c->generation++;
+    for (i = 0; i < SSL_PKEY_NUM; i++) {
+        if (!c->entries[i].fetching)
+            ocsp_fetch_end(&c->entries[i]);
+        c->entries[i].refresh_at = 0;
+    }
+    CRYPTO_THREAD_unlock(c->lock);
+    return 1;
+# else
+    ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+    return 0;
+# endif
+}
+
+int SSL_CTX_refresh_ocsp_staple(SSL_CTX *ctx)
+{
+# ifndef OPENSSL_NO_SOCK
+    SSL_OCSP_STAPLE_CACHE *c = ctx->ocsp_staples;
+    int i, rv, fetch, ret = 1, found = 0;
+
+    if (!CRYPTO_THREAD_read_lock(c->lock))
+        return 0;
+    fetch = c->fetch;
+    CRYPTO_THREAD_unlock(c->lock);
+    if (!fetch) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_NO_OCSP_RESPONDER);
+        return 0;
+    }
+    for (i = 0; i < SSL_PKEY_NUM; i++) {
+        if (ctx->cert->pkeys[i].x509 == NULL)
+            continue;
+        found = 1;
+        rv = ocsp_fetch(ctx, c, i, time(NULL), 1);
+        if (rv == 0)
+            ret = 0;
+        else if (rv == -1 && ret == 1)
+            ret = -1;
+    }
+    if (!found) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_NO_CERTIFICATE_ASSIGNED);
+        return 0;
+    }
+    return ret;
+# else
+    ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+    return 0;
+# endif
+}
+
+#endif
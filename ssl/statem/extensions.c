@@ -37,6 +37,14 @@ static EXT_RETURN tls_construct_certificate_authorities(SSL *s, WPACKET *pkt,
 static int tls_parse_certificate_authorities(SSL *s, PACKET *pkt,
                                              unsigned int context, X509 *x,
                                              size_t chainidx);
+static int init_compress_certificate(SSL *s, unsigned int context);
+static EXT_RETURN tls_construct_compress_certificate(SSL *s, WPACKET *pkt,
+                                                     unsigned int context,
+                                                     X509 *x,
+                                                     size_t chainidx);
+static int tls_parse_compress_certificate(SSL *s, PACKET *pkt,
+                                          unsigned int context, X509 *x,
+                                          size_t chainidx);
 #ifndef OPENSSL_NO_SRP
 static int init_srp(SSL *s, unsigned int context);
 #endif
@@ -362,6 +370,15 @@ static const EXTENSION_DEFINITION ext_defs[] = {
         tls_construct_certificate_authorities,
         tls_construct_certificate_authorities, NULL,
     },
+    {
+        TLSEXT_TYPE_compress_certificate,
+        SSL_EXT_CLIENT_HELLO | SSL_EXT_TLS1_3_CERTIFICATE_REQUEST
+        | SSL_EXT_TLS1_3_ONLY,
+        init_compress_certificate,
+        tls_parse_compress_certificate, tls_parse_compress_certificate,
+        tls_construct_compress_certificate,
+        tls_construct_compress_certificate, NULL
+    },
     {
         /* Must be immediately before pre_shared_key */
         TLSEXT_TYPE_padding,
@@ -523,6 +540,17 @@ int extension_is_relevant(SSL *s, unsigned int extctx, unsigned int thisctx)
     return 1;
 }
 
+/*
+ * Read the next extension from the extensions block |exts| into |*type| and
+ * |*data|. Returns 1 on success or 0 if the block is malformed.
+ */
+static ossl_inline int extension_block_next(PACKET *exts, unsigned int *type,
+                                            PACKET *data)
+{
+    return PACKET_get_net_2(exts, type)
+           && PACKET_get_length_prefixed_2(exts, data);
+}
+
 /*
  * Gather a list of all the extensions from the data in |packet]. |context|
  * tells us which message this extension is for. The raw extension data is
@@ -571,8 +599,7 @@ int tls_collect_extensions(SSL *s, PACKET *packet, unsigned int context,
         PACKET extension;
         RAW_EXTENSION *thisex;
 
-        if (!PACKET_get_net_2(&extensions, &type) ||
-            !PACKET_get_length_prefixed_2(&extensions, &extension)) {
+        if (!extension_block_next(&extensions, &type, &extension)) {
             SSLfatal(s, SSL_AD_DECODE_ERROR, SSL_R_BAD_EXTENSION);
             goto err;
         }
@@ -660,6 +687,202 @@ int tls_collect_extensions(SSL *s, PACKET *packet, unsigned int context,
     return 0;
 }
 
+/*
+ * Pre-parse the server_name extension |pkt| of a ClientHello, applying the
+ * same checks as tls_parse_ctos_server_name().
+ */
+static int client_hello_preparse_sni(PACKET *pkt, PACKET *hostname)
+{
+    PACKET sni;
+    unsigned int servname_type;
+
+    return PACKET_as_length_prefixed_2(pkt, &sni)
+           && PACKET_get_1(&sni, &servname_type)
+           && servname_type == TLSEXT_NAMETYPE_host_name
+           && PACKET_get_length_prefixed_2(&sni, hostname)
+           && PACKET_remaining(hostname) <= TLSEXT_MAXLEN_host_name
+           && !PACKET_contains_zero_byte(hostname);
+}
+
+/*
+ * Pre-parse the ALPN extension |pkt| of a ClientHello, applying the same
+ * checks as tls_parse_ctos_alpn().
+ */
+static int client_hello_preparse_alpn(PACKET *pkt, PACKET *protocol_list)
+{
+    PACKET list, protocol;
+
+    if (!PACKET_as_length_prefixed_2(pkt, protocol_list)
+            || PACKET_remaining(protocol_list) < 2)
+        return 0;
+
+    list = *protocol_list;
+    do {
+        /* Protocol names can't be empty. */
+        if (!PACKET_get_length_prefixed_1(&list, &protocol)
+                || PACKET_remaining(&protocol) == 0)
+            return 0;
+    } while (PACKET_remaining(&list) != 0);
+
+    return 1;
+}
+
+/*
+ * Pre-parse the extensions block of a ClientHello. We only look inside the
+ * extensions needed for routing decisions, and like tls_collect_extensions()
+ * reject duplicates of those and a PSK extension that is not the last one.
+ */
+static int client_hello_preparse_extensions(PACKET *pkt,
+                                            SSL_CLIENT_HELLO_INFO *info)
+{
+    PACKET extensions = *pkt, extension, tmp;
+    unsigned int type;
+    int seen_sni = 0, seen_alpn = 0, seen_versions = 0;
+
+    while (PACKET_remaining(&extensions) > 0) {
+        if (!extension_block_next(&extensions, &type, &extension))
+            return 0;
+
+        switch (type) {
+        case TLSEXT_TYPE_server_name:
+            if (seen_sni++ || !client_hello_preparse_sni(&extension, &tmp))
+                return 0;
+            info->servername = PACKET_data(&tmp);
+            info->servername_len = PACKET_remaining(&tmp);
+            break;
+
+        case TLSEXT_TYPE_application_layer_protocol_negotiation:
+            if (seen_alpn++ || !client_hello_preparse_alpn(&extension, &tmp))
+                return 0;
+            info->alpn = PACKET_data(&tmp);
+            info->alpn_len = PACKET_remaining(&tmp);
+            break;
+
+        case TLSEXT_TYPE_supported_versions:
+            if (seen_versions++
+                    || !PACKET_as_length_prefixed_1(&extension, &tmp)
+                    || PACKET_remaining(&tmp) == 0
+                    || PACKET_remaining(&tmp) % 2 != 0)
+                return 0;
+            info->supported_versions = PACKET_data(&tmp);
+            info->supported_versions_len = PACKET_remaining(&tmp);
+            break;
+
+        case TLSEXT_TYPE_psk:
+            if (PACKET_remaining(&extensions) != 0)
+                return 0;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return 1;
+}
+
+int SSL_client_hello_parse(const unsigned char *buf, size_t len,
+                           SSL_CLIENT_HELLO_INFO *info)
+{
+    PACKET pkt, body, session_id, ciphersuites, compression, extensions;
+    unsigned int rectype, recvers, mt;
+    size_t msglen;
+
+    if (buf == NULL || info == NULL)
+        return SSL_CLIENT_HELLO_ERROR;
+
+    memset(info, 0, sizeof(*info));
+    if (!PACKET_buf_init(&pkt, buf, len))
+        return SSL_CLIENT_HELLO_ERROR;
+
+    /*
+     * Skip the record header if the caller handed us the raw bytes off the
+     * wire. We only deal with a ClientHello that fits in a single record.
+     */
+    if (PACKET_remaining(&pkt) > 0 && *PACKET_data(&pkt) == SSL3_RT_HANDSHAKE) {
+        PACKET rec;
+
+        if (PACKET_remaining(&pkt) < SSL3_RT_HEADER_LENGTH)
+            return SSL_CLIENT_HELLO_RETRY;
+        if (!PACKET_get_1(&pkt, &rectype)
+                || !PACKET_get_net_2(&pkt, &recvers)
+                || (recvers >> 8) != SSL3_VERSION_MAJOR
+                || !PACKET_get_net_2_len(&pkt, &msglen)
+                || msglen > SSL3_RT_MAX_PLAIN_LENGTH)
+            return SSL_CLIENT_HELLO_ERROR;
+        if (!PACKET_get_sub_packet(&pkt, &rec, msglen))
+            return SSL_CLIENT_HELLO_RETRY;
+        pkt = rec;
+        if (PACKET_remaining(&pkt) < SSL3_HM_HEADER_LENGTH)
+            return SSL_CLIENT_HELLO_ERROR;
+    }
+
+    if (PACKET_remaining(&pkt) < SSL3_HM_HEADER_LENGTH)
+        return SSL_CLIENT_HELLO_RETRY;
+    if (!PACKET_get_1(&pkt, &mt)
+            || mt != SSL3_MT_CLIENT_HELLO
+            || !PACKET_get_net_3_len(&pkt, &msglen))
+        return SSL_CLIENT_HELLO_ERROR;
+    if (!PACKET_get_sub_packet(&pkt, &body, msglen)) {
+        /* A ClientHello spanning several records is not supported */
+        return buf[0] == SSL3_RT_HANDSHAKE ? SSL_CLIENT_HELLO_ERROR
+                                           : SSL_CLIENT_HELLO_RETRY;
+    }
+
+    /* This mirrors the regular ClientHello case in tls_process_client_hello */
+    if (!PACKET_get_net_2(&body, &info->legacy_version)
+            || !PACKET_get_bytes(&body, &info->random, SSL3_RANDOM_SIZE)
+            || !PACKET_get_length_prefixed_1(&body, &session_id)
+            || PACKET_remaining(&session_id) > SSL_MAX_SSL_SESSION_ID_LENGTH
+            || !PACKET_get_length_prefixed_2(&body, &ciphersuites)
+            || !PACKET_get_length_prefixed_1(&body, &compression))
+        return SSL_CLIENT_HELLO_ERROR;
+
+    /* Could be empty. */
+    if (PACKET_remaining(&body) == 0) {
+        PACKET_null_init(&extensions);
+    } else if (!PACKET_get_length_prefixed_2(&body, &extensions)
+               || PACKET_remaining(&body) != 0
+               || !client_hello_preparse_extensions(&extensions, info)) {
+        return SSL_CLIENT_HELLO_ERROR;
+    }
+
+    info->session_id = PACKET_data(&session_id);
+    info->session_id_len = PACKET_remaining(&session_id);
+    info->ciphers = PACKET_data(&ciphersuites);
+    info->ciphers_len = PACKET_remaining(&ciphersuites);
+    info->compression_methods = PACKET_data(&compression);
+    info->compression_methods_len = PACKET_remaining(&compression);
+    info->extensions = PACKET_data(&extensions);
+    info->extensions_len = PACKET_remaining(&extensions);
+
+    return SSL_CLIENT_HELLO_SUCCESS;
+}
+
+int SSL_client_hello_info_get0_ext(const SSL_CLIENT_HELLO_INFO *info,
+                                   unsigned int type,
+                                   const unsigned char **out, size_t *outlen)
+{
+    PACKET extensions, extension;
+    unsigned int thistype;
+
+    if (info == NULL || info->extensions == NULL
+            || !PACKET_buf_init(&extensions, info->extensions,
+                                info->extensions_len))
+        return 0;
+
+    while (extension_block_next(&extensions, &thistype, &extension)) {
+        if (thistype == type) {
+            if (out != NULL)
+                *out = PACKET_data(&extension);
+            if (outlen != NULL)
+                *outlen = PACKET_remaining(&extension);
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /*
  * Runs the parser for a given extension with index |idx|. |exts| contains the
  * list of all parsed extensions previously collected by
@@ -1053,6 +1276,8 @@ static int init_status_request(SSL *s, unsigned int context)
 {
     if (s->server) {
         s->ext.status_type = TLSEXT_STATUSTYPE_nothing;
+        ssl_ocsp_staple_free(s->ext.ocsp.staple);
+        s->ext.ocsp.staple = NULL;
     } else {
         /*
          * Ensure we get sensible values passed to tlsext_status_cb in the event
@@ -1229,6 +1454,79 @@ static int tls_parse_certificate_authorities(SSL *s, PACKET *pkt,
     return 1;
 }
 
+static int init_compress_certificate(SSL *s, unsigned int context)
+{
+    s->ext.compress_certificate_from_peer = TLSEXT_comp_cert_none;
+    return 1;
+}
+
+/*
+ * The compress_certificate extension (RFC8879) has the same format in the
+ * ClientHello and in a CertificateRequest: it lists the algorithms that the
+ * sender is willing to decompress.
+ */
+static EXT_RETURN tls_construct_compress_certificate(SSL *s, WPACKET *pkt,
+                                                     unsigned int context,
+                                                     X509 *x,
+                                                     size_t chainidx)
+{
+    int i;
+
+    if (s->cert_comp_prefs[0] == TLSEXT_comp_cert_none)
+        return EXT_RETURN_NOT_SENT;
+
+    if (!WPACKET_put_bytes_u16(pkt, TLSEXT_TYPE_compress_certificate)
+            || !WPACKET_start_sub_packet_u16(pkt)
+            || !WPACKET_start_sub_packet_u8(pkt)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return EXT_RETURN_FAIL;
+    }
+    for (i = 0; s->cert_comp_prefs[i] != TLSEXT_comp_cert_none; i++) {
+        if (!WPACKET_put_bytes_u16(pkt, s->cert_comp_prefs[i])) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return EXT_RETURN_FAIL;
+        }
+    }
+    if (!WPACKET_close(pkt) || !WPACKET_close(pkt)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return EXT_RETURN_FAIL;
+    }
+
+    return EXT_RETURN_SENT;
+}
+
+static int tls_parse_compress_certificate(SSL *s, PACKET *pkt,
+                                          unsigned int context, X509 *x,
+                                          size_t chainidx)
+{
+    PACKET algs;
+    unsigned int alg, peer_algs = 0;
+    int i;
+
+    if (!PACKET_as_length_prefixed_1(pkt, &algs)
+            || PACKET_remaining(&algs) == 0
+            || (PACKET_remaining(&algs) & 1) != 0) {
+        SSLfatal(s, SSL_AD_DECODE_ERROR, SSL_R_BAD_EXTENSION);
+        return 0;
+    }
+
+    while (PACKET_get_net_2(&algs, &alg)) {
+        /* Ignore algorithms we know nothing about */
+        if (alg > TLSEXT_comp_cert_none && alg < TLSEXT_comp_cert_limit)
+            peer_algs |= 1U << alg;
+    }
+
+    /* We use the first of our own preferences that the peer supports */
+    for (i = 0; s->cert_comp_prefs[i] != TLSEXT_comp_cert_none; i++) {
+        if ((peer_algs & (1U << s->cert_comp_prefs[i])) != 0) {
+            s->ext.compress_certificate_from_peer = s->cert_comp_prefs[i];
+            break;
+        }
+    }
+
+    return 1;
+}
+
 #ifndef OPENSSL_NO_SRTP
 static int init_srtp(SSL *s, unsigned int context)
 {
@@ -1622,6 +1920,10 @@ static int final_early_data(SSL *s, unsigned int context, int sent)
             || s->early_data_state != SSL_EARLY_DATA_ACCEPTING
             || !s->ext.early_data_ok
             || s->hello_retry_request != SSL_HRR_NONE
+            || (s->ext.replay_binder_len > 0
+                && !ssl_anti_replay_check(s->session_ctx->anti_replay,
+                                          s->ext.replay_binder,
+                                          s->ext.replay_binder_len))
             || (s->allow_early_data_cb != NULL
                 && !s->allow_early_data_cb(s,
                                          s->allow_early_data_cb_data))) {
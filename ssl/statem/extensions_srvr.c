@@ -989,6 +989,9 @@ int tls_parse_ctos_psk(SSL *s, PACKET *pkt, unsigned int context, X509 *x,
     SSL_SESSION *sess = NULL;
     unsigned int id, i, ext = 0;
     const EVP_MD *md = NULL;
+    int check_replay = 0;
+
+    s->ext.replay_binder_len = 0;
 
     /*
      * If we have no PSK kex mode that we recognise then we can't resume so
@@ -1098,13 +1101,13 @@ int tls_parse_ctos_psk(SSL *s, PACKET *pkt, unsigned int context, X509 *x,
             int ret;
 
             /*
-             * If we are using anti-replay protection then we behave as if
-             * SSL_OP_NO_TICKET is set - we are caching tickets anyway so there
-             * is no point in using full stateless tickets.
+             * If we are using anti-replay protection through the session
+             * cache then we behave as if SSL_OP_NO_TICKET is set - we are
+             * caching tickets anyway so there is no point in using full
+             * stateless tickets.
              */
             if ((s->options & SSL_OP_NO_TICKET) != 0
-                    || (s->max_early_data > 0
-                        && (s->options & SSL_OP_NO_ANTI_REPLAY) == 0))
+                    || SSL_EARLY_DATA_NEEDS_STATEFUL_TICKETS(s))
                 ret = tls_get_stateful_ticket(s, &identity, &sess);
             else
                 ret = tls_decrypt_ticket(s, PACKET_data(&identity),
@@ -1125,8 +1128,7 @@ int tls_parse_ctos_psk(SSL *s, PACKET *pkt, unsigned int context, X509 *x,
                 continue;
 
             /* Check for replay */
-            if (s->max_early_data > 0
-                    && (s->options & SSL_OP_NO_ANTI_REPLAY) == 0
+            if (SSL_EARLY_DATA_NEEDS_STATEFUL_TICKETS(s)
                     && !SSL_CTX_remove_session(s->session_ctx, sess)) {
                 SSL_SESSION_free(sess);
                 sess = NULL;
@@ -1157,6 +1159,14 @@ int tls_parse_ctos_psk(SSL *s, PACKET *pkt, unsigned int context, X509 *x,
                  * for early data
                  */
                 s->ext.early_data_ok = 1;
+                /*
+                 * Stateless tickets can be used more than once, so we need
+                 * to check with the anti-replay cache before accepting early
+                 * data.
+                 */
+                check_replay = s->max_early_data > 0
+                               && (s->options & SSL_OP_NO_ANTI_REPLAY) == 0
+                               && s->session_ctx->anti_replay != NULL;
             }
         }
 
@@ -1168,6 +1178,7 @@ int tls_parse_ctos_psk(SSL *s, PACKET *pkt, unsigned int context, X509 *x,
             sess = NULL;
             s->ext.early_data_ok = 0;
             s->ext.ticket_expected = 0;
+            check_replay = 0;
             continue;
         }
         break;
@@ -1204,6 +1215,11 @@ int tls_parse_ctos_psk(SSL *s, PACKET *pkt, unsigned int context, X509 *x,
 
     s->ext.tick_identity = id;
 
+    if (check_replay) {
+        memcpy(s->ext.replay_binder, PACKET_data(&binder), hashsize);
+        s->ext.replay_binder_len = hashsize;
+    }
+
     SSL_SESSION_free(s->session);
     s->session = sess;
     return 1;
@@ -129,7 +129,7 @@ static int ossl_statem_client13_read_transition(SSL *s, int mt)
                 st->hand_state = TLS_ST_CR_CERT_REQ;
                 return 1;
             }
-            if (mt == SSL3_MT_CERTIFICATE) {
+            if (tls13_is_certificate_message(s, mt)) {
                 st->hand_state = TLS_ST_CR_CERT;
                 return 1;
             }
@@ -137,7 +137,7 @@ static int ossl_statem_client13_read_transition(SSL *s, int mt)
         break;
 
     case TLS_ST_CR_CERT_REQ:
-        if (mt == SSL3_MT_CERTIFICATE) {
+        if (tls13_is_certificate_message(s, mt)) {
             st->hand_state = TLS_ST_CR_CERT;
             return 1;
         }
@@ -913,8 +913,15 @@ int ossl_statem_client_construct_message(SSL *s, WPACKET *pkt,
         break;
 
     case TLS_ST_CW_CERT:
-        *confunc = tls_construct_client_certificate;
-        *mt = SSL3_MT_CERTIFICATE;
+        if (SSL_IS_TLS13(s)
+                && s->ext.compress_certificate_from_peer
+                   != TLSEXT_comp_cert_none) {
+            *confunc = tls_construct_client_compressed_certificate;
+            *mt = SSL3_MT_COMPRESSED_CERTIFICATE;
+        } else {
+            *confunc = tls_construct_client_certificate;
+            *mt = SSL3_MT_CERTIFICATE;
+        }
         break;
 
     case TLS_ST_CW_KEY_EXCH:
@@ -1028,6 +1035,9 @@ MSG_PROCESS_RETURN ossl_statem_client_process_message(SSL *s, PACKET *pkt)
         return dtls_process_hello_verify(s, pkt);
 
     case TLS_ST_CR_CERT:
+        if (s->s3.tmp.message_type == SSL3_MT_COMPRESSED_CERTIFICATE)
+            return tls_process_compressed_certificate(s, pkt,
+                                              tls_process_server_certificate);
         return tls_process_server_certificate(s, pkt);
 
     case TLS_ST_CR_CERT_VRFY:
@@ -3482,7 +3492,7 @@ WORK_STATE tls_prepare_client_certificate(SSL *s, WORK_STATE wst)
     return WORK_ERROR;
 }
 
-int tls_construct_client_certificate(SSL *s, WPACKET *pkt)
+static int tls_construct_client_certificate_body(SSL *s, WPACKET *pkt)
 {
     if (SSL_IS_TLS13(s)) {
         if (s->pha_context == NULL) {
@@ -3503,6 +3513,15 @@ int tls_construct_client_certificate(SSL *s, WPACKET *pkt)
         return 0;
     }
 
+    return 1;
+}
+
+/*
+ * In TLSv1.3 the client switches to the handshake write keys once its
+ * Certificate (or CompressedCertificate) message has been constructed.
+ */
+static int tls_client_certificate_change_cipher_state(SSL *s)
+{
     if (SSL_IS_TLS13(s)
             && SSL_IS_FIRST_HANDSHAKE(s)
             && (!s->method->ssl3_enc->change_cipher_state(s,
@@ -3518,6 +3537,30 @@ int tls_construct_client_certificate(SSL *s, WPACKET *pkt)
     return 1;
 }
 
+int tls_construct_client_certificate(SSL *s, WPACKET *pkt)
+{
+    if (!tls_construct_client_certificate_body(s, pkt)) {
+        /* SSLfatal() already called */
+        return 0;
+    }
+
+    return tls_client_certificate_change_cipher_state(s);
+}
+
+int tls_construct_client_compressed_certificate(SSL *s, WPACKET *pkt)
+{
+    int alg = s->ext.compress_certificate_from_peer;
+
+    if (!tls_construct_compressed_certificate(s, pkt, alg,
+                                        tls_construct_client_certificate_body)) {
+        /* SSLfatal() already called */
+        return 0;
+    }
+    s->ext.client_cert_comp = alg;
+
+    return tls_client_certificate_change_cipher_state(s);
+}
+
 int ssl3_check_cert_and_algorithm(SSL *s)
 {
     const SSL_CERT_LOOKUP *clu;
@@ -100,6 +100,11 @@ int tls_setup_handshake(SSL *s)
     /* Reset any extension flags */
     memset(s->ext.extflags, 0, sizeof(s->ext.extflags));
 
+    /* Reset certificate compression state */
+    s->ext.compress_certificate_from_peer = TLSEXT_comp_cert_none;
+    s->ext.server_cert_comp = TLSEXT_comp_cert_none;
+    s->ext.client_cert_comp = TLSEXT_comp_cert_none;
+
     if (ssl_get_min_max_version(s, &ver_min, &ver_max, NULL) != 0) {
         SSLfatal(s, SSL_AD_PROTOCOL_VERSION, SSL_R_NO_PROTOCOLS_AVAILABLE);
         return 0;
@@ -1037,6 +1042,142 @@ unsigned long ssl3_output_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk)
     return 1;
 }
 
+/*
+ * Returns 1 if |mt| may carry the peer's TLSv1.3 Certificate: either a plain
+ * Certificate message or, if we offered certificate compression, a
+ * CompressedCertificate message (RFC8879).
+ */
+int tls13_is_certificate_message(SSL *s, int mt)
+{
+    if (mt == SSL3_MT_CERTIFICATE)
+        return 1;
+
+    return mt == SSL3_MT_COMPRESSED_CERTIFICATE
+           && (s->ext.extflags[TLSEXT_IDX_compress_certificate]
+               & SSL_EXT_FLAG_SENT) != 0;
+}
+
+/*
+ * Construct a CompressedCertificate message body by building the equivalent
+ * Certificate message body with |construct| and compressing it with |alg|.
+ */
+int tls_construct_compressed_certificate(SSL *s, WPACKET *pkt, int alg,
+                                         confunc_f construct)
+{
+    BUF_MEM *buf;
+    WPACKET tmppkt;
+    unsigned char *out;
+    size_t len, outlen;
+    int ret = 0;
+
+    if ((buf = BUF_MEM_new()) == NULL
+            || !WPACKET_init(&tmppkt, buf)) {
+        BUF_MEM_free(buf);
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+
+    if (!construct(s, &tmppkt)) {
+        /* SSLfatal() already called */
+        WPACKET_cleanup(&tmppkt);
+        goto err;
+    }
+    if (!WPACKET_get_total_written(&tmppkt, &len)
+            || !WPACKET_finish(&tmppkt)) {
+        WPACKET_cleanup(&tmppkt);
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+
+    if (!WPACKET_put_bytes_u16(pkt, alg)
+            || !WPACKET_put_bytes_u24(pkt, len)
+            || !WPACKET_start_sub_packet_u24(pkt)
+            || !WPACKET_reserve_bytes(pkt, SSL_CERT_COMP_MAX_LEN(len), &out)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    if (!ssl_cert_comp_compress(alg, (unsigned char *)buf->data, len, out,
+                                &outlen)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_COMPRESSION_FAILURE);
+        goto err;
+    }
+    if (!WPACKET_allocate_bytes(pkt, outlen, NULL)
+            || !WPACKET_close(pkt)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    ret = 1;
+
+ err:
+    BUF_MEM_free(buf);
+    return ret;
+}
+
+/*
+ * Decompress a received CompressedCertificate message and hand the resulting
+ * Certificate message body to |process|.
+ */
+MSG_PROCESS_RETURN tls_process_compressed_certificate(SSL *s, PACKET *pkt,
+        MSG_PROCESS_RETURN (*process)(SSL *s, PACKET *pkt))
+{
+    PACKET comp, body;
+    unsigned int alg;
+    unsigned long orig_len;
+    unsigned char *buf = NULL;
+    MSG_PROCESS_RETURN ret = MSG_PROCESS_ERROR;
+    int i, offered = 0;
+
+    if (!PACKET_get_net_2(pkt, &alg)
+            || !PACKET_get_net_3(pkt, &orig_len)
+            || !PACKET_get_length_prefixed_3(pkt, &comp)
+            || PACKET_remaining(pkt) != 0
+            || PACKET_remaining(&comp) == 0) {
+        SSLfatal(s, SSL_AD_DECODE_ERROR, SSL_R_LENGTH_MISMATCH);
+        return MSG_PROCESS_ERROR;
+    }
+
+    for (i = 0; s->cert_comp_prefs[i] != TLSEXT_comp_cert_none; i++) {
+        if (s->cert_comp_prefs[i] == (int)alg)
+            offered = 1;
+    }
+    if (!offered) {
+        SSLfatal(s, SSL_AD_ILLEGAL_PARAMETER,
+                 SSL_R_UNSUPPORTED_COMPRESSION_ALGORITHM);
+        return MSG_PROCESS_ERROR;
+    }
+
+    if (orig_len == 0 || orig_len > s->max_cert_list) {
+        SSLfatal(s, SSL_AD_BAD_CERTIFICATE, SSL_R_EXCESSIVE_MESSAGE_SIZE);
+        return MSG_PROCESS_ERROR;
+    }
+
+    if ((buf = OPENSSL_malloc(orig_len)) == NULL) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+        return MSG_PROCESS_ERROR;
+    }
+    if (!ssl_cert_comp_expand(alg, PACKET_data(&comp), PACKET_remaining(&comp),
+                              buf, orig_len)) {
+        SSLfatal(s, SSL_AD_BAD_CERTIFICATE, SSL_R_BAD_DECOMPRESSION);
+        goto err;
+    }
+    if (!PACKET_buf_init(&body, buf, orig_len)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+
+    ret = process(s, &body);
+    if (ret != MSG_PROCESS_ERROR) {
+        if (s->server)
+            s->ext.client_cert_comp = alg;
+        else
+            s->ext.server_cert_comp = alg;
+    }
+
+ err:
+    OPENSSL_free(buf);
+    return ret;
+}
+
 /*
  * Tidy up after the end of a handshake. In the case of SCTP this may result
  * in NBIO events. If |clearbufs| is set then init_buf and the wbio buffer is
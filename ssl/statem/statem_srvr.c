@@ -86,7 +86,7 @@ static int ossl_statem_server13_read_transition(SSL *s, int mt)
     case TLS_ST_SR_END_OF_EARLY_DATA:
     case TLS_ST_SW_FINISHED:
         if (s->s3.tmp.cert_request) {
-            if (mt == SSL3_MT_CERTIFICATE) {
+            if (tls13_is_certificate_message(s, mt)) {
                 st->hand_state = TLS_ST_SR_CERT;
                 return 1;
             }
@@ -127,7 +127,7 @@ static int ossl_statem_server13_read_transition(SSL *s, int mt)
         if (s->early_data_state == SSL_EARLY_DATA_READING)
             break;
 
-        if (mt == SSL3_MT_CERTIFICATE
+        if (tls13_is_certificate_message(s, mt)
                 && s->post_handshake_auth == SSL_PHA_REQUESTED) {
             st->hand_state = TLS_ST_SR_CERT;
             return 1;
@@ -1050,8 +1050,15 @@ int ossl_statem_server_construct_message(SSL *s, WPACKET *pkt,
         break;
 
     case TLS_ST_SW_CERT:
-        *confunc = tls_construct_server_certificate;
-        *mt = SSL3_MT_CERTIFICATE;
+        if (SSL_IS_TLS13(s)
+                && s->ext.compress_certificate_from_peer
+                   != TLSEXT_comp_cert_none) {
+            *confunc = tls_construct_server_compressed_certificate;
+            *mt = SSL3_MT_COMPRESSED_CERTIFICATE;
+        } else {
+            *confunc = tls_construct_server_certificate;
+            *mt = SSL3_MT_CERTIFICATE;
+        }
         break;
 
     case TLS_ST_SW_CERT_VRFY:
@@ -1193,6 +1200,9 @@ MSG_PROCESS_RETURN ossl_statem_server_process_message(SSL *s, PACKET *pkt)
         return tls_process_end_of_early_data(s, pkt);
 
     case TLS_ST_SR_CERT:
+        if (s->s3.tmp.message_type == SSL3_MT_COMPRESSED_CERTIFICATE)
+            return tls_process_compressed_certificate(s, pkt,
+                                              tls_process_client_certificate);
         return tls_process_client_certificate(s, pkt);
 
     case TLS_ST_SR_KEY_EXCH:
@@ -2093,6 +2103,18 @@ static int tls_handle_status_request(SSL *s)
             }
         }
     }
+#ifndef OPENSSL_NO_OCSP
+    else if (s->ext.status_type != TLSEXT_STATUSTYPE_nothing
+             && s->ctx != NULL
+             && s->s3.tmp.cert != NULL) {
+        /* Built-in stapling: send the cached response, if any */
+        ssl_ocsp_staple_free(s->ext.ocsp.staple);
+        s->ext.ocsp.staple = ssl_ocsp_staple_get(s->ctx,
+                                                 s->s3.tmp.cert->x509);
+        if (s->ext.ocsp.staple != NULL)
+            s->ext.status_expected = 1;
+    }
+#endif
 
     return 1;
 }
@@ -3607,6 +3629,62 @@ int tls_construct_server_certificate(SSL *s, WPACKET *pkt)
     return 1;
 }
 
+/*
+ * A Certificate message pre-compressed by SSL_CTX_compress_certs() can only be
+ * sent if this connection would not add any per-connection extensions (such
+ * as a stapled OCSP response) to the certificate entries.
+ */
+static int server_cert_msg_is_static(SSL *s)
+{
+    size_t i;
+
+    if (s->ext.status_expected)
+        return 0;
+
+    /* The chain was built with the chaining mode of the SSL_CTX */
+    if (((s->mode ^ s->ctx->mode) & SSL_MODE_NO_AUTO_CHAIN) != 0)
+        return 0;
+
+    for (i = 0; i < s->cert->custext.meths_count; i++) {
+        const custom_ext_method *meth = &s->cert->custext.meths[i];
+
+        if ((meth->context & SSL_EXT_TLS1_3_CERTIFICATE) != 0
+                && meth->role != ENDPOINT_CLIENT)
+            return 0;
+    }
+
+    return 1;
+}
+
+int tls_construct_server_compressed_certificate(SSL *s, WPACKET *pkt)
+{
+    CERT_PKEY *cpk = s->s3.tmp.cert;
+    int alg = s->ext.compress_certificate_from_peer;
+    OSSL_COMP_CERT *cc;
+
+    if (cpk == NULL) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    cc = cpk->comp_cert[alg];
+    if (cc != NULL && server_cert_msg_is_static(s)) {
+        if (!WPACKET_put_bytes_u16(pkt, alg)
+                || !WPACKET_put_bytes_u24(pkt, cc->orig_len)
+                || !WPACKET_sub_memcpy_u24(pkt, cc->data, cc->len)) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return 0;
+        }
+    } else if (!tls_construct_compressed_certificate(s, pkt, alg,
+                                            tls_construct_server_certificate)) {
+        /* SSLfatal() already called */
+        return 0;
+    }
+    s->ext.server_cert_comp = alg;
+
+    return 1;
+}
+
 static int create_ticket_prequel(SSL *s, WPACKET *pkt, uint32_t age_add,
                                  unsigned char *tick_nonce)
 {
@@ -3933,14 +4011,13 @@ int tls_construct_new_session_ticket(SSL *s, WPACKET *pkt)
         goto err;
 
     /*
-     * If we are using anti-replay protection then we behave as if
-     * SSL_OP_NO_TICKET is set - we are caching tickets anyway so there
-     * is no point in using full stateless tickets.
+     * If we are using anti-replay protection through the session cache then
+     * we behave as if SSL_OP_NO_TICKET is set - we are caching tickets anyway
+     * so there is no point in using full stateless tickets.
      */
     if (SSL_IS_TLS13(s)
             && ((s->options & SSL_OP_NO_TICKET) != 0
-                || (s->max_early_data > 0
-                    && (s->options & SSL_OP_NO_ANTI_REPLAY) == 0))) {
+                || SSL_EARLY_DATA_NEEDS_STATEFUL_TICKETS(s))) {
         if (!construct_stateful_ticket(s, pkt, age_add_u.age_add, tick_nonce)) {
             /* SSLfatal() already called */
             goto err;
@@ -3982,9 +4059,17 @@ int tls_construct_new_session_ticket(SSL *s, WPACKET *pkt)
  */
 int tls_construct_cert_status_body(SSL *s, WPACKET *pkt)
 {
+    const unsigned char *resp = s->ext.ocsp.resp;
+    size_t resp_len = s->ext.ocsp.resp_len;
+
+#ifndef OPENSSL_NO_OCSP
+    if (s->ext.ocsp.staple != NULL) {
+        resp = s->ext.ocsp.staple->der;
+        resp_len = s->ext.ocsp.staple->der_len;
+    }
+#endif
     if (!WPACKET_put_bytes_u8(pkt, s->ext.status_type)
-            || !WPACKET_sub_memcpy_u24(pkt, s->ext.ocsp.resp,
-                                       s->ext.ocsp.resp_len)) {
+            || !WPACKET_sub_memcpy_u24(pkt, resp, resp_len)) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
         return 0;
     }
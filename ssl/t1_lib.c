@@ -20,6 +20,7 @@
 #include <openssl/bn.h>
 #include <openssl/provider.h>
 #include <openssl/param_build.h>
+#include "internal/cryptlib.h"
 #include "internal/nelem.h"
 #include "internal/sizes.h"
 #include "internal/tlsgroups.h"
@@ -1121,6 +1122,14 @@ static const uint16_t tls_default_sigalg[] = {
     0, /* SSL_PKEY_ED448 */
 };
 
+/* Bitmap with one bit per entry in the sigalg lookup cache */
+#define SIGALG_BITMAP_WORDS ((OSSL_NELEM(sigalg_lookup_tbl) + 31) / 32)
+
+static ossl_inline size_t sigalg_index_hash(uint16_t sigalg)
+{
+    return (sigalg ^ (sigalg >> 6)) & (SSL_SIGALG_INDEX_SIZE - 1);
+}
+
 int ssl_setup_sig_algs(SSL_CTX *ctx)
 {
     size_t i;
@@ -1165,6 +1174,19 @@ int ssl_setup_sig_algs(SSL_CTX *ctx)
         EVP_PKEY_CTX_free(pctx);
     }
     ERR_pop_to_mark();
+
+    /* Index the cache by sigalg so that lookups don't need a linear scan */
+    if (!ossl_assert(OSSL_NELEM(sigalg_lookup_tbl) < SSL_SIGALG_INDEX_SIZE))
+        goto err;
+    memset(ctx->sigalg_lookup_index, 0, sizeof(ctx->sigalg_lookup_index));
+    for (i = 0; i < OSSL_NELEM(sigalg_lookup_tbl); i++) {
+        size_t h = sigalg_index_hash(cache[i].sigalg);
+
+        while (ctx->sigalg_lookup_index[h] != 0)
+            h = (h + 1) & (SSL_SIGALG_INDEX_SIZE - 1);
+        ctx->sigalg_lookup_index[h] = (unsigned char)(i + 1);
+    }
+
     ctx->sigalg_lookup_cache = cache;
     cache = NULL;
 
@@ -1176,22 +1198,34 @@ int ssl_setup_sig_algs(SSL_CTX *ctx)
 }
 
 /* Lookup TLS signature algorithm */
+/*
+ * Find the index of |sigalg| in the sigalg lookup cache of |ctx|, whether it is
+ * enabled or not. Returns -1 if the sigalg is unknown.
+ */
+static int tls1_sigalg_cache_idx(const SSL_CTX *ctx, uint16_t sigalg)
+{
+    size_t h = sigalg_index_hash(sigalg);
+    unsigned int i;
+
+    while ((i = ctx->sigalg_lookup_index[h]) != 0) {
+        if (ctx->sigalg_lookup_cache[i - 1].sigalg == sigalg)
+            return (int)i - 1;
+        h = (h + 1) & (SSL_SIGALG_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
 static const SIGALG_LOOKUP *tls1_lookup_sigalg(const SSL *s, uint16_t sigalg)
 {
-    size_t i;
+    int i = tls1_sigalg_cache_idx(s->ctx, sigalg);
     const SIGALG_LOOKUP *lu;
 
-    for (i = 0, lu = s->ctx->sigalg_lookup_cache;
-         /* cache should have the same number of elements as sigalg_lookup_tbl */
-         i < OSSL_NELEM(sigalg_lookup_tbl);
-         lu++, i++) {
-        if (lu->sigalg == sigalg) {
-            if (!lu->enabled)
-                return NULL;
-            return lu;
-        }
-    }
-    return NULL;
+    if (i < 0)
+        return NULL;
+    lu = &s->ctx->sigalg_lookup_cache[i];
+    if (!lu->enabled)
+        return NULL;
+    return lu;
 }
 /* Lookup hash: return 0 if invalid or not enabled */
 int tls1_lookup_md(SSL_CTX *ctx, const SIGALG_LOOKUP *lu, const EVP_MD **pmd)
@@ -2156,8 +2190,17 @@ static size_t tls12_shared_sigalgs(SSL *s, const SIGALG_LOOKUP **shsig,
                                    const uint16_t *pref, size_t preflen,
                                    const uint16_t *allow, size_t allowlen)
 {
-    const uint16_t *ptmp, *atmp;
-    size_t i, j, nmatch = 0;
+    const uint16_t *ptmp;
+    size_t i, idx, nmatch = 0;
+    uint32_t allow_bits[SIGALG_BITMAP_WORDS] = { 0 };
+    int aidx;
+
+    /* Turn |allow| into a bitmap over the sigalg lookup cache */
+    for (i = 0; i < allowlen; i++) {
+        if ((aidx = tls1_sigalg_cache_idx(s->ctx, allow[i])) >= 0)
+            allow_bits[aidx / 32] |= (uint32_t)1 << (aidx % 32);
+    }
+
     for (i = 0, ptmp = pref; i < preflen; i++, ptmp++) {
         const SIGALG_LOOKUP *lu = tls1_lookup_sigalg(s, *ptmp);
 
@@ -2165,13 +2208,11 @@ static size_t tls12_shared_sigalgs(SSL *s, const SIGALG_LOOKUP **shsig,
         if (lu == NULL
                 || !tls12_sigalg_allowed(s, SSL_SECOP_SIGALG_SHARED, lu))
             continue;
-        for (j = 0, atmp = allow; j < allowlen; j++, atmp++) {
-            if (*ptmp == *atmp) {
-                nmatch++;
-                if (shsig)
-                    *shsig++ = lu;
-                break;
-            }
+        idx = lu - s->ctx->sigalg_lookup_cache;
+        if ((allow_bits[idx / 32] >> (idx % 32)) & 1) {
+            nmatch++;
+            if (shsig)
+                *shsig++ = lu;
         }
     }
     return nmatch;
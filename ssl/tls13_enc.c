@@ -823,6 +823,9 @@ int tls13_update_key(SSL *s, int sending)
     unsigned char secret[EVP_MAX_MD_SIZE];
     EVP_CIPHER_CTX *ciph_ctx;
     int ret = 0;
+#if !defined(OPENSSL_NO_KTLS) && defined(OPENSSL_KTLS_TLS13)
+    ktls_crypto_info_t crypto_info;
+#endif
 
     if (s->server == sending)
         insecret = s->server_app_traffic_secret;
@@ -851,6 +854,25 @@ int tls13_update_key(SSL *s, int sending)
 
     memcpy(insecret, secret, hashlen);
 
+#if !defined(OPENSSL_NO_KTLS) && defined(OPENSSL_KTLS_TLS13)
+    /*
+     * If the kernel is encrypting for us then it must be given the new key.
+     * Everything we write goes through the kernel from now on, so there is no
+     * falling back to encrypting in user space if it refuses.
+     */
+    if (sending && s->wbio != NULL && BIO_get_ktls_send(s->wbio)) {
+        if (!ktls_configure_crypto(s, s->s3.tmp.new_sym_enc, ciph_ctx,
+                                   RECORD_LAYER_get_write_sequence(&s->rlayer),
+                                   &crypto_info, NULL, iv, key, NULL, 0)
+                || !BIO_set_ktls(s->wbio, &crypto_info, 1)) {
+            OPENSSL_cleanse(&crypto_info, sizeof(crypto_info));
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_KTLS_KEY_UPDATE_FAILED);
+            goto err;
+        }
+        OPENSSL_cleanse(&crypto_info, sizeof(crypto_info));
+    }
+#endif
+
     s->statem.enc_write_state = ENC_WRITE_STATE_VALID;
     ret = 1;
  err:
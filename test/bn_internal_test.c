@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -20,6 +20,7 @@
 #include "internal/numbers.h"
 #include "testutil.h"
 #include "bn_prime.h"
+#include "bn_local.h"
 #include "crypto/bn.h"
 
 static BN_CTX *ctx;
@@ -84,6 +85,133 @@ err:
     return ret;
 }
 
+/*
+ * Check the incremental sieve against trial division of each candidate.
+ * Whatever number of primes the sieve uses, a candidate it rejects must have
+ * a small factor and a candidate it accepts must have no factor among the
+ * first 64 primes.
+ */
+static int test_sieve(void)
+{
+    BIGNUM *w = NULL, *step = NULL;
+    BN_SIEVE *sieve = NULL;
+    int i, j, has_factor, ret = 0;
+
+    if (!TEST_ptr(w = BN_new())
+            || !TEST_ptr(step = BN_new())
+            || !TEST_true(BN_rand(w, 1024, BN_RAND_TOP_ONE,
+                                  BN_RAND_BOTTOM_ODD))
+            || !TEST_true(BN_rand(step, 300, BN_RAND_TOP_ONE,
+                                  BN_RAND_BOTTOM_ANY))
+            || !TEST_true(BN_lshift1(step, step))
+            || !TEST_ptr(sieve = bn_sieve_new(step, BN_num_bits(w)))
+            || !TEST_true(bn_sieve_start(sieve, w)))
+        goto err;
+
+    for (i = 0; i < 500; i++) {
+        has_factor = 0;
+        for (j = 1; j < NUMPRIMES && !has_factor; j++)
+            if (BN_mod_word(w, primes[j]) == 0)
+                has_factor = j < 64 ? 2 : 1;
+        if (bn_sieve_has_factor(sieve)) {
+            if (!TEST_int_ne(has_factor, 0))
+                goto err;
+        } else if (!TEST_int_ne(has_factor, 2)) {
+            goto err;
+        }
+        if (!TEST_true(BN_add(w, w, step)))
+            goto err;
+        bn_sieve_next(sieve);
+    }
+    ret = 1;
+ err:
+    bn_sieve_free(sieve);
+    BN_free(w);
+    BN_free(step);
+    return ret;
+}
+
+/*
+ * Pairs of modulus sizes for bn_mod_exp_mont_consttime_x2(), including
+ * sizes that are not handled by parallel code and unequal sizes.
+ */
+static const int mod_exp_x2_bits[][2] = {
+    { 1024, 1024 }, { 1536, 1536 }, { 2048, 2048 },
+    { 1000, 1000 }, { 1024, 2048 }
+};
+
+static int test_mod_exp_x2(int idx)
+{
+    BIGNUM *m[2], *a[2], *p[2], *r[2], *expected = NULL;
+    BN_MONT_CTX *mont[2] = { NULL, NULL };
+    int i, j, round, ret = 0;
+
+    for (j = 0; j < 2; j++)
+        m[j] = a[j] = p[j] = r[j] = NULL;
+    for (j = 0; j < 2; j++)
+        if (!TEST_ptr(m[j] = BN_new())
+                || !TEST_ptr(a[j] = BN_new())
+                || !TEST_ptr(p[j] = BN_new())
+                || !TEST_ptr(r[j] = BN_new())
+                || !TEST_ptr(mont[j] = BN_MONT_CTX_new()))
+            goto err;
+    if (!TEST_ptr(expected = BN_new()))
+        goto err;
+
+    for (round = 0; round < 10; round++) {
+        for (j = 0; j < 2; j++) {
+            int bits = mod_exp_x2_bits[idx][j];
+
+            if (!TEST_true(BN_rand(m[j], bits, BN_RAND_TOP_ONE,
+                                   BN_RAND_BOTTOM_ODD))
+                    || !TEST_true(BN_MONT_CTX_set(mont[j], m[j], ctx))
+                    || !TEST_true(BN_rand(p[j], bits, BN_RAND_TOP_ANY,
+                                          BN_RAND_BOTTOM_ANY)))
+                goto err;
+            switch (round) {
+            case 0:         /* base is zero */
+                BN_zero(a[j]);
+                break;
+            case 1:         /* base is m - 1 */
+                if (!TEST_true(BN_sub(a[j], m[j], BN_value_one())))
+                    goto err;
+                break;
+            case 2:         /* exponent is zero */
+                BN_zero(p[j]);
+                /* fall through */
+            default:        /* base may be larger than modulus */
+                if (!TEST_true(BN_rand(a[j], bits, BN_RAND_TOP_ANY,
+                                       BN_RAND_BOTTOM_ANY)))
+                    goto err;
+                break;
+            }
+        }
+        /* The first one is computed in place */
+        if (!TEST_true(BN_copy(r[0], a[0]))
+                || !TEST_true(bn_mod_exp_mont_consttime_x2(r[0], r[0], p[0],
+                                                           m[0], mont[0],
+                                                           r[1], a[1], p[1],
+                                                           m[1], NULL, ctx)))
+            goto err;
+        for (i = 0; i < 2; i++)
+            if (!TEST_true(BN_mod_exp(expected, a[i], p[i], m[i], ctx))
+                    || !TEST_BN_eq(r[i], expected))
+                goto err;
+    }
+    ret = 1;
+
+ err:
+    for (j = 0; j < 2; j++) {
+        BN_free(m[j]);
+        BN_free(a[j]);
+        BN_free(p[j]);
+        BN_free(r[j]);
+        BN_MONT_CTX_free(mont[j]);
+    }
+    BN_free(expected);
+    return ret;
+}
+
 int setup_tests(void)
 {
     if (!TEST_ptr(ctx = BN_CTX_new()))
@@ -92,6 +220,8 @@ int setup_tests(void)
     ADD_TEST(test_is_prime_enhanced);
     ADD_ALL_TESTS(test_is_composite_enhanced, (int)OSSL_NELEM(composites));
     ADD_TEST(test_bn_small_factors);
+    ADD_TEST(test_sieve);
+    ADD_ALL_TESTS(test_mod_exp_x2, (int)OSSL_NELEM(mod_exp_x2_bits));
 
     return 1;
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2015-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -371,6 +371,98 @@ static int test_reuse_crl(void)
     return 1;
 }
 
+#ifndef OPENSSL_NO_EC
+# define LARGE_CRL_ENTRIES 10000
+
+static X509_REVOKED *revoked_new(ASN1_INTEGER *serial, long n,
+                                 ASN1_TIME *tm)
+{
+    X509_REVOKED *rev = X509_REVOKED_new();
+
+    if (!TEST_ptr(rev)
+            || !TEST_true(ASN1_INTEGER_set(serial, n))
+            || !TEST_true(X509_REVOKED_set_serialNumber(rev, serial))
+            || !TEST_true(X509_REVOKED_set_revocationDate(rev, tm))) {
+        X509_REVOKED_free(rev);
+        return NULL;
+    }
+    return rev;
+}
+
+/*
+ * Look up the serial numbers of a large decoded CRL, which revokes the odd
+ * serial numbers.
+ */
+static int test_large_crl(void)
+{
+    EVP_PKEY_CTX *kctx = NULL;
+    EVP_PKEY *key = NULL;
+    X509_CRL *crl = NULL, *decoded = NULL;
+    X509_REVOKED *rev = NULL, *found;
+    ASN1_INTEGER *serial = NULL;
+    ASN1_TIME *tm = NULL;
+    unsigned char *der = NULL;
+    const unsigned char *p;
+    int i, len, ret = 0;
+
+    if (!TEST_ptr(kctx = EVP_PKEY_CTX_new_from_name(NULL, "ED25519", NULL))
+            || !TEST_int_gt(EVP_PKEY_keygen_init(kctx), 0)
+            || !TEST_int_gt(EVP_PKEY_keygen(kctx, &key), 0)
+            || !TEST_ptr(crl = X509_CRL_new())
+            || !TEST_true(X509_CRL_set_issuer_name(crl,
+                              X509_get_subject_name(test_root)))
+            || !TEST_ptr(tm = ASN1_TIME_set(NULL, PARAM_TIME))
+            || !TEST_true(X509_CRL_set1_lastUpdate(crl, tm))
+            || !TEST_ptr(serial = ASN1_INTEGER_new()))
+        goto err;
+    for (i = 1; i < 2 * LARGE_CRL_ENTRIES; i += 2) {
+        if (!TEST_ptr(rev = revoked_new(serial, i, tm))
+                || !TEST_true(X509_CRL_add0_revoked(crl, rev)))
+            goto err;
+        rev = NULL;
+    }
+    if (!TEST_int_gt(X509_CRL_sign(crl, key, NULL), 0)
+            || !TEST_int_gt(len = i2d_X509_CRL(crl, &der), 0))
+        goto err;
+    p = der;
+    if (!TEST_ptr(decoded = d2i_X509_CRL(NULL, &p, len)))
+        goto err;
+
+    for (i = 0; i <= 2 * LARGE_CRL_ENTRIES; i++)
+        if (!TEST_true(ASN1_INTEGER_set(serial, i))
+                || !TEST_int_eq(X509_CRL_get0_by_serial(decoded, &found,
+                                                        serial), i % 2))
+            goto err;
+    if (!TEST_true(ASN1_INTEGER_set(serial, -1))
+            || !TEST_int_eq(X509_CRL_get0_by_serial(decoded, &found, serial),
+                            0))
+        goto err;
+
+    /* Entries added after decoding are found too */
+    if (!TEST_ptr(rev = revoked_new(serial, 2, tm))
+            || !TEST_true(X509_CRL_add0_revoked(decoded, rev)))
+        goto err;
+    rev = NULL;
+    if (!TEST_int_eq(X509_CRL_get0_by_serial(decoded, &found, serial), 1)
+            || !TEST_true(ASN1_INTEGER_set(serial, 3))
+            || !TEST_int_eq(X509_CRL_get0_by_serial(decoded, &found, serial),
+                            1))
+        goto err;
+
+    ret = 1;
+ err:
+    X509_REVOKED_free(rev);
+    ASN1_INTEGER_free(serial);
+    ASN1_TIME_free(tm);
+    OPENSSL_free(der);
+    X509_CRL_free(decoded);
+    X509_CRL_free(crl);
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(kctx);
+    return ret;
+}
+#endif
+
 int setup_tests(void)
 {
     if (!TEST_ptr(test_root = X509_from_strings(kCRLTestRoot))
@@ -383,6 +475,9 @@ int setup_tests(void)
     ADD_TEST(test_known_critical_crl);
     ADD_ALL_TESTS(test_unknown_critical_crl, OSSL_NELEM(unknown_critical_crls));
     ADD_TEST(test_reuse_crl);
+#ifndef OPENSSL_NO_EC
+    ADD_TEST(test_large_crl);
+#endif
     return 1;
 }
 
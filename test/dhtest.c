@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -722,6 +722,77 @@ err:
     return ok;
 }
 
+/*
+ * Check the public keys of the named groups, which are computed using
+ * precomputed tables for the generator, against a plain exponentiation.
+ */
+static int dh_test_prime_groups_pub_key(int index)
+{
+    int ok = 0, i;
+    DH *dh = NULL;
+    const BIGNUM *p, *q, *g, *pub;
+    BIGNUM *priv = NULL, *expected = NULL;
+    BN_CTX *ctx = NULL;
+
+    if (!TEST_ptr(ctx = BN_CTX_new())
+        || !TEST_ptr(expected = BN_new()))
+        goto err;
+
+    for (i = 0; i < 6; i++) {
+        if (!TEST_ptr(dh = DH_new_by_nid(prime_groups[index]))
+            || !TEST_ptr(priv = BN_new()))
+            goto err;
+        DH_get0_pqg(dh, &p, &q, &g);
+
+        switch (i) {
+        case 0:
+            if (!TEST_true(BN_one(priv)))
+                goto err;
+            break;
+        case 1:
+            if (!TEST_true(BN_set_word(priv, 0x12345)))
+                goto err;
+            break;
+        case 2:
+            /* The largest possible private key */
+            if (!TEST_ptr(BN_copy(priv, q))
+                || !TEST_true(BN_sub_word(priv, 1)))
+                goto err;
+            break;
+        case 3:
+            /* Too large for the precomputed table */
+            if (!TEST_ptr(BN_copy(priv, p))
+                || !TEST_true(BN_sub_word(priv, 2)))
+                goto err;
+            break;
+        default:
+            if (!TEST_true(BN_rand_range(priv, q)))
+                goto err;
+            break;
+        }
+
+        if (!TEST_true(DH_set0_key(dh, NULL, priv)))
+            goto err;
+        priv = NULL;
+        if (!TEST_true(DH_generate_key(dh)))
+            goto err;
+        DH_get0_key(dh, &pub, NULL);
+        if (!TEST_true(BN_mod_exp(expected, g, DH_get0_priv_key(dh), p, ctx))
+            || !TEST_BN_eq(pub, expected))
+            goto err;
+        DH_free(dh);
+        dh = NULL;
+    }
+
+    ok = 1;
+err:
+    BN_free(priv);
+    BN_free(expected);
+    BN_CTX_free(ctx);
+    DH_free(dh);
+    return ok;
+}
+
 static int dh_get_nid(void)
 {
     int ok = 0;
@@ -796,6 +867,7 @@ int setup_tests(void)
     ADD_TEST(rfc5114_test);
     ADD_TEST(rfc7919_test);
     ADD_ALL_TESTS(dh_test_prime_groups, OSSL_NELEM(prime_groups));
+    ADD_ALL_TESTS(dh_test_prime_groups_pub_key, OSSL_NELEM(prime_groups));
     ADD_TEST(dh_get_nid);
 #endif
     return 1;
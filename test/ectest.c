@@ -1217,6 +1217,38 @@ static const struct nistp_test_params nistp_tests_params[] = {
      /* d */
      "c477f9f65c22cce20657faa5b2d1d8122336f851a508a1ed04e479c34985bf96",
      },
+    {
+     /* P-384 */
+     NID_secp384r1,
+     384,
+     /* p */
+     "fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffe"
+     "ffffffff0000000000000000ffffffff",
+     /* a */
+     "fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffe"
+     "ffffffff0000000000000000fffffffc",
+     /* b */
+     "b3312fa7e23ee7e4988e056be3f82d19181d9c6efe8141120314088f5013875a"
+     "c656398d8a2ed19d2a85c8edd3ec2aef",
+     /* Qx */
+     "8d5ae6e1c54860f67c6710ee1339d837c742c8b59bfb5e8bbe6b40de2add64bd"
+     "9c60e50831b4fe225a99fc4443c88d73",
+     /* Qy */
+     "aba0818a0880ce7d3609dd52759d0f50a621148404a7efb159f36ed5572f18dd"
+     "046c9c7b193cf7e977949b8b13a76bec",
+     /* Gx */
+     "aa87ca22be8b05378eb1c71ef320ad746e1d3b628ba79b9859f741e082542a38"
+     "5502f25dbf55296c3a545e3872760ab7",
+     /* Gy */
+     "3617de4a96262c6f5d9e98bf9292dc29f8f41dbd289a147ce9da3113b5f0b8c0"
+     "0a60b1ce1d7e819d7a431d7c90ea0e5f",
+     /* order */
+     "ffffffffffffffffffffffffffffffffffffffffffffffffc7634d81f4372ddf"
+     "581a0db248b0a77aecec196accc52973",
+     /* d */
+     "11c6ab18f5ca1b36f361f4f360f17ab7dd29a3f75a0bcf6c1d1177ff5e66aec9"
+     "42a33ce95f720595da0ea6bc399a86e2",
+     },
     {
      /* P-521 */
      NID_secp521r1,
@@ -2556,6 +2588,172 @@ err:
     return ret;
 }
 
+/*
+ * check that fixed point multiplication of the generator, which may use
+ * precomputation, agrees with variable point multiplication
+ */
+static int generator_mul_test(int id)
+{
+    int ret = 0, i, nid;
+    EC_GROUP *group = NULL;
+    EC_POINT *Q1 = NULL, *Q2 = NULL;
+    const EC_POINT *G;
+    BN_CTX *ctx = NULL;
+    BIGNUM *k = NULL;
+    const BIGNUM *order;
+
+    nid = curves[id].nid;
+    TEST_note("Curve %s", OBJ_nid2sn(nid));
+    if (!TEST_ptr(ctx = BN_CTX_new())
+        || !TEST_ptr(k = BN_new())
+        || !TEST_ptr(group = EC_GROUP_new_by_curve_name(nid))
+        || !TEST_ptr(Q1 = EC_POINT_new(group))
+        || !TEST_ptr(Q2 = EC_POINT_new(group)))
+        goto err;
+    G = EC_GROUP_get0_generator(group);
+    order = EC_GROUP_get0_order(group);
+
+    for (i = 0; i < 8; i++) {
+        switch (i) {
+        case 0:
+            BN_zero(k);
+            break;
+        case 1:
+            if (!TEST_true(BN_one(k)))
+                goto err;
+            break;
+        case 2:
+            if (!TEST_ptr(BN_copy(k, order))
+                || !TEST_true(BN_sub_word(k, 1)))
+                goto err;
+            break;
+        case 3:
+            if (!TEST_ptr(BN_copy(k, order)))
+                goto err;
+            break;
+        case 4:
+            /* all ones, larger than the order for most curves */
+            if (!TEST_true(BN_set_word(k, 1))
+                || !TEST_true(BN_lshift(k, k, BN_num_bits(order)))
+                || !TEST_true(BN_sub_word(k, 1)))
+                goto err;
+            break;
+        case 5:
+            if (!TEST_true(BN_set_word(k, 12345)))
+                goto err;
+            BN_set_negative(k, 1);
+            break;
+        default:
+            if (!TEST_true(BN_rand_range(k, order)))
+                goto err;
+            break;
+        }
+        if (!TEST_true(EC_POINT_mul(group, Q1, k, NULL, NULL, ctx))
+            || !TEST_true(EC_POINT_mul(group, Q2, NULL, G, k, ctx))
+            || !TEST_int_eq(EC_POINT_cmp(group, Q1, Q2, ctx), 0))
+            goto err;
+    }
+
+    ret = 1;
+ err:
+    EC_POINT_free(Q1);
+    EC_POINT_free(Q2);
+    EC_GROUP_free(group);
+    BN_free(k);
+    BN_CTX_free(ctx);
+    return ret;
+}
+
+/*
+ * check that a multi-scalar multiplication with enough points to use the
+ * bucket method agrees with the sum of smaller multiplications
+ */
+#define MSM_TEST_POINTS 128
+#define MSM_TEST_CHUNK  16
+
+static int multi_scalar_mul_test(int id)
+{
+    int ret = 0, i, nid;
+    EC_GROUP *group = NULL;
+    EC_POINT *points[MSM_TEST_POINTS], *Q1 = NULL, *Q2 = NULL, *T = NULL;
+    BIGNUM *scalars[MSM_TEST_POINTS], *k = NULL, *x = NULL;
+    const BIGNUM *order;
+    BN_CTX *ctx = NULL;
+
+    memset(points, 0, sizeof(points));
+    memset(scalars, 0, sizeof(scalars));
+    nid = curves[id].nid;
+    TEST_note("Curve %s", OBJ_nid2sn(nid));
+    if (!TEST_ptr(ctx = BN_CTX_new())
+        || !TEST_ptr(k = BN_new())
+        || !TEST_ptr(x = BN_new())
+        || !TEST_ptr(group = EC_GROUP_new_by_curve_name(nid))
+        || !TEST_ptr(Q1 = EC_POINT_new(group))
+        || !TEST_ptr(Q2 = EC_POINT_new(group))
+        || !TEST_ptr(T = EC_POINT_new(group)))
+        goto err;
+    order = EC_GROUP_get0_order(group);
+
+    for (i = 0; i < MSM_TEST_POINTS; i++) {
+        if (!TEST_ptr(points[i] = EC_POINT_new(group))
+            || !TEST_ptr(scalars[i] = BN_new())
+            || !TEST_true(BN_rand_range(x, order))
+            || !TEST_true(BN_rand_range(scalars[i], order))
+            || !TEST_true(EC_POINT_mul(group, points[i], x, NULL, NULL, ctx)))
+            goto err;
+    }
+    /* some special cases: a repeated point, infinity and unusual scalars */
+    BN_zero(scalars[1]);
+    BN_set_negative(scalars[2], 1);
+    if (!TEST_true(EC_POINT_copy(points[4], points[3]))
+        || !TEST_true(BN_copy(scalars[4], scalars[3]))
+        || !TEST_true(EC_POINT_set_to_infinity(group, points[5]))
+        || !TEST_true(BN_lshift(scalars[6], scalars[6], 8))
+        || !TEST_true(BN_copy(scalars[7], order))
+        || !TEST_true(BN_rand_range(k, order)))
+        goto err;
+
+    if (!TEST_true(EC_POINT_msm(group, Q1, k, MSM_TEST_POINTS,
+                                (const EC_POINT **)points,
+                                (const BIGNUM **)scalars, ctx))
+        || !TEST_true(EC_POINT_mul(group, Q2, k, NULL, NULL, ctx)))
+        goto err;
+    for (i = 0; i < MSM_TEST_POINTS; i += MSM_TEST_CHUNK) {
+        if (!TEST_true(EC_POINT_msm(group, T, NULL, MSM_TEST_CHUNK,
+                                    (const EC_POINT **)points + i,
+                                    (const BIGNUM **)scalars + i, ctx))
+            || !TEST_true(EC_POINT_add(group, Q2, Q2, T, ctx)))
+            goto err;
+    }
+    if (!TEST_int_eq(EC_POINT_cmp(group, Q1, Q2, ctx), 0))
+        goto err;
+
+    /* and without the generator */
+    if (!TEST_true(EC_POINT_msm(group, Q1, NULL, MSM_TEST_POINTS,
+                                (const EC_POINT **)points,
+                                (const BIGNUM **)scalars, ctx))
+        || !TEST_true(EC_POINT_mul(group, T, k, NULL, NULL, ctx))
+        || !TEST_true(EC_POINT_invert(group, T, ctx))
+        || !TEST_true(EC_POINT_add(group, Q2, Q2, T, ctx))
+        || !TEST_int_eq(EC_POINT_cmp(group, Q1, Q2, ctx), 0))
+        goto err;
+
+    ret = 1;
+ err:
+    for (i = 0; i < MSM_TEST_POINTS; i++) {
+        EC_POINT_free(points[i]);
+        BN_free(scalars[i]);
+    }
+    EC_POINT_free(Q1);
+    EC_POINT_free(Q2);
+    EC_POINT_free(T);
+    EC_GROUP_free(group);
+    BN_free(k);
+    BN_free(x);
+    BN_CTX_free(ctx);
+    return ret;
+}
+
 /*
  * check the EC_METHOD respects the supplied EC_GROUP_set_generator G
  */
@@ -2941,6 +3139,8 @@ int setup_tests(void)
     ADD_ALL_TESTS(check_ec_key_field_public_range_test, crv_len);
     ADD_ALL_TESTS(check_named_curve_from_ecparameters, crv_len);
     ADD_ALL_TESTS(ec_point_hex2point_test, crv_len);
+    ADD_ALL_TESTS(generator_mul_test, crv_len);
+    ADD_ALL_TESTS(multi_scalar_mul_test, crv_len);
     ADD_ALL_TESTS(custom_generator_test, crv_len);
     ADD_ALL_TESTS(custom_params_test, crv_len);
     return 1;
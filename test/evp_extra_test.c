@@ -955,6 +955,207 @@ static int test_EVP_DigestVerifyInit(void)
     return ret;
 }
 
+#ifndef OPENSSL_NO_EC
+/* More than the number of Ed25519 signatures checked at once */
+# define BATCH_SIGS      70
+
+/*
+ * Test 0: all the signatures of the batch are valid
+ * Test 1: one of the Ed25519 signatures is invalid
+ * Test 2: the RSA signature is invalid
+ */
+static int test_EVP_VERIFY_BATCH(int tst)
+{
+    EVP_PKEY *keys[3] = { NULL, NULL, NULL }, *rsa = NULL;
+    EVP_PKEY_CTX *pctx = NULL;
+    EVP_MD_CTX *md_ctx = NULL;
+    EVP_VERIFY_BATCH *batch = NULL;
+    unsigned char msgs[BATCH_SIGS][16], sigs[BATCH_SIGS][64];
+    unsigned char rsasig[sizeof(kSignature)];
+    size_t i, siglen;
+    int ret = 0;
+
+    for (i = 0; i < OSSL_NELEM(keys); i++) {
+        EVP_PKEY_CTX_free(pctx);
+        if (!TEST_ptr(pctx = EVP_PKEY_CTX_new_from_name(testctx, "ED25519",
+                                                        NULL))
+                || !TEST_int_gt(EVP_PKEY_keygen_init(pctx), 0)
+                || !TEST_int_gt(EVP_PKEY_keygen(pctx, &keys[i]), 0))
+            goto err;
+    }
+    if (!TEST_ptr(rsa = load_example_rsa_key())
+            || !TEST_ptr(batch = EVP_VERIFY_BATCH_new(testctx, NULL)))
+        goto err;
+
+    for (i = 0; i < BATCH_SIGS; i++) {
+        memset(msgs[i], (int)i, sizeof(msgs[i]));
+        siglen = sizeof(sigs[i]);
+        EVP_MD_CTX_free(md_ctx);
+        if (!TEST_ptr(md_ctx = EVP_MD_CTX_new())
+                || !TEST_true(EVP_DigestSignInit_ex(md_ctx, NULL, NULL,
+                                                    testctx, NULL,
+                                                    keys[i % 3]))
+                || !TEST_true(EVP_DigestSign(md_ctx, sigs[i], &siglen,
+                                             msgs[i], sizeof(msgs[i])))
+                || !TEST_true(EVP_VERIFY_BATCH_add(batch, keys[i % 3], NULL,
+                                                   sigs[i], siglen, msgs[i],
+                                                   sizeof(msgs[i]))))
+            goto err;
+    }
+    memcpy(rsasig, kSignature, sizeof(rsasig));
+    if (!TEST_true(EVP_VERIFY_BATCH_add(batch, rsa, "SHA256", rsasig,
+                                        sizeof(rsasig), kMsg, sizeof(kMsg)))
+            || !TEST_int_eq(EVP_VERIFY_BATCH_num(batch), BATCH_SIGS + 1))
+        goto err;
+
+    /* The signatures are not copied, so can still be altered */
+    if (tst == 1)
+        sigs[BATCH_SIGS / 2][10] ^= 1;
+    else if (tst == 2)
+        rsasig[10] ^= 1;
+
+    if (!TEST_int_eq(EVP_VERIFY_BATCH_verify(batch), tst == 0))
+        goto err;
+    ret = 1;
+
+ err:
+    EVP_VERIFY_BATCH_free(batch);
+    EVP_MD_CTX_free(md_ctx);
+    EVP_PKEY_CTX_free(pctx);
+    for (i = 0; i < OSSL_NELEM(keys); i++)
+        EVP_PKEY_free(keys[i]);
+    EVP_PKEY_free(rsa);
+    return ret;
+}
+
+# define SIGN_BATCH      20
+
+static const char *sign_batch_groups[] = { "P-256", "P-384", "secp256k1" };
+
+/*
+ * Test 0-2: ECDSA over each of |sign_batch_groups|
+ * Test 3: RSA, which is signed one input at a time
+ */
+static int test_EVP_PKEY_sign_batch(int tst)
+{
+    EVP_PKEY *pkey = NULL;
+    EVP_PKEY_CTX *pctx = NULL, *vctx = NULL;
+    unsigned char dgsts[SIGN_BATCH][32], *sigs[SIGN_BATCH] = { NULL };
+    const unsigned char *tbs[SIGN_BATCH];
+    size_t i, siglens[SIGN_BATCH], tbslens[SIGN_BATCH];
+    int ret = 0;
+
+    if (tst < (int)OSSL_NELEM(sign_batch_groups)) {
+        if (!TEST_ptr(pctx = EVP_PKEY_CTX_new_from_name(testctx, "EC", NULL))
+                || !TEST_int_gt(EVP_PKEY_keygen_init(pctx), 0)
+                || !TEST_int_gt(EVP_PKEY_CTX_set_group_name(pctx,
+                                    sign_batch_groups[tst]), 0)
+                || !TEST_int_gt(EVP_PKEY_keygen(pctx, &pkey), 0))
+            goto err;
+        EVP_PKEY_CTX_free(pctx);
+        pctx = NULL;
+    } else if (!TEST_ptr(pkey = load_example_rsa_key())) {
+        goto err;
+    }
+
+    for (i = 0; i < SIGN_BATCH; i++) {
+        memset(dgsts[i], (int)i + 1, sizeof(dgsts[i]));
+        tbs[i] = dgsts[i];
+        tbslens[i] = sizeof(dgsts[i]);
+    }
+    if (!TEST_ptr(pctx = EVP_PKEY_CTX_new_from_pkey(testctx, pkey, NULL))
+            || !TEST_int_gt(EVP_PKEY_sign_init(pctx), 0)
+            || !TEST_int_gt(EVP_PKEY_sign_batch(pctx, SIGN_BATCH, NULL,
+                                                siglens, tbs, tbslens), 0))
+        goto err;
+    for (i = 0; i < SIGN_BATCH; i++)
+        if (!TEST_ptr(sigs[i] = OPENSSL_malloc(siglens[i])))
+            goto err;
+    if (!TEST_int_gt(EVP_PKEY_sign_batch(pctx, SIGN_BATCH, sigs, siglens,
+                                         tbs, tbslens), 0)
+            || !TEST_ptr(vctx = EVP_PKEY_CTX_new_from_pkey(testctx, pkey,
+                                                           NULL))
+            || !TEST_int_gt(EVP_PKEY_verify_init(vctx), 0))
+        goto err;
+
+    for (i = 0; i < SIGN_BATCH; i++)
+        if (!TEST_int_eq(EVP_PKEY_verify(vctx, sigs[i], siglens[i],
+                                         tbs[i], tbslens[i]), 1))
+            goto err;
+    /* Check that the signatures did not get mixed up */
+    if (!TEST_int_le(EVP_PKEY_verify(vctx, sigs[0], siglens[0],
+                                     tbs[1], tbslens[1]), 0))
+        goto err;
+    ret = 1;
+
+ err:
+    for (i = 0; i < SIGN_BATCH; i++)
+        OPENSSL_free(sigs[i]);
+    EVP_PKEY_CTX_free(pctx);
+    EVP_PKEY_CTX_free(vctx);
+    EVP_PKEY_free(pkey);
+    return ret;
+}
+
+# define KEYGEN_BATCH    7
+
+static const char *keygen_batch_algs[] = { "X25519", "ED25519", "X448", "EC" };
+
+/*
+ * Test 0-1: X25519 and ED25519, generated together by the provider
+ * Test 2-3: X448 and EC, generated one key at a time
+ */
+static int test_EVP_PKEY_keygen_batch(int tst)
+{
+    const char *alg = keygen_batch_algs[tst];
+    EVP_PKEY_CTX *pctx = NULL;
+    EVP_PKEY *pkeys[KEYGEN_BATCH], *pkey = NULL;
+    unsigned char priv[64];
+    size_t i, privlen;
+    int ret = 0;
+
+    for (i = 0; i < KEYGEN_BATCH; i++)
+        pkeys[i] = NULL;
+    if (!TEST_ptr(pctx = EVP_PKEY_CTX_new_from_name(testctx, alg, NULL))
+            || !TEST_int_gt(EVP_PKEY_keygen_init(pctx), 0)
+            || (strcmp(alg, "EC") == 0
+                && !TEST_int_gt(EVP_PKEY_CTX_set_group_name(pctx, "P-256"),
+                                0))
+            || !TEST_int_gt(EVP_PKEY_keygen_batch(pctx, KEYGEN_BATCH, pkeys),
+                            0))
+        goto err;
+
+    for (i = 0; i < KEYGEN_BATCH; i++) {
+        if (!TEST_ptr(pkeys[i]))
+            goto err;
+        if (i > 0 && !TEST_int_ne(EVP_PKEY_eq(pkeys[i - 1], pkeys[i]), 1))
+            goto err;
+        if (strcmp(alg, "EC") == 0)
+            continue;
+
+        /* Check the public key against the one derived from the private key */
+        privlen = sizeof(priv);
+        if (!TEST_true(EVP_PKEY_get_raw_private_key(pkeys[i], priv, &privlen))
+                || !TEST_ptr(pkey = EVP_PKEY_new_raw_private_key_ex(testctx,
+                                                                    alg, NULL,
+                                                                    priv,
+                                                                    privlen))
+                || !TEST_int_eq(EVP_PKEY_eq(pkeys[i], pkey), 1))
+            goto err;
+        EVP_PKEY_free(pkey);
+        pkey = NULL;
+    }
+    ret = 1;
+
+ err:
+    for (i = 0; i < KEYGEN_BATCH; i++)
+        EVP_PKEY_free(pkeys[i]);
+    EVP_PKEY_free(pkey);
+    EVP_PKEY_CTX_free(pctx);
+    return ret;
+}
+#endif
+
 /*
  * Test corner cases of EVP_DigestInit/Update/Final API call behavior.
  */
@@ -1000,6 +1201,81 @@ static int test_EVP_Digest(void)
     return ret;
 }
 
+static const char *multi_digests[] = {
+    "SHA3-224", "SHA3-256", "SHA3-384", "SHA3-512", "SHAKE-128", "SHAKE-256",
+    "SHA256"
+};
+static const size_t multi_lengths[] = { 0, 1, 71, 72, 167, 168, 1000 };
+
+/*
+ * Check that EVP_Digest_multi() agrees with hashing the messages one by one
+ * for message lengths around the SHA-3 block sizes, including a number of
+ * messages that isn't a multiple of four.
+ */
+static int test_EVP_Digest_multi(int idx)
+{
+    const char *alg = multi_digests[idx / OSSL_NELEM(multi_lengths)];
+    size_t len = multi_lengths[idx % OSSL_NELEM(multi_lengths)];
+    unsigned char *in[5] = { NULL }, *out[5] = { NULL };
+    unsigned char expected[1000];
+    EVP_MD_CTX *md_ctx = NULL;
+    EVP_MD *md = NULL;
+    const EVP_MD *legacy_md;
+    size_t i, j, size;
+    int xof, ret = 0;
+
+    if (!TEST_ptr(md = EVP_MD_fetch(testctx, alg, NULL))
+            || !TEST_ptr(md_ctx = EVP_MD_CTX_new()))
+        goto err;
+    xof = (EVP_MD_flags(md) & EVP_MD_FLAG_XOF) != 0;
+    size = xof ? sizeof(expected) : (size_t)EVP_MD_size(md);
+
+    for (i = 0; i < OSSL_NELEM(in); i++) {
+        if (!TEST_ptr(in[i] = OPENSSL_malloc(len + 1))
+                || !TEST_ptr(out[i] = OPENSSL_malloc(size)))
+            goto err;
+        for (j = 0; j < len; j++)
+            in[i][j] = (unsigned char)(i * 31 + j);
+    }
+    if (!TEST_true(EVP_Digest_multi(md, OSSL_NELEM(in),
+                                    (const unsigned char *const *)in, len,
+                                    out, size)))
+        goto err;
+
+    for (i = 0; i < OSSL_NELEM(in); i++) {
+        if (!TEST_true(EVP_DigestInit_ex(md_ctx, md, NULL))
+                || !TEST_true(EVP_DigestUpdate(md_ctx, in[i], len))
+                || !TEST_true(xof ? EVP_DigestFinalXOF(md_ctx, expected, size)
+                                  : EVP_DigestFinal_ex(md_ctx, expected, NULL))
+                || !TEST_mem_eq(out[i], size, expected, size))
+            goto err;
+    }
+
+    /* Wrong output length of a fixed size digest */
+    if (!xof && !TEST_false(EVP_Digest_multi(md, OSSL_NELEM(in),
+                                             (const unsigned char *const *)in,
+                                             len, out, size - 1)))
+        goto err;
+
+    /* A legacy EVP_MD is resolved the same way as by EVP_DigestInit_ex() */
+    if (!TEST_ptr(legacy_md = EVP_get_digestbyname(alg))
+            || !TEST_true(EVP_Digest_multi(legacy_md, OSSL_NELEM(in),
+                                           (const unsigned char *const *)in,
+                                           len, out, size))
+            || !TEST_mem_eq(out[OSSL_NELEM(in) - 1], size, expected, size))
+        goto err;
+    ret = 1;
+
+ err:
+    for (i = 0; i < OSSL_NELEM(in); i++) {
+        OPENSSL_free(in[i]);
+        OPENSSL_free(out[i]);
+    }
+    EVP_MD_CTX_free(md_ctx);
+    EVP_MD_free(md);
+    return ret;
+}
+
 static int test_d2i_AutoPrivateKey(int i)
 {
     int ret = 0;
@@ -2450,7 +2726,15 @@ int setup_tests(void)
     ADD_TEST(test_EVP_set_default_properties);
     ADD_ALL_TESTS(test_EVP_DigestSignInit, 9);
     ADD_TEST(test_EVP_DigestVerifyInit);
+#ifndef OPENSSL_NO_EC
+    ADD_ALL_TESTS(test_EVP_VERIFY_BATCH, 3);
+    ADD_ALL_TESTS(test_EVP_PKEY_sign_batch,
+                  OSSL_NELEM(sign_batch_groups) + 1);
+    ADD_ALL_TESTS(test_EVP_PKEY_keygen_batch, OSSL_NELEM(keygen_batch_algs));
+#endif
     ADD_TEST(test_EVP_Digest);
+    ADD_ALL_TESTS(test_EVP_Digest_multi,
+                  OSSL_NELEM(multi_digests) * OSSL_NELEM(multi_lengths));
     ADD_TEST(test_EVP_Enveloped);
     ADD_ALL_TESTS(test_d2i_AutoPrivateKey, OSSL_NELEM(keydata));
     ADD_TEST(test_privatekey_to_pkcs8);
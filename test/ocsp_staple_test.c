@@ -0,0 +1,250 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Tests of the built-in OCSP stapling of SSL_CTX that fetch the responses
+ * from a real OCSP responder, started by the test recipe.
+ */
+
+#include <string.h>
+#include <openssl/ssl.h>
+#include <openssl/ocsp.h>
+#include "internal/cryptlib.h"
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+
+/* How long to wait for a fetch to complete, in milliseconds */
+#define FETCH_WAIT  10000
+#define FETCH_STEP  50
+
+static char *cert = NULL;
+static char *privkey = NULL;
+static char *rootfile = NULL;
+static const char *responder = NULL;
+
+/* The response received by the client in the last handshake */
+static unsigned char *resp_der = NULL;
+static long resp_der_len = 0;
+
+static int status_cb(SSL *s, void *arg)
+{
+    const unsigned char *der;
+    long len;
+
+    OPENSSL_free(resp_der);
+    resp_der = NULL;
+    resp_der_len = 0;
+    len = SSL_get_tlsext_status_ocsp_resp(s, &der);
+    if (len > 0) {
+        if (!TEST_ptr(resp_der = OPENSSL_memdup(der, len)))
+            return -1;
+        resp_der_len = len;
+    }
+    return 1;
+}
+
+/* Check that |resp_der| says that the server certificate is good */
+static int check_response(X509 *leaf, X509 *root)
+{
+    const unsigned char *p = resp_der;
+    OCSP_RESPONSE *resp = NULL;
+    OCSP_BASICRESP *bs = NULL;
+    OCSP_CERTID *id = NULL;
+    int status = -1, ret;
+
+    ret = TEST_ptr(resp = d2i_OCSP_RESPONSE(NULL, &p, resp_der_len))
+        && TEST_int_eq(OCSP_response_status(resp),
+                       OCSP_RESPONSE_STATUS_SUCCESSFUL)
+        && TEST_ptr(bs = OCSP_response_get1_basic(resp))
+        && TEST_ptr(id = OCSP_cert_to_id(NULL, leaf, root))
+        && TEST_true(OCSP_resp_find_status(bs, id, &status, NULL, NULL, NULL,
+                                           NULL))
+        && TEST_int_eq(status, V_OCSP_CERTSTATUS_GOOD);
+
+    OCSP_CERTID_free(id);
+    OCSP_BASICRESP_free(bs);
+    OCSP_RESPONSE_free(resp);
+    return ret;
+}
+
+/* Advance the fetches of |sctx| until they are over */
+static int refresh(SSL_CTX *sctx)
+{
+    int i, rv = -1;
+
+    for (i = 0; i < FETCH_WAIT / FETCH_STEP; i++) {
+        if ((rv = SSL_CTX_refresh_ocsp_staple(sctx)) != -1)
+            break;
+        ossl_sleep(FETCH_STEP);
+    }
+    return rv;
+}
+
+static int handshake(SSL_CTX *sctx, SSL_CTX *cctx)
+{
+    SSL *serverssl = NULL, *clientssl = NULL;
+    int ret;
+
+    ret = TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                       NULL, NULL))
+        && TEST_true(create_ssl_connection(serverssl, clientssl,
+                                           SSL_ERROR_NONE));
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    return ret;
+}
+
+static int load_certs(X509 **leaf, X509 **root)
+{
+    BIO *bio = NULL;
+    int ret;
+
+    ret = TEST_ptr(bio = BIO_new_file(cert, "r"))
+        && TEST_ptr(*leaf = PEM_read_bio_X509(bio, NULL, NULL, NULL));
+    BIO_free(bio);
+    bio = NULL;
+    ret = ret
+        && TEST_ptr(bio = BIO_new_file(rootfile, "r"))
+        && TEST_ptr(*root = PEM_read_bio_X509(bio, NULL, NULL, NULL));
+    BIO_free(bio);
+    return ret;
+}
+
+/*
+ * The server fetches a response from the responder, serves the same one to
+ * every client, and serves a new one once it has fetched it again.
+ */
+static int test_ocsp_staple_fetch(void)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    X509 *leaf = NULL, *root = NULL;
+    unsigned char *first = NULL;
+    long first_len = 0;
+    int testresult = 0;
+
+    if (!load_certs(&leaf, &root)
+            || !TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                              TLS_client_method(), 0, 0,
+                                              &sctx, &cctx, cert, privkey))
+            || !TEST_true(SSL_CTX_load_verify_file(sctx, rootfile))
+            || !TEST_true(SSL_CTX_set_tlsext_status_type(cctx,
+                                                    TLSEXT_STATUSTYPE_ocsp))
+            || !TEST_true(SSL_CTX_set_tlsext_status_cb(cctx, status_cb)))
+        goto end;
+
+    /* Nothing is stapled until a response has been fetched */
+    if (!TEST_true(SSL_CTX_set_ocsp_staple_responder(sctx, responder))
+            || !TEST_int_eq(refresh(sctx), 1)
+            || !handshake(sctx, cctx)
+            || !TEST_ptr(resp_der)
+            || !check_response(leaf, root))
+        goto end;
+    first = resp_der;
+    first_len = resp_der_len;
+    resp_der = NULL;
+
+    /* The cached response is served without fetching it again */
+    if (!TEST_int_eq(SSL_CTX_refresh_ocsp_staple(sctx), 1)
+            || !handshake(sctx, cctx)
+            || !TEST_mem_eq(resp_der, resp_der_len, first, first_len))
+        goto end;
+
+    /*
+     * Setting the responder again starts over, a new response is fetched.
+     * It is produced at a later time, so it differs from the first one.
+     */
+    ossl_sleep(1100);
+    if (!TEST_true(SSL_CTX_set_ocsp_staple_responder(sctx, responder))
+            || !TEST_int_eq(refresh(sctx), 1)
+            || !handshake(sctx, cctx)
+            || !TEST_ptr(resp_der)
+            || !check_response(leaf, root)
+            || !TEST_mem_ne(resp_der, resp_der_len, first, first_len))
+        goto end;
+
+    testresult = 1;
+
+ end:
+    OPENSSL_free(first);
+    OPENSSL_free(resp_der);
+    resp_der = NULL;
+    X509_free(leaf);
+    X509_free(root);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/*
+ * A handshake that advances a fetch whose responder doesn't answer still
+ * succeeds, without a response.
+ */
+static int test_ocsp_staple_no_responder(void)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    int testresult = 0;
+
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), 0, 0,
+                                       &sctx, &cctx, cert, privkey))
+            || !TEST_true(SSL_CTX_load_verify_file(sctx, rootfile))
+            || !TEST_true(SSL_CTX_set_tlsext_status_type(cctx,
+                                                    TLSEXT_STATUSTYPE_ocsp))
+            || !TEST_true(SSL_CTX_set_tlsext_status_cb(cctx, status_cb)))
+        goto end;
+
+    /* Nothing listens on port 1 */
+    if (!TEST_true(SSL_CTX_set_ocsp_staple_responder(sctx,
+                                                     "http://127.0.0.1:1/"))
+            || !handshake(sctx, cctx)
+            || !TEST_ptr_null(resp_der)
+            || !TEST_int_eq(refresh(sctx), 0))
+        goto end;
+
+    testresult = 1;
+
+ end:
+    OPENSSL_free(resp_der);
+    resp_der = NULL;
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+OPT_TEST_DECLARE_USAGE("certsdir responder_url\n")
+
+int setup_tests(void)
+{
+    char *certsdir;
+
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(certsdir = test_get_argument(0))
+            || !TEST_ptr(responder = test_get_argument(1))
+            || !TEST_ptr(cert = test_mk_file_path(certsdir, "servercert.pem"))
+            || !TEST_ptr(privkey = test_mk_file_path(certsdir,
+                                                     "serverkey.pem"))
+            || !TEST_ptr(rootfile = test_mk_file_path(certsdir,
+                                                      "rootcert.pem")))
+        return 0;
+
+    ADD_TEST(test_ocsp_staple_fetch);
+    ADD_TEST(test_ocsp_staple_no_responder);
+    return 1;
+}
+
+void cleanup_tests(void)
+{
+    OPENSSL_free(cert);
+    OPENSSL_free(privkey);
+    OPENSSL_free(rootfile);
+}
@@ -0,0 +1,44 @@
+#! /usr/bin/env perl
+# Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+
+
+use strict;
+use warnings;
+
+use OpenSSL::Test qw/:DEFAULT srctop_file/;
+use OpenSSL::Test::Utils;
+
+setup("test_x509bench");
+
+my @tests = ("parse", "verify", "crl");
+push @tests, "ocsp" unless disabled("ocsp");
+
+plan tests => 4;
+
+# Run all the tests, and check that each one produces a result
+my @out = run(app(["openssl", "x509bench", "-mr", "-seconds", "1",
+                   "-store_size", "10", "-crl_size", "10"]),
+              capture => 1);
+my @results = grep { /^\+R:\w+:1:\d+:[\d.]+$/ } @out;
+ok(scalar @results == scalar @tests, "x509bench runs all the tests");
+
+ok(run(app(["openssl", "x509bench", "-seconds", "1", "-store_size", "0",
+            "-in", srctop_file("test", "certs", "root-cert.pem"),
+            "parse"])),
+   "x509bench parses the certificates of a file");
+
+SKIP: {
+    skip "No thread support in this build", 1 if disabled("threads");
+
+    ok(run(app(["openssl", "x509bench", "-seconds", "1", "-threads", "2",
+                "-cache", "10", "verify"])),
+       "x509bench verifies in several threads");
+}
+
+ok(!run(app(["openssl", "x509bench", "-seconds", "1", "unknown"])),
+   "x509bench rejects unknown tests");
@@ -0,0 +1,77 @@
+#! /usr/bin/env perl
+# Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+
+
+use strict;
+use warnings;
+
+use OpenSSL::Test qw/:DEFAULT cmdstr srctop_dir srctop_file data_file/;
+use OpenSSL::Test::Utils;
+
+setup("test_ocsp_staple");
+
+plan skip_all => "OCSP is not supported by this OpenSSL build"
+    if disabled("ocsp");
+plan skip_all => "Sockets are not supported by this OpenSSL build"
+    if disabled("sock");
+plan skip_all => "Tests involving a local OCSP responder not available on Windows or VMS"
+    if $^O =~ /^(VMS|MSWin32)$/;
+plan skip_all => "Tests involving a local OCSP responder not available in cross-compile builds"
+    if defined $ENV{EXE_SHELL};
+
+plan tests => 2;
+
+# Start "openssl ocsp" as responder for the server certificate of
+# test/certs, in its own process group so that it can be stopped along with
+# the wrapper that runs it.  Returns the pid and port, or nothing on failure.
+sub start_responder {
+    my $cmd = cmdstr(app(["openssl", "ocsp",
+                          "-index", data_file("index.txt"),
+                          "-rsigner", srctop_file("test", "certs",
+                                                  "rootcert.pem"),
+                          "-rkey", srctop_file("test", "certs",
+                                               "rootkey.pem"),
+                          "-CA", srctop_file("test", "certs", "rootcert.pem"),
+                          "-ndays", "1", "-ignore_err"]));
+
+    foreach (1 .. 10) {
+        my $port = 20000 + int(rand(20000));
+        my $pid = open(my $fh, "-|");
+
+        return unless defined $pid;
+        if ($pid == 0) {
+            setpgrp(0, 0);
+            open(STDERR, ">&STDOUT");
+            exec("$cmd -port $port");
+            exit(1);
+        }
+        my $line = <$fh>;
+        return ($pid, $port, $fh)
+            if defined $line && $line =~ /waiting for OCSP client connections/;
+        kill('TERM', -$pid);
+        close($fh);
+    }
+    return;
+}
+
+my ($pid, $port, $fh) = start_responder();
+
+ok($pid, "start the OCSP responder");
+
+SKIP: {
+    skip "No OCSP responder", 1 unless $pid;
+
+    ok(run(test(["ocsp_staple_test", srctop_dir("test", "certs"),
+                 "http://127.0.0.1:$port/"])),
+       "fetch OCSP staples from the responder");
+}
+
+if ($pid) {
+    kill('TERM', -$pid);
+    close($fh);
+}
@@ -0,0 +1,17 @@
+#! /usr/bin/env perl
+# Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+
+
+use OpenSSL::Test qw/:DEFAULT srctop_dir/;
+
+setup("test_verify_mt");
+
+plan tests => 1;
+
+ok(run(test(["verify_mt_test", srctop_dir("test", "certs")])),
+   "running verify_mt_test");
@@ -1,5 +1,5 @@
 /*
- * Copyright 2018-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2018-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -456,6 +456,23 @@ static int test_sp80056b_keygen(int id)
     return ret;
 }
 
+static int test_sp80056b_keygen_threads(void)
+{
+    RSA *key = NULL;
+    int ret;
+
+    if (!TEST_ptr(key = RSA_new()))
+        return 0;
+    ossl_rsa_set_keygen_threads(key, 4);
+    ret = TEST_true(ossl_rsa_sp800_56b_generate_key(key, 2048, NULL, NULL))
+          && TEST_true(ossl_rsa_sp800_56b_check_public(key))
+          && TEST_true(ossl_rsa_sp800_56b_check_private(key))
+          && TEST_true(ossl_rsa_sp800_56b_check_keypair(key, NULL, -1, 2048));
+
+    RSA_free(key);
+    return ret;
+}
+
 static int test_check_private_key(void)
 {
     int ret = 0;
@@ -541,5 +558,6 @@ int setup_tests(void)
     ADD_TEST(test_invalid_keypair);
     ADD_TEST(test_pq_diff);
     ADD_ALL_TESTS(test_sp80056b_keygen, (int)OSSL_NELEM(keygen_size));
+    ADD_TEST(test_sp80056b_keygen_threads);
     return 1;
 }
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Micro-benchmark for server side cipher suite and signature algorithm
+ * selection. Besides reporting the time taken per selection, it checks that
+ * the expected cipher suite and signature algorithm are chosen.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <openssl/ssl.h>
+#include "internal/nelem.h"
+#include "../ssl/ssl_local.h"
+#include "testutil.h"
+
+#define CLIENT_CIPHERS  60
+#define ITERATIONS      20000
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+/* The only cipher suite the client list has in common with the server */
+static const char *target_cipher = "AES128-GCM-SHA256";
+
+static void report(const char *what, clock_t start, int iterations)
+{
+    double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    TEST_info("%s: %d iterations, %.0f ns per selection", what, iterations,
+              secs * 1e9 / iterations);
+}
+
+static SSL *server_new(SSL_CTX **sctx)
+{
+    SSL *s = NULL;
+
+    if (!TEST_ptr(*sctx = SSL_CTX_new(TLS_server_method()))
+            || !TEST_int_eq(SSL_CTX_use_certificate_file(*sctx, cert,
+                                                         SSL_FILETYPE_PEM), 1)
+            || !TEST_int_eq(SSL_CTX_use_PrivateKey_file(*sctx, privkey,
+                                                        SSL_FILETYPE_PEM), 1)
+            || !TEST_ptr(s = SSL_new(*sctx)))
+        return NULL;
+
+    SSL_set_accept_state(s);
+    s->version = TLS1_2_VERSION;
+    return s;
+}
+
+/*
+ * Build a realistic size client cipher list in which the only cipher shared
+ * with |srvr| is the last one, which is the worst case for the selection.
+ */
+static STACK_OF(SSL_CIPHER) *client_ciphers(STACK_OF(SSL_CIPHER) *srvr)
+{
+    STACK_OF(SSL_CIPHER) *clnt = sk_SSL_CIPHER_new_null();
+    const SSL_CIPHER *c, *target = NULL;
+    int i, n = ssl3_num_ciphers();
+
+    if (!TEST_ptr(clnt))
+        return NULL;
+
+    for (i = 0; i < n; i++) {
+        c = ssl3_get_cipher(i);
+        if (strcmp(c->name, target_cipher) == 0)
+            target = c;
+        else if (c->min_tls <= TLS1_2_VERSION && c->max_tls >= TLS1_2_VERSION
+                 && sk_SSL_CIPHER_num(clnt) < CLIENT_CIPHERS - 1
+                 && sk_SSL_CIPHER_find(srvr, c) < 0)
+            sk_SSL_CIPHER_push(clnt, c);
+    }
+    if (!TEST_ptr(target)
+            || !TEST_int_ge(sk_SSL_CIPHER_find(srvr, target), 0)
+            || !TEST_true(sk_SSL_CIPHER_push(clnt, target))) {
+        sk_SSL_CIPHER_free(clnt);
+        return NULL;
+    }
+    TEST_info("client list has %d cipher suites, server list has %d",
+              sk_SSL_CIPHER_num(clnt), sk_SSL_CIPHER_num(srvr));
+    return clnt;
+}
+
+/*
+ * Test 0: client preference
+ * Test 1: server preference
+ */
+static int test_cipher_select(int tst)
+{
+    SSL_CTX *sctx = NULL;
+    SSL *s = NULL;
+    STACK_OF(SSL_CIPHER) *clnt = NULL, *srvr;
+    const SSL_CIPHER *c = NULL;
+    clock_t start;
+    int i, testresult = 0;
+
+    if (!TEST_ptr(s = server_new(&sctx))
+            || !TEST_ptr(srvr = SSL_get_ciphers(s))
+            || !TEST_ptr(clnt = client_ciphers(srvr)))
+        goto end;
+    if (tst == 1)
+        SSL_set_options(s, SSL_OP_CIPHER_SERVER_PREFERENCE);
+
+    start = clock();
+    for (i = 0; i < ITERATIONS; i++) {
+        c = ssl3_choose_cipher(s, clnt, srvr);
+        if (!TEST_ptr(c))
+            goto end;
+    }
+    report(tst == 0 ? "cipher, client preference"
+                    : "cipher, server preference", start, ITERATIONS);
+
+    if (!TEST_str_eq(c->name, target_cipher))
+        goto end;
+
+    testresult = 1;
+ end:
+    sk_SSL_CIPHER_free(clnt);
+    SSL_free(s);
+    SSL_CTX_free(sctx);
+    return testresult;
+}
+
+static int test_sigalg_select(void)
+{
+    /*
+     * A typical browser list, preceded by code points we don't know about
+     * so that the first shared sigalg is well down the list.
+     */
+    static const unsigned char client_sigalgs[] = {
+        0x01, 0x01, 0x01, 0x02, 0x0a, 0x0a, 0x1a, 0x1a, 0x2a, 0x2a,
+        0x3a, 0x3a, 0x4a, 0x4a, 0x5a, 0x5a, 0xfe, 0x01, 0xfe, 0x02,
+        0x04, 0x03, 0x08, 0x04, 0x04, 0x01, 0x05, 0x03, 0x08, 0x05,
+        0x05, 0x01, 0x08, 0x06, 0x06, 0x01, 0x02, 0x01
+    };
+    SSL_CTX *sctx = NULL;
+    SSL *s = NULL;
+    PACKET pkt;
+    clock_t start;
+    int i, testresult = 0;
+
+    if (!TEST_ptr(s = server_new(&sctx)))
+        goto end;
+
+    start = clock();
+    for (i = 0; i < ITERATIONS; i++) {
+        if (!TEST_true(PACKET_buf_init(&pkt, client_sigalgs,
+                                       sizeof(client_sigalgs)))
+                || !TEST_true(tls1_save_sigalgs(s, &pkt, 0))
+                || !TEST_true(tls1_process_sigalgs(s)))
+            goto end;
+    }
+    report("sigalgs", start, ITERATIONS);
+
+    /*
+     * ecdsa_secp256r1_sha256 is the first shared sigalg, but with our RSA
+     * certificate rsa_pss_rsae_sha256 has to be chosen.
+     */
+    s->s3.tmp.new_cipher = SSL_CIPHER_find(s, (const unsigned char *)"\x00\x9c");
+    tls1_set_cert_validity(s);
+    if (!TEST_size_t_gt(s->shared_sigalgslen, 1)
+            || !TEST_ptr(s->s3.tmp.new_cipher)
+            || !TEST_int_eq(s->shared_sigalgs[0]->sigalg,
+                            TLSEXT_SIGALG_ecdsa_secp256r1_sha256)
+            || !TEST_true(tls_choose_sigalg(s, 0))
+            || !TEST_ptr(s->s3.tmp.sigalg)
+            || !TEST_int_eq(s->s3.tmp.sigalg->sigalg,
+                            TLSEXT_SIGALG_rsa_pss_rsae_sha256))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_free(s);
+    SSL_CTX_free(sctx);
+    return testresult;
+}
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+    ADD_ALL_TESTS(test_cipher_select, 2);
+    ADD_TEST(test_sigalg_select);
+    return 1;
+}
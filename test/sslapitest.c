@@ -26,6 +26,7 @@
 #include <openssl/srp.h>
 #include <openssl/txt_db.h>
 #include <openssl/aes.h>
+#include <openssl/comp.h>
 #include <openssl/rand.h>
 #include <openssl/core_names.h>
 #include <openssl/core_dispatch.h>
@@ -644,6 +645,142 @@ end:
     return testresult;
 }
 
+/*
+ * Test SSL_client_hello_parse() on a real ClientHello, both with and without
+ * the record header, and on truncated and corrupted versions of it.
+ */
+static int test_client_hello_parse(void)
+{
+    SSL_CTX *cctx = NULL;
+    SSL *clientssl = NULL;
+    BIO *rbio = NULL, *wbio = NULL;
+    SSL_CLIENT_HELLO_INFO *info = NULL;
+    const unsigned char alpn[] = {
+        2, 'h', '2', 8, 'h', 't', 't', 'p', '/', '1', '.', '1'
+    };
+    const char *host = "www.example.com";
+    unsigned char *data, *copy = NULL;
+    const unsigned char *ext, *p;
+    size_t extlen, plen;
+    long len;
+    size_t i, reclen;
+    int testresult = 0;
+
+    if (!TEST_ptr(info = SSL_CLIENT_HELLO_INFO_new())
+            || !TEST_ptr(cctx = SSL_CTX_new_ex(libctx, NULL,
+                                               TLS_client_method()))
+            || !TEST_ptr(clientssl = SSL_new(cctx))
+            || !TEST_ptr(rbio = BIO_new(BIO_s_mem()))
+            || !TEST_ptr(wbio = BIO_new(BIO_s_mem())))
+        goto end;
+    SSL_set_bio(clientssl, rbio, wbio);
+    rbio = wbio = NULL;
+
+    if (!TEST_true(SSL_set_tlsext_host_name(clientssl, host))
+            || !TEST_int_eq(SSL_set_alpn_protos(clientssl, alpn, sizeof(alpn)),
+                            0)
+            || !TEST_int_le(SSL_connect(clientssl), 0)
+            || !TEST_int_eq(SSL_get_error(clientssl, 0), SSL_ERROR_WANT_READ)
+            || !TEST_long_gt(len = BIO_get_mem_data(SSL_get_wbio(clientssl),
+                                                    (char **)&data),
+                             SSL3_RT_HEADER_LENGTH))
+        goto end;
+
+    /* With the record header */
+    if (!TEST_int_eq(SSL_client_hello_parse(data, len, info),
+                     SSL_CLIENT_HELLO_SUCCESS)
+            || !TEST_uint_eq(SSL_client_hello_info_get0_legacy_version(info),
+                             TLS1_2_VERSION)
+            || !TEST_size_t_eq(SSL_client_hello_info_get0_random(info, NULL),
+                               SSL3_RANDOM_SIZE))
+        goto end;
+    plen = SSL_client_hello_info_get0_session_id(info, &p);
+    if (!TEST_size_t_le(plen, SSL_MAX_SSL_SESSION_ID_LENGTH))
+        goto end;
+    plen = SSL_client_hello_info_get0_servername(info, &p);
+    if (!TEST_mem_eq(p, plen, host, strlen(host)))
+        goto end;
+    plen = SSL_client_hello_info_get0_alpn(info, &p);
+    if (!TEST_mem_eq(p, plen, alpn, sizeof(alpn)))
+        goto end;
+    plen = SSL_client_hello_info_get0_ciphers(info, &p);
+    if (!TEST_size_t_gt(plen, 0)
+            || !TEST_size_t_eq(plen % 2, 0))
+        goto end;
+    plen = SSL_client_hello_info_get0_compression_methods(info, &p);
+    if (!TEST_size_t_eq(plen, 1))
+        goto end;
+    plen = SSL_client_hello_info_get0_extensions(info, &p);
+    if (!TEST_size_t_gt(plen, 0)
+            || !TEST_true(SSL_client_hello_info_get0_ext(info,
+                                                         TLSEXT_TYPE_server_name,
+                                                         &ext, &extlen))
+            || !TEST_size_t_gt(extlen, strlen(host))
+            || !TEST_false(SSL_client_hello_info_get0_ext(info, 0xfefe,
+                                                          NULL, NULL)))
+        goto end;
+#ifndef OSSL_NO_USABLE_TLS1_3
+    plen = SSL_client_hello_info_get0_supported_versions(info, &p);
+    if (!TEST_size_t_ge(plen, 2)
+            || !TEST_int_eq(p[0], 0x03)
+            || !TEST_int_eq(p[1], 0x04))
+        goto end;
+#endif
+
+    /* Without the record header */
+    if (!TEST_int_eq(SSL_client_hello_parse(data + SSL3_RT_HEADER_LENGTH,
+                                            len - SSL3_RT_HEADER_LENGTH,
+                                            info),
+                     SSL_CLIENT_HELLO_SUCCESS))
+        goto end;
+    plen = SSL_client_hello_info_get0_servername(info, &p);
+    if (!TEST_mem_eq(p, plen, host, strlen(host)))
+        goto end;
+
+    /* Any truncation must ask for more data */
+    for (i = 0; i < (size_t)len; i++) {
+        if (!TEST_int_eq(SSL_client_hello_parse(data, i, info),
+                         SSL_CLIENT_HELLO_RETRY))
+            goto end;
+    }
+    for (i = 0; i < (size_t)len - SSL3_RT_HEADER_LENGTH; i++) {
+        if (!TEST_int_eq(SSL_client_hello_parse(data + SSL3_RT_HEADER_LENGTH,
+                                                i, info),
+                         SSL_CLIENT_HELLO_RETRY))
+            goto end;
+    }
+
+    /* A message that is not a ClientHello must be rejected */
+    if (!TEST_ptr(copy = OPENSSL_memdup(data, len)))
+        goto end;
+    copy[SSL3_RT_HEADER_LENGTH] = SSL3_MT_SERVER_HELLO;
+    if (!TEST_int_eq(SSL_client_hello_parse(copy, len, info),
+                     SSL_CLIENT_HELLO_ERROR))
+        goto end;
+
+    /* A ClientHello that doesn't fit in its record must be rejected */
+    memcpy(copy, data, len);
+    reclen = ((copy[3] << 8) | copy[4]) - 1;
+    copy[3] = (unsigned char)(reclen >> 8);
+    copy[4] = (unsigned char)reclen;
+    if (!TEST_int_eq(SSL_client_hello_parse(copy, reclen + SSL3_RT_HEADER_LENGTH,
+                                            info),
+                     SSL_CLIENT_HELLO_ERROR))
+        goto end;
+
+    testresult = 1;
+
+end:
+    OPENSSL_free(copy);
+    SSL_CLIENT_HELLO_INFO_free(info);
+    BIO_free(rbio);
+    BIO_free(wbio);
+    SSL_free(clientssl);
+    SSL_CTX_free(cctx);
+
+    return testresult;
+}
+
 #ifndef OPENSSL_NO_TLS1_2
 static int full_client_hello_callback(SSL *s, int *al, void *arg)
 {
@@ -1071,6 +1208,48 @@ end:
     return 0;
 }
 
+/*
+ * Send a TLSv1.3 KeyUpdate from |s|. If |s| is using ktls for sending the
+ * kernel has to be re-keyed. Kernels that cannot do that make the connection
+ * fail, in which case |*skip| is set.
+ */
+static int ktls_key_update(SSL *s, int *skip)
+{
+    unsigned long err;
+
+    if (!TEST_true(SSL_key_update(s, SSL_KEY_UPDATE_NOT_REQUESTED)))
+        return 0;
+    if (SSL_do_handshake(s) == 1)
+        return 1;
+
+    err = ERR_peek_last_error();
+    if (BIO_get_ktls_send(s->wbio)
+            && ERR_GET_LIB(err) == ERR_LIB_SSL
+            && ERR_GET_REASON(err) == SSL_R_KTLS_KEY_UPDATE_FAILED) {
+        TEST_info("Kernel does not support ktls key updates, skipping");
+        ERR_clear_error();
+        *skip = 1;
+        return 1;
+    }
+    TEST_error("KeyUpdate failed");
+    return 0;
+}
+
+/* Send a one byte message from |from| to |to| */
+static int ktls_send_msg(SSL *from, SSL *to)
+{
+    char msg = 'x', buf = 0;
+    int ret;
+
+    if (!TEST_int_eq(SSL_write(from, &msg, 1), 1))
+        return 0;
+    while ((ret = SSL_read(to, &buf, 1)) != 1) {
+        if (!TEST_int_eq(SSL_get_error(to, ret), SSL_ERROR_WANT_READ))
+            return 0;
+    }
+    return TEST_char_eq(buf, msg);
+}
+
 static int execute_test_ktls(int cis_ktls_tx, int cis_ktls_rx,
                              int sis_ktls_tx, int sis_ktls_rx,
                              int tls_version, const char *cipher,
@@ -1159,6 +1338,30 @@ static int execute_test_ktls(int cis_ktls_tx, int cis_ktls_rx,
 				   rec_seq_size)))
         goto end;
 
+    /*
+     * Re-key both directions mid-stream. Sides that use ktls for sending must
+     * keep doing so with the new keys. The short messages make each peer
+     * process the KeyUpdate before the record sequences are checked again.
+     */
+    if (tls_version == TLS1_3_VERSION) {
+        int skip = 0;
+
+        if (!ktls_key_update(clientssl, &skip))
+            goto end;
+        if (!skip && !ktls_key_update(serverssl, &skip))
+            goto end;
+        if (!skip
+                && (!ktls_send_msg(clientssl, serverssl)
+                    || !ktls_send_msg(serverssl, clientssl)
+                    || !TEST_int_eq(BIO_get_ktls_send(clientssl->wbio) != 0,
+                                 cis_ktls_tx)
+                    || !TEST_int_eq(BIO_get_ktls_send(serverssl->wbio) != 0,
+                                    sis_ktls_tx)
+                    || !TEST_true(ping_pong_query(clientssl, serverssl, cfd,
+                                                  sfd, rec_seq_size))))
+            goto end;
+    }
+
     testresult = 1;
 end:
     if (clientssl) {
@@ -1686,6 +1889,232 @@ static int test_tlsext_status_type(void)
 }
 #endif
 
+#ifndef OPENSSL_NO_OCSP
+static unsigned char *staple_der = NULL;
+static int staple_der_len = 0;
+static const unsigned char *staple_exp = NULL;
+static int staple_exp_len = 0;
+
+static int ocsp_staple_client_cb(SSL *s, void *arg)
+{
+    const unsigned char *respderin;
+    long len;
+
+    len = SSL_get_tlsext_status_ocsp_resp(s, &respderin);
+    if (!TEST_mem_eq(staple_exp, staple_exp_len, respderin, len))
+        return 0;
+
+    ocsp_client_called = 1;
+    return 1;
+}
+
+/*
+ * Create a DER encoded OCSP response about |x| issued by |issuer|, signed with
+ * |signkey| on behalf of |signer| and valid for a day.
+ */
+static int mk_ocsp_response(X509 *x, X509 *issuer, X509 *signer,
+                            EVP_PKEY *signkey, unsigned char **der)
+{
+    OCSP_BASICRESP *bs = NULL;
+    OCSP_RESPONSE *resp = NULL;
+    OCSP_CERTID *id = NULL;
+    ASN1_TIME *thisupd = NULL, *nextupd = NULL;
+    EVP_MD *sha1 = NULL;
+    EVP_MD_CTX *mctx = NULL;
+    int len = 0;
+
+    if (!TEST_ptr(bs = OCSP_BASICRESP_new())
+            || !TEST_ptr(sha1 = EVP_MD_fetch(libctx, "SHA1", NULL))
+            || !TEST_ptr(id = OCSP_cert_to_id(sha1, x, issuer))
+            || !TEST_ptr(thisupd = X509_gmtime_adj(NULL, 0))
+            || !TEST_ptr(nextupd = X509_gmtime_adj(NULL, 24 * 3600))
+            || !TEST_ptr(OCSP_basic_add1_status(bs, id, V_OCSP_CERTSTATUS_GOOD,
+                                                0, NULL, thisupd, nextupd))
+            || !TEST_ptr(mctx = EVP_MD_CTX_new())
+            || !TEST_true(EVP_DigestSignInit_ex(mctx, NULL, "SHA256", libctx,
+                                                NULL, signkey))
+            || !TEST_true(OCSP_basic_sign_ctx(bs, signer, mctx, NULL, 0))
+            || !TEST_ptr(resp = OCSP_response_create(
+                             OCSP_RESPONSE_STATUS_SUCCESSFUL, bs))
+            || !TEST_int_gt(len = i2d_OCSP_RESPONSE(resp, der), 0))
+        len = 0;
+
+    EVP_MD_CTX_free(mctx);
+    EVP_MD_free(sha1);
+    ASN1_TIME_free(thisupd);
+    ASN1_TIME_free(nextupd);
+    OCSP_CERTID_free(id);
+    OCSP_RESPONSE_free(resp);
+    OCSP_BASICRESP_free(bs);
+    return len;
+}
+
+/*
+ * Test the built-in OCSP stapling of the SSL_CTX
+ * Test 0: TLSv1.2
+ * Test 1: TLSv1.3
+ * Test 2: TLSv1.3 with an RSA and an ECDSA certificate
+ */
+static int test_ocsp_staple(int tst)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    X509 *root = NULL, *leaf = NULL, *ecleaf = NULL;
+    EVP_PKEY *rootkey = NULL, *leafkey = NULL;
+    unsigned char *bad_der = NULL, *ec_der = NULL;
+    int i, bad_der_len, ec_der_len = 0, testresult = 0;
+    char *rootfile = NULL, *rootkeyfile = NULL;
+    BIO *bio = NULL;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (tst == 0)
+        return 1;
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (tst >= 1)
+        return 1;
+#endif
+#ifdef OPENSSL_NO_EC
+    if (tst == 2)
+        return 1;
+#endif
+
+    if (!TEST_ptr(rootfile = test_mk_file_path(certsdir, "rootcert.pem"))
+            || !TEST_ptr(rootkeyfile = test_mk_file_path(certsdir,
+                                                         "rootkey.pem"))
+            || !TEST_ptr(bio = BIO_new_file(rootfile, "r"))
+            || !TEST_ptr(root = PEM_read_bio_X509(bio, NULL, NULL, NULL)))
+        goto end;
+    BIO_free(bio);
+    if (!TEST_ptr(bio = BIO_new_file(rootkeyfile, "r"))
+            || !TEST_ptr(rootkey = PEM_read_bio_PrivateKey_ex(bio, NULL, NULL,
+                                                              NULL, libctx,
+                                                              NULL)))
+        goto end;
+    BIO_free(bio);
+    if (!TEST_ptr(bio = BIO_new_file(cert, "r"))
+            || !TEST_ptr(leaf = PEM_read_bio_X509(bio, NULL, NULL, NULL)))
+        goto end;
+    BIO_free(bio);
+    if (!TEST_ptr(bio = BIO_new_file(privkey, "r"))
+            || !TEST_ptr(leafkey = PEM_read_bio_PrivateKey_ex(bio, NULL, NULL,
+                                                              NULL, libctx,
+                                                              NULL)))
+        goto end;
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(),
+                                       tst == 0 ? TLS1_2_VERSION
+                                                : TLS1_3_VERSION,
+                                       tst == 0 ? TLS1_2_VERSION
+                                                : TLS1_3_VERSION,
+                                       &sctx, &cctx, cert, privkey)))
+        goto end;
+
+    /* The issuer of the server certificate can't be found yet */
+    if (!TEST_int_gt(staple_der_len = mk_ocsp_response(leaf, root, root,
+                                                       rootkey, &staple_der),
+                     0)
+            || !TEST_false(SSL_CTX_set1_ocsp_staple(sctx, staple_der,
+                                                    staple_der_len))
+            || !TEST_true(X509_STORE_add_cert(SSL_CTX_get_cert_store(sctx),
+                                              root)))
+        goto end;
+
+    /* Responses not signed by an authorised responder must be rejected */
+    if (!TEST_int_gt(bad_der_len = mk_ocsp_response(leaf, root, leaf,
+                                                    leafkey, &bad_der), 0)
+            || !TEST_false(SSL_CTX_set1_ocsp_staple(sctx, bad_der,
+                                                    bad_der_len))
+            || !TEST_true(SSL_CTX_set1_ocsp_staple(sctx, staple_der,
+                                                   staple_der_len)))
+        goto end;
+    staple_exp = staple_der;
+    staple_exp_len = staple_der_len;
+
+    /* The ECDSA certificate has a response of its own */
+    if (tst == 2) {
+        BIO_free(bio);
+        if (!TEST_ptr(bio = BIO_new_file(cert2, "r"))
+                || !TEST_ptr(ecleaf = PEM_read_bio_X509(bio, NULL, NULL,
+                                                        NULL))
+                || !TEST_int_eq(SSL_CTX_use_certificate(sctx, ecleaf), 1)
+                || !TEST_int_eq(SSL_CTX_use_PrivateKey_file(sctx, privkey2,
+                                                            SSL_FILETYPE_PEM),
+                                1)
+                || !TEST_int_gt(ec_der_len = mk_ocsp_response(ecleaf, root,
+                                                              root, rootkey,
+                                                              &ec_der), 0)
+                || !TEST_true(SSL_CTX_set1_ocsp_staple(sctx, ec_der,
+                                                       ec_der_len)))
+            goto end;
+    }
+
+    /* A client that doesn't ask for a response doesn't get one */
+    ocsp_client_called = 0;
+    SSL_CTX_set_tlsext_status_cb(cctx, ocsp_staple_client_cb);
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                      NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE))
+            || !TEST_false(ocsp_client_called))
+        goto end;
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    serverssl = clientssl = NULL;
+
+    /* Every client that asks for it gets the same response */
+    if (!TEST_true(SSL_CTX_set_tlsext_status_type(cctx,
+                                                  TLSEXT_STATUSTYPE_ocsp)))
+        goto end;
+    for (i = 0; i < 2; i++) {
+        /* With two certificates, each client gets the response for its own */
+        if (tst == 2) {
+            if (!TEST_true(SSL_CTX_set1_sigalgs_list(cctx,
+                                                     i == 0
+                                                     ? "rsa_pss_rsae_sha256"
+                                                     : "ECDSA+SHA256")))
+                goto end;
+            staple_exp = i == 0 ? staple_der : ec_der;
+            staple_exp_len = i == 0 ? staple_der_len : ec_der_len;
+        }
+        ocsp_client_called = 0;
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                          NULL, NULL))
+                || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                    SSL_ERROR_NONE))
+                || !TEST_true(ocsp_client_called))
+            goto end;
+        SSL_free(serverssl);
+        SSL_free(clientssl);
+        serverssl = clientssl = NULL;
+    }
+
+    testresult = 1;
+
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    OPENSSL_free(staple_der);
+    staple_der = NULL;
+    staple_exp = NULL;
+    OPENSSL_free(bad_der);
+    OPENSSL_free(ec_der);
+    X509_free(ecleaf);
+    BIO_free(bio);
+    X509_free(root);
+    X509_free(leaf);
+    EVP_PKEY_free(rootkey);
+    EVP_PKEY_free(leafkey);
+    OPENSSL_free(rootfile);
+    OPENSSL_free(rootkeyfile);
+
+    return testresult;
+}
+#endif
+
 #if !defined(OSSL_NO_USABLE_TLS1_3) || !defined(OPENSSL_NO_TLS1_2)
 static int new_called, remove_called, get_called;
 
@@ -3477,6 +3906,97 @@ static int test_early_data_replay(int idx)
     return ret;
 }
 
+/*
+ * Test that a server using stateless tickets together with an early data
+ * replay cache accepts early data the first time a ClientHello is seen and
+ * rejects it when exactly the same ClientHello is replayed.
+ */
+static int test_early_data_replay_cache(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL, *replayssl = NULL;
+    BIO *rbio = NULL, *wbio = NULL;
+    int testresult = 0;
+    SSL_SESSION *sess = NULL;
+    size_t readbytes, written;
+    unsigned char buf[20];
+    unsigned char flight[4096];
+    int flightlen;
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(), TLS1_VERSION, 0,
+                                       &sctx, &cctx, cert, privkey))
+            || !TEST_true(SSL_CTX_set_early_data_replay_cache(sctx, 1000, 0)))
+        goto end;
+
+    if (!TEST_true(setupearly_data_test(&cctx, &sctx, &clientssl,
+                                        &serverssl, &sess, idx)))
+        goto end;
+
+    /* Write some early data and keep a copy of the client's first flight */
+    if (!TEST_true(SSL_write_early_data(clientssl, MSG1, strlen(MSG1),
+                                        &written))
+            || !TEST_size_t_eq(written, strlen(MSG1))
+            || !TEST_int_gt(flightlen = BIO_read(SSL_get_rbio(serverssl),
+                                                 flight, sizeof(flight)), 0)
+            || !TEST_int_lt(flightlen, (int)sizeof(flight))
+            || !TEST_int_eq(BIO_write(SSL_get_rbio(serverssl), flight,
+                                      flightlen), flightlen))
+        goto end;
+
+    /* The first time the ClientHello is seen the early data is accepted */
+    if (!TEST_int_eq(SSL_read_early_data(serverssl, buf, sizeof(buf),
+                                         &readbytes),
+                     SSL_READ_EARLY_DATA_SUCCESS)
+            || !TEST_mem_eq(MSG1, strlen(MSG1), buf, readbytes)
+            || !TEST_int_gt(SSL_connect(clientssl), 0)
+            || !TEST_int_eq(SSL_read_early_data(serverssl, buf, sizeof(buf),
+                                                &readbytes),
+                            SSL_READ_EARLY_DATA_FINISH)
+            || !TEST_int_eq(SSL_get_early_data_status(serverssl),
+                            SSL_EARLY_DATA_ACCEPTED)
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE))
+            || !TEST_true(SSL_session_reused(serverssl)))
+        goto end;
+
+    /* Replay the same flight to a new server connection */
+    if (!TEST_ptr(replayssl = SSL_new(sctx))
+            || !TEST_ptr(rbio = BIO_new(BIO_s_mem()))
+            || !TEST_ptr(wbio = BIO_new(BIO_s_mem())))
+        goto end;
+    BIO_set_mem_eof_return(rbio, -1);
+    BIO_set_mem_eof_return(wbio, -1);
+    SSL_set_bio(replayssl, rbio, wbio);
+    rbio = wbio = NULL;
+    if (!TEST_int_eq(BIO_write(SSL_get_rbio(replayssl), flight, flightlen),
+                     flightlen))
+        goto end;
+
+    /* The ticket is still fine but the early data must be rejected */
+    if (!TEST_int_eq(SSL_read_early_data(replayssl, buf, sizeof(buf),
+                                         &readbytes),
+                     SSL_READ_EARLY_DATA_FINISH)
+            || !TEST_int_eq(SSL_get_early_data_status(replayssl),
+                            SSL_EARLY_DATA_REJECTED)
+            || !TEST_true(SSL_session_reused(replayssl)))
+        goto end;
+
+    testresult = 1;
+
+ end:
+    BIO_free(rbio);
+    BIO_free(wbio);
+    SSL_SESSION_free(sess);
+    SSL_free(replayssl);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+
+    return testresult;
+}
+
 /*
  * Helper function to test that a server attempting to read early data can
  * handle a connection from a client where the early data should be skipped.
@@ -8555,6 +9075,218 @@ end:
     SSL_CTX_free(cctx);
     return testresult;
 }
+
+static unsigned char *stored_cert = NULL;
+static size_t stored_cert_len = 0;
+static int stored_cert_seen = 0;
+
+/*
+ * Replace the precompressed data in |cc| with a zlib stream that holds the
+ * same Certificate message in a single stored (uncompressed) block. A server
+ * sending these exact bytes must have used the precompressed data.
+ */
+static int replace_comp_cert(OSSL_COMP_CERT *cc)
+{
+# ifdef OPENSSL_NO_COMP
+    return 0;
+# else
+    COMP_CTX *comp = NULL;
+    unsigned char *body = NULL, *p;
+    unsigned long a = 1, b = 0;
+    size_t i, len = cc->orig_len;
+    int ret = 0;
+
+    if (!TEST_size_t_le(len, 0xffff)
+            || !TEST_ptr(body = OPENSSL_malloc(len))
+            || !TEST_ptr(stored_cert = OPENSSL_malloc(len + 11))
+            || !TEST_ptr(comp = COMP_CTX_new(COMP_zlib_oneshot()))
+            || !TEST_int_eq(COMP_expand_block(comp, body, (int)len, cc->data,
+                                              (int)cc->len), (int)len))
+        goto end;
+
+    for (i = 0; i < len; i++) {
+        a = (a + body[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    p = stored_cert;
+    *p++ = 0x78;
+    *p++ = 0x01;
+    *p++ = 0x01;
+    *p++ = (unsigned char)(len & 0xff);
+    *p++ = (unsigned char)(len >> 8);
+    *p++ = (unsigned char)(~len & 0xff);
+    *p++ = (unsigned char)((~len >> 8) & 0xff);
+    memcpy(p, body, len);
+    p += len;
+    *p++ = (unsigned char)(b >> 8);
+    *p++ = (unsigned char)(b & 0xff);
+    *p++ = (unsigned char)(a >> 8);
+    *p++ = (unsigned char)(a & 0xff);
+    stored_cert_len = len + 11;
+
+    OPENSSL_free(cc->data);
+    if (!TEST_ptr(cc->data = OPENSSL_memdup(stored_cert, stored_cert_len)))
+        goto end;
+    cc->len = stored_cert_len;
+    ret = 1;
+
+ end:
+    COMP_CTX_free(comp);
+    OPENSSL_free(body);
+    return ret;
+# endif
+}
+
+static void comp_cert_msg_cb(int write_p, int version, int content_type,
+                             const void *buf, size_t len, SSL *ssl, void *arg)
+{
+    const unsigned char *msg = buf;
+
+    /* Header (4), algorithm (2), uncompressed length (3), data length (3) */
+    if (write_p || content_type != SSL3_RT_HANDSHAKE || len < 12
+            || msg[0] != SSL3_MT_COMPRESSED_CERTIFICATE)
+        return;
+    if (len - 12 == stored_cert_len
+            && memcmp(msg + 12, stored_cert, stored_cert_len) == 0)
+        stored_cert_seen = 1;
+}
+
+/*
+ * Test TLSv1.3 certificate compression (RFC8879)
+ * Test 0: Both sides enabled, server compresses on the fly
+ * Test 1: Both sides enabled, server uses precompressed certificates
+ * Test 2: Both sides enabled, mutual authentication
+ * Test 3: Only the client enabled
+ * Test 4: Only the server enabled
+ * Test 5: Precompressed, then an extra chain certificate is added
+ * Test 6: Precompressed, then a chain store is set
+ */
+static int test_cert_comp(int tst)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    X509_STORE *store = NULL;
+    X509 *root = NULL;
+    char *rootfile = NULL;
+    BIO *bio = NULL;
+    int testresult = 0;
+    int algs[] = { TLSEXT_comp_cert_zlib };
+    int expsrv = TLSEXT_comp_cert_none, expclnt = TLSEXT_comp_cert_none;
+
+# ifndef OPENSSL_NO_COMP
+    if (COMP_get_type(COMP_zlib_oneshot()) == NID_undef)
+# endif
+    {
+        TEST_info("zlib not available, skipping");
+        return 1;
+    }
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(), TLS1_3_VERSION, 0,
+                                       &sctx, &cctx, cert, privkey)))
+        goto end;
+
+    if (tst != 4
+            && !TEST_true(SSL_CTX_set1_cert_comp_preference(cctx, algs,
+                                                            OSSL_NELEM(algs))))
+        goto end;
+    if (tst != 3
+            && !TEST_true(SSL_CTX_set1_cert_comp_preference(sctx, algs,
+                                                            OSSL_NELEM(algs))))
+        goto end;
+    if (tst == 1 || tst >= 5) {
+        OSSL_COMP_CERT *cc;
+
+        if (!TEST_true(SSL_CTX_compress_certs(sctx, TLSEXT_comp_cert_none))
+                || !TEST_ptr(cc = sctx->cert->pkeys[SSL_PKEY_RSA]
+                                  .comp_cert[TLSEXT_comp_cert_zlib])
+                || !replace_comp_cert(cc))
+            goto end;
+    }
+    /* Changing the chain must discard the precompressed message */
+    if (tst >= 5) {
+        if (!TEST_ptr(rootfile = test_mk_file_path(certsdir, "rootcert.pem"))
+                || !TEST_ptr(bio = BIO_new_file(rootfile, "r"))
+                || !TEST_ptr(root = X509_new_ex(libctx, NULL))
+                || !TEST_ptr(PEM_read_bio_X509(bio, &root, NULL, NULL)))
+            goto end;
+        if (tst == 5) {
+            if (!TEST_true(SSL_CTX_add_extra_chain_cert(sctx, root)))
+                goto end;
+            root = NULL;
+        } else if (!TEST_ptr(store = X509_STORE_new())
+                   || !TEST_true(X509_STORE_add_cert(store, root))
+                   || !TEST_true(SSL_CTX_set1_chain_cert_store(sctx, store))) {
+            goto end;
+        }
+        if (!TEST_ptr_null(sctx->cert->pkeys[SSL_PKEY_RSA]
+                           .comp_cert[TLSEXT_comp_cert_zlib]))
+            goto end;
+    }
+    if (tst == 2) {
+        if (!TEST_int_eq(SSL_CTX_use_certificate_chain_file(cctx, cert), 1)
+                || !TEST_int_eq(SSL_CTX_use_PrivateKey_file(cctx, privkey,
+                                                            SSL_FILETYPE_PEM),
+                                1))
+            goto end;
+        SSL_CTX_set_verify(sctx,
+                           SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT,
+                           verify_cb);
+        expclnt = TLSEXT_comp_cert_zlib;
+    }
+    if (tst != 3 && tst != 4)
+        expsrv = TLSEXT_comp_cert_zlib;
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                      NULL, NULL)))
+        goto end;
+    SSL_set_msg_callback(clientssl, comp_cert_msg_cb);
+    if (!TEST_true(create_ssl_connection(serverssl, clientssl,
+                                         SSL_ERROR_NONE)))
+        goto end;
+
+    /* Only the precompressed data can contain the stored block */
+    if (!TEST_int_eq(stored_cert_seen, tst == 1))
+        goto end;
+
+    if (!TEST_int_eq(SSL_get_negotiated_server_cert_comp(clientssl), expsrv)
+            || !TEST_int_eq(SSL_get_negotiated_server_cert_comp(serverssl),
+                            expsrv)
+            || !TEST_int_eq(SSL_get_negotiated_client_cert_comp(clientssl),
+                            expclnt)
+            || !TEST_int_eq(SSL_get_negotiated_client_cert_comp(serverssl),
+                            expclnt))
+        goto end;
+
+    /* The decompressed certificates must be usable as normal */
+    if (!TEST_ptr(SSL_get0_peer_certificate(clientssl))
+            || (tst == 2
+                && !TEST_ptr(SSL_get0_peer_certificate(serverssl))))
+        goto end;
+
+    /* The client must have received the new chain */
+    if (tst >= 5
+            && !TEST_int_eq(sk_X509_num(SSL_get_peer_cert_chain(clientssl)),
+                            2))
+        goto end;
+
+    testresult = 1;
+
+end:
+    OPENSSL_free(stored_cert);
+    stored_cert = NULL;
+    stored_cert_len = 0;
+    stored_cert_seen = 0;
+    X509_STORE_free(store);
+    X509_free(root);
+    BIO_free(bio);
+    OPENSSL_free(rootfile);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
 #endif
 
 OPT_TEST_DECLARE_USAGE("certfile privkeyfile srpvfile tmpfile provider config\n")
@@ -8692,6 +9424,7 @@ int setup_tests(void)
     ADD_TEST(test_cleanse_plaintext);
 #ifndef OPENSSL_NO_OCSP
     ADD_TEST(test_tlsext_status_type);
+    ADD_ALL_TESTS(test_ocsp_staple, 3);
 #endif
     ADD_TEST(test_session_with_only_int_cache);
     ADD_TEST(test_session_with_only_ext_cache);
@@ -8716,6 +9449,7 @@ int setup_tests(void)
     ADD_TEST(test_keylog_no_master_key);
 #endif
     ADD_TEST(test_client_cert_verify_cb);
+    ADD_TEST(test_client_hello_parse);
 #ifndef OPENSSL_NO_TLS1_2
     ADD_TEST(test_client_hello_cb);
     ADD_TEST(test_no_ems);
@@ -8728,6 +9462,7 @@ int setup_tests(void)
      * in that scenario.
      */
     ADD_ALL_TESTS(test_early_data_replay, 2);
+    ADD_ALL_TESTS(test_early_data_replay_cache, 2);
     ADD_ALL_TESTS(test_early_data_skip, 3);
     ADD_ALL_TESTS(test_early_data_skip_hrr, 3);
     ADD_ALL_TESTS(test_early_data_skip_hrr_fail, 3);
@@ -8803,6 +9538,7 @@ int setup_tests(void)
 #endif
 #ifndef OSSL_NO_USABLE_TLS1_3
     ADD_TEST(test_sni_tls13);
+    ADD_ALL_TESTS(test_cert_comp, 7);
 #endif
     return 1;
 
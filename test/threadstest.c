@@ -7,86 +7,19 @@
  * https://www.openssl.org/source/license.html
  */
 
-#if defined(_WIN32)
-# include <windows.h>
-#endif
-
 #include <string.h>
 #include <openssl/crypto.h>
 #include <openssl/evp.h>
 #include <openssl/aes.h>
 #include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include "internal/nelem.h"
 #include "testutil.h"
+#include "threadstest.h"
 
 static int do_fips = 0;
 static char *privkey;
 
-#if !defined(OPENSSL_THREADS) || defined(CRYPTO_TDEBUG)
-
-typedef unsigned int thread_t;
-
-static int run_thread(thread_t *t, void (*f)(void))
-{
-    f();
-    return 1;
-}
-
-static int wait_for_thread(thread_t thread)
-{
-    return 1;
-}
-
-#elif defined(OPENSSL_SYS_WINDOWS)
-
-typedef HANDLE thread_t;
-
-static DWORD WINAPI thread_run(LPVOID arg)
-{
-    void (*f)(void);
-
-    *(void **) (&f) = arg;
-
-    f();
-    return 0;
-}
-
-static int run_thread(thread_t *t, void (*f)(void))
-{
-    *t = CreateThread(NULL, 0, thread_run, *(void **) &f, 0, NULL);
-    return *t != NULL;
-}
-
-static int wait_for_thread(thread_t thread)
-{
-    return WaitForSingleObject(thread, INFINITE) == 0;
-}
-
-#else
-
-typedef pthread_t thread_t;
-
-static void *thread_run(void *arg)
-{
-    void (*f)(void);
-
-    *(void **) (&f) = arg;
-
-    f();
-    return NULL;
-}
-
-static int run_thread(thread_t *t, void (*f)(void))
-{
-    return pthread_create(t, NULL, thread_run, *(void **) &f) == 0;
-}
-
-static int wait_for_thread(thread_t thread)
-{
-    return pthread_join(thread, NULL) == 0;
-}
-
-#endif
-
 static int test_lock(void)
 {
     CRYPTO_RWLOCK *lock = CRYPTO_THREAD_lock_new();
@@ -401,17 +334,233 @@ static void thread_shared_evp_pkey(void)
         multi_success = 0;
 }
 
+static void thread_shared_evp_pkey_sign(void)
+{
+    unsigned char tbs[32];
+    unsigned char sig[256];
+    size_t siglen;
+    EVP_PKEY_CTX *sctx = NULL, *vctx = NULL;
+    int success = 0;
+    int i;
+
+    sctx = EVP_PKEY_CTX_new_from_pkey(multi_libctx, shared_evp_pkey, NULL);
+    vctx = EVP_PKEY_CTX_new_from_pkey(multi_libctx, shared_evp_pkey, NULL);
+    if (!TEST_ptr(sctx)
+            || !TEST_ptr(vctx)
+            || !TEST_int_gt(EVP_PKEY_sign_init(sctx), 0)
+            || !TEST_int_gt(EVP_PKEY_verify_init(vctx), 0))
+        goto err;
+
+    /*
+     * Enough signatures for every thread to refresh its blinding factors at
+     * least once.
+     */
+    for (i = 0; i < 40; i++) {
+        memset(tbs, i, sizeof(tbs));
+        siglen = sizeof(sig);
+        if (!TEST_int_gt(EVP_PKEY_sign(sctx, sig, &siglen,
+                                       tbs, sizeof(tbs)), 0)
+                || !TEST_int_gt(EVP_PKEY_verify(vctx, sig, siglen,
+                                                tbs, sizeof(tbs)), 0))
+            goto err;
+    }
+
+    success = 1;
+
+ err:
+    EVP_PKEY_CTX_free(sctx);
+    EVP_PKEY_CTX_free(vctx);
+    if (!success)
+        multi_success = 0;
+}
+
+/*
+ * Returns a certificate for |pkey|, freshly parsed from its DER encoding so
+ * that its public key has not been decoded yet.  If |corrupt| is set, the
+ * encoding of the public key is broken, so that decoding it fails.
+ */
+static X509 *make_fresh_cert(EVP_PKEY *pkey, int corrupt)
+{
+    X509 *x = NULL, *ret = NULL;
+    X509_NAME *name = NULL;
+    const ASN1_BIT_STRING *key;
+    unsigned char *der = NULL;
+    const unsigned char *p;
+    int der_len, i;
+
+    if (!TEST_ptr(x = X509_new_ex(multi_libctx, NULL))
+            || !TEST_ptr(name = X509_NAME_new())
+            || !TEST_true(X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                                     (unsigned char *)"Test",
+                                                     -1, -1, 0))
+            || !TEST_true(X509_set_version(x, 2))
+            || !TEST_true(ASN1_INTEGER_set(X509_get_serialNumber(x), 1))
+            || !TEST_true(X509_set_subject_name(x, name))
+            || !TEST_true(X509_set_issuer_name(x, name))
+            || !TEST_ptr(X509_gmtime_adj(X509_getm_notBefore(x), 0))
+            || !TEST_ptr(X509_gmtime_adj(X509_getm_notAfter(x), 60))
+            || !TEST_true(X509_set_pubkey(x, pkey))
+            || !TEST_int_gt(X509_sign(x, pkey, EVP_sha256()), 0)
+            || !TEST_int_gt(der_len = i2d_X509(x, &der), 0)
+            || !TEST_ptr(key = X509_get0_pubkey_bitstr(x)))
+        goto err;
+
+    if (corrupt) {
+        /* Turn the outer SEQUENCE of the RSAPublicKey into a SET */
+        for (i = 0; i + key->length <= der_len; i++)
+            if (memcmp(der + i, key->data, key->length) == 0)
+                break;
+        if (!TEST_int_le(i + key->length, der_len))
+            goto err;
+        der[i] = V_ASN1_SET | V_ASN1_CONSTRUCTED;
+    }
+
+    p = der;
+    if (TEST_ptr(ret = X509_new_ex(multi_libctx, NULL))
+            && !TEST_ptr(d2i_X509(&ret, &p, der_len))) {
+        X509_free(ret);
+        ret = NULL;
+    }
+
+ err:
+    OPENSSL_free(der);
+    X509_NAME_free(name);
+    X509_free(x);
+    return ret;
+}
+
+/*
+ * Getting the public key of a freshly parsed certificate, one call after the
+ * other.  The key must only be decoded once, and if decoding fails, every
+ * call must fail and report an error.
+ */
+static int test_x509_pubkey_lazy(void)
+{
+    X509 *good = NULL, *bad = NULL;
+    EVP_PKEY *pkey = NULL, *first = NULL;
+    int i, testresult = 0;
+
+    if (!TEST_ptr(multi_libctx = OSSL_LIB_CTX_new())
+            || !TEST_ptr(pkey = load_pkey_pem(privkey, multi_libctx))
+            || !TEST_ptr(good = make_fresh_cert(pkey, 0))
+            || !TEST_ptr(bad = make_fresh_cert(pkey, 1)))
+        goto err;
+
+    /* Hold a reference, so that a second decode cannot reuse its address */
+    if (!TEST_ptr(first = X509_get_pubkey(good))
+            || !TEST_int_eq(EVP_PKEY_eq(first, pkey), 1))
+        goto err;
+    for (i = 0; i < 3; i++) {
+        if (!TEST_ptr_eq(X509_get0_pubkey(good), first)
+                || !TEST_ptr_eq(X509_PUBKEY_get0(X509_get_X509_PUBKEY(good)),
+                                first))
+            goto err;
+    }
+
+    for (i = 0; i < 3; i++) {
+        ERR_clear_error();
+        if (!TEST_ptr_null(X509_get0_pubkey(bad))
+                || !TEST_ulong_ne(ERR_peek_error(), 0))
+            goto err;
+    }
+    ERR_clear_error();
+
+    testresult = 1;
+
+ err:
+    EVP_PKEY_free(first);
+    X509_free(good);
+    X509_free(bad);
+    EVP_PKEY_free(pkey);
+    OSSL_LIB_CTX_free(multi_libctx);
+    multi_libctx = NULL;
+    return testresult;
+}
+
+static X509 *shared_x509 = NULL;
+/* The references each thread got, so that their addresses stay unique */
+static EVP_PKEY *shared_x509_pkey[3];
+static int shared_x509_count = 0;
+static CRYPTO_RWLOCK *shared_x509_lock = NULL;
+
+static void thread_shared_x509_pubkey(void)
+{
+    EVP_PKEY *pkey = X509_get_pubkey(shared_x509);
+    int i, n;
+
+    /* Every call in this thread must give the same key */
+    for (i = 0; i < 100; i++)
+        if (!TEST_ptr_eq(X509_get0_pubkey(shared_x509), pkey))
+            multi_success = 0;
+
+    if (CRYPTO_atomic_add(&shared_x509_count, 1, &n, shared_x509_lock)
+            && n <= (int)OSSL_NELEM(shared_x509_pkey)) {
+        shared_x509_pkey[n - 1] = pkey;
+    } else {
+        EVP_PKEY_free(pkey);
+        multi_success = 0;
+    }
+}
+
+static void thread_shared_x509_bad_pubkey(void)
+{
+    int i;
+
+    for (i = 0; i < 100; i++) {
+        ERR_clear_error();
+        if (!TEST_ptr_null(X509_get0_pubkey(shared_x509))
+                || !TEST_ulong_ne(ERR_peek_error(), 0))
+            multi_success = 0;
+    }
+    ERR_clear_error();
+}
+
+/*
+ * Names with the same encoding share one interned copy, so creating and
+ * freeing them in several threads at once races taking the first reference
+ * to the copy with dropping the last one.
+ */
+static void thread_x509_name_intern(void)
+{
+    static const unsigned char cn[] = "Test";
+    X509_NAME *name, *keep = NULL;
+    int i;
+
+    for (i = 0; i < 1000 && multi_success; i++) {
+        if (!TEST_ptr(name = X509_NAME_new())
+                || !TEST_true(X509_NAME_add_entry_by_txt(name, "CN",
+                                                         MBSTRING_ASC, cn,
+                                                         -1, -1, 0))
+                || !TEST_int_gt(i2d_X509_NAME(name, NULL), 0)
+                || (keep != NULL
+                    && !TEST_int_eq(X509_NAME_cmp(name, keep), 0)))
+            multi_success = 0;
+        /* Keep a name now and then, so the copy goes in and out of use */
+        X509_NAME_free(keep);
+        keep = NULL;
+        if (i % 3 == 0)
+            keep = name;
+        else
+            X509_NAME_free(name);
+    }
+    X509_NAME_free(keep);
+}
+
 /*
  * Do work in multiple worker threads at the same time.
  * Test 0: General worker, using the default provider
  * Test 1: General worker, using the fips provider
  * Test 2: Simple fetch worker
  * Test 3: Worker using a shared EVP_PKEY
+ * Test 4: Worker signing with a shared EVP_PKEY
+ * Test 5: Worker getting the public key of a shared, freshly parsed X509
+ * Test 6: As test 5, with a public key that fails to decode
+ * Test 7: Worker creating and freeing X509_NAMEs with the same encoding
  */
 static int test_multi(int idx)
 {
     thread_t thread1, thread2;
-    int testresult = 0;
+    int i, testresult = 0;
     OSSL_PROVIDER *prov = NULL, *prov2 = NULL;
     void (*worker)(void);
 
@@ -446,6 +595,26 @@ static int test_multi(int idx)
             goto err;
         worker = thread_shared_evp_pkey;
         break;
+    case 4:
+        if (!TEST_ptr(shared_evp_pkey = load_pkey_pem(privkey, multi_libctx)))
+            goto err;
+        worker = thread_shared_evp_pkey_sign;
+        break;
+    case 5:
+    case 6:
+        shared_x509_count = 0;
+        if (!TEST_ptr(shared_x509_lock = CRYPTO_THREAD_lock_new())
+                || !TEST_ptr(shared_evp_pkey = load_pkey_pem(privkey,
+                                                             multi_libctx))
+                || !TEST_ptr(shared_x509 = make_fresh_cert(shared_evp_pkey,
+                                                           idx == 6)))
+            goto err;
+        worker = idx == 5 ? thread_shared_x509_pubkey
+                          : thread_shared_x509_bad_pubkey;
+        break;
+    case 7:
+        worker = thread_x509_name_intern;
+        break;
     default:
         TEST_error("Invalid test index");
         goto err;
@@ -462,9 +631,29 @@ static int test_multi(int idx)
             || !TEST_true(multi_success))
         goto err;
 
+    /* All threads, and later calls, must see the one decoded key */
+    if (idx == 5
+            && (!TEST_int_eq(shared_x509_count, 3)
+                || !TEST_ptr(shared_x509_pkey[0])
+                || !TEST_ptr_eq(shared_x509_pkey[1], shared_x509_pkey[0])
+                || !TEST_ptr_eq(shared_x509_pkey[2], shared_x509_pkey[0])
+                || !TEST_ptr_eq(X509_get0_pubkey(shared_x509),
+                                shared_x509_pkey[0])
+                || !TEST_int_eq(EVP_PKEY_eq(shared_x509_pkey[0],
+                                            shared_evp_pkey), 1)))
+        goto err;
+
     testresult = 1;
 
  err:
+    for (i = 0; i < (int)OSSL_NELEM(shared_x509_pkey); i++) {
+        EVP_PKEY_free(shared_x509_pkey[i]);
+        shared_x509_pkey[i] = NULL;
+    }
+    X509_free(shared_x509);
+    shared_x509 = NULL;
+    CRYPTO_THREAD_lock_free(shared_x509_lock);
+    shared_x509_lock = NULL;
     OSSL_PROVIDER_unload(prov);
     OSSL_PROVIDER_unload(prov2);
     OSSL_LIB_CTX_free(multi_libctx);
@@ -518,7 +707,8 @@ int setup_tests(void)
     ADD_TEST(test_once);
     ADD_TEST(test_thread_local);
     ADD_TEST(test_atomic);
-    ADD_ALL_TESTS(test_multi, 4);
+    ADD_TEST(test_x509_pubkey_lazy);
+    ADD_ALL_TESTS(test_multi, 8);
     return 1;
 }
 
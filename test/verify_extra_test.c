@@ -9,11 +9,13 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <openssl/crypto.h>
 #include <openssl/bio.h>
 #include <openssl/x509.h>
 #include <openssl/pem.h>
 #include <openssl/err.h>
+#include <openssl/x509v3.h>
 #include "testutil.h"
 
 static const char *root_f;
@@ -220,6 +222,590 @@ static int test_store_ctx(void)
     return test_self_signed(bad_f, 0, 0);
 }
 
+/*
+ * roots.pem and untrusted.pem hold four different certificates, two of which
+ * (subinterCA and subinterCA (ss)) have the same subject name.
+ */
+static int test_store_lookup(void)
+{
+    X509_STORE *store = NULL;
+    X509_STORE_CTX *ctx = NULL;
+    X509 *bad = NULL, *leaf = NULL, *issuer = NULL;
+    STACK_OF(X509) *certs = NULL;
+    X509_OBJECT *obj = NULL;
+    X509_NAME *unknown = NULL;
+    const X509_NAME *nm;
+    int i, ret = 0;
+
+    if (!TEST_ptr(store = X509_STORE_new())
+            || !TEST_ptr(ctx = X509_STORE_CTX_new()))
+        goto err;
+
+    /* Adding the same certificates again must not create duplicates */
+    for (i = 0; i < 2; i++) {
+        if (!TEST_true(X509_STORE_load_file(store, roots_f))
+                || !TEST_true(X509_STORE_load_file(store, untrusted_f)))
+            goto err;
+    }
+    if (!TEST_int_eq(sk_X509_OBJECT_num(X509_STORE_get0_objects(store)), 4))
+        goto err;
+
+    if (!TEST_ptr(bad = load_cert_from_file(bad_f))
+            || !TEST_true(X509_STORE_CTX_init(ctx, store, bad, NULL)))
+        goto err;
+
+    /* The issuer of bad is leaf */
+    if (!TEST_int_eq(X509_STORE_CTX_get1_issuer(&leaf, ctx, bad), 1)
+            || !TEST_int_eq(X509_NAME_cmp(X509_get_subject_name(leaf),
+                                          X509_get_issuer_name(bad)), 0))
+        goto err;
+
+    /* The issuer of leaf is either subinterCA */
+    nm = X509_get_issuer_name(leaf);
+    if (!TEST_int_eq(X509_STORE_CTX_get1_issuer(&issuer, ctx, leaf), 1)
+            || !TEST_int_eq(X509_NAME_cmp(X509_get_subject_name(issuer), nm),
+                            0))
+        goto err;
+
+    /* All certificates with a subject name are returned */
+    if (!TEST_ptr(certs = X509_STORE_CTX_get1_certs(ctx, nm))
+            || !TEST_int_eq(sk_X509_num(certs), 2)
+            || !TEST_int_ne(X509_cmp(sk_X509_value(certs, 0),
+                                     sk_X509_value(certs, 1)), 0))
+        goto err;
+    for (i = 0; i < sk_X509_num(certs); i++)
+        if (!TEST_int_eq(X509_NAME_cmp(X509_get_subject_name(sk_X509_value(certs, i)),
+                                       nm), 0))
+            goto err;
+
+    /* Certificates and CRLs are kept apart */
+    if (!TEST_ptr(obj = X509_STORE_CTX_get_obj_by_subject(ctx, X509_LU_X509,
+                                                          nm)))
+        goto err;
+    X509_OBJECT_free(obj);
+    if (!TEST_ptr_null(obj = X509_STORE_CTX_get_obj_by_subject(ctx,
+                                                               X509_LU_CRL,
+                                                               nm)))
+        goto err;
+
+    /* Unknown names are not found */
+    if (!TEST_ptr(unknown = X509_NAME_new())
+            || !TEST_true(X509_NAME_add_entry_by_txt(unknown, "CN", MBSTRING_ASC,
+                                                     (unsigned char *)"unknown",
+                                                     -1, -1, 0))
+            || !TEST_ptr_null(X509_STORE_CTX_get1_certs(ctx, unknown)))
+        goto err;
+
+    ret = 1;
+ err:
+    X509_NAME_free(unknown);
+    X509_OBJECT_free(obj);
+    sk_X509_pop_free(certs, X509_free);
+    X509_free(issuer);
+    X509_free(leaf);
+    X509_free(bad);
+    X509_STORE_CTX_free(ctx);
+    X509_STORE_free(store);
+    return ret;
+}
+
+/*
+ * Verifies |x| with |store|, and returns 1 on success, with the verified
+ * chain in |*chain| if |chain| is not NULL, or the opposite of the
+ * verification error on failure.
+ */
+static int verify_cached(X509_STORE *store, X509 *x, STACK_OF(X509) *untrusted,
+                         const char *host, STACK_OF(X509) **chain)
+{
+    X509_STORE_CTX *ctx = X509_STORE_CTX_new();
+    X509_VERIFY_PARAM *vpm;
+    int ret = -1;
+
+    if (!TEST_ptr(ctx)
+            || !TEST_true(X509_STORE_CTX_init(ctx, store, x, untrusted)))
+        goto end;
+    vpm = X509_STORE_CTX_get0_param(ctx);
+    if (host != NULL && !TEST_true(X509_VERIFY_PARAM_set1_host(vpm, host, 0)))
+        goto end;
+
+    ret = X509_verify_cert(ctx);
+    if (ret > 0 && chain != NULL)
+        *chain = X509_STORE_CTX_get1_chain(ctx);
+    else if (ret <= 0)
+        ret = -X509_STORE_CTX_get_error(ctx);
+ end:
+    X509_STORE_CTX_free(ctx);
+    return ret;
+}
+
+static int test_verify_cache(void)
+{
+    X509_STORE *store = NULL;
+    STACK_OF(X509) *untrusted = NULL, *chain[2] = { NULL, NULL };
+    X509 *leaf, *bad = NULL;
+    int i, ret = 0;
+
+    if (!TEST_ptr(store = X509_STORE_new())
+            || !TEST_true(X509_STORE_load_file(store, roots_f))
+            || !TEST_true(X509_STORE_set_verify_cache(store, 16))
+            || !TEST_ptr(untrusted = load_certs_pem(untrusted_f))
+            || !TEST_ptr(bad = load_cert_from_file(bad_f)))
+        goto err;
+    /* untrusted.pem holds subinterCA and leaf */
+    leaf = sk_X509_value(untrusted, 1);
+
+    /* The second verification returns the same chain as the first one */
+    for (i = 0; i < 2; i++)
+        if (!TEST_int_eq(verify_cached(store, leaf, untrusted, NULL,
+                                       &chain[i]), 1))
+            goto err;
+    if (!TEST_int_eq(sk_X509_num(chain[0]), sk_X509_num(chain[1])))
+        goto err;
+    for (i = 0; i < sk_X509_num(chain[0]); i++)
+        if (!TEST_int_eq(X509_cmp(sk_X509_value(chain[0], i),
+                                  sk_X509_value(chain[1], i)), 0))
+            goto err;
+
+    /* Different parameters are verified separately */
+    if (!TEST_int_eq(verify_cached(store, leaf, untrusted, "leaf.invalid",
+                                   NULL), -X509_V_ERR_HOSTNAME_MISMATCH))
+        goto err;
+
+    /* Failures are never cached */
+    for (i = 0; i < 2; i++)
+        if (!TEST_int_eq(verify_cached(store, bad, untrusted, NULL, NULL),
+                         -X509_V_ERR_INVALID_CA))
+            goto err;
+
+    /* Changing the store flushes the cache */
+    if (!TEST_true(X509_STORE_add_cert(store, leaf))
+            || !TEST_int_eq(verify_cached(store, leaf, untrusted, NULL, NULL),
+                            1)
+            || !TEST_true(X509_STORE_set_verify_cache(store, 0))
+            || !TEST_int_eq(verify_cached(store, leaf, untrusted, NULL, NULL),
+                            1))
+        goto err;
+
+    ret = 1;
+ err:
+    sk_X509_pop_free(chain[0], X509_free);
+    sk_X509_pop_free(chain[1], X509_free);
+    sk_X509_pop_free(untrusted, X509_free);
+    X509_free(bad);
+    X509_STORE_free(store);
+    return ret;
+}
+
+/*
+ * Adds (if |add| is set) or removes the certificates of |certs| as hashed
+ * files in the current directory, which is private to the test.
+ */
+static int hashed_files(STACK_OF(X509) *certs, int add)
+{
+    char name[16];
+    BIO *bio;
+    int i, ok;
+
+    for (i = 0; i < sk_X509_num(certs); i++) {
+        X509 *x = sk_X509_value(certs, i);
+
+        BIO_snprintf(name, sizeof(name), "%08lx.0",
+                     X509_NAME_hash_ex(X509_get_subject_name(x), NULL, NULL,
+                                       NULL));
+        if (!add) {
+            remove(name);
+            continue;
+        }
+        ok = TEST_ptr(bio = BIO_new_file(name, "w"))
+             && TEST_true(PEM_write_bio_X509(bio, x));
+        BIO_free(bio);
+        if (!ok)
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * Test 0: hashed directory without index or negative cache
+ * Test 1: with an index
+ * Test 2: with a negative cache
+ * Test 3: with a negative cache, forgotten when a certificate is added to the
+ *         store
+ * Test 4: with a negative cache, forgotten when a directory is added
+ */
+static int test_dir_lookup(int tst)
+{
+    X509_STORE *store = NULL;
+    X509_LOOKUP *lookup;
+    STACK_OF(X509) *roots = NULL, *untrusted = NULL;
+    X509 *leaf, *root = NULL;
+    int ret = 0;
+
+    if (!TEST_ptr(roots = load_certs_pem(roots_f))
+            || !TEST_ptr(untrusted = load_certs_pem(untrusted_f))
+            || !TEST_ptr(store = X509_STORE_new())
+            || !TEST_ptr(lookup = X509_STORE_add_lookup(store,
+                                                        X509_LOOKUP_hash_dir()))
+            || (tst != 4
+                && !TEST_true(X509_LOOKUP_add_dir(lookup, ".",
+                                                  X509_FILETYPE_PEM)))
+            || !TEST_true(X509_LOOKUP_set_dir_index(lookup, tst == 1))
+            || !TEST_true(X509_LOOKUP_set_dir_negative_ttl(lookup,
+                                                           tst >= 2 ? 3600
+                                                                    : 0)))
+        goto err;
+    leaf = sk_X509_value(untrusted, 1);
+    hashed_files(roots, 0);
+
+    if (!TEST_int_eq(verify_cached(store, leaf, untrusted, NULL, NULL),
+                     -X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY)
+            || !TEST_true(hashed_files(roots, 1)))
+        goto err;
+
+    if (tst == 3) {
+        /* Any certificate does, even one that is not in the chain */
+        if (!TEST_ptr(root = load_cert_from_file(root_f))
+                || !TEST_true(X509_STORE_add_cert(store, root)))
+            goto err;
+    } else if (tst == 4) {
+        if (!TEST_true(X509_LOOKUP_add_dir(lookup, ".", X509_FILETYPE_PEM)))
+            goto err;
+    }
+
+    /*
+     * The index and negative cache do not see the new files until reloaded,
+     * unless the negative cache has been forgotten
+     */
+    if (!TEST_int_eq(verify_cached(store, leaf, untrusted, NULL, NULL),
+                     tst == 0 || tst >= 3
+                     ? 1 : -X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY)
+            || !TEST_true(X509_LOOKUP_reload_dir(lookup))
+            || !TEST_int_eq(verify_cached(store, leaf, untrusted, NULL, NULL),
+                            1))
+        goto err;
+
+    /* Once loaded, the certificates no longer need the files */
+    hashed_files(roots, 0);
+    if (!TEST_int_eq(verify_cached(store, leaf, untrusted, NULL, NULL), 1))
+        goto err;
+
+    ret = 1;
+ err:
+    hashed_files(roots, 0);
+    X509_free(root);
+    sk_X509_pop_free(roots, X509_free);
+    sk_X509_pop_free(untrusted, X509_free);
+    X509_STORE_free(store);
+    return ret;
+}
+
+#ifndef OPENSSL_NO_EC
+static EVP_PKEY *ed25519_keygen(void)
+{
+    EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new_from_name(NULL, "ED25519", NULL);
+    EVP_PKEY *pkey = NULL;
+
+    if (!TEST_ptr(pctx)
+            || !TEST_int_gt(EVP_PKEY_keygen_init(pctx), 0)
+            || !TEST_int_gt(EVP_PKEY_keygen(pctx, &pkey), 0))
+        pkey = NULL;
+    EVP_PKEY_CTX_free(pctx);
+    return pkey;
+}
+
+/*
+ * Returns a CA certificate for |key| issued by |issuer| with |signkey|, or
+ * self-signed if |issuer| is NULL, as if it was just received.
+ */
+static X509 *make_cert(const char *cn, EVP_PKEY *key, X509 *issuer,
+                       EVP_PKEY *signkey)
+{
+    X509 *x = X509_new(), *ret = NULL;
+    BASIC_CONSTRAINTS *bc = BASIC_CONSTRAINTS_new();
+
+    if (!TEST_ptr(x) || !TEST_ptr(bc))
+        goto end;
+    bc->ca = 1;
+    if (TEST_true(X509_set_version(x, 2))
+            && TEST_true(ASN1_INTEGER_set(X509_get_serialNumber(x), 1))
+            && TEST_ptr(X509_gmtime_adj(X509_getm_notBefore(x), 0))
+            && TEST_ptr(X509_gmtime_adj(X509_getm_notAfter(x), 3600))
+            && TEST_true(X509_NAME_add_entry_by_txt(X509_get_subject_name(x),
+                                                    "CN", MBSTRING_ASC,
+                                                    (unsigned char *)cn,
+                                                    -1, -1, 0))
+            && TEST_true(X509_set_issuer_name(x, issuer != NULL
+                                                 ? X509_get_subject_name(issuer)
+                                                 : X509_get_subject_name(x)))
+            && TEST_true(X509_set_pubkey(x, key))
+            && TEST_true(X509_add1_ext_i2d(x, NID_basic_constraints, bc, 1,
+                                           X509V3_ADD_DEFAULT))
+            && TEST_int_gt(X509_sign(x, signkey, NULL), 0))
+        ret = X509_dup(x);
+ end:
+    BASIC_CONSTRAINTS_free(bc);
+    X509_free(x);
+    return ret;
+}
+
+/*
+ * Returns a CRL issued by |issuer| with |key|, last updated |age| seconds
+ * ago, that revokes |revoked| if it is not NULL, as if it was just received.
+ */
+static X509_CRL *make_crl(X509 *issuer, EVP_PKEY *key, long age,
+                          X509 *revoked)
+{
+    X509_CRL *crl = X509_CRL_new(), *ret = NULL;
+    X509_REVOKED *rev = NULL;
+    ASN1_TIME *last = NULL, *next = NULL;
+    X509_NAME *name = X509_get_subject_name(issuer);
+
+    if (!TEST_ptr(crl)
+            || !TEST_true(X509_CRL_set_version(crl, 1))
+            || !TEST_true(X509_CRL_set_issuer_name(crl, name))
+            || !TEST_ptr(last = X509_gmtime_adj(NULL, -age))
+            || !TEST_ptr(next = X509_gmtime_adj(NULL, 3600))
+            || !TEST_true(X509_CRL_set1_lastUpdate(crl, last))
+            || !TEST_true(X509_CRL_set1_nextUpdate(crl, next)))
+        goto end;
+    if (revoked != NULL) {
+        if (!TEST_ptr(rev = X509_REVOKED_new())
+                || !TEST_true(X509_REVOKED_set_serialNumber(rev,
+                                  X509_get_serialNumber(revoked)))
+                || !TEST_true(X509_REVOKED_set_revocationDate(rev, last))
+                || !TEST_true(X509_CRL_add0_revoked(crl, rev)))
+            goto end;
+        rev = NULL;
+    }
+    if (TEST_true(X509_CRL_sort(crl))
+            && TEST_int_gt(X509_CRL_sign(crl, key, NULL), 0))
+        ret = X509_CRL_dup(crl);
+ end:
+    X509_REVOKED_free(rev);
+    ASN1_TIME_free(last);
+    ASN1_TIME_free(next);
+    X509_CRL_free(crl);
+    return ret;
+}
+
+/* A CRL added to the store after a cached success applies to the next one */
+static int test_verify_cache_crl(void)
+{
+    EVP_PKEY *keys[2] = { NULL, NULL };
+    X509 *root = NULL, *ee = NULL;
+    X509_CRL *crl = NULL;
+    X509_STORE *store = NULL;
+    int i, ret = 0;
+
+    for (i = 0; i < 2; i++)
+        if (!TEST_ptr(keys[i] = ed25519_keygen()))
+            goto err;
+    if (!TEST_ptr(root = make_cert("Root", keys[0], NULL, keys[0]))
+            || !TEST_ptr(ee = make_cert("EE", keys[1], root, keys[0]))
+            || !TEST_ptr(store = X509_STORE_new())
+            || !TEST_true(X509_STORE_add_cert(store, root))
+            || !TEST_true(X509_STORE_set_flags(store, X509_V_FLAG_CRL_CHECK))
+            || !TEST_true(X509_STORE_set_verify_cache(store, 16))
+            || !TEST_ptr(crl = make_crl(root, keys[0], 120, NULL))
+            || !TEST_true(X509_STORE_add_crl(store, crl)))
+        goto err;
+    X509_CRL_free(crl);
+    crl = NULL;
+
+    for (i = 0; i < 2; i++)
+        if (!TEST_int_eq(verify_cached(store, ee, NULL, NULL, NULL), 1))
+            goto err;
+
+    /* The newer CRL revokes |ee| */
+    if (!TEST_ptr(crl = make_crl(root, keys[0], 60, ee))
+            || !TEST_true(X509_STORE_add_crl(store, crl))
+            || !TEST_int_eq(verify_cached(store, ee, NULL, NULL, NULL),
+                            -X509_V_ERR_CERT_REVOKED))
+        goto err;
+
+    ret = 1;
+ err:
+    X509_CRL_free(crl);
+    X509_STORE_free(store);
+    X509_free(root);
+    X509_free(ee);
+    for (i = 0; i < 2; i++)
+        EVP_PKEY_free(keys[i]);
+    return ret;
+}
+
+/*
+ * With a lookup method, the CRLs are looked up on each verification, so a
+ * CRL that only the lookup method has, here a new file in a hashed
+ * directory, applies although nothing was added to the store
+ */
+static int test_verify_cache_crl_lookup(void)
+{
+    EVP_PKEY *keys[2] = { NULL, NULL };
+    X509 *root = NULL, *ee = NULL;
+    X509_CRL *crl = NULL;
+    X509_STORE *store = NULL;
+    X509_LOOKUP *lookup;
+    BIO *bio = NULL;
+    char name[16];
+    int i, ret = 0;
+
+    for (i = 0; i < 2; i++)
+        if (!TEST_ptr(keys[i] = ed25519_keygen()))
+            goto err;
+    if (!TEST_ptr(root = make_cert("Root", keys[0], NULL, keys[0]))
+            || !TEST_ptr(ee = make_cert("EE", keys[1], root, keys[0]))
+            || !TEST_ptr(store = X509_STORE_new())
+            || !TEST_ptr(lookup = X509_STORE_add_lookup(store,
+                                                        X509_LOOKUP_hash_dir()))
+            || !TEST_true(X509_LOOKUP_add_dir(lookup, ".", X509_FILETYPE_PEM))
+            || !TEST_true(X509_STORE_add_cert(store, root))
+            || !TEST_true(X509_STORE_set_flags(store, X509_V_FLAG_CRL_CHECK))
+            || !TEST_true(X509_STORE_set_verify_cache(store, 16))
+            || !TEST_ptr(crl = make_crl(root, keys[0], 120, NULL))
+            || !TEST_true(X509_STORE_add_crl(store, crl)))
+        goto err;
+    X509_CRL_free(crl);
+    crl = NULL;
+    BIO_snprintf(name, sizeof(name), "%08lx.r0",
+                 X509_NAME_hash_ex(X509_get_subject_name(root), NULL, NULL,
+                                   NULL));
+    remove(name);
+
+    for (i = 0; i < 2; i++)
+        if (!TEST_int_eq(verify_cached(store, ee, NULL, NULL, NULL), 1))
+            goto err;
+
+    /* The newer CRL revokes |ee| */
+    if (!TEST_ptr(crl = make_crl(root, keys[0], 60, ee))
+            || !TEST_ptr(bio = BIO_new_file(name, "w"))
+            || !TEST_true(PEM_write_bio_X509_CRL(bio, crl)))
+        goto err;
+    BIO_free(bio);
+    bio = NULL;
+    if (!TEST_int_eq(verify_cached(store, ee, NULL, NULL, NULL),
+                     -X509_V_ERR_CERT_REVOKED))
+        goto err;
+
+    ret = 1;
+ err:
+    BIO_free(bio);
+    remove(name);
+    X509_CRL_free(crl);
+    X509_STORE_free(store);
+    X509_free(root);
+    X509_free(ee);
+    for (i = 0; i < 2; i++)
+        EVP_PKEY_free(keys[i]);
+    return ret;
+}
+
+/* A cached success only holds within the validity period of the chain */
+static int test_verify_cache_time(void)
+{
+    EVP_PKEY *keys[2] = { NULL, NULL };
+    X509 *root = NULL, *ee = NULL;
+    X509_STORE *store = NULL;
+    X509_VERIFY_PARAM *vpm;
+    time_t now = time(NULL);
+    int i, ret = 0;
+
+    for (i = 0; i < 2; i++)
+        if (!TEST_ptr(keys[i] = ed25519_keygen()))
+            goto err;
+    /* Both are valid for an hour from now */
+    if (!TEST_ptr(root = make_cert("Root", keys[0], NULL, keys[0]))
+            || !TEST_ptr(ee = make_cert("EE", keys[1], root, keys[0]))
+            || !TEST_ptr(store = X509_STORE_new())
+            || !TEST_true(X509_STORE_add_cert(store, root))
+            || !TEST_true(X509_STORE_set_verify_cache(store, 16)))
+        goto err;
+    vpm = X509_STORE_get0_param(store);
+
+    X509_VERIFY_PARAM_set_time(vpm, now + 60);
+    for (i = 0; i < 2; i++)
+        if (!TEST_int_eq(verify_cached(store, ee, NULL, NULL, NULL), 1))
+            goto err;
+
+    X509_VERIFY_PARAM_set_time(vpm, now + 7200);
+    if (!TEST_int_eq(verify_cached(store, ee, NULL, NULL, NULL),
+                     -X509_V_ERR_CERT_HAS_EXPIRED))
+        goto err;
+
+    X509_VERIFY_PARAM_set_time(vpm, now - 3600);
+    if (!TEST_int_eq(verify_cached(store, ee, NULL, NULL, NULL),
+                     -X509_V_ERR_CERT_NOT_YET_VALID))
+        goto err;
+
+    ret = 1;
+ err:
+    X509_STORE_free(store);
+    X509_free(root);
+    X509_free(ee);
+    for (i = 0; i < 2; i++)
+        EVP_PKEY_free(keys[i]);
+    return ret;
+}
+
+/*
+ * Test 0: valid Ed25519 chain verified with X509_V_FLAG_BATCH_VERIFY
+ * Test 1: bad end-entity signature
+ * Test 2: bad intermediate signature
+ */
+static int test_batch_verify(int tst)
+{
+    EVP_PKEY *keys[3] = { NULL, NULL, NULL };
+    X509 *root = NULL, *ca = NULL, *ee = NULL;
+    X509_STORE *store = NULL;
+    X509_STORE_CTX *ctx = NULL;
+    STACK_OF(X509) *untrusted = NULL;
+    ASN1_BIT_STRING *sig;
+    int i, ret = 0;
+
+    for (i = 0; i < 3; i++)
+        if (!TEST_ptr(keys[i] = ed25519_keygen()))
+            goto err;
+    if (!TEST_ptr(root = make_cert("Root", keys[0], NULL, keys[0]))
+            || !TEST_ptr(ca = make_cert("CA", keys[1], root, keys[0]))
+            || !TEST_ptr(ee = make_cert("EE", keys[2], ca, keys[1]))
+            || !TEST_ptr(untrusted = sk_X509_new_null())
+            || !TEST_true(sk_X509_push(untrusted, ca))
+            || !TEST_ptr(store = X509_STORE_new())
+            || !TEST_true(X509_STORE_add_cert(store, root))
+            || !TEST_true(X509_STORE_set_flags(store, X509_V_FLAG_BATCH_VERIFY))
+            || !TEST_ptr(ctx = X509_STORE_CTX_new()))
+        goto err;
+
+    if (tst > 0) {
+        X509_get0_signature((const ASN1_BIT_STRING **)&sig, NULL,
+                            tst == 1 ? ee : ca);
+        sig->data[0] ^= 1;
+    }
+
+    if (!TEST_true(X509_STORE_CTX_init(ctx, store, ee, untrusted))
+            || !TEST_int_eq(X509_verify_cert(ctx), tst == 0))
+        goto err;
+    if (tst > 0
+            && (!TEST_int_eq(X509_STORE_CTX_get_error(ctx),
+                             X509_V_ERR_CERT_SIGNATURE_FAILURE)
+                || !TEST_int_eq(X509_STORE_CTX_get_error_depth(ctx),
+                                tst - 1)))
+        goto err;
+
+    ret = 1;
+ err:
+    X509_STORE_CTX_free(ctx);
+    X509_STORE_free(store);
+    sk_X509_free(untrusted);
+    X509_free(root);
+    X509_free(ca);
+    X509_free(ee);
+    for (i = 0; i < 3; i++)
+        EVP_PKEY_free(keys[i]);
+    return ret;
+}
+#endif
+
 int setup_tests(void)
 {
     if (!test_skip_common_options()) {
@@ -241,5 +827,14 @@ int setup_tests(void)
     ADD_TEST(test_self_signed_good);
     ADD_TEST(test_self_signed_bad);
     ADD_TEST(test_self_signed_error);
+    ADD_TEST(test_store_lookup);
+    ADD_TEST(test_verify_cache);
+    ADD_ALL_TESTS(test_dir_lookup, 5);
+#ifndef OPENSSL_NO_EC
+    ADD_ALL_TESTS(test_batch_verify, 3);
+    ADD_TEST(test_verify_cache_crl);
+    ADD_TEST(test_verify_cache_crl_lookup);
+    ADD_TEST(test_verify_cache_time);
+#endif
     return 1;
 }
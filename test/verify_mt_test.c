@@ -0,0 +1,217 @@
+/*
+ * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Benchmark for certificate verification by many threads sharing the same
+ * X509_STORE, as done by a server verifying client certificates. It compares
+ * an ordinary store with a read mostly one, without and with a verification
+ * cache, and reports the number of verifications per second for various
+ * numbers of threads.
+ */
+
+#include <openssl/crypto.h>
+#include <openssl/pem.h>
+#include <openssl/x509_vfy.h>
+#include "internal/nelem.h"
+#include "testutil.h"
+#include "threadstest.h"
+
+#ifndef OPENSSL_SYS_WINDOWS
+# include <sys/time.h>
+#endif
+
+#define VERIFICATIONS   200
+
+static const char *certs_dir = NULL;
+static X509 *root = NULL, *root2 = NULL, *ca = NULL, *ee = NULL;
+static STACK_OF(X509) *untrusted = NULL;
+
+/* State shared by the verification threads */
+static X509_STORE *verify_store = NULL;
+static int verify_success = 1;
+
+static double wall_time(void)
+{
+#ifdef OPENSSL_SYS_WINDOWS
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+#endif
+}
+
+static X509 *load_cert(const char *name)
+{
+    char *path = test_mk_file_path(certs_dir, name);
+    BIO *bio = NULL;
+    X509 *cert = NULL;
+
+    if (TEST_ptr(path) && TEST_ptr(bio = BIO_new_file(path, "r")))
+        (void)TEST_ptr(cert = PEM_read_bio_X509(bio, NULL, NULL, NULL));
+    BIO_free(bio);
+    OPENSSL_free(path);
+    return cert;
+}
+
+static int verify_ee(X509_STORE *store)
+{
+    X509_STORE_CTX *ctx = X509_STORE_CTX_new();
+    int ret = ctx != NULL
+              && X509_STORE_CTX_init(ctx, store, ee, untrusted)
+              && X509_verify_cert(ctx) == 1;
+
+    X509_STORE_CTX_free(ctx);
+    return ret;
+}
+
+static void verify_worker(void)
+{
+    int i;
+
+    for (i = 0; i < VERIFICATIONS; i++)
+        if (!verify_ee(verify_store))
+            verify_success = 0;
+}
+
+/*
+ * Check that a read mostly store sees the certificates added after it
+ * became read mostly.
+ */
+static int test_read_mostly_update(void)
+{
+    X509_STORE *store = X509_STORE_new();
+    int testresult = 0;
+
+    if (!TEST_ptr(store)
+            || !TEST_true(X509_STORE_set_read_mostly(store, 1))
+            || !TEST_false(verify_ee(store))
+            || !TEST_true(X509_STORE_add_cert(store, root))
+            || !TEST_true(verify_ee(store))
+            || !TEST_true(X509_STORE_set_read_mostly(store, 0))
+            || !TEST_true(verify_ee(store)))
+        goto end;
+
+    testresult = 1;
+ end:
+    X509_STORE_free(store);
+    return testresult;
+}
+
+/*
+ * Check that the issuer is found in a read mostly store when it was added
+ * after the X509_STORE_CTX was initialised, although the snapshot of the
+ * X509_STORE_CTX has a certificate with the same name that is no issuer.
+ */
+static int test_read_mostly_new_issuer(void)
+{
+    X509_STORE *store = X509_STORE_new();
+    X509_STORE_CTX *ctx = X509_STORE_CTX_new();
+    X509 *issuer = NULL;
+    int testresult = 0;
+
+    if (!TEST_ptr(store)
+            || !TEST_ptr(ctx)
+            || !TEST_true(X509_STORE_add_cert(store, root2))
+            || !TEST_true(X509_STORE_set_read_mostly(store, 1))
+            || !TEST_true(X509_STORE_CTX_init(ctx, store, ca, NULL))
+            || !TEST_true(X509_STORE_add_cert(store, root))
+            || !TEST_int_eq(X509_STORE_CTX_get1_issuer(&issuer, ctx, ca), 1)
+            || !TEST_int_eq(X509_cmp(issuer, root), 0))
+        goto end;
+
+    testresult = 1;
+ end:
+    X509_free(issuer);
+    X509_STORE_CTX_free(ctx);
+    X509_STORE_free(store);
+    return testresult;
+}
+
+/*
+ * Test 0-2: ordinary store, with 1, 8 and 64 threads
+ * Test 3-5: read mostly store, with 1, 8 and 64 threads
+ * Test 6-8: read mostly store with a verification cache, with 1, 8 and 64
+ *           threads
+ */
+static int test_verify_mt(int idx)
+{
+    static const int nthreads[] = { 1, 8, 64 };
+    static const char *store_types[] = {
+        "ordinary", "read mostly", "read mostly cached"
+    };
+    int n = nthreads[idx % OSSL_NELEM(nthreads)];
+    int type = idx / OSSL_NELEM(nthreads);
+    thread_t threads[64];
+    double start, secs;
+    int i, started = 0, testresult = 0;
+
+    verify_success = 1;
+    if (!TEST_ptr(verify_store = X509_STORE_new())
+            || !TEST_true(X509_STORE_add_cert(verify_store, root))
+            || !TEST_true(X509_STORE_set_read_mostly(verify_store, type > 0))
+            || !TEST_true(X509_STORE_set_verify_cache(verify_store,
+                                                      type > 1 ? 16 : 0)))
+        goto end;
+
+    start = wall_time();
+    for (; started < n; started++)
+        if (!TEST_true(run_thread(&threads[started], verify_worker)))
+            break;
+    for (i = 0; i < started; i++)
+        if (!TEST_true(wait_for_thread(threads[i])))
+            verify_success = 0;
+    secs = wall_time() - start;
+
+    if (!TEST_int_eq(started, n) || !TEST_true(verify_success))
+        goto end;
+
+    TEST_info("%s store, %d threads: %.0f verifications per second",
+              store_types[type], n,
+              secs > 0 ? n * VERIFICATIONS / secs : 0.0);
+    testresult = 1;
+ end:
+    X509_STORE_free(verify_store);
+    verify_store = NULL;
+    return testresult;
+}
+
+OPT_TEST_DECLARE_USAGE("certsdir\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(certs_dir = test_get_argument(0))
+            || !TEST_ptr(root = load_cert("root-cert.pem"))
+            || !TEST_ptr(root2 = load_cert("root-cert2.pem"))
+            || !TEST_ptr(ca = load_cert("ca-cert.pem"))
+            || !TEST_ptr(ee = load_cert("ee-cert.pem"))
+            || !TEST_ptr(untrusted = sk_X509_new_null())
+            || !TEST_true(sk_X509_push(untrusted, ca)))
+        return 0;
+
+    ADD_TEST(test_read_mostly_update);
+    ADD_TEST(test_read_mostly_new_issuer);
+    ADD_ALL_TESTS(test_verify_mt, 9);
+    return 1;
+}
+
+void cleanup_tests(void)
+{
+    sk_X509_free(untrusted);
+    X509_free(root);
+    X509_free(root2);
+    X509_free(ca);
+    X509_free(ee);
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2018 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2021 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -14,8 +14,10 @@
 
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
+#include <openssl/provider.h>
 #include "testutil.h"
 #include "internal/nelem.h"
+#include "crypto/x509.h"
 
 /**********************************************************************
  *
@@ -48,8 +50,113 @@ static int test_standard_exts(void)
     return good;
 }
 
+/**********************************************************************
+ *
+ * Test of the interning of canonical X509_NAME encodings
+ *
+ ***/
+
+static X509_NAME *name_new(const char *cn, const char *o)
+{
+    X509_NAME *name = X509_NAME_new();
+
+    if (name == NULL
+            || !X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                           (const unsigned char *)cn, -1,
+                                           -1, 0)
+            || !X509_NAME_add_entry_by_txt(name, "O", MBSTRING_ASC,
+                                           (const unsigned char *)o, -1,
+                                           -1, 0)
+            || i2d_X509_NAME(name, NULL) <= 0) {
+        X509_NAME_free(name);
+        return NULL;
+    }
+    return name;
+}
+
+static int test_name_canon(void)
+{
+    X509_NAME *a = NULL, *b = NULL, *c = NULL, *dup = NULL;
+    X509_NAME *empty1 = NULL, *empty2 = NULL;
+    OSSL_LIB_CTX *libctx = NULL;
+    OSSL_PROVIDER *nullprov = NULL;
+    unsigned long hash;
+    int ok = 0, testresult = 0;
+
+    /* |a| and |b| only differ by case and spaces, so are equal */
+    if (!TEST_ptr(a = name_new("Foo  Bar", "Example"))
+            || !TEST_ptr(b = name_new(" foo bar", "EXAMPLE"))
+            || !TEST_ptr(c = name_new("Foo Bar", "Another example"))
+            || !TEST_ptr(dup = X509_NAME_dup(a))
+            || !TEST_ptr(a->canon)
+            || !TEST_ptr_eq(a->canon, b->canon)
+            || !TEST_ptr_eq(a->canon, dup->canon)
+            || !TEST_ptr_ne(a->canon, c->canon)
+            || !TEST_int_eq(X509_NAME_cmp(a, b), 0)
+            || !TEST_int_ne(X509_NAME_cmp(a, c), 0))
+        goto err;
+
+    /* The hash is computed once and shared */
+    hash = X509_NAME_hash_ex(a, NULL, NULL, &ok);
+    if (!TEST_true(ok)
+            || !TEST_ulong_eq(X509_NAME_hash_ex(b, NULL, NULL, &ok), hash)
+            || !TEST_true(ok)
+            || !TEST_ulong_ne(X509_NAME_hash_ex(c, NULL, NULL, &ok), hash))
+        goto err;
+
+    /* Freeing a name must not affect the others with the same encoding */
+    X509_NAME_free(a);
+    a = NULL;
+    if (!TEST_int_eq(X509_NAME_cmp(b, dup), 0)
+            || !TEST_ulong_eq(X509_NAME_hash_ex(dup, NULL, NULL, &ok), hash))
+        goto err;
+
+    /* A modified name gets a new encoding */
+    if (!TEST_true(X509_NAME_add_entry_by_txt(b, "OU", MBSTRING_ASC,
+                                              (const unsigned char *)"Unit",
+                                              -1, -1, 0))
+            || !TEST_int_ne(X509_NAME_cmp(b, dup), 0)
+            || !TEST_ptr_ne(b->canon, dup->canon)
+            || !TEST_ulong_ne(X509_NAME_hash_ex(b, NULL, NULL, &ok), hash)
+            || !TEST_ulong_eq(X509_NAME_hash_ex(dup, NULL, NULL, &ok), hash))
+        goto err;
+
+    /* The cached hash is not used for a library context without SHA1 */
+    if (!TEST_ptr(libctx = OSSL_LIB_CTX_new())
+            || !TEST_ptr(nullprov = OSSL_PROVIDER_load(libctx, "null")))
+        goto err;
+    ERR_set_mark();
+    (void)X509_NAME_hash_ex(dup, libctx, NULL, &ok);
+    ERR_pop_to_mark();
+    if (!TEST_false(ok)
+            || !TEST_ulong_eq(X509_NAME_hash_ex(dup, NULL, NULL, &ok), hash)
+            || !TEST_true(ok))
+        goto err;
+
+    /* Empty names have no encoding to share */
+    if (!TEST_ptr(empty1 = X509_NAME_new())
+            || !TEST_ptr(empty2 = X509_NAME_new())
+            || !TEST_int_eq(X509_NAME_cmp(empty1, empty2), 0)
+            || !TEST_ptr_null(empty1->canon)
+            || !TEST_int_ne(X509_NAME_cmp(empty1, dup), 0))
+        goto err;
+
+    testresult = 1;
+ err:
+    X509_NAME_free(a);
+    X509_NAME_free(b);
+    X509_NAME_free(c);
+    X509_NAME_free(dup);
+    X509_NAME_free(empty1);
+    X509_NAME_free(empty2);
+    OSSL_PROVIDER_unload(nullprov);
+    OSSL_LIB_CTX_free(libctx);
+    return testresult;
+}
+
 int setup_tests(void)
 {
     ADD_TEST(test_standard_exts);
+    ADD_TEST(test_name_canon);
     return 1;
 }